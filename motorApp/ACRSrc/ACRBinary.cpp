@@ -0,0 +1,190 @@
+/*
+FILENAME... ACRBinary.cpp
+USAGE...    Binary parameter access for the Parker ACR series of controllers.
+
+The ACR recognizes binary packets in the ASCII command stream by their 0x00 header byte.
+The input and output terminators of the asyn port are removed for the duration of a binary
+transaction, because the binary data can contain any byte value.
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <asynOctet.h>
+
+#include <epicsExport.h>
+#include "ACRBinary.h"
+
+static const char *driverName = "ACRBinary";
+
+/** Creates an empty block of parameters. */
+ACRBinaryBlock::ACRBinaryBlock()
+{
+  clear();
+}
+
+/** Removes all parameters from the block. */
+void ACRBinaryBlock::clear()
+{
+  numParams_ = 0;
+}
+
+/** Adds a parameter to the block.
+  * \param[in] parameter The P-parameter number, e.g. 12290
+  * \param[in] type ACRParamLong for a 32 bit integer, ACRParamIEEE for a 32 bit float
+  * \return The index of the parameter for getLong() and getDouble(), -1 if the block is full */
+int ACRBinaryBlock::add(int parameter, ACRParamType_t type)
+{
+  if (numParams_ >= ACR_BINARY_MAX_PARAMS) return -1;
+  params_[numParams_] = parameter;
+  types_[numParams_] = type;
+  values_[numParams_] = 0;
+  return numParams_++;
+}
+
+size_t ACRBinaryBlock::buildRequest(char *buffer)
+{
+  int i;
+  char *pos = buffer;
+
+  for (i=0; i<numParams_; i++) {
+    *pos++ = ACR_BINARY_HEADER;
+    *pos++ = (char) ((types_[i] == ACRParamIEEE) ? ACR_BINARY_GET_IEEE : ACR_BINARY_GET_LONG);
+    *pos++ = (char) (params_[i] & 0xff);
+    *pos++ = (char) ((params_[i] >> 8) & 0xff);
+  }
+  return pos - buffer;
+}
+
+asynStatus ACRBinaryBlock::parseReply(const unsigned char *buffer, size_t len)
+{
+  int i;
+  const unsigned char *pos = buffer;
+  unsigned char code;
+
+  if (len != (size_t) numParams_ * ACR_BINARY_REPLY_SIZE) return asynError;
+  for (i=0; i<numParams_; i++, pos += ACR_BINARY_REPLY_SIZE) {
+    code = (types_[i] == ACRParamIEEE) ? ACR_BINARY_GET_IEEE : ACR_BINARY_GET_LONG;
+    // Each reply repeats its request, which detects a lost or shifted reply
+    if ((pos[0] != ACR_BINARY_HEADER) || (pos[1] != code) ||
+        (pos[2] != (params_[i] & 0xff)) || (pos[3] != ((params_[i] >> 8) & 0xff))) return asynError;
+    values_[i] = (epicsInt32) ((epicsUInt32) pos[4] | ((epicsUInt32) pos[5] << 8) |
+                               ((epicsUInt32) pos[6] << 16) | ((epicsUInt32) pos[7] << 24));
+  }
+  return asynSuccess;
+}
+
+/** Reads all parameters of the block in one binary transaction.
+  * The asyn port is locked for the whole transaction and the asynOctet interface is called directly,
+  * because the pasynOctetSyncIO functions queue a request and would deadlock on the locked port.
+  * The terminators are restored afterwards, also when the transaction fails.
+  * \param[in] pasynUser asynUser connected to the ACR with pasynOctetSyncIO->connect()
+  * \param[in] timeout Timeout for the write and for each read */
+asynStatus ACRBinaryBlock::readParameters(asynUser *pasynUser, double timeout)
+{
+  char request[ACR_BINARY_MAX_PARAMS * ACR_BINARY_REQUEST_SIZE];
+  unsigned char reply[ACR_BINARY_MAX_PARAMS * ACR_BINARY_REPLY_SIZE];
+  char inputEos[10], outputEos[10];
+  int inputEosLen=0, outputEosLen=0;
+  size_t requestLen, replyLen, nwrite, nread, total=0;
+  int eomReason;
+  double savedTimeout;
+  asynInterface *pasynInterface;
+  asynOctet *pasynOctet;
+  void *octetPvt;
+  asynStatus status, eosStatus;
+  static const char *functionName = "readParameters";
+
+  if (numParams_ == 0) return asynSuccess;
+  requestLen = buildRequest(request);
+  replyLen = numParams_ * ACR_BINARY_REPLY_SIZE;
+
+  pasynInterface = pasynManager->findInterface(pasynUser, asynOctetType, 1);
+  if (!pasynInterface) {
+    asynPrint(pasynUser, ASYN_TRACE_ERROR,
+      "%s:%s: port does not have an asynOctet interface\n",
+      driverName, functionName);
+    return asynError;
+  }
+  pasynOctet = (asynOctet *)pasynInterface->pinterface;
+  octetPvt = pasynInterface->drvPvt;
+
+  status = pasynManager->lockPort(pasynUser);
+  if (status) {
+    asynPrint(pasynUser, ASYN_TRACE_ERROR,
+      "%s:%s: error locking port, status=%d\n",
+      driverName, functionName, status);
+    return status;
+  }
+  savedTimeout = pasynUser->timeout;
+  pasynUser->timeout = timeout;
+
+  status = pasynOctet->getInputEos(octetPvt, pasynUser, inputEos, sizeof(inputEos), &inputEosLen);
+  if (status == asynSuccess)
+    status = pasynOctet->getOutputEos(octetPvt, pasynUser, outputEos, sizeof(outputEos), &outputEosLen);
+  if (status) goto unlock;
+  status = pasynOctet->setInputEos(octetPvt, pasynUser, "", 0);
+  if (status) goto unlock;
+  status = pasynOctet->setOutputEos(octetPvt, pasynUser, "", 0);
+  if (status) goto restoreInput;
+
+  pasynOctet->flush(octetPvt, pasynUser);
+  status = pasynOctet->write(octetPvt, pasynUser, request, requestLen, &nwrite);
+  if ((status == asynSuccess) && (nwrite != requestLen)) status = asynError;
+  // Without a terminator a read returns whatever has arrived, read until the block is complete
+  while ((status == asynSuccess) && (total < replyLen)) {
+    nread = 0;
+    status = pasynOctet->read(octetPvt, pasynUser, (char *)reply + total, replyLen - total,
+                              &nread, &eomReason);
+    total += nread;
+  }
+
+  eosStatus = pasynOctet->setOutputEos(octetPvt, pasynUser, outputEos, outputEosLen);
+  if (eosStatus) {
+    asynPrint(pasynUser, ASYN_TRACE_ERROR,
+      "%s:%s: error restoring the output terminator, status=%d\n",
+      driverName, functionName, eosStatus);
+  }
+restoreInput:
+  eosStatus = pasynOctet->setInputEos(octetPvt, pasynUser, inputEos, inputEosLen);
+  if (eosStatus) {
+    asynPrint(pasynUser, ASYN_TRACE_ERROR,
+      "%s:%s: error restoring the input terminator, status=%d\n",
+      driverName, functionName, eosStatus);
+  }
+unlock:
+  pasynUser->timeout = savedTimeout;
+  pasynManager->unlockPort(pasynUser);
+
+  if (status == asynSuccess) status = parseReply(reply, total);
+  if (status) {
+    asynPrint(pasynUser, ASYN_TRACE_ERROR,
+      "%s:%s: error reading %d parameters, status=%d, received %d of %d bytes\n",
+      driverName, functionName, numParams_, status, (int)total, (int)replyLen);
+  }
+  return status;
+}
+
+/** Returns a parameter read as ACRParamLong.
+  * \param[in] index The index returned by add() */
+epicsInt32 ACRBinaryBlock::getLong(int index)
+{
+  if ((index < 0) || (index >= numParams_)) return 0;
+  return values_[index];
+}
+
+/** Returns a parameter read as ACRParamIEEE, or a long parameter converted to double.
+  * \param[in] index The index returned by add() */
+double ACRBinaryBlock::getDouble(int index)
+{
+  union {
+    epicsInt32 i;
+    epicsFloat32 f;
+  } value;
+
+  if ((index < 0) || (index >= numParams_)) return 0.;
+  if (types_[index] == ACRParamLong) return values_[index];
+  value.i = values_[index];
+  return value.f;
+}
@@ -0,0 +1,49 @@
+/*
+FILENAME...   ACRBinary.h
+USAGE...      Binary parameter access for the Parker ACR series of controllers.
+
+*/
+
+#ifndef ACRBinary_H
+#define ACRBinary_H
+
+#include <epicsTypes.h>
+#include <asynDriver.h>
+
+/* A binary get parameter request is 4 bytes: the header 0x00, the get code and the parameter number LSB first.
+ * The reply repeats the 4 request bytes, followed by the 4 byte value LSB first. */
+#define ACR_BINARY_HEADER       0x00
+#define ACR_BINARY_GET_LONG     0x88
+#define ACR_BINARY_GET_IEEE     0x89
+#define ACR_BINARY_REQUEST_SIZE 4
+#define ACR_BINARY_REPLY_SIZE   8
+#define ACR_BINARY_MAX_PARAMS   64
+
+typedef enum {
+  ACRParamLong,
+  ACRParamIEEE
+} ACRParamType_t;
+
+/** A block of P-parameters that is read with one binary request.
+  * The get packets of all parameters are written in one write and the replies read back as one block,
+  * so reading a block costs one round trip instead of one ASCII query per parameter. */
+class epicsShareClass ACRBinaryBlock {
+public:
+  ACRBinaryBlock();
+  void clear();
+  int add(int parameter, ACRParamType_t type);
+  asynStatus readParameters(asynUser *pasynUser, double timeout);
+  epicsInt32 getLong(int index);
+  double getDouble(int index);
+  int numParams() { return numParams_; }
+
+private:
+  size_t buildRequest(char *buffer);
+  asynStatus parseReply(const unsigned char *buffer, size_t len);
+  int numParams_;
+  int params_[ACR_BINARY_MAX_PARAMS];
+  ACRParamType_t types_[ACR_BINARY_MAX_PARAMS];
+  epicsInt32 values_[ACR_BINARY_MAX_PARAMS];
+};
+
+#endif /* ACRBinary_H */
@@ -49,6 +49,10 @@ ACRController::ACRController(const char *portName, const char *ACRPortName, int
 
   binaryInReg_  = 4096;
   binaryOutReg_ = 4097;
+  binaryAccess_ = true;
+  binaryValid_  = false;
+  binaryPolls_  = 0;
+  binaryErrors_ = 0;
   
   // Create controller-specific parameters
   createParam(ACRJerkString,         asynParamFloat64,       &ACRJerk_);
@@ -70,7 +74,7 @@ ACRController::ACRController(const char *portName, const char *ACRPortName, int
   // Wait a short while so that any responses to the above commands have time to arrive so we can flush
   // them in the next writeReadController()
   epicsThreadSleep(0.5);
-  // Read the binary I/O registers once
+  // Read the binary I/O registers once, this also tells whether the controller supports binary parameter access
   readBinaryIO();
   // Set the output=output readback so bi records reflect current state
   setUIntDigitalParam(0, ACRBinaryOut_, binaryOutRBV_, 0xFFFFFFFF);
@@ -113,6 +117,8 @@ void ACRController::report(FILE *fp, int level)
   if (level > 0) {
     fprintf(fp, "  binary input = 0x%x\n", binaryIn_);
     fprintf(fp, "  binary output readback = 0x%x\n", binaryOutRBV_);
+    fprintf(fp, "  binary parameter access=%s, poll blocks=%lu, errors=%lu\n",
+            binaryAccess_ ? "yes" : "no", binaryPolls_, binaryErrors_);
   }
 
 
@@ -250,10 +256,34 @@ asynStatus ACRController::writeUInt32Digital(asynUser *pasynUser, epicsUInt32 va
 /** Reads the binary input and binary output registers on the ACR.
   * Sets the values in the parameter library.
   * Keeps track of which bits have changed.
-  * Calls any registered callbacks for this pasynUser->reason and address. */ 
+  * Calls any registered callbacks for this pasynUser->reason and address. 
+  * Both registers are read with one binary request.  If the first binary request fails the controller
+  * is assumed not to support binary parameter access, and it is polled with ASCII queries from then on. */ 
 asynStatus ACRController::readBinaryIO()
 {
   asynStatus status;
+  ACRBinaryBlock block;
+  static const char *functionName = "readBinaryIO";
+
+  if (binaryAccess_) {
+    block.add(binaryInReg_, ACRParamLong);
+    block.add(binaryOutReg_, ACRParamLong);
+    status = block.readParameters(pasynUserController_, DEFAULT_CONTROLLER_TIMEOUT);
+    if (!status) {
+      binaryIn_ = block.getLong(0);
+      setUIntDigitalParam(0, ACRBinaryIn_, binaryIn_, 0xFFFFFFFF);
+      binaryOutRBV_ = block.getLong(1);
+      setUIntDigitalParam(0, ACRBinaryOutRBV_, binaryOutRBV_, 0xFFFFFFFF);
+      callParamCallbacks(0);
+      return status;
+    }
+    if (binaryPolls_ == 0) {
+      asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+        "%s:%s: no reply to binary parameter access, using ASCII queries\n",
+        driverName, functionName);
+      binaryAccess_ = false;
+    }
+  }
 
   // Read the binary inputs
   sprintf(outString_, "?P%d", binaryInReg_);
@@ -274,6 +304,34 @@ asynStatus ACRController::readBinaryIO()
   return status;
 }
 
+/** Polls the controller once per poll cycle, before the axes are polled.
+  * Reads the encoder position, theoretical position, flags and limits of all axes with one binary request.
+  * If the request fails the axes read their registers with ASCII queries in this cycle. */
+asynStatus ACRController::poll()
+{
+  int axis;
+  ACRAxis *pAxis;
+  asynStatus status;
+
+  binaryValid_ = false;
+  if (!binaryAccess_) return asynSuccess;
+
+  pollBlock_.clear();
+  for (axis=0; axis<numAxes_; axis++) {
+    pAxis = getAxis(axis);
+    if (!pAxis) continue;
+    pAxis->binaryIndex_ = pollBlock_.add(pAxis->encoderPositionReg_, ACRParamIEEE);
+    pollBlock_.add(pAxis->theoryPositionReg_, ACRParamIEEE);
+    pollBlock_.add(pAxis->flagsReg_,          ACRParamLong);
+    pollBlock_.add(pAxis->limitsReg_,         ACRParamLong);
+  }
+  status = pollBlock_.readParameters(pasynUserController_, DEFAULT_CONTROLLER_TIMEOUT);
+  binaryPolls_++;
+  if (status) binaryErrors_++;
+  else binaryValid_ = true;
+  return status;
+}
+
 // These are the ACRAxis methods
 
 /** Creates a new ACRAxis object.
@@ -293,6 +351,7 @@ ACRAxis::ACRAxis(ACRController *pC, int axisNo)
   theoryPositionReg_  = 12294 + 256*axisNo;
   limitsReg_          = 4600  + axisNo;
   flagsReg_           = 4120  + axisNo;
+  binaryIndex_        = -1;
   // Get the number of pulses per unit on this axis
   sprintf(pC->outString_, "%s PPU", axisName_);
   status = pC->writeReadController();
@@ -429,36 +488,47 @@ asynStatus ACRAxis::poll(bool *moving)
   int done;
   int driveOn;
   int limit;
+  int encoderCmd=-1, theoryCmd=-1, flagsCmd=-1, limitsCmd=-1, driveCmd;
+  bool binary = pC_->binaryValid_ && (binaryIndex_ >= 0);
+  asynMotorBurst burst;
   asynStatus comStatus;
 
-  // Read the current encoder position
-  sprintf(pC_->outString_, "?P%d", encoderPositionReg_);
-  comStatus = pC_->writeReadController();
+  // The controller has read the positions, flags and limits of all axes in one binary block.
+  // Otherwise read them here in one burst together with the drive power status.
+  if (!binary) {
+    encoderCmd = burst.add("?P%d", encoderPositionReg_);
+    theoryCmd  = burst.add("?P%d", theoryPositionReg_);
+    flagsCmd   = burst.add("?P%d", flagsReg_);
+    limitsCmd  = burst.add("?P%d", limitsReg_);
+  }
+  driveCmd = burst.add("DRIVE %s", axisName_);
+  comStatus = pC_->writeReadBurst(&burst);
   if (comStatus) goto skip;
-  encoderPosition_ = atof(pC_->inString_);
+
+  if (binary) {
+    encoderPosition_ = pC_->pollBlock_.getDouble(binaryIndex_);
+    theoryPosition_  = pC_->pollBlock_.getDouble(binaryIndex_ + 1);
+    currentFlags_    = pC_->pollBlock_.getLong(binaryIndex_ + 2);
+    currentLimits_   = pC_->pollBlock_.getLong(binaryIndex_ + 3);
+  } else {
+    encoderPosition_ = atof(burst.reply(encoderCmd));
+    theoryPosition_  = atof(burst.reply(theoryCmd));
+    currentFlags_    = atoi(burst.reply(flagsCmd));
+    currentLimits_   = atoi(burst.reply(limitsCmd));
+  }
+
+  // The current encoder position
   setDoubleParam(pC_->motorEncoderPosition_,encoderPosition_);
 
-  // Read the current theoretical position
-  sprintf(pC_->outString_, "?P%d", theoryPositionReg_);
-  comStatus = pC_->writeReadController();
-  if (comStatus) goto skip;
-  theoryPosition_ = atof(pC_->inString_);
+  // The current theoretical position
   setDoubleParam(pC_->motorPosition_, theoryPosition_);
 
-  // Read the current flags
-  sprintf(pC_->outString_, "?P%d", flagsReg_);
-  comStatus = pC_->writeReadController();
-  if (comStatus) goto skip;
-  currentFlags_ = atoi(pC_->inString_);
+  // The current flags
   done = (currentFlags_ & 0x1000000)?0:1;
   setIntegerParam(pC_->motorStatusDone_, done);
   *moving = done ? false:true;
 
-  // Read the current limit status
-  sprintf(pC_->outString_, "?P%d", limitsReg_);
-  comStatus = pC_->writeReadController();
-  if (comStatus) goto skip;
-  currentLimits_ = atoi(pC_->inString_);
+  // The current limit status
   limit = (currentLimits_ & 0x1)?1:0;
   setIntegerParam(pC_->motorStatusHighLimit_, limit);
   limit = (currentLimits_ & 0x2)?1:0;
@@ -466,11 +536,8 @@ asynStatus ACRAxis::poll(bool *moving)
   limit = (currentLimits_ & 0x4)?1:0;
   setIntegerParam(pC_->motorStatusAtHome_, limit);
 
-  // Read the drive power on status
-  sprintf(pC_->outString_, "DRIVE %s", axisName_);
-  comStatus = pC_->writeReadController();
-  if (comStatus) goto skip;
-  driveOn = strstr(pC_->inString_, "ON") ? 1:0;
+  // The drive power on status
+  driveOn = strstr(burst.reply(driveCmd), "ON") ? 1:0;
   setIntegerParam(pC_->motorStatusPowerOn_, driveOn);
   setIntegerParam(pC_->motorStatusProblem_, 0);
 
@@ -9,6 +9,7 @@ March 28, 2011
 
 #include "asynMotorController.h"
 #include "asynMotorAxis.h"
+#include "ACRBinary.h"
 
 /** drvInfo strings for extra parameters that the ACR controller supports */
 #define ACRJerkString           "ACR_JERK"
@@ -44,6 +45,7 @@ private:
   double theoryPosition_;  /**< Cached copy of the theoretical position */ 
   int currentFlags_;       /**< Cached copy of the current flags */ 
   int currentLimits_;      /**< Cached copy of the current limits */ 
+  int binaryIndex_;        /**< Index of the encoder position in the binary poll block, -1 if not in the block */
   
 friend class ACRController;
 };
@@ -61,6 +63,7 @@ public:
   void report(FILE *fp, int level);
   ACRAxis* getAxis(asynUser *pasynUser);
   ACRAxis* getAxis(int axisNo);
+  asynStatus poll();
 
   
   /* These are the methods that are new to this class */
@@ -82,6 +85,11 @@ private:
   int binaryOutRBV_;
   int binaryInReg_;
   int binaryOutReg_;
+  bool binaryAccess_;         /**< The controller answers binary parameter requests */
+  bool binaryValid_;          /**< pollBlock_ holds the values of the current poll cycle */
+  ACRBinaryBlock pollBlock_;  /**< Positions, flags and limits of all axes */
+  unsigned long binaryPolls_; /**< Number of binary poll blocks read */
+  unsigned long binaryErrors_;/**< Number of binary poll blocks that failed */
   
 friend class ACRAxis;
 };
@@ -0,0 +1,656 @@
+/*
+FILENAME... A3200Driver.cpp
+USAGE...    asynMotorController driver for the Aerotech A3200.
+
+This driver replaces the motor_interface driver in drvA3200Asyn.cc, which is kept for
+existing IOCs.  Commands are sent to task 2, which runs in queue mode, immediate commands
+to task 3.  The poller reads the status, fault and positions of up to A3200_STATUS_AXES axes
+with one multi-item ~STATUS query.
+
+Profile moves are streamed into the queue of task 2 as PVT commands, a batch per poll while
+the queue is not full.
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <iocsh.h>
+#include <epicsThread.h>
+
+#include <asynOctetSyncIO.h>
+
+#include <epicsExport.h>
+#include "A3200Driver.h"
+
+/* NOTE: The following two files are copied from the A3200 C library include files.
+* If changing the driver to target a different version of the A3200, copy the following two files from that version's C library include files */
+#include "A3200CommonStructures.h"
+#include "A3200ParameterId.h"
+
+static const char *driverName = "A3200Driver";
+
+/** Creates a new A3200Controller object.
+  * \param[in] portName          The name of the asyn port that will be created for this driver
+  * \param[in] asynPortName      The name of the drvAsynIPPort that was created previously
+  * \param[in] numAxes           The number of axes that this controller supports
+  * \param[in] movingPollPeriod  The time between polls when any axis is moving
+  * \param[in] idlePollPeriod    The time between polls when no axis is moving
+  */
+A3200Controller::A3200Controller(const char *portName, const char *asynPortName, int numAxes,
+                                 double movingPollPeriod, double idlePollPeriod)
+  :  AerotechController(portName, asynPortName, numAxes, 0),
+     queueStatusValid_(false),
+     queueStatus_(0),
+     nextPvtPoint_(0)
+{
+  int axis;
+  int retry;
+  asynStatus status;
+  static const char *functionName = "A3200Controller";
+
+  for (retry=0; retry<AEROTECH_RETRIES; retry++) {
+    status = sendAndReceive("~TASK 2", inString_, sizeof(inString_));
+    if (status == asynSuccess) break;
+  }
+  if (status || (inString_[0] != ASCII_ACK_CHAR)) {
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+      "%s:%s: no response from A3200 on port %s\n",
+      driverName, functionName, asynPortName);
+    return;
+  }
+  // Reset the task
+  sendAndReceive("~STOPTASK", inString_, sizeof(inString_));
+
+  for (axis=0; axis<numAxes; axis++) {
+    new A3200Axis(this, axis);
+  }
+
+  sendAndReceive("~INITQUEUE", inString_, sizeof(inString_));
+
+  // Prevent task 2 and 3 from blocking during motion commands
+  sendAndReceive("WAIT MODE AUTO", inString_, sizeof(inString_));
+  sendAndReceive("~TASK 3", inString_, sizeof(inString_));
+  sendAndReceive("WAIT MODE AUTO", inString_, sizeof(inString_));
+  sendAndReceive("~TASK 2", inString_, sizeof(inString_));
+
+  startPoller(movingPollPeriod, idlePollPeriod, 2);
+}
+
+
+/** Creates a new A3200Controller object.
+  * Configuration command, called directly or from iocsh
+  * \param[in] portName          The name of the asyn port that will be created for this driver
+  * \param[in] asynPortName      The name of the drvAsynIPPort that was created previously
+  * \param[in] numAxes           The number of axes that this controller supports
+  * \param[in] movingPollPeriod  The time in ms between polls when any axis is moving
+  * \param[in] idlePollPeriod    The time in ms between polls when no axis is moving
+  */
+extern "C" int A3200CreateController(const char *portName, const char *asynPortName, int numAxes,
+                                     int movingPollPeriod, int idlePollPeriod)
+{
+  if ((numAxes < 1) || (numAxes > A3200_MAX_AXES)) {
+    printf("%s:A3200CreateController: numAxes must be in range 1 to %d\n", driverName, A3200_MAX_AXES);
+    return asynError;
+  }
+  new A3200Controller(portName, asynPortName, numAxes, movingPollPeriod/1000., idlePollPeriod/1000.);
+  return asynSuccess;
+}
+
+/** Allocates the profile move arrays of an A3200 controller.
+  * Configuration command, called directly or from iocsh
+  * \param[in] portName   The name of the asyn port of the controller
+  * \param[in] maxPoints  The maximum number of profile points
+  */
+extern "C" int A3200CreateProfile(const char *portName, int maxPoints)
+{
+  A3200Controller *pC;
+  static const char *functionName = "A3200CreateProfile";
+
+  pC = (A3200Controller*) findAsynPortDriver(portName);
+  if (!pC) {
+    printf("%s:%s: Error port %s not found\n",
+           driverName, functionName, portName);
+    return asynError;
+  }
+  pC->lock();
+  pC->initializeProfile(maxPoints);
+  pC->unlock();
+  return asynSuccess;
+}
+
+/** Reports on status of the driver
+  * \param[in] fp The file pointer on which report information will be written
+  * \param[in] level The level of report detail desired
+  *
+  * If details > 0 then information is printed about each axis.
+  * After printing controller-specific information calls asynMotorController::report()
+  */
+void A3200Controller::report(FILE *fp, int level)
+{
+  fprintf(fp, "A3200 motor driver %s, numAxes=%d, moving poll period=%f, idle poll period=%f\n",
+    this->portName, numAxes_, movingPollPeriod_, idlePollPeriod_);
+  fprintf(fp, "  max. profile points=%d, queue status=0x%x\n", (int)maxProfilePoints_, queueStatus_);
+
+  // Call the base class method
+  asynMotorController::report(fp, level);
+}
+
+/** Returns a pointer to an A3200Axis object.
+  * Returns NULL if the axis number encoded in pasynUser is invalid.
+  * \param[in] pasynUser asynUser structure that encodes the axis index number. */
+A3200Axis* A3200Controller::getAxis(asynUser *pasynUser)
+{
+  return static_cast<A3200Axis*>(asynMotorController::getAxis(pasynUser));
+}
+
+/** Returns a pointer to an A3200Axis object.
+  * Returns NULL if the axis number is invalid.
+  * \param[in] axisNo Axis index number. */
+A3200Axis* A3200Controller::getAxis(int axisNo)
+{
+  return static_cast<A3200Axis*>(asynMotorController::getAxis(axisNo));
+}
+
+/** Polls the controller.
+  * Reads the status, fault and positions of A3200_STATUS_AXES axes with each ~STATUS query,
+  * and the queue status of task 2 while a profile is active.
+  * The axes publish the values in A3200Axis::poll(), which the poller calls after this function. */
+asynStatus A3200Controller::poll()
+{
+  A3200Axis *pAxis;
+  int first, last, axis;
+  int executeState;
+  bool readQueue, statusOK;
+  double axisFault;
+  char *pos;
+  int numItems;
+  asynStatus status, pollStatus = asynSuccess;
+  static const char *functionName = "poll";
+
+  getIntegerParam(profileExecuteState_, &executeState);
+  queueStatusValid_ = false;
+  for (first=0; first<numAxes_; first=last) {
+    pos = outputBuff_ + sprintf(outputBuff_, "~STATUS");
+    numItems = 0;
+    for (last=first; (last<numAxes_) && (last<first+A3200_STATUS_AXES); last++) {
+      pAxis = getAxis(last);
+      // An axis whose name could not be read is not polled
+      if (!pAxis || !pAxis->axisName_[0]) continue;
+      numItems++;
+      pos += sprintf(pos, " (%s, AxisStatus) (%s, DriveStatus) (%s, AxisFault)"
+                          " (%s, ProgramPositionFeedback) (%s, ProgramPositionCommand)",
+                     pAxis->axisName_, pAxis->axisName_, pAxis->axisName_, pAxis->axisName_, pAxis->axisName_);
+    }
+    readQueue = (last == numAxes_) && (executeState != PROFILE_EXECUTE_DONE);
+    if (readQueue) {
+      strcpy(pos, " (2, QueueStatus)");
+      numItems++;
+    }
+    // A batch without any items is not sent, the axes in it stay invalid
+    statusOK = false;
+    if (numItems > 0) {
+      status = sendAndReceive(outputBuff_, inputBuff_, sizeof(inputBuff_));
+      if ((status == asynSuccess) && (inputBuff_[0] != ASCII_ACK_CHAR)) status = asynError;
+      if (status && (pollStatus == asynSuccess)) pollStatus = status;
+      statusOK = (status == asynSuccess);
+    }
+
+    // The reply is the values of the items separated by blanks
+    pos = inputBuff_ + 1;
+    for (axis=first; axis<last; axis++) {
+      pAxis = getAxis(axis);
+      if (!pAxis) continue;
+      pAxis->statusValid_ = statusOK && pAxis->axisName_[0];
+      if (!pAxis->statusValid_) continue;
+      pAxis->axisStatus_ = (epicsUInt32) strtod(pos, &pos);
+      pAxis->driveStatus_ = (epicsUInt32) strtod(pos, &pos);
+      axisFault = strtod(pos, &pos);
+      pAxis->encoderPos_ = strtod(pos, &pos) / fabs(pAxis->stepSize_);
+      pAxis->currentCmdPos_ = strtod(pos, &pos) / fabs(pAxis->stepSize_);
+      // A fault is kept until it is acknowledged by A3200Axis::setClosedLoop()
+      if (axisFault && (axisFault != pAxis->lastFault_)) {
+        asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+          "%s:%s: controller fault on axis=%s fault=0x%X\n",
+          driverName, functionName, pAxis->axisName_, (int)axisFault);
+        pAxis->lastFault_ = (int)axisFault;
+      }
+      pAxis->moving_ = !(pAxis->axisStatus_ & AXISSTATUS_MoveDone);
+    }
+    if (readQueue && statusOK) {
+      queueStatus_ = (epicsUInt32) strtod(pos, &pos);
+      queueStatusValid_ = true;
+    }
+  }
+
+  pollProfile();
+  return pollStatus;
+}
+
+
+/* These are the functions for profile moves */
+
+/** Checks that the PVT command of the profile axes fits into one command.
+  * \param[in] numProfileAxes The number of axes in the profile
+  * \param[in] numPoints The number of profile points
+  * \param[out] message The error message */
+asynStatus A3200Controller::checkProfile(int numProfileAxes, int numPoints, char *message)
+{
+  if (numProfileAxes > A3200_MAX_PROFILE_AXES) {
+    sprintf(message, "Too many axes in profile, maximum is %d", A3200_MAX_PROFILE_AXES);
+    return asynError;
+  }
+  return asynSuccess;
+}
+
+/** The profile is streamed while it executes, there is nothing to load in advance.
+  * \param[out] message The error message */
+asynStatus A3200Controller::loadProfile(char *message)
+{
+  nextPvtPoint_ = 0;
+  return asynSuccess;
+}
+
+/** Sets task 2 up for PVT motion and queues the first batch of PVT points.
+  * \param[out] message The error message */
+asynStatus A3200Controller::startProfile(char *message)
+{
+  asynStatus status;
+
+  if (!queueStatusValid_ || !(queueStatus_ & QUEUESTATUS_QueueModeActive)) {
+    sendAndReceive("~INITQUEUE", inString_, sizeof(inString_));
+  }
+  status = sendAndReceive("VELOCITY ON", inString_, sizeof(inString_));
+  if (status == asynSuccess) status = sendAndReceive("PVT INIT TIME INC", inString_, sizeof(inString_));
+  if (status || (inString_[0] != ASCII_ACK_CHAR)) {
+    sprintf(message, "Error initializing PVT motion in task 2");
+    return asynError;
+  }
+  nextPvtPoint_ = 0;
+  return queueProfilePoints(message);
+}
+
+/** Queues the next batch of PVT points in task 2.
+  * Velocity blending is switched off before the last profile point, so that the deceleration
+  * point ends at rest.
+  * \param[out] message The error message */
+asynStatus A3200Controller::queueProfilePoints(char *message)
+{
+  MotorBurstCommand commands[A3200_PROFILE_BATCH+1];
+  A3200Axis *pAxis;
+  int numCommands = 0;
+  int numPoints = 0;
+  int i, j;
+  char *pos;
+  asynStatus status;
+
+  while ((numPoints < A3200_PROFILE_BATCH) && (nextPvtPoint_ <= numProfilePoints_)) {
+    if (nextPvtPoint_ == numProfilePoints_-1) strcpy(pvtCommands_[numCommands++], "VELOCITY OFF");
+    pos = pvtCommands_[numCommands++];
+    pos += sprintf(pos, "PVT");
+    for (j=0; j<numProfileAxes_; j++) {
+      pAxis = getAxis(profileAxes_[j]);
+      pos += sprintf(pos, " %s %.*f, %.*f", pAxis->axisName_,
+                     pAxis->maxDigits_, profilePosition(pAxis, nextPvtPoint_),
+                     pAxis->maxDigits_, profileVelocity(pAxis, nextPvtPoint_));
+    }
+    sprintf(pos, " TIME %.6f", profileDuration(nextPvtPoint_));
+    nextPvtPoint_++;
+    numPoints++;
+  }
+  for (i=0; i<numCommands; i++) {
+    commands[i].output = pvtCommands_[i];
+    commands[i].input = pvtReplies_[i];
+    commands[i].maxInput = sizeof(pvtReplies_[i]);
+  }
+  status = writeReadBurst(commands, numCommands, AEROTECH_TIMEOUT);
+  for (i=0; (status == asynSuccess) && (i<numCommands); i++) {
+    if (pvtReplies_[i][0] != ASCII_ACK_CHAR) status = asynError;
+  }
+  if (status) {
+    sprintf(message, "Error queueing PVT point %d", nextPvtPoint_);
+  }
+  return status;
+}
+
+/** Queues PVT points while the queue of task 2 has room and checks whether the profile is done.
+  * The profile is done when all points were queued, the queue is empty and the axes have stopped.
+  * \param[out] running true while the profile is running
+  * \param[out] message The error message */
+asynStatus A3200Controller::runningProfile(bool *running, char *message)
+{
+  int j;
+
+  *running = true;
+  // Wait for a poll that read the queue status
+  if (!queueStatusValid_) return asynSuccess;
+  if (!(queueStatus_ & QUEUESTATUS_QueueModeActive)) {
+    sprintf(message, "Task 2 left queue mode");
+    return asynError;
+  }
+  if (nextPvtPoint_ <= numProfilePoints_) {
+    if (queueStatus_ & QUEUESTATUS_QueueBufferFull) return asynSuccess;
+    return queueProfilePoints(message);
+  }
+  if (!(queueStatus_ & QUEUESTATUS_QueueBufferEmpty)) return asynSuccess;
+  for (j=0; j<numProfileAxes_; j++) {
+    if (getAxis(profileAxes_[j])->moving_) return asynSuccess;
+  }
+  *running = false;
+  return asynSuccess;
+}
+
+/** Stops the axes of the profile from task 3 and clears the queue of task 2. */
+asynStatus A3200Controller::stopProfile()
+{
+  A3200Axis *pAxis;
+  char *pos;
+  int j;
+  asynStatus status;
+
+  pos = outString_ + sprintf(outString_, "ABORT");
+  for (j=0; j<numProfileAxes_; j++) {
+    pAxis = getAxis(profileAxes_[j]);
+    pos += sprintf(pos, " %s", pAxis->axisName_);
+  }
+  sendAndReceive("~TASK 3", inString_, sizeof(inString_));
+  status = sendAndReceive(outString_, inString_, sizeof(inString_));
+  sendAndReceive("~TASK 2", inString_, sizeof(inString_));
+  sendAndReceive("~INITQUEUE", inString_, sizeof(inString_));
+  sendAndReceive("VELOCITY OFF", inString_, sizeof(inString_));
+  nextPvtPoint_ = numProfilePoints_ + 1;
+  return status;
+}
+
+
+// These are the A3200Axis methods
+
+/** Creates a new A3200Axis object.
+  * Reads the name and configuration of the axis from the controller.
+  * \param[in] pC Pointer to the A3200Controller to which this axis belongs.
+  * \param[in] axisNo Index number of this axis, range 0 to pC->numAxes_-1.
+  */
+A3200Axis::A3200Axis(A3200Controller *pC, int axisNo)
+  : AerotechAxis(pC, axisNo),
+    pC_(pC),
+    limitSetup_(0),
+    axisStatus_(0),
+    driveStatus_(0)
+{
+  int digits;
+
+  sprintf(pC_->outString_, "$strtask0 = GETPARMSTRING %d, PARAMETERID_AxisName", axisNo);
+  pC_->sendAndReceive(pC_->outString_, pC_->inString_, sizeof(pC_->inString_));
+  pC_->sendAndReceive("~GETVARIABLE $strtask0", pC_->inString_, sizeof(pC_->inString_));
+  if (pC_->inString_[0] != ASCII_ACK_CHAR) {
+    // Signal "Controller Error" to the user
+    setIntegerParam(pC_->motorStatusProblem_, 1);
+    return;
+  }
+  strncpy(axisName_, &pC_->inString_[1], sizeof(axisName_) - 1);
+
+  if (getParameter("PositionFeedbackType") && (atoi(&pC_->inString_[1]) > 0)) {
+    setIntegerParam(pC_->motorStatusHasEncoder_, 1);
+  }
+  if (getParameter("CountsPerUnit")) stepSize_ = 1. / atof(&pC_->inString_[1]);
+  digits = (int) -log10(fabs(stepSize_)) + 2;
+  maxDigits_ = digits < 1 ? 1 : digits;
+
+  if (getParameter("HomeOffset")) homePreset_ = atof(&pC_->inString_[1]);
+  if (getParameter("HomeSetup")) homeDirection_ = atoi(&pC_->inString_[1]) & 0x1;
+  if (getParameter("EndOfTravelLimitSetup")) limitSetup_ = atoi(&pC_->inString_[1]);
+  if (getParameter("ReverseMotionDirection")) reverseDirec_ = atoi(&pC_->inString_[1]) ? true : false;
+
+  sprintf(pC_->outString_, "RAMP MODE RATE %s", axisName_);
+  pC_->sendAndReceive(pC_->outString_, pC_->inString_, sizeof(pC_->inString_));
+
+  // Set GAIN_SUPPORT on so that at least, CNEN functions
+  setIntegerParam(pC_->motorStatusGainSupport_, 1);
+}
+
+/** Reads a parameter of the axis into pC_->inString_.
+  * \param[in] name The name of the parameter, e.g. "CountsPerUnit"
+  * \return true if the controller acknowledged the query */
+bool A3200Axis::getParameter(const char *name)
+{
+  sprintf(pC_->outString_, "%s.%s", name, axisName_);
+  pC_->sendAndReceive(pC_->outString_, pC_->inString_, sizeof(pC_->inString_));
+  return (pC_->inString_[0] == ASCII_ACK_CHAR);
+}
+
+/** Reports on status of the axis
+  * \param[in] fp The file pointer on which report information will be written
+  * \param[in] level The level of report detail desired
+  *
+  * After printing device-specific information calls asynMotorAxis::report()
+  */
+void A3200Axis::report(FILE *fp, int level)
+{
+  if (level > 0) {
+    fprintf(fp, "  axis %d\n"
+                "    name %s\n"
+                "    step size %g\n"
+                "    max digits %d\n"
+                "    reverse direction %d\n"
+                "    axis status 0x%x\n"
+                "    drive status 0x%x\n"
+                "    last fault 0x%x\n",
+            axisNo_, axisName_, stepSize_, maxDigits_, reverseDirec_,
+            axisStatus_, driveStatus_, lastFault_);
+  }
+
+  // Call the base class method
+  asynMotorAxis::report(fp, level);
+}
+
+asynStatus A3200Axis::move(double position, int relative, double minVelocity, double maxVelocity, double acceleration)
+{
+  int taskError;
+  asynStatus status;
+
+  if (acceleration > 0) { /* only use the acceleration if > 0 */
+    sprintf(pC_->outString_, "RAMP RATE %s %.*f", axisName_, maxDigits_, acceleration * fabs(stepSize_));
+    pC_->sendAndReceive(pC_->outString_, pC_->inString_, sizeof(pC_->inString_));
+  }
+  sprintf(pC_->outString_, "%s %s %.*f %.*f", relative ? "MOVEINC" : "MOVEABS", axisName_,
+          maxDigits_, position * fabs(stepSize_), maxDigits_, maxVelocity * fabs(stepSize_));
+  status = pC_->sendAndReceive(pC_->outString_, pC_->inString_, sizeof(pC_->inString_));
+  if (status || (pC_->inString_[0] != ASCII_ACK_CHAR)) {
+    if (pC_->inString_[0] == ASCII_FAULT_CHAR) {
+      // Signal "Controller Error" to the user, the fault needs to be acknowledged
+      setIntegerParam(pC_->motorStatusProblem_, 1);
+      pC_->sendAndReceive("~STATUS(2, TaskErrorCode)", pC_->inString_, sizeof(pC_->inString_));
+      taskError = atoi(&pC_->inString_[1]);
+      if (taskError != 0) lastFault_ = taskError;
+      callParamCallbacks();
+    }
+    return asynError;
+  }
+  if (relative) setIntegerParam(pC_->motorStatusDirection_, position >= 0. ? 1 : 0);
+  else          setIntegerParam(pC_->motorStatusDirection_, position >= currentCmdPos_ ? 1 : 0);
+  // Delay the status update so the controller has time to set MoveDone false
+  epicsThreadSleep(0.010);
+  return asynSuccess;
+}
+
+asynStatus A3200Axis::home(double minVelocity, double maxVelocity, double acceleration, int forwards)
+{
+  epicsUInt32 hparam;
+  asynStatus status;
+
+  if (maxVelocity > 0) {
+    sprintf(pC_->outString_, "HomeSpeed.%s = %.*f", axisName_, maxDigits_, maxVelocity * fabs(stepSize_));
+    pC_->sendAndReceive(pC_->outString_, pC_->inString_, sizeof(pC_->inString_));
+  }
+  if (acceleration > 0) {
+    sprintf(pC_->outString_, "HomeRampRate.%s = %.*f", axisName_, maxDigits_, acceleration * fabs(stepSize_));
+    pC_->sendAndReceive(pC_->outString_, pC_->inString_, sizeof(pC_->inString_));
+  }
+
+  // Adjust the home direction for the ReverseMotionDirection parameter
+  hparam = homeDirection_;
+  if (forwards == (int) reverseDirec_) hparam |= 0x00000001;
+  else                                 hparam &= 0xFFFFFFFE;
+  homeDirection_ = hparam;
+  sprintf(pC_->outString_, "HomeSetup.%s = %d", axisName_, hparam);
+  pC_->sendAndReceive(pC_->outString_, pC_->inString_, sizeof(pC_->inString_));
+
+  sprintf(pC_->outString_, "HOME %s", axisName_);
+  status = pC_->sendAndReceive(pC_->outString_, pC_->inString_, sizeof(pC_->inString_));
+  setIntegerParam(pC_->motorStatusDirection_, forwards);
+  return status;
+}
+
+asynStatus A3200Axis::moveVelocity(double minVelocity, double maxVelocity, double acceleration)
+{
+  asynStatus status;
+
+  sprintf(pC_->outString_, "AbortDecelRate.%s = %.*f", axisName_, maxDigits_, acceleration * fabs(stepSize_));
+  pC_->sendAndReceive(pC_->outString_, pC_->inString_, sizeof(pC_->inString_));
+  sprintf(pC_->outString_, "RAMP RATE %s %.*f", axisName_, maxDigits_, acceleration * fabs(stepSize_));
+  pC_->sendAndReceive(pC_->outString_, pC_->inString_, sizeof(pC_->inString_));
+  sprintf(pC_->outString_, "FREERUN %s %.*f", axisName_, maxDigits_, maxVelocity * fabs(stepSize_));
+  status = pC_->sendAndReceive(pC_->outString_, pC_->inString_, sizeof(pC_->inString_));
+  setIntegerParam(pC_->motorStatusDirection_, maxVelocity > 0. ? 1 : 0);
+  // Delay the status update so the controller has time to set MoveDone false
+  epicsThreadSleep(0.010);
+  return status;
+}
+
+asynStatus A3200Axis::stop(double acceleration)
+{
+  asynStatus status;
+
+  // The ABORT is sent from task 3, because task 2 can be blocked by the queue
+  pC_->sendAndReceive("~TASK 3", pC_->inString_, sizeof(pC_->inString_));
+  sprintf(pC_->outString_, "ABORT %s", axisName_);
+  status = pC_->sendAndReceive(pC_->outString_, pC_->inString_, sizeof(pC_->inString_));
+  pC_->sendAndReceive("~TASK 2", pC_->inString_, sizeof(pC_->inString_));
+  return status;
+}
+
+asynStatus A3200Axis::setPosition(double position)
+{
+  asynStatus status;
+
+  sprintf(pC_->outString_, "POSOFFSET SET %s %.*f", axisName_, maxDigits_, position * fabs(stepSize_));
+  status = pC_->sendAndReceive(pC_->outString_, pC_->inString_, sizeof(pC_->inString_));
+  if ((status == asynSuccess) && (pC_->inString_[0] != ASCII_ACK_CHAR)) status = asynError;
+  return status;
+}
+
+asynStatus A3200Axis::setClosedLoop(bool closedLoop)
+{
+  int task2State, task3State;
+  asynStatus status;
+
+  status = pC_->sendAndReceive("~STATUS (2, TaskState) (3, TaskState)", pC_->inString_, sizeof(pC_->inString_));
+  if (status || (pC_->inString_[0] != ASCII_ACK_CHAR)) {
+    setIntegerParam(pC_->motorStatusCommsError_, 1);
+    return asynError;
+  }
+  sscanf(&pC_->inString_[1], "%d %d", &task2State, &task3State);
+  if (task2State == TASKSTATE_Idle) pC_->sendAndReceive("~INITQUEUE 2", pC_->inString_, sizeof(pC_->inString_));
+
+  if (!closedLoop) {
+    sprintf(pC_->outString_, "DISABLE %s", axisName_);
+  } else {
+    if (lastFault_) {
+      if ((lastFault_ == 52) || (lastFault_ == 78)) {
+        pC_->sendAndReceive("~TASK 3", pC_->inString_, sizeof(pC_->inString_));
+        // Prevent task 3 from blocking during motion commands
+        pC_->sendAndReceive("WAIT MODE AUTO", pC_->inString_, sizeof(pC_->inString_));
+        pC_->sendAndReceive("ACKNOWLEDGEALL", pC_->inString_, sizeof(pC_->inString_));
+        pC_->sendAndReceive("~TASK 2", pC_->inString_, sizeof(pC_->inString_));
+        sprintf(pC_->outString_, "~INITQUEUE");
+      } else {
+        sprintf(pC_->outString_, "FAULTACK %s", axisName_);
+      }
+      pC_->sendAndReceive(pC_->outString_, pC_->inString_, sizeof(pC_->inString_));
+      // Clear the fault indicator
+      lastFault_ = 0;
+      setIntegerParam(pC_->motorStatusProblem_, 0);
+    }
+    sprintf(pC_->outString_, "ENABLE %s", axisName_);
+  }
+  status = pC_->sendAndReceive(pC_->outString_, pC_->inString_, sizeof(pC_->inString_));
+  // Set indicator to force status update when Enable does not work
+  setIntegerParam(pC_->motorStatusPowerOn_, closedLoop ? 1 : 0);
+
+  // Prevent task 2 from blocking during motion commands
+  pC_->sendAndReceive("WAIT MODE AUTO", pC_->inString_, sizeof(pC_->inString_));
+  return status;
+}
+
+/** Polls the axis.
+  * This function publishes the status and positions that A3200Controller::poll() read in this cycle.
+  * It calls setIntegerParam() and setDoubleParam() for each item that it polls,
+  * and then calls callParamCallbacks() at the end.
+  * \param[out] moving A flag that is set indicating that the axis is moving (true) or done (false). */
+asynStatus A3200Axis::poll(bool *moving)
+{
+  int CW_sw_active, CCW_sw_active;
+
+  *moving = false;
+  if (!statusValid_) {
+    setIntegerParam(pC_->motorStatusCommsError_, 1);
+    callParamCallbacks();
+    return asynError;
+  }
+  setIntegerParam(pC_->motorStatusCommsError_, 0);
+
+  *moving = moving_;
+  setIntegerParam(pC_->motorStatusDone_, moving_ ? 0 : 1);
+  setIntegerParam(pC_->motorStatusPowerOn_, (driveStatus_ & DRIVESTATUS_Enabled) ? 1 : 0);
+  setIntegerParam(pC_->motorStatusAtHome_, (axisStatus_ & AXISSTATUS_Homed) ? 1 : 0);
+
+  CW_sw_active  = ((driveStatus_ & DRIVESTATUS_CwEndOfTravelLimitInput) != 0)  == ((limitSetup_ & A3200_CW_EOT_LEVEL) != 0);
+  CCW_sw_active = ((driveStatus_ & DRIVESTATUS_CcwEndOfTravelLimitInput) != 0) == ((limitSetup_ & A3200_CCW_EOT_LEVEL) != 0);
+  setIntegerParam(pC_->motorStatusHighLimit_, reverseDirec_ ? CCW_sw_active : CW_sw_active);
+  setIntegerParam(pC_->motorStatusLowLimit_,  reverseDirec_ ? CW_sw_active : CCW_sw_active);
+
+  setDoubleParam(pC_->motorEncoderPosition_, encoderPos_);
+  setDoubleParam(pC_->motorPosition_, currentCmdPos_);
+  setIntegerParam(pC_->motorStatusProblem_, lastFault_ ? 1 : 0);
+  callParamCallbacks();
+  return asynSuccess;
+}
+
+/** Code for iocsh registration */
+static const iocshArg A3200CreateControllerArg0 = {"Port name", iocshArgString};
+static const iocshArg A3200CreateControllerArg1 = {"A3200 port name", iocshArgString};
+static const iocshArg A3200CreateControllerArg2 = {"Number of axes", iocshArgInt};
+static const iocshArg A3200CreateControllerArg3 = {"Moving poll period (ms)", iocshArgInt};
+static const iocshArg A3200CreateControllerArg4 = {"Idle poll period (ms)", iocshArgInt};
+static const iocshArg * const A3200CreateControllerArgs[] = {&A3200CreateControllerArg0,
+                                                             &A3200CreateControllerArg1,
+                                                             &A3200CreateControllerArg2,
+                                                             &A3200CreateControllerArg3,
+                                                             &A3200CreateControllerArg4};
+static const iocshFuncDef A3200CreateControllerDef = {"A3200CreateController", 5, A3200CreateControllerArgs};
+static void A3200CreateControllerCallFunc(const iocshArgBuf *args)
+{
+  A3200CreateController(args[0].sval, args[1].sval, args[2].ival, args[3].ival, args[4].ival);
+}
+
+static const iocshArg A3200CreateProfileArg0 = {"Controller port name", iocshArgString};
+static const iocshArg A3200CreateProfileArg1 = {"Max points", iocshArgInt};
+static const iocshArg * const A3200CreateProfileArgs[] = {&A3200CreateProfileArg0,
+                                                          &A3200CreateProfileArg1};
+static const iocshFuncDef A3200CreateProfileDef = {"A3200CreateProfile", 2, A3200CreateProfileArgs};
+static void A3200CreateProfileCallFunc(const iocshArgBuf *args)
+{
+  A3200CreateProfile(args[0].sval, args[1].ival);
+}
+
+static void A3200MotorRegister(void)
+{
+  iocshRegister(&A3200CreateControllerDef, A3200CreateControllerCallFunc);
+  iocshRegister(&A3200CreateProfileDef, A3200CreateProfileCallFunc);
+}
+
+extern "C" {
+epicsExportRegistrar(A3200MotorRegister);
+}
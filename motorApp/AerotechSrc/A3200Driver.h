@@ -0,0 +1,77 @@
+/*
+FILENAME...   A3200Driver.h
+USAGE...      asynMotorController driver for the Aerotech A3200.
+
+*/
+
+#ifndef A3200Driver_H
+#define A3200Driver_H
+
+#include "AerotechController.h"
+
+#define A3200_MAX_AXES            32
+#define A3200_STATUS_AXES         8     /* Axes per ~STATUS query of the poller */
+#define A3200_MAX_PROFILE_AXES    8     /* Axes in one PVT command */
+#define A3200_PROFILE_BATCH       8     /* PVT commands queued per poll */
+#define A3200_PVT_STRING_SIZE     512
+
+/* Bits of the EndOfTravelLimitSetup parameter */
+#define A3200_CCW_EOT_LEVEL       0x2
+#define A3200_CW_EOT_LEVEL        0x4
+
+class epicsShareClass A3200Axis : public AerotechAxis
+{
+public:
+  /* These are the methods we override from the base class */
+  A3200Axis(class A3200Controller *pC, int axisNo);
+  void report(FILE *fp, int level);
+  asynStatus move(double position, int relative, double min_velocity, double max_velocity, double acceleration);
+  asynStatus moveVelocity(double min_velocity, double max_velocity, double acceleration);
+  asynStatus home(double min_velocity, double max_velocity, double acceleration, int forwards);
+  asynStatus stop(double acceleration);
+  asynStatus poll(bool *moving);
+  asynStatus setPosition(double position);
+  asynStatus setClosedLoop(bool closedLoop);
+
+private:
+  bool getParameter(const char *name);
+
+  A3200Controller *pC_;       /**< Pointer to the controller to which this axis belongs.
+                                *   Abbreviated because it is used very frequently */
+  epicsUInt32 limitSetup_;    /**< EndOfTravelLimitSetup parameter of the axis */
+  epicsUInt32 axisStatus_;    /**< AxisStatus from the last poll */
+  epicsUInt32 driveStatus_;   /**< DriveStatus from the last poll */
+
+friend class A3200Controller;
+};
+
+class epicsShareClass A3200Controller : public AerotechController {
+public:
+  A3200Controller(const char *portName, const char *asynPortName, int numAxes, double movingPollPeriod, double idlePollPeriod);
+
+  /* These are the methods that we override from asynMotorDriver */
+  void report(FILE *fp, int level);
+  A3200Axis* getAxis(asynUser *pasynUser);
+  A3200Axis* getAxis(int axisNo);
+  asynStatus poll();
+
+protected:
+  asynStatus checkProfile(int numProfileAxes, int numPoints, char *message);
+  asynStatus loadProfile(char *message);
+  asynStatus startProfile(char *message);
+  asynStatus runningProfile(bool *running, char *message);
+  asynStatus stopProfile();
+
+private:
+  asynStatus queueProfilePoints(char *message);
+
+  bool queueStatusValid_;     /**< queueStatus_ was read in the last poll */
+  epicsUInt32 queueStatus_;   /**< QueueStatus of task 2, read by the poller while a profile is active */
+  int nextPvtPoint_;          /**< Next PVT point of the profile to be queued */
+  char pvtCommands_[A3200_PROFILE_BATCH+1][A3200_PVT_STRING_SIZE];   /**< PVT commands of one batch */
+  char pvtReplies_[A3200_PROFILE_BATCH+1][MAX_BURST_STRING_SIZE];    /**< Replies to the PVT commands */
+
+friend class A3200Axis;
+};
+
+#endif /* A3200Driver_H */
@@ -0,0 +1,521 @@
+/*
+FILENAME... AerotechController.cpp
+USAGE...    Common base classes of the asynMotorController drivers for the Aerotech Ensemble and A3200.
+
+The base classes implement the ASCII command protocol shared by both controllers and the
+controller independent part of profile moves.  A profile is executed as a sequence of PVT
+(position, velocity, time) points: an acceleration point at the start, one point for each
+profile point and a deceleration point at the end.  The Ensemble loads the points into
+global variables and executes them from an AeroBasic program, the A3200 streams them into
+the command queue of task 2, see EnsembleDriver.cpp and A3200Driver.cpp.
+
+Neither controller can be triggered to record positions at the profile points over the
+ASCII interface, so the readbacks are interpolated from the encoder positions that the
+poller reads during the profile.  Their resolution is therefore limited by the moving
+poll period.
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <asynOctetSyncIO.h>
+
+#include <epicsExport.h>
+#include "AerotechController.h"
+
+#ifndef MAX
+#define MAX(a,b) ((a)>(b)? (a): (b))
+#endif
+
+static const char *driverName = "AerotechController";
+
+/** Creates a new AerotechController object.
+  * \param[in] portName          The name of the asyn port that will be created for this driver
+  * \param[in] asynPortName      The name of the drvAsynIPPort or drvAsynSerialPort that was created previously
+  * \param[in] numAxes           The number of axes that this controller supports
+  * \param[in] numParams         The number of controller-specific parameters
+  */
+AerotechController::AerotechController(const char *portName, const char *asynPortName, int numAxes, int numParams)
+  :  asynMotorController(portName, numAxes, numParams,
+                         0, // No additional interfaces beyond those in base class
+                         0, // No additional callback interfaces beyond those in base class
+                         ASYN_CANBLOCK | ASYN_MULTIDEVICE,
+                         1, // autoconnect
+                         0, 0),  // Default priority and stack size
+     profileBuilt_(false),
+     numProfilePoints_(0),
+     numProfileAxes_(0),
+     profileAccelTime_(AEROTECH_MIN_PROFILE_ACCEL_TIME),
+     profileTotalTime_(0.),
+     profileStartPolls_(0),
+     profileSampleTimes_(NULL),
+     numProfileSamples_(0),
+     maxProfileSamples_(0),
+     profileSampleStride_(1),
+     profileSamplePolls_(0)
+{
+  asynStatus status;
+  static const char *functionName = "AerotechController";
+
+  status = pasynOctetSyncIO->connect(asynPortName, 0, &pasynUserController_, NULL);
+  if (status) {
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+      "%s:%s: cannot connect to Aerotech controller on port %s\n",
+      driverName, functionName, asynPortName);
+  }
+  /* Set command End-of-string */
+  pasynOctetSyncIO->setInputEos(pasynUserController_, ASCII_EOS_STR, strlen(ASCII_EOS_STR));
+  pasynOctetSyncIO->setOutputEos(pasynUserController_, ASCII_EOS_STR, strlen(ASCII_EOS_STR));
+  epicsTimeGetCurrent(&profileStartTime_);
+}
+
+/** Sends a command to the controller and reads the reply.
+  * A read that times out is retried, because a slow command can answer after the timeout.
+  * The reply starts with ASCII_ACK_CHAR on success, ASCII_NAK_CHAR or ASCII_FAULT_CHAR on error.
+  * \param[in] output The command, without terminator
+  * \param[out] input The reply, an empty string on error
+  * \param[in] inputSize The size of input */
+asynStatus AerotechController::sendAndReceive(const char *output, char *input, size_t inputSize)
+{
+  size_t nRead;
+  int eomReason;
+  int retry;
+  asynStatus status;
+  static const char *functionName = "sendAndReceive";
+
+  status = writeReadController(output, input, inputSize, &nRead, AEROTECH_TIMEOUT);
+  for (retry=1; (status == asynTimeout) && (retry <= AEROTECH_RETRIES); retry++) {
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+      "%s:%s: retrying read, retry# = %d\n", driverName, functionName, retry);
+    status = pasynOctetSyncIO->read(pasynUserController_, input, inputSize, AEROTECH_TIMEOUT, &nRead, &eomReason);
+  }
+  if (status) {
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+      "%s:%s: error, output=%s status=%d, error=%s\n",
+      driverName, functionName, output, status, pasynUserController_->errorMessage);
+    input[0] = 0;
+  }
+  else if ((input[0] == ASCII_NAK_CHAR) || (input[0] == ASCII_FAULT_CHAR)) {
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+      "%s:%s: error returned for command = %s with response = %s\n",
+      driverName, functionName, output, input);
+  }
+  return status;
+}
+
+/** Returns a pointer to an AerotechAxis object.
+  * Returns NULL if the axis number encoded in pasynUser is invalid.
+  * \param[in] pasynUser asynUser structure that encodes the axis index number. */
+AerotechAxis* AerotechController::getAxis(asynUser *pasynUser)
+{
+  return static_cast<AerotechAxis*>(asynMotorController::getAxis(pasynUser));
+}
+
+/** Returns a pointer to an AerotechAxis object.
+  * Returns NULL if the axis number is invalid.
+  * \param[in] axisNo Axis index number. */
+AerotechAxis* AerotechController::getAxis(int axisNo)
+{
+  return static_cast<AerotechAxis*>(asynMotorController::getAxis(axisNo));
+}
+
+
+/* These are the functions for profile moves */
+
+/** Allocates the profile arrays of the controller and of the axes.
+  * \param[in] maxPoints The maximum number of profile points */
+asynStatus AerotechController::initializeProfile(size_t maxPoints)
+{
+  if (profileSampleTimes_) free(profileSampleTimes_);
+  maxProfileSamples_ = maxPoints * AEROTECH_PROFILE_SAMPLES_PER_POINT;
+  profileSampleTimes_ = (double *)calloc(maxProfileSamples_, sizeof(double));
+  return asynMotorController::initializeProfile(maxPoints);
+}
+
+/** Returns the duration of the PVT segment that ends at a PVT point.
+  * PVT point 0 is the first profile point, reached from the start position after the acceleration.
+  * PVT point numProfilePoints_ is the end position after the deceleration.
+  * \param[in] pvtPoint The PVT point, 0 to numProfilePoints_ */
+double AerotechController::profileDuration(int pvtPoint)
+{
+  if ((pvtPoint == 0) || (pvtPoint == numProfilePoints_)) return profileAccelTime_;
+  return profileTimes_[pvtPoint-1];
+}
+
+/** Returns the position of an axis at a PVT point in controller units.
+  * \param[in] pAxis The axis
+  * \param[in] pvtPoint The PVT point, 0 to numProfilePoints_ */
+double AerotechController::profilePosition(AerotechAxis *pAxis, int pvtPoint)
+{
+  double position;
+
+  if (pvtPoint == numProfilePoints_) position = pAxis->profileEnd_;
+  else position = pAxis->profilePositions_[pvtPoint] + pAxis->profileOffset_;
+  return position * fabs(pAxis->stepSize_);
+}
+
+/** Returns the velocity of an axis at a PVT point in controller units.
+  * \param[in] pAxis The axis
+  * \param[in] pvtPoint The PVT point, 0 to numProfilePoints_ */
+double AerotechController::profileVelocity(AerotechAxis *pAxis, int pvtPoint)
+{
+  if (pvtPoint == numProfilePoints_) return 0.;
+  return pAxis->profileVelocities_[pvtPoint] * fabs(pAxis->stepSize_);
+}
+
+/** Checks the profile and computes the velocity of each axis at each profile point.
+  * The velocity at a point is the average velocity of the segments on either side of it. */
+asynStatus AerotechController::buildProfile()
+{
+  AerotechAxis *pAxis;
+  int i, j;
+  int numPoints;
+  int useAxis;
+  bool buildOK = false;
+  double *positions;
+  double accelTime;
+  char message[MAX_CONTROLLER_STRING_SIZE];
+  static const char *functionName = "buildProfile";
+
+  // Call the base class method which will build the time array if needed
+  asynMotorController::buildProfile();
+
+  strcpy(message, "");
+  setStringParam(profileBuildMessage_, message);
+  setIntegerParam(profileBuildState_, PROFILE_BUILD_BUSY);
+  setIntegerParam(profileBuildStatus_, PROFILE_STATUS_UNDEFINED);
+  callParamCallbacks();
+
+  profileBuilt_ = false;
+  numProfileAxes_ = 0;
+  getIntegerParam(profileNumPoints_, &numPoints);
+  if ((numPoints < 2) || ((size_t)numPoints > maxProfilePoints_)) {
+    sprintf(message, "Number of points must be 2 to %d", (int)maxProfilePoints_);
+    goto done;
+  }
+  for (i=0; i<numPoints-1; i++) {
+    if (profileTimes_[i] <= 0.) {
+      sprintf(message, "Time of point %d is not positive", i+1);
+      goto done;
+    }
+  }
+  for (j=0; j<numAxes_; j++) {
+    pAxis = getAxis(j);
+    if (!pAxis) continue;
+    getIntegerParam(j, profileUseAxis_, &useAxis);
+    if (useAxis) profileAxes_[numProfileAxes_++] = j;
+  }
+  if (numProfileAxes_ == 0) {
+    sprintf(message, "No axis used in profile");
+    goto done;
+  }
+  if (checkProfile(numProfileAxes_, numPoints, message)) goto done;
+
+  for (j=0; j<numProfileAxes_; j++) {
+    pAxis = getAxis(profileAxes_[j]);
+    positions = pAxis->profilePositions_;
+    pAxis->profileVelocities_[0] = (positions[1] - positions[0]) / profileTimes_[0];
+    for (i=1; i<numPoints-1; i++) {
+      pAxis->profileVelocities_[i] = (positions[i+1] - positions[i-1]) / (profileTimes_[i-1] + profileTimes_[i]);
+    }
+    pAxis->profileVelocities_[numPoints-1] = (positions[numPoints-1] - positions[numPoints-2]) / profileTimes_[numPoints-2];
+  }
+
+  getDoubleParam(profileAcceleration_, &accelTime);
+  profileAccelTime_ = (accelTime > AEROTECH_MIN_PROFILE_ACCEL_TIME) ? accelTime : AEROTECH_MIN_PROFILE_ACCEL_TIME;
+  profileTotalTime_ = 2. * profileAccelTime_;
+  for (i=0; i<numPoints-1; i++) profileTotalTime_ += profileTimes_[i];
+  numProfilePoints_ = numPoints;
+  profileBuilt_ = true;
+  buildOK = true;
+
+  done:
+  setIntegerParam(profileBuildStatus_, buildOK ? PROFILE_STATUS_SUCCESS : PROFILE_STATUS_FAILURE);
+  setStringParam(profileBuildMessage_, message);
+  if (!buildOK) {
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+              "%s:%s: %s\n",
+              driverName, functionName, message);
+  }
+  /* Clear build command.  This is a "busy" record, don't want to do this until build is complete. */
+  setIntegerParam(profileBuild_, 0);
+  setIntegerParam(profileBuildState_, PROFILE_BUILD_DONE);
+  callParamCallbacks();
+  return buildOK ? asynSuccess : asynError;
+}
+
+/** Loads the profile into the controller and moves the axes to the start positions.
+  * The profile is started by pollProfile() when the axes have stopped there. */
+asynStatus AerotechController::executeProfile()
+{
+  AerotechAxis *pAxis;
+  int i, j;
+  int moveMode;
+  int last = numProfilePoints_ - 1;
+  double velocity, acceleration;
+  char message[MAX_CONTROLLER_STRING_SIZE];
+  asynStatus status;
+
+  strcpy(message, "");
+  setStringParam(profileExecuteMessage_, message);
+  setIntegerParam(profileExecuteState_, PROFILE_EXECUTE_MOVE_START);
+  setIntegerParam(profileExecuteStatus_, PROFILE_STATUS_UNDEFINED);
+  callParamCallbacks();
+
+  if (!profileBuilt_) {
+    setProfileExecuteDone(PROFILE_STATUS_FAILURE, "Profile is not built");
+    return asynError;
+  }
+  getIntegerParam(profileMoveMode_, &moveMode);
+  for (j=0; j<numProfileAxes_; j++) {
+    pAxis = getAxis(profileAxes_[j]);
+    pAxis->profileOffset_ = (moveMode == PROFILE_MOVE_MODE_RELATIVE) ? pAxis->currentCmdPos_ : 0.;
+    // The acceleration and deceleration segments are at constant acceleration
+    pAxis->profileStart_ = pAxis->profilePositions_[0] + pAxis->profileOffset_ -
+                           0.5 * pAxis->profileVelocities_[0] * profileAccelTime_;
+    pAxis->profileEnd_ = pAxis->profilePositions_[last] + pAxis->profileOffset_ +
+                         0.5 * pAxis->profileVelocities_[last] * profileAccelTime_;
+  }
+
+  status = loadProfile(message);
+  if (status) {
+    setProfileExecuteDone(PROFILE_STATUS_FAILURE, message);
+    return status;
+  }
+
+  for (j=0; j<numProfileAxes_; j++) {
+    pAxis = getAxis(profileAxes_[j]);
+    getDoubleParam(profileAxes_[j], motorVelocity_, &velocity);
+    getDoubleParam(profileAxes_[j], motorAccel_, &acceleration);
+    if (velocity <= 0.) {
+      for (i=0; i<numProfilePoints_; i++) velocity = MAX(velocity, fabs(pAxis->profileVelocities_[i]));
+    }
+    status = pAxis->move(pAxis->profileStart_, 0, 0., velocity, acceleration);
+    if (status) {
+      sprintf(message, "Error moving axis %d to the start position", profileAxes_[j]);
+      setProfileExecuteDone(PROFILE_STATUS_FAILURE, message);
+      return status;
+    }
+  }
+  profileStartPolls_ = 0;
+  numProfileSamples_ = 0;
+  profileSampleStride_ = 1;
+  profileSamplePolls_ = 0;
+  wakeupPoller();
+  return asynSuccess;
+}
+
+/** Stops the axes of the profile. */
+asynStatus AerotechController::abortProfile()
+{
+  int state;
+  asynStatus status;
+
+  getIntegerParam(profileExecuteState_, &state);
+  if (state == PROFILE_EXECUTE_DONE) return asynSuccess;
+  status = stopProfile();
+  setProfileExecuteDone(PROFILE_STATUS_ABORT, "Profile aborted");
+  return status;
+}
+
+/** Sets the profile execute state to done.
+  * \param[in] status The execute status, one of the ProfileStatus values
+  * \param[in] message The execute message */
+void AerotechController::setProfileExecuteDone(int status, const char *message)
+{
+  setIntegerParam(profileExecuteStatus_, status);
+  setStringParam(profileExecuteMessage_, message);
+  if (status != PROFILE_STATUS_SUCCESS) {
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+              "%s:executeProfile: %s\n",
+              driverName, message);
+  }
+  /* Clear execute command.  This is a "busy" record, don't want to do this until execution is complete. */
+  setIntegerParam(profileExecute_, 0);
+  setIntegerParam(profileExecuteState_, PROFILE_EXECUTE_DONE);
+  callParamCallbacks();
+}
+
+/** Stores the encoder positions of the profile axes from the current poll.
+  * When the sample arrays are full every other sample is dropped and samples are stored
+  * half as often, so a profile of any length is sampled over its whole duration. */
+void AerotechController::sampleProfile()
+{
+  AerotechAxis *pAxis;
+  epicsTimeStamp now;
+  size_t i;
+  int j;
+
+  if (maxProfileSamples_ < 2) return;
+  if (++profileSamplePolls_ < profileSampleStride_) return;
+  profileSamplePolls_ = 0;
+  if (numProfileSamples_ >= maxProfileSamples_) {
+    for (i=0; i<maxProfileSamples_/2; i++) {
+      profileSampleTimes_[i] = profileSampleTimes_[2*i];
+      for (j=0; j<numProfileAxes_; j++) {
+        pAxis = getAxis(profileAxes_[j]);
+        pAxis->profileSamples_[i] = pAxis->profileSamples_[2*i];
+      }
+    }
+    numProfileSamples_ = maxProfileSamples_/2;
+    profileSampleStride_ *= 2;
+  }
+  epicsTimeGetCurrent(&now);
+  profileSampleTimes_[numProfileSamples_] = epicsTimeDiffInSeconds(&now, &profileStartTime_);
+  for (j=0; j<numProfileAxes_; j++) {
+    pAxis = getAxis(profileAxes_[j]);
+    pAxis->profileSamples_[numProfileSamples_] = pAxis->encoderPos_;
+  }
+  numProfileSamples_++;
+}
+
+/** Advances a profile move, called by the poll() of the controller after the axes were read.
+  * Starts the profile when the axes have reached the start positions, samples the positions
+  * while it runs and detects its end. */
+void AerotechController::pollProfile()
+{
+  AerotechAxis *pAxis;
+  epicsTimeStamp now;
+  int state;
+  int j;
+  bool running;
+  char message[MAX_CONTROLLER_STRING_SIZE];
+
+  getIntegerParam(profileExecuteState_, &state);
+  if (state == PROFILE_EXECUTE_MOVE_START) {
+    // The first poll after the move command can still see the axes stopped
+    if (++profileStartPolls_ < 2) return;
+    for (j=0; j<numProfileAxes_; j++) {
+      pAxis = getAxis(profileAxes_[j]);
+      if (pAxis->moving_ || !pAxis->statusValid_) return;
+    }
+    strcpy(message, "");
+    epicsTimeGetCurrent(&profileStartTime_);
+    if (startProfile(message)) {
+      stopProfile();
+      setProfileExecuteDone(PROFILE_STATUS_FAILURE, message);
+      return;
+    }
+    setIntegerParam(profileExecuteState_, PROFILE_EXECUTE_EXECUTING);
+    callParamCallbacks();
+  }
+  else if (state == PROFILE_EXECUTE_EXECUTING) {
+    sampleProfile();
+    strcpy(message, "");
+    if (runningProfile(&running, message)) {
+      stopProfile();
+      setProfileExecuteDone(PROFILE_STATUS_FAILURE, message);
+      return;
+    }
+    if (!running) {
+      setProfileExecuteDone(PROFILE_STATUS_SUCCESS, "");
+      return;
+    }
+    epicsTimeGetCurrent(&now);
+    if (epicsTimeDiffInSeconds(&now, &profileStartTime_) > 2.*profileTotalTime_ + 5.) {
+      stopProfile();
+      setProfileExecuteDone(PROFILE_STATUS_TIMEOUT, "Timeout");
+    }
+  }
+}
+
+/** Computes the readbacks and following errors of the profile axes from the positions
+  * sampled by the poller, interpolated to the times of the profile points. */
+asynStatus AerotechController::readbackProfile()
+{
+  AerotechAxis *pAxis;
+  int i, j;
+  size_t k;
+  double time, fraction;
+  bool readOK = false;
+  char message[MAX_CONTROLLER_STRING_SIZE];
+  static const char *functionName = "readbackProfile";
+
+  strcpy(message, "");
+  setStringParam(profileReadbackMessage_, message);
+  setIntegerParam(profileReadbackState_, PROFILE_READBACK_BUSY);
+  setIntegerParam(profileReadbackStatus_, PROFILE_STATUS_UNDEFINED);
+  callParamCallbacks();
+
+  if (!profileBuilt_ || (numProfileSamples_ < 2)) {
+    sprintf(message, "No positions were sampled during the profile");
+    goto done;
+  }
+  for (j=0; j<numProfileAxes_; j++) {
+    pAxis = getAxis(profileAxes_[j]);
+    time = profileAccelTime_;
+    k = 0;
+    for (i=0; i<numProfilePoints_; i++) {
+      if (i > 0) time += profileTimes_[i-1];
+      while ((k < numProfileSamples_-2) && (profileSampleTimes_[k+1] < time)) k++;
+      fraction = (time - profileSampleTimes_[k]) / (profileSampleTimes_[k+1] - profileSampleTimes_[k]);
+      if (fraction < 0.) fraction = 0.;
+      if (fraction > 1.) fraction = 1.;
+      pAxis->profileReadbacks_[i] = pAxis->profileSamples_[k] +
+                                    fraction * (pAxis->profileSamples_[k+1] - pAxis->profileSamples_[k]);
+      pAxis->profileFollowingErrors_[i] = pAxis->profileReadbacks_[i] -
+                                          (pAxis->profilePositions_[i] + pAxis->profileOffset_);
+    }
+  }
+  setIntegerParam(profileNumReadbacks_, numProfilePoints_);
+  // The base class converts the readbacks to user units and does the array callbacks
+  asynMotorController::readbackProfile();
+  readOK = true;
+
+  done:
+  setIntegerParam(profileReadbackStatus_, readOK ? PROFILE_STATUS_SUCCESS : PROFILE_STATUS_FAILURE);
+  setStringParam(profileReadbackMessage_, message);
+  if (!readOK) {
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+              "%s:%s: %s\n",
+              driverName, functionName, message);
+  }
+  /* Clear readback command.  This is a "busy" record, don't want to do this until readback is complete. */
+  setIntegerParam(profileReadback_, 0);
+  setIntegerParam(profileReadbackState_, PROFILE_READBACK_DONE);
+  callParamCallbacks();
+  return readOK ? asynSuccess : asynError;
+}
+
+
+// These are the AerotechAxis methods
+
+/** Creates a new AerotechAxis object.
+  * \param[in] pC Pointer to the AerotechController to which this axis belongs.
+  * \param[in] axisNo Index number of this axis, range 0 to pC->numAxes_-1.
+  */
+AerotechAxis::AerotechAxis(AerotechController *pC, int axisNo)
+  : asynMotorAxis(pC, axisNo),
+    pC_(pC),
+    stepSize_(1.),
+    maxDigits_(1),
+    reverseDirec_(false),
+    homeDirection_(0),
+    homePreset_(0.),
+    lastFault_(0),
+    currentCmdPos_(0.),
+    encoderPos_(0.),
+    moving_(false),
+    statusValid_(false),
+    profileVelocities_(NULL),
+    profileOffset_(0.),
+    profileStart_(0.),
+    profileEnd_(0.),
+    profileSamples_(NULL)
+{
+  strcpy(axisName_, "");
+}
+
+/** Allocates the profile arrays of the axis.
+  * \param[in] maxPoints The maximum number of profile points */
+asynStatus AerotechAxis::initializeProfile(size_t maxPoints)
+{
+  if (profileVelocities_) free(profileVelocities_);
+  profileVelocities_ = (double *)calloc(maxPoints, sizeof(double));
+  if (profileSamples_) free(profileSamples_);
+  profileSamples_ = (double *)calloc(maxPoints * AEROTECH_PROFILE_SAMPLES_PER_POINT, sizeof(double));
+  return asynMotorAxis::initializeProfile(maxPoints);
+}
@@ -0,0 +1,114 @@
+/*
+FILENAME...   AerotechController.h
+USAGE...      Common base classes of the asynMotorController drivers for the Aerotech Ensemble and A3200.
+
+*/
+
+#ifndef AerotechController_H
+#define AerotechController_H
+
+#include <epicsTime.h>
+
+#include "asynMotorController.h"
+#include "asynMotorAxis.h"
+
+#define AEROTECH_BUFFER_SIZE 4096   /* Size of input and output buffers, ~STATUS replies of the A3200 are long */
+#define AEROTECH_TIMEOUT     2.0    /* Timeout for I/O in seconds */
+#define AEROTECH_RETRIES     3      /* Number of retries of a read that timed out */
+
+/* The following should be defined to have the same value as
+ * the Ensemble/A3200 parameters specified */
+#define ASCII_EOS_CHAR      '\n'  /* CommandTerminatingCharacter */
+#define ASCII_EOS_STR       "\n"
+#define ASCII_ACK_CHAR      '%'   /* CommandSuccessCharacter */
+#define ASCII_NAK_CHAR      '!'   /* CommandInvalidCharacter */
+#define ASCII_FAULT_CHAR    '#'   /* CommandFaultCharacter */
+
+#define AEROTECH_MAX_AXES    32     /* Largest number of axes of one controller */
+
+#define AEROTECH_MIN_PROFILE_ACCEL_TIME 0.05   /* Shortest acceleration and deceleration time of a profile */
+#define AEROTECH_PROFILE_SAMPLES_PER_POINT 4   /* Poller samples allocated per profile point for the readback */
+
+class epicsShareClass AerotechAxis : public asynMotorAxis
+{
+public:
+  AerotechAxis(class AerotechController *pC, int axisNo);
+  asynStatus initializeProfile(size_t maxPoints);
+
+protected:
+  AerotechController *pC_;     /**< Pointer to the controller to which this axis belongs.
+                                 *   Abbreviated because it is used very frequently */
+  char axisName_[40];          /**< Name of the axis in commands, "@0" on the Ensemble, "X" on the A3200 */
+  double stepSize_;            /**< Controller units per motor record step, 1/CountsPerUnit */
+  int maxDigits_;              /**< Number of decimal places of positions in commands */
+  bool reverseDirec_;          /**< ReverseMotionDirection parameter of the axis */
+  epicsUInt32 homeDirection_;  /**< HomeSetup parameter of the axis */
+  double homePreset_;          /**< HomeOffset parameter of the axis */
+  int lastFault_;              /**< Last axis or task fault reported by the controller */
+  double currentCmdPos_;       /**< Commanded position in steps from the last poll */
+  double encoderPos_;          /**< Encoder position in steps from the last poll */
+  bool moving_;                /**< Moving status from the last poll */
+  bool statusValid_;           /**< The status of the last poll was read without error */
+
+  // Profile move data, positions in steps and velocities in steps/s
+  double *profileVelocities_;  /**< Velocity at each profile point */
+  double profileOffset_;       /**< Position added to the profile in relative mode, in steps */
+  double profileStart_;        /**< Position at which the profile starts, before the acceleration */
+  double profileEnd_;          /**< Position at which the profile ends, after the deceleration */
+  double *profileSamples_;     /**< Encoder positions in steps sampled by the poller during the profile */
+
+friend class AerotechController;
+};
+
+class epicsShareClass AerotechController : public asynMotorController {
+public:
+  AerotechController(const char *portName, const char *asynPortName, int numAxes, int numParams);
+
+  asynStatus sendAndReceive(const char *output, char *input, size_t inputSize);
+  AerotechAxis* getAxis(asynUser *pasynUser);
+  AerotechAxis* getAxis(int axisNo);
+
+  /* These are the functions for profile moves */
+  asynStatus initializeProfile(size_t maxPoints);
+  asynStatus buildProfile();
+  asynStatus executeProfile();
+  asynStatus abortProfile();
+  asynStatus readbackProfile();
+
+protected:
+  /* These are implemented by the Ensemble and A3200 controllers */
+  virtual asynStatus checkProfile(int numProfileAxes, int numPoints, char *message) = 0;
+  virtual asynStatus loadProfile(char *message) = 0;
+  virtual asynStatus startProfile(char *message) = 0;
+  virtual asynStatus runningProfile(bool *running, char *message) = 0;
+  virtual asynStatus stopProfile() = 0;
+
+  void pollProfile();
+  void sampleProfile();
+  void setProfileExecuteDone(int status, const char *message);
+  double profileDuration(int pvtPoint);
+  double profilePosition(AerotechAxis *pAxis, int pvtPoint);
+  double profileVelocity(AerotechAxis *pAxis, int pvtPoint);
+
+  char inputBuff_[AEROTECH_BUFFER_SIZE];    /**< Reply of the last poll */
+  char outputBuff_[AEROTECH_BUFFER_SIZE];   /**< Command of the last poll */
+
+  // Profile move state
+  bool profileBuilt_;                 /**< The profile was built without error */
+  int numProfilePoints_;              /**< Number of points of the built profile */
+  int numProfileAxes_;                /**< Number of axes in the profile */
+  int profileAxes_[AEROTECH_MAX_AXES];  /**< Axis numbers in the profile */
+  double profileAccelTime_;           /**< Time to accelerate onto and decelerate off the profile */
+  double profileTotalTime_;           /**< Expected duration of the profile including acceleration */
+  int profileStartPolls_;             /**< Polls since the move to the start position was started */
+  epicsTimeStamp profileStartTime_;   /**< Time the controller started the profile */
+  double *profileSampleTimes_;        /**< Time since profileStartTime_ of each poller sample */
+  size_t numProfileSamples_;          /**< Number of poller samples */
+  size_t maxProfileSamples_;          /**< Size of the sample arrays */
+  int profileSampleStride_;           /**< Polls per stored sample, doubled each time the arrays fill up */
+  int profileSamplePolls_;            /**< Polls since the last stored sample */
+
+friend class AerotechAxis;
+};
+
+#endif /* AerotechController_H */
@@ -0,0 +1,1244 @@
+/*
+FILENAME... EnsembleDriver.cpp
+USAGE...    asynMotorController driver for the Aerotech Ensemble.
+
+This driver replaces the motor_interface driver in drvEnsembleAsyn.cc, which is kept for
+existing IOCs.  The Ensemble has no query that returns the status of several axes, so the
+poller reads the status, positions and fault of all axes with bursts of single-axis queries,
+see asynMotorController::writeReadBurst().  PLANESTATUS(0) is read once per poll for all axes.
+
+Profile moves are loaded into the DGLOBAL variables of the controller and executed by the
+DOPROFILE command of the AeroBasic program doCommand.ab, which must be compiled to
+doCommand.bcx on the controller.
+
+PSO fly scans replace the records of EnsemblePSOFly.db: the driver computes the taxi position,
+the PSO window and the pulse positions from start, end, step and speed, and configures and arms
+the PSO with one burst.  The encoder positions at the pulses are recorded with DATAACQ, which
+is only available in AeroBasic and is run through doCommand.bcx.
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <iocsh.h>
+#include <epicsThread.h>
+
+#include <asynOctetSyncIO.h>
+
+#include <epicsExport.h>
+#include "EnsembleDriver.h"
+#include "ParameterId.h"
+
+#ifndef MIN
+#define MIN(a,b) ((a)<(b)? (a): (b))
+#endif
+#ifndef MAX
+#define MAX(a,b) ((a)>(b)? (a): (b))
+#endif
+
+static const char *driverName = "EnsembleDriver";
+
+/** Creates a new EnsembleController object.
+  * \param[in] portName          The name of the asyn port that will be created for this driver
+  * \param[in] asynPortName      The name of the drvAsynIPPort or drvAsynSerialPort that was created previously
+  * \param[in] numAxes           The number of axes that this controller supports
+  * \param[in] movingPollPeriod  The time between polls when any axis is moving
+  * \param[in] idlePollPeriod    The time between polls when no axis is moving
+  */
+EnsembleController::EnsembleController(const char *portName, const char *asynPortName, int numAxes,
+                                       double movingPollPeriod, double idlePollPeriod)
+  :  AerotechController(portName, asynPortName, numAxes, NUM_ENSEMBLE_PARAMS),
+     planeMoving_(false),
+     globalDoubles_(0),
+     globalIntegers_(0),
+     flyAxis_(NULL),
+     flyState_(ENSEMBLE_FLY_IDLE),
+     flyPolls_(0),
+     maxFlyPulses_(0),
+     flyPulseType_(ENSEMBLE_FLY_PULSE_TRIGGER),
+     flyPulsePeriod_(0),
+     flyPulseOn_(0),
+     flyNumPulses_(0),
+     flyNumCaptured_(0),
+     flyCapture_(false),
+     flyPulsePositions_(NULL),
+     flyEncoderPositions_(NULL)
+{
+  int axis, axisId;
+  int retry;
+  asynStatus status;
+  static const char *functionName = "EnsembleController";
+
+  createParam(EnsembleFlyStartString,            asynParamFloat64,      &EnsembleFlyStart_);
+  createParam(EnsembleFlyEndString,              asynParamFloat64,      &EnsembleFlyEnd_);
+  createParam(EnsembleFlyStepString,             asynParamFloat64,      &EnsembleFlyStep_);
+  createParam(EnsembleFlySpeedString,            asynParamFloat64,      &EnsembleFlySpeed_);
+  createParam(EnsembleFlyAccelTimeString,        asynParamFloat64,      &EnsembleFlyAccelTime_);
+  createParam(EnsembleFlyPulseTypeString,        asynParamInt32,        &EnsembleFlyPulseType_);
+  createParam(EnsembleFlyTrigFracString,         asynParamFloat64,      &EnsembleFlyTrigFrac_);
+  createParam(EnsembleFlyDetSetupString,         asynParamFloat64,      &EnsembleFlyDetSetup_);
+  createParam(EnsembleFlyCaptureString,          asynParamInt32,        &EnsembleFlyCapture_);
+  createParam(EnsembleFlyTaxiString,             asynParamInt32,        &EnsembleFlyTaxi_);
+  createParam(EnsembleFlyFlyString,              asynParamInt32,        &EnsembleFlyFly_);
+  createParam(EnsembleFlyAbortString,            asynParamInt32,        &EnsembleFlyAbort_);
+  createParam(EnsembleFlyStateString,            asynParamInt32,        &EnsembleFlyState_);
+  createParam(EnsembleFlyStatusString,           asynParamInt32,        &EnsembleFlyStatus_);
+  createParam(EnsembleFlyMessageString,          asynParamOctet,        &EnsembleFlyMessage_);
+  createParam(EnsembleFlyTaxiPositionString,     asynParamFloat64,      &EnsembleFlyTaxiPosition_);
+  createParam(EnsembleFlyEndPositionString,      asynParamFloat64,      &EnsembleFlyEndPosition_);
+  createParam(EnsembleFlyWindowStartString,      asynParamFloat64,      &EnsembleFlyWindowStart_);
+  createParam(EnsembleFlyWindowEndString,        asynParamFloat64,      &EnsembleFlyWindowEnd_);
+  createParam(EnsembleFlyNumPulsesString,        asynParamInt32,        &EnsembleFlyNumPulses_);
+  createParam(EnsembleFlyNumCapturedString,      asynParamInt32,        &EnsembleFlyNumCaptured_);
+  createParam(EnsembleFlyPulsePositionsString,   asynParamFloat64Array, &EnsembleFlyPulsePositions_);
+  createParam(EnsembleFlyEncoderPositionsString, asynParamFloat64Array, &EnsembleFlyEncoderPositions_);
+  setIntegerParam(EnsembleFlyState_, ENSEMBLE_FLY_IDLE);
+  setIntegerParam(EnsembleFlyStatus_, PROFILE_STATUS_UNDEFINED);
+  setStringParam(EnsembleFlyMessage_, "");
+
+  // We only care if we get a response, so we don't need to send a valid command
+  for (retry=0; retry<AEROTECH_RETRIES; retry++) {
+    status = sendAndReceive("NONE", inString_, sizeof(inString_));
+    if (status == asynSuccess) break;
+  }
+  if (status) {
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+      "%s:%s: no response from Ensemble on port %s\n",
+      driverName, functionName, asynPortName);
+    return;
+  }
+
+  // Create the axes that exist on the controller, we know an axis exists if it has a name
+  axis = 0;
+  for (axisId=0; (axisId<ENSEMBLE_MAX_AXES) && (axis<numAxes); axisId++) {
+    sprintf(outString_, "GETPARM(@%d, %d)", axisId, PARAMETERID_AxisName);
+    sendAndReceive(outString_, inString_, sizeof(inString_));
+    if (inString_[0] != ASCII_ACK_CHAR) continue;
+    new EnsembleAxis(this, axis, axisId);
+    axis++;
+  }
+  if (axis < numAxes) {
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+      "%s:%s: only %d of %d axes found\n",
+      driverName, functionName, axis, numAxes);
+  }
+
+  // The number of DGLOBAL variables limits the size of a profile
+  sprintf(outString_, "GETPARM(%d)", PARAMETERID_GlobalDoubles);
+  sendAndReceive(outString_, inString_, sizeof(inString_));
+  if (inString_[0] == ASCII_ACK_CHAR) globalDoubles_ = atoi(&inString_[1]);
+
+  // The number of IGLOBAL variables limits the encoder positions of a fly scan
+  sprintf(outString_, "GETPARM(%d)", PARAMETERID_GlobalIntegers);
+  sendAndReceive(outString_, inString_, sizeof(inString_));
+  if (inString_[0] == ASCII_ACK_CHAR) globalIntegers_ = atoi(&inString_[1]);
+
+  // Prevent the ASCII interpreter from blocking during motion commands
+  sendAndReceive("WAIT MODE NOWAIT", inString_, sizeof(inString_));
+
+  startPoller(movingPollPeriod, idlePollPeriod, 2);
+}
+
+
+/** Creates a new EnsembleController object.
+  * Configuration command, called directly or from iocsh
+  * \param[in] portName          The name of the asyn port that will be created for this driver
+  * \param[in] asynPortName      The name of the drvAsynIPPort or drvAsynSerialPort that was created previously
+  * \param[in] numAxes           The number of axes that this controller supports
+  * \param[in] movingPollPeriod  The time in ms between polls when any axis is moving
+  * \param[in] idlePollPeriod    The time in ms between polls when no axis is moving
+  */
+extern "C" int EnsembleCreateController(const char *portName, const char *asynPortName, int numAxes,
+                                        int movingPollPeriod, int idlePollPeriod)
+{
+  if ((numAxes < 1) || (numAxes > ENSEMBLE_MAX_AXES)) {
+    printf("%s:EnsembleCreateController: numAxes must be in range 1 to %d\n", driverName, ENSEMBLE_MAX_AXES);
+    return asynError;
+  }
+  new EnsembleController(portName, asynPortName, numAxes, movingPollPeriod/1000., idlePollPeriod/1000.);
+  return asynSuccess;
+}
+
+/** Allocates the profile move arrays of an Ensemble controller.
+  * Configuration command, called directly or from iocsh
+  * \param[in] portName   The name of the asyn port of the controller
+  * \param[in] maxPoints  The maximum number of profile points
+  */
+extern "C" int EnsembleCreateProfile(const char *portName, int maxPoints)
+{
+  EnsembleController *pC;
+  static const char *functionName = "EnsembleCreateProfile";
+
+  pC = (EnsembleController*) findAsynPortDriver(portName);
+  if (!pC) {
+    printf("%s:%s: Error port %s not found\n",
+           driverName, functionName, portName);
+    return asynError;
+  }
+  pC->lock();
+  pC->initializeProfile(maxPoints);
+  pC->unlock();
+  return asynSuccess;
+}
+
+/** Allocates the PSO fly scan arrays of an Ensemble controller.
+  * Configuration command, called directly or from iocsh
+  * \param[in] portName   The name of the asyn port of the controller
+  * \param[in] maxPulses  The maximum number of pulses of a fly scan
+  */
+extern "C" int EnsembleCreateFlyScan(const char *portName, int maxPulses)
+{
+  EnsembleController *pC;
+  static const char *functionName = "EnsembleCreateFlyScan";
+
+  pC = (EnsembleController*) findAsynPortDriver(portName);
+  if (!pC) {
+    printf("%s:%s: Error port %s not found\n",
+           driverName, functionName, portName);
+    return asynError;
+  }
+  pC->lock();
+  pC->initializeFlyScan(maxPulses);
+  pC->unlock();
+  return asynSuccess;
+}
+
+/** Reports on status of the driver
+  * \param[in] fp The file pointer on which report information will be written
+  * \param[in] level The level of report detail desired
+  *
+  * If details > 0 then information is printed about each axis.
+  * After printing controller-specific information calls asynMotorController::report()
+  */
+void EnsembleController::report(FILE *fp, int level)
+{
+  fprintf(fp, "Ensemble motor driver %s, numAxes=%d, moving poll period=%f, idle poll period=%f\n",
+    this->portName, numAxes_, movingPollPeriod_, idlePollPeriod_);
+  fprintf(fp, "  global doubles=%d, max. profile points=%d\n", globalDoubles_, (int)maxProfilePoints_);
+  fprintf(fp, "  global integers=%d, max. fly scan pulses=%d, fly scan state=%d\n",
+    globalIntegers_, (int)maxFlyPulses_, flyState_);
+
+  // Call the base class method
+  asynMotorController::report(fp, level);
+}
+
+/** Returns a pointer to an EnsembleAxis object.
+  * Returns NULL if the axis number encoded in pasynUser is invalid.
+  * \param[in] pasynUser asynUser structure that encodes the axis index number. */
+EnsembleAxis* EnsembleController::getAxis(asynUser *pasynUser)
+{
+  return static_cast<EnsembleAxis*>(asynMotorController::getAxis(pasynUser));
+}
+
+/** Returns a pointer to an EnsembleAxis object.
+  * Returns NULL if the axis number is invalid.
+  * \param[in] axisNo Axis index number. */
+EnsembleAxis* EnsembleController::getAxis(int axisNo)
+{
+  return static_cast<EnsembleAxis*>(asynMotorController::getAxis(axisNo));
+}
+
+/** Polls the controller.
+  * Reads PLANESTATUS(0) and the status, positions and fault of all axes in as few bursts as possible.
+  * The axes publish the values in EnsembleAxis::poll(), which the poller calls after this function. */
+asynStatus EnsembleController::poll()
+{
+  EnsembleAxis *pAxis;
+  asynMotorBurst burst;
+  int first, last, axis;
+  int cmd, i;
+  epicsUInt32 axisFault;
+  asynStatus status, pollStatus = asynSuccess;
+  static const char *functionName = "poll";
+
+  for (first=0; first<numAxes_; first=last) {
+    burst.clear();
+    if (first == 0) burst.add("PLANESTATUS(0)");
+    for (last=first; last<numAxes_; last++) {
+      if (burst.numCommands_ + ENSEMBLE_POLL_COMMANDS > MAX_BURST_COMMANDS) break;
+      pAxis = getAxis(last);
+      if (!pAxis) continue;
+      burst.add("AXISSTATUS(@%d)", pAxis->axisId_);
+      burst.add("PFBKPROG(@%d)", pAxis->axisId_);
+      burst.add("PCMDPROG(@%d)", pAxis->axisId_);
+      burst.add("AXISFAULT(@%d)", pAxis->axisId_);
+    }
+    // The replies that did arrive are still used, the axes of failed commands are marked invalid
+    status = writeReadBurst(&burst, AEROTECH_TIMEOUT);
+    if (status && (pollStatus == asynSuccess)) pollStatus = status;
+
+    cmd = 0;
+    if (first == 0) {
+      planeMoving_ = (burst.status(0) == asynSuccess) && (burst.reply(0)[0] == ASCII_ACK_CHAR) &&
+                     (atoi(burst.reply(0)+1) & 0x01);
+      cmd = 1;
+    }
+    for (axis=first; axis<last; axis++) {
+      pAxis = getAxis(axis);
+      if (!pAxis) continue;
+      pAxis->statusValid_ = true;
+      for (i=0; i<ENSEMBLE_POLL_COMMANDS; i++) {
+        if (burst.status(cmd+i) || (burst.reply(cmd+i)[0] != ASCII_ACK_CHAR)) pAxis->statusValid_ = false;
+      }
+      if (pAxis->statusValid_) {
+        pAxis->axisStatus_.All = (epicsUInt32) strtoul(burst.reply(cmd)+1, NULL, 10);
+        pAxis->encoderPos_ = atof(burst.reply(cmd+1)+1) / fabs(pAxis->stepSize_);
+        pAxis->currentCmdPos_ = atof(burst.reply(cmd+2)+1) / fabs(pAxis->stepSize_);
+        axisFault = (epicsUInt32) strtoul(burst.reply(cmd+3)+1, NULL, 10);
+        if (axisFault && ((int)axisFault != pAxis->lastFault_)) {
+          asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+            "%s:%s: controller fault on axis=%d fault=0x%X\n",
+            driverName, functionName, axis, axisFault);
+        }
+        pAxis->lastFault_ = axisFault;
+        pAxis->moving_ = planeMoving_ || pAxis->axisStatus_.Bits.move_active;
+      }
+      cmd += ENSEMBLE_POLL_COMMANDS;
+    }
+  }
+
+  pollProfile();
+  status = pollFlyScan();
+  if (status && (pollStatus == asynSuccess)) pollStatus = status;
+  return pollStatus;
+}
+
+/** Writes the commands of a burst that only expect an acknowledge, e.g. assignments of globals.
+  * \param[in] pBurst The burst */
+asynStatus EnsembleController::writeBurst(asynMotorBurst *pBurst)
+{
+  asynStatus status;
+  int i;
+
+  status = writeReadBurst(pBurst, AEROTECH_TIMEOUT);
+  for (i=0; (status == asynSuccess) && (i<pBurst->numCommands_); i++) {
+    if (pBurst->reply(i)[0] != ASCII_ACK_CHAR) status = asynError;
+  }
+  pBurst->clear();
+  return status;
+}
+
+/** Starts doCommand.bcx in task 1 if it is not running.
+  * \param[out] message The error message */
+asynStatus EnsembleController::startCommandProgram(char *message)
+{
+  int taskState;
+  asynStatus status;
+
+  sprintf(outString_, "TASKSTATE(%d)", ENSEMBLE_PROFILE_TASK);
+  status = sendAndReceive(outString_, inString_, sizeof(inString_));
+  if (status || (inString_[0] != ASCII_ACK_CHAR)) {
+    sprintf(message, "Error reading state of task %d", ENSEMBLE_PROFILE_TASK);
+    return asynError;
+  }
+  taskState = atoi(&inString_[1]);
+
+  // 3 is running, 6 is in error, the other states need the program to be started
+  if (taskState == 3) return asynSuccess;
+  if (taskState == 6) {
+    sprintf(outString_, "PROGRAM STOP %d", ENSEMBLE_PROFILE_TASK);
+    sendAndReceive(outString_, inString_, sizeof(inString_));
+    epicsThreadSleep(0.1);
+  }
+  sprintf(outString_, "IGLOBAL(%d) = 0", ENSEMBLE_IGLOBAL_CMD);
+  sendAndReceive(outString_, inString_, sizeof(inString_));
+  sprintf(outString_, "PROGRAM RUN %d, \"doCommand.bcx\"", ENSEMBLE_PROFILE_TASK);
+  status = sendAndReceive(outString_, inString_, sizeof(inString_));
+  if (status || (inString_[0] != ASCII_ACK_CHAR)) {
+    sprintf(message, "Error starting doCommand.bcx in task %d", ENSEMBLE_PROFILE_TASK);
+    return asynError;
+  }
+  epicsThreadSleep(0.1);
+  return asynSuccess;
+}
+
+/** Runs a command of doCommand.bcx and waits until the program has negated it.
+  * The arguments and the command are written with one burst.
+  * \param[in] command The command, one of the ENSEMBLE_CMD_ values
+  * \param[in] numArgs The number of integer arguments, at most 4
+  * \param[in] args The integer arguments
+  * \param[out] message The error message */
+asynStatus EnsembleController::runCommand(int command, int numArgs, const int *args, char *message)
+{
+  asynMotorBurst burst;
+  double elapsed;
+  int i;
+  asynStatus status;
+
+  status = startCommandProgram(message);
+  if (status) return status;
+
+  burst.add("IGLOBAL(%d) = %d", ENSEMBLE_IGLOBAL_NUM_IARG, numArgs);
+  for (i=0; i<numArgs; i++) {
+    burst.add("IGLOBAL(%d) = %d", ENSEMBLE_IGLOBAL_IARG1+i, args[i]);
+  }
+  burst.add("IGLOBAL(%d) = %d", ENSEMBLE_IGLOBAL_CMD, command);
+  status = writeBurst(&burst);
+  if (status) {
+    sprintf(message, "Error sending command %d to doCommand.bcx", command);
+    return status;
+  }
+
+  sprintf(outString_, "IGLOBAL(%d)", ENSEMBLE_IGLOBAL_CMD);
+  for (elapsed=0.; elapsed<ENSEMBLE_COMMAND_TIMEOUT; elapsed+=0.01) {
+    status = sendAndReceive(outString_, inString_, sizeof(inString_));
+    if ((status == asynSuccess) && (inString_[0] == ASCII_ACK_CHAR) &&
+        (atoi(&inString_[1]) == -command)) return asynSuccess;
+    epicsThreadSleep(0.01);
+  }
+  sprintf(message, "Timeout waiting for doCommand.bcx to execute command %d", command);
+  return asynError;
+}
+
+
+/* These are the functions for profile moves */
+
+/** Checks that the profile fits into the DOPROFILE command and the DGLOBAL variables.
+  * \param[in] numProfileAxes The number of axes in the profile
+  * \param[in] numPoints The number of profile points
+  * \param[out] message The error message */
+asynStatus EnsembleController::checkProfile(int numProfileAxes, int numPoints, char *message)
+{
+  int numGlobals = (numPoints + 1) * (2 * numProfileAxes + 1);
+
+  if (numProfileAxes > ENSEMBLE_MAX_PROFILE_AXES) {
+    sprintf(message, "Too many axes in profile, maximum is %d", ENSEMBLE_MAX_PROFILE_AXES);
+    return asynError;
+  }
+  if (numGlobals > globalDoubles_) {
+    sprintf(message, "Profile needs %d DGLOBALs, GlobalDoubles=%d", numGlobals, globalDoubles_);
+    return asynError;
+  }
+  return asynSuccess;
+}
+
+/** Writes the PVT points of the profile to the DGLOBAL variables.
+  * Each PVT point is stored as the position and velocity of each axis, followed by the incremental time.
+  * \param[out] message The error message */
+asynStatus EnsembleController::loadProfile(char *message)
+{
+  EnsembleAxis *pAxis;
+  asynMotorBurst burst;
+  int pvtPoint, j;
+  int index = 0;
+  double values[2];
+  asynStatus status = asynSuccess;
+
+  for (pvtPoint=0; pvtPoint<=numProfilePoints_; pvtPoint++) {
+    for (j=0; j<numProfileAxes_; j++) {
+      pAxis = getAxis(profileAxes_[j]);
+      values[0] = profilePosition(pAxis, pvtPoint);
+      values[1] = profileVelocity(pAxis, pvtPoint);
+      if (burst.numCommands_ + 2 > MAX_BURST_COMMANDS) status = writeBurst(&burst);
+      burst.add("DGLOBAL(%d) = %.*f", index++, pAxis->maxDigits_, values[0]);
+      burst.add("DGLOBAL(%d) = %.*f", index++, pAxis->maxDigits_, values[1]);
+    }
+    if (burst.numCommands_ + 1 > MAX_BURST_COMMANDS) status = writeBurst(&burst);
+    burst.add("DGLOBAL(%d) = %.6f", index++, profileDuration(pvtPoint));
+    if (status) break;
+  }
+  if (status == asynSuccess) status = writeBurst(&burst);
+  if (status) sprintf(message, "Error writing profile to DGLOBAL variables");
+  return status;
+}
+
+/** Sends the DOPROFILE command to doCommand.bcx.
+  * \param[out] message The error message */
+asynStatus EnsembleController::startProfile(char *message)
+{
+  asynMotorBurst burst;
+  int j;
+  asynStatus status;
+
+  burst.add("IGLOBAL(%d) = 0", ENSEMBLE_IGLOBAL_CMD);
+  burst.add("IGLOBAL(%d) = %d", ENSEMBLE_IGLOBAL_NUM_IARG, numProfileAxes_);
+  burst.add("IGLOBAL(%d) = %d", ENSEMBLE_IGLOBAL_NUM_POINTS, numProfilePoints_+1);
+  for (j=0; j<numProfileAxes_; j++) {
+    burst.add("IGLOBAL(%d) = %d", ENSEMBLE_IGLOBAL_IARG1+j, getAxis(profileAxes_[j])->axisId_);
+  }
+  status = writeBurst(&burst);
+  if (status) {
+    sprintf(message, "Error writing profile arguments to IGLOBAL variables");
+    return status;
+  }
+
+  status = startCommandProgram(message);
+  if (status) return status;
+
+  sprintf(outString_, "IGLOBAL(%d) = %d", ENSEMBLE_IGLOBAL_CMD, ENSEMBLE_CMD_DOPROFILE);
+  status = sendAndReceive(outString_, inString_, sizeof(inString_));
+  if (status || (inString_[0] != ASCII_ACK_CHAR)) {
+    sprintf(message, "Error sending DOPROFILE command");
+    return asynError;
+  }
+  return asynSuccess;
+}
+
+/** Checks whether the profile is still running.
+  * doCommand.bcx negates the command when it has queued the last PVT point, after that
+  * the profile runs until the axes have stopped.
+  * \param[out] running true while the profile is running
+  * \param[out] message The error message */
+asynStatus EnsembleController::runningProfile(bool *running, char *message)
+{
+  asynMotorBurst burst;
+  int j;
+  asynStatus status;
+
+  *running = true;
+  burst.add("IGLOBAL(%d)", ENSEMBLE_IGLOBAL_CMD);
+  burst.add("TASKSTATE(%d)", ENSEMBLE_PROFILE_TASK);
+  status = writeReadBurst(&burst, AEROTECH_TIMEOUT);
+  if (status) {
+    sprintf(message, "Error reading state of doCommand.bcx");
+    return status;
+  }
+  if (atoi(burst.reply(1)+1) == 6) {
+    sprintf(message, "doCommand.bcx in task %d is in error", ENSEMBLE_PROFILE_TASK);
+    return asynError;
+  }
+  if (atoi(burst.reply(0)+1) != -ENSEMBLE_CMD_DOPROFILE) return asynSuccess;
+  for (j=0; j<numProfileAxes_; j++) {
+    if (getAxis(profileAxes_[j])->moving_) return asynSuccess;
+  }
+  *running = false;
+  return asynSuccess;
+}
+
+/** Stops the axes of the profile and doCommand.bcx. */
+asynStatus EnsembleController::stopProfile()
+{
+  EnsembleAxis *pAxis;
+  char *pos;
+  int j;
+  asynStatus status;
+
+  pos = outString_ + sprintf(outString_, "ABORT");
+  for (j=0; j<numProfileAxes_; j++) {
+    pAxis = getAxis(profileAxes_[j]);
+    pos += sprintf(pos, " @%d", pAxis->axisId_);
+  }
+  status = sendAndReceive(outString_, inString_, sizeof(inString_));
+  sprintf(outString_, "PROGRAM STOP %d", ENSEMBLE_PROFILE_TASK);
+  sendAndReceive(outString_, inString_, sizeof(inString_));
+  return status;
+}
+
+
+/* These are the functions for PSO fly scans */
+
+/** Allocates the pulse position arrays of the fly scans.
+  * \param[in] maxPulses The maximum number of pulses of a fly scan */
+asynStatus EnsembleController::initializeFlyScan(size_t maxPulses)
+{
+  if (flyPulsePositions_) free(flyPulsePositions_);
+  flyPulsePositions_ = (double *)calloc(maxPulses, sizeof(double));
+  if (flyEncoderPositions_) free(flyEncoderPositions_);
+  flyEncoderPositions_ = (double *)calloc(maxPulses, sizeof(double));
+  maxFlyPulses_ = maxPulses;
+  return asynSuccess;
+}
+
+/** Called when asyn clients call pasynInt32->write().
+  * Starts the taxi and fly moves and aborts fly scans.
+  * For all other functions it calls asynMotorController::writeInt32.
+  * \param[in] pasynUser asynUser structure that encodes the reason and address.
+  * \param[in] value     Value to write. */
+asynStatus EnsembleController::writeInt32(asynUser *pasynUser, epicsInt32 value)
+{
+  int function = pasynUser->reason;
+  EnsembleAxis *pAxis;
+  asynStatus status = asynSuccess;
+  static const char *functionName = "writeInt32";
+
+  pAxis = getAxis(pasynUser);
+  if (!pAxis) return asynError;
+
+  if ((function != EnsembleFlyTaxi_) && (function != EnsembleFlyFly_) && (function != EnsembleFlyAbort_)) {
+    return asynMotorController::writeInt32(pasynUser, value);
+  }
+
+  pAxis->setIntegerParam(function, value);
+  if (function == EnsembleFlyAbort_) {
+    status = abortFlyScan();
+  } else if (value && (function == EnsembleFlyTaxi_)) {
+    status = taxiFlyScan(pAxis);
+  } else if (value && (function == EnsembleFlyFly_)) {
+    status = flyFlyScan(pAxis);
+  }
+  pAxis->callParamCallbacks();
+  if (status)
+    asynPrint(pasynUser, ASYN_TRACE_ERROR,
+        "%s:%s: error, status=%d function=%d, value=%d\n",
+        driverName, functionName, status, function, value);
+  return status;
+}
+
+/** Called when asyn clients call pasynFloat64Array->read().
+  * Returns the pulse and encoder positions of the last fly scan of the axis.
+  * For all other functions it calls asynMotorController::readFloat64Array.
+  * \param[in] pasynUser asynUser structure that encodes the reason and address.
+  * \param[out] value Array of values read.
+  * \param[in] nElements Size of the value array.
+  * \param[out] nRead Number of values read. */
+asynStatus EnsembleController::readFloat64Array(asynUser *pasynUser, epicsFloat64 *value,
+                                                size_t nElements, size_t *nRead)
+{
+  int function = pasynUser->reason;
+  EnsembleAxis *pAxis;
+  int numValues;
+
+  if ((function != EnsembleFlyPulsePositions_) && (function != EnsembleFlyEncoderPositions_)) {
+    return asynMotorController::readFloat64Array(pasynUser, value, nElements, nRead);
+  }
+  pAxis = getAxis(pasynUser);
+  if (!pAxis || !flyPulsePositions_) return asynError;
+  getIntegerParam(pAxis->axisNo_, (function == EnsembleFlyPulsePositions_) ? EnsembleFlyNumPulses_ : EnsembleFlyNumCaptured_,
+                  &numValues);
+  *nRead = numValues;
+  if (*nRead > nElements) *nRead = nElements;
+  memcpy(value, (function == EnsembleFlyPulsePositions_) ? flyPulsePositions_ : flyEncoderPositions_,
+         *nRead*sizeof(double));
+  return asynSuccess;
+}
+
+/** Computes the taxi and end positions, the PSO window and the pulse positions of a fly scan.
+  * These are the calculations of EnsemblePSOFly.db: the axis accelerates from the taxi position,
+  * which is a whole number of steps before the first pulse, and the PSO window extends half a
+  * step beyond the data range.  The window is relative to the taxi position, where the PSO is reset.
+  * \param[in] pAxis The axis of the fly scan
+  * \param[out] message The error message */
+asynStatus EnsembleController::computeFlyScan(EnsembleAxis *pAxis, char *message)
+{
+  int axis = pAxis->axisNo_;
+  double start, end, step, speed, accelTime, trigFrac, detSetup;
+  double accelDist, taxiDist, dataOffset, rangeOffset, eps;
+  int capture, maxCapture;
+  int k, kMin, kMax;
+
+  getDoubleParam(axis, EnsembleFlyStart_, &start);
+  getDoubleParam(axis, EnsembleFlyEnd_, &end);
+  getDoubleParam(axis, EnsembleFlyStep_, &step);
+  getDoubleParam(axis, EnsembleFlySpeed_, &speed);
+  getDoubleParam(axis, EnsembleFlyAccelTime_, &accelTime);
+  getIntegerParam(axis, EnsembleFlyPulseType_, &flyPulseType_);
+  getDoubleParam(axis, EnsembleFlyTrigFrac_, &trigFrac);
+  getDoubleParam(axis, EnsembleFlyDetSetup_, &detSetup);
+  getIntegerParam(axis, EnsembleFlyCapture_, &capture);
+
+  if (maxFlyPulses_ == 0) {
+    sprintf(message, "EnsembleCreateFlyScan was not called");
+    return asynError;
+  }
+  step = fabs(step);
+  if ((step <= 0.) || (speed <= 0.) || (start == end)) {
+    sprintf(message, "Invalid fly scan, step=%g speed=%g start=%g end=%g", step, speed, start, end);
+    return asynError;
+  }
+  if (accelTime < 0.) accelTime = 0.;
+  flyDirection_ = (end > start) ? 1. : -1.;
+  flyStep_ = step;
+  flySpeed_ = speed;
+  flyAccel_ = (accelTime > 0.) ? speed / accelTime : 0.;
+
+  accelDist   = speed * accelTime / 2.;
+  taxiDist    = ceil(accelDist / step) * step;
+  dataOffset  = (flyPulseType_ == ENSEMBLE_FLY_PULSE_GATE) ? 0. : trigFrac * step;
+  flyTaxiPos_ = start + dataOffset * flyDirection_ - taxiDist * flyDirection_;
+  flyEndPos_  = end + accelDist * flyDirection_;
+  rangeOffset = flyTaxiPos_ + flyDirection_ * step / 2.;
+  flyWindowStart_ = MIN(start, end) - rangeOffset - ((start > end) ? step : 0.);
+  flyWindowEnd_   = MAX(start, end) - rangeOffset - ((start > end) ? step : 0.);
+
+  if (flyPulseType_ == ENSEMBLE_FLY_PULSE_GATE) {
+    if (detSetup >= step / speed) {
+      sprintf(message, "Detector setup time %g s is longer than a step, %g s", detSetup, step / speed);
+      return asynError;
+    }
+    flyPulsePeriod_ = (int)(step / speed * 1.e6);
+    flyPulseOn_     = (int)((step / speed - detSetup) * 1.e6);
+  }
+
+  // The PSO fires every step from the taxi position, the window selects the pulses in the data range
+  eps = step * 1.e-6;
+  if (flyDirection_ > 0) {
+    kMin = (int)ceil((flyWindowStart_ - eps) / step);
+    kMax = (int)floor((flyWindowEnd_ + eps) / step);
+  } else {
+    kMin = (int)ceil((-flyWindowEnd_ - eps) / step);
+    kMax = (int)floor((-flyWindowStart_ + eps) / step);
+  }
+  if (kMin < 1) kMin = 1;
+  flyNumPulses_ = kMax - kMin + 1;
+  if (flyNumPulses_ < 1) {
+    sprintf(message, "No pulses in the PSO window");
+    return asynError;
+  }
+  if (flyNumPulses_ > (int)maxFlyPulses_) {
+    sprintf(message, "Fly scan has %d pulses, maximum is %d", flyNumPulses_, (int)maxFlyPulses_);
+    return asynError;
+  }
+  maxCapture = globalIntegers_ - ENSEMBLE_IGLOBAL_DATA;
+  flyCapture_ = capture ? true : false;
+  if (flyCapture_ && (flyNumPulses_ > maxCapture)) {
+    sprintf(message, "Capture of %d pulses needs %d IGLOBALs, GlobalIntegers=%d",
+            flyNumPulses_, flyNumPulses_ + ENSEMBLE_IGLOBAL_DATA, globalIntegers_);
+    return asynError;
+  }
+  for (k=kMin; k<=kMax; k++) {
+    flyPulsePositions_[k-kMin] = flyTaxiPos_ + flyDirection_ * k * step;
+  }
+
+  pAxis->setDoubleParam(EnsembleFlyTaxiPosition_, flyTaxiPos_);
+  pAxis->setDoubleParam(EnsembleFlyEndPosition_, flyEndPos_);
+  pAxis->setDoubleParam(EnsembleFlyWindowStart_, flyWindowStart_);
+  pAxis->setDoubleParam(EnsembleFlyWindowEnd_, flyWindowEnd_);
+  pAxis->setIntegerParam(EnsembleFlyNumPulses_, flyNumPulses_);
+  pAxis->setIntegerParam(EnsembleFlyNumCaptured_, 0);
+  doCallbacksFloat64Array(flyPulsePositions_, flyNumPulses_, EnsembleFlyPulsePositions_, axis);
+  return asynSuccess;
+}
+
+/** Computes the fly scan and moves the axis to the taxi position.
+  * The poller configures and arms the PSO when the axis has stopped there.
+  * \param[in] pAxis The axis of the fly scan */
+asynStatus EnsembleController::taxiFlyScan(EnsembleAxis *pAxis)
+{
+  asynMotorBurst burst;
+  double velocity, acceleration;
+  char message[MAX_CONTROLLER_STRING_SIZE];
+  asynStatus status;
+
+  if (flyAxis_ && ((flyAxis_ != pAxis) || (flyState_ != ENSEMBLE_FLY_READY))) {
+    pAxis->setIntegerParam(EnsembleFlyTaxi_, 0);
+    pAxis->setStringParam(EnsembleFlyMessage_, "Fly scan of another axis is active");
+    return asynError;
+  }
+  flyAxis_ = pAxis;
+  strcpy(message, "");
+  pAxis->setStringParam(EnsembleFlyMessage_, message);
+  pAxis->setIntegerParam(EnsembleFlyStatus_, PROFILE_STATUS_UNDEFINED);
+  status = computeFlyScan(pAxis, message);
+  if (status) {
+    setFlyScanDone(PROFILE_STATUS_FAILURE, message);
+    return status;
+  }
+
+  // The taxi move uses the speed of the motor record
+  getDoubleParam(pAxis->axisNo_, motorVelocity_, &velocity);
+  getDoubleParam(pAxis->axisNo_, motorAccel_, &acceleration);
+  velocity = (velocity > 0.) ? velocity * fabs(pAxis->stepSize_) : flySpeed_;
+  burst.add("ABS");
+  if (acceleration > 0.) {
+    burst.add("RAMP RATE @%d %.*f", pAxis->axisId_, pAxis->maxDigits_, acceleration * fabs(pAxis->stepSize_));
+  }
+  burst.add("LINEAR @%d %.*f F%.*f", pAxis->axisId_, pAxis->maxDigits_, flyTaxiPos_, pAxis->maxDigits_, velocity);
+  status = writeBurst(&burst);
+  if (status) {
+    setFlyScanDone(PROFILE_STATUS_FAILURE, "Error moving to the taxi position");
+    return status;
+  }
+  flyState_ = ENSEMBLE_FLY_TAXIING;
+  flyPolls_ = 0;
+  pAxis->setIntegerParam(EnsembleFlyState_, flyState_);
+  wakeupPoller();
+  return asynSuccess;
+}
+
+/** Resets, configures and arms the PSO of the fly scan axis with one burst.
+  * \param[out] message The error message */
+asynStatus EnsembleController::armFlyScan(char *message)
+{
+  asynMotorBurst burst;
+  int id = flyAxis_->axisId_;
+  int digits = flyAxis_->maxDigits_;
+  asynStatus status;
+
+  burst.add("PSOCONTROL @%d RESET", id);
+  burst.add("PSOOUTPUT @%d CONTROL 1", id);
+  if (flyPulseType_ == ENSEMBLE_FLY_PULSE_GATE) {
+    burst.add("PSOPULSE @%d TIME %d,%d", id, flyPulsePeriod_, flyPulseOn_);
+  } else {
+    burst.add("PSOPULSE @%d TIME 2,1", id);
+  }
+  burst.add("PSOOUTPUT @%d PULSE WINDOW MASK", id);
+  burst.add("PSOTRACK @%d INPUT %d", id, ENSEMBLE_PSO_INPUT);
+  burst.add("PSODISTANCE @%d FIXED %.*f UNITS", id, digits, flyStep_);
+  burst.add("PSOWINDOW @%d 1 INPUT %d", id, ENSEMBLE_PSO_INPUT);
+  burst.add("PSOWINDOW @%d 1 RANGE %.*f,%.*f UNITS", id, digits, flyWindowStart_, digits, flyWindowEnd_);
+  burst.add("PSOCONTROL @%d ARM", id);
+  status = writeBurst(&burst);
+  if (status) sprintf(message, "Error configuring the PSO");
+  return status;
+}
+
+/** Starts the DATAACQ capture if enabled, and arms the PSO and starts the move through the
+  * data range with one burst.
+  * \param[in] pAxis The axis of the fly scan */
+asynStatus EnsembleController::flyFlyScan(EnsembleAxis *pAxis)
+{
+  asynMotorBurst burst;
+  int args[2];
+  char message[MAX_CONTROLLER_STRING_SIZE];
+  asynStatus status;
+
+  if ((pAxis != flyAxis_) || (flyState_ != ENSEMBLE_FLY_READY)) {
+    pAxis->setIntegerParam(EnsembleFlyFly_, 0);
+    pAxis->setStringParam(EnsembleFlyMessage_, "Axis has not taxied");
+    return asynError;
+  }
+  strcpy(message, "");
+
+  if (flyCapture_) {
+    args[0] = pAxis->axisId_;
+    args[1] = ENSEMBLE_DATAACQ_TRIG_PSO;
+    status = runCommand(ENSEMBLE_CMD_DATAACQ_TRIG, 2, args, message);
+    if (status == asynSuccess) {
+      args[1] = ENSEMBLE_DATAACQ_INP_ENCODER;
+      status = runCommand(ENSEMBLE_CMD_DATAACQ_INP, 2, args, message);
+    }
+    if (status == asynSuccess) {
+      args[1] = flyNumPulses_;
+      status = runCommand(ENSEMBLE_CMD_DATAACQ_ON, 2, args, message);
+    }
+    if (status) {
+      stopFlyScan(true);
+      setFlyScanDone(PROFILE_STATUS_FAILURE, message);
+      return status;
+    }
+  }
+
+  burst.add("PSOCONTROL @%d ARM", pAxis->axisId_);
+  burst.add("ABS");
+  if (flyAccel_ > 0.) {
+    burst.add("RAMP RATE @%d %.*f", pAxis->axisId_, pAxis->maxDigits_, flyAccel_);
+  }
+  burst.add("LINEAR @%d %.*f F%.*f", pAxis->axisId_, pAxis->maxDigits_, flyEndPos_, pAxis->maxDigits_, flySpeed_);
+  status = writeBurst(&burst);
+  if (status) {
+    stopFlyScan(flyCapture_);
+    setFlyScanDone(PROFILE_STATUS_FAILURE, "Error starting the fly move");
+    return status;
+  }
+  flyState_ = ENSEMBLE_FLY_FLYING;
+  flyPolls_ = 0;
+  pAxis->setIntegerParam(EnsembleFlyState_, flyState_);
+  wakeupPoller();
+  return asynSuccess;
+}
+
+/** Stops the fly scan axis and disables its PSO.
+  * \param[in] dataAcq Also turn off the DATAACQ capture */
+asynStatus EnsembleController::stopFlyScan(bool dataAcq)
+{
+  asynMotorBurst burst;
+  int args[1];
+  char message[MAX_CONTROLLER_STRING_SIZE];
+  asynStatus status;
+
+  burst.add("ABORT @%d", flyAxis_->axisId_);
+  burst.add("PSOWINDOW @%d 1 OFF", flyAxis_->axisId_);
+  burst.add("PSOCONTROL @%d OFF", flyAxis_->axisId_);
+  status = writeBurst(&burst);
+  if (dataAcq) {
+    args[0] = flyAxis_->axisId_;
+    runCommand(ENSEMBLE_CMD_DATAACQ_OFF, 1, args, message);
+  }
+  return status;
+}
+
+/** Aborts the fly scan. */
+asynStatus EnsembleController::abortFlyScan()
+{
+  asynStatus status;
+
+  if (!flyAxis_) return asynSuccess;
+  status = stopFlyScan(flyCapture_ && (flyState_ == ENSEMBLE_FLY_FLYING));
+  setFlyScanDone(PROFILE_STATUS_ABORT, "Fly scan aborted");
+  return status;
+}
+
+/** Reads the encoder positions that DATAACQ recorded at the pulses.
+  * doCommand.bcx copies them to the IGLOBALs from ENSEMBLE_IGLOBAL_DATA, which are read with bursts.
+  * DATAACQ records the position feedback in counts, as in EnsembleTrajectoryScan.st.
+  * \param[out] message The error message */
+asynStatus EnsembleController::readFlyScan(char *message)
+{
+  asynMotorBurst burst;
+  int args[3];
+  int first, i;
+  char offMessage[MAX_CONTROLLER_STRING_SIZE];
+  asynStatus status;
+
+  args[0] = flyAxis_->axisId_;
+  args[1] = ENSEMBLE_IGLOBAL_DATA;
+  args[2] = flyNumPulses_;
+  status = runCommand(ENSEMBLE_CMD_DATAACQ_READ, 3, args, message);
+  runCommand(ENSEMBLE_CMD_DATAACQ_OFF, 1, args, offMessage);
+  if (status) return status;
+
+  for (first=0; first<flyNumPulses_; first+=MAX_BURST_COMMANDS) {
+    burst.clear();
+    for (i=first; (i<flyNumPulses_) && (i<first+MAX_BURST_COMMANDS); i++) {
+      burst.add("IGLOBAL(%d)", ENSEMBLE_IGLOBAL_DATA + i);
+    }
+    status = writeReadBurst(&burst, AEROTECH_TIMEOUT);
+    for (i=0; (status == asynSuccess) && (i<burst.numCommands_); i++) {
+      if (burst.reply(i)[0] != ASCII_ACK_CHAR) {
+        status = asynError;
+        break;
+      }
+      flyEncoderPositions_[first+i] = atoi(burst.reply(i)+1) * fabs(flyAxis_->stepSize_);
+    }
+    if (status) {
+      sprintf(message, "Error reading the encoder positions");
+      return status;
+    }
+    flyNumCaptured_ = first + burst.numCommands_;
+  }
+  return asynSuccess;
+}
+
+/** Advances a fly scan, called by the poll() of the controller after the axes were read.
+  * Arms the PSO when the axis has reached the taxi position, and disables it and reads back
+  * the encoder positions when the axis has reached the end position.
+  * \return The status of the commands sent to the controller, the scan itself is failed with a message */
+asynStatus EnsembleController::pollFlyScan()
+{
+  char message[MAX_CONTROLLER_STRING_SIZE];
+  asynMotorBurst burst;
+  int axis;
+  asynStatus status;
+
+  if (!flyAxis_ || ((flyState_ != ENSEMBLE_FLY_TAXIING) && (flyState_ != ENSEMBLE_FLY_FLYING))) return asynSuccess;
+  // The first poll after the move command can still see the axis stopped
+  if (++flyPolls_ < 2) return asynSuccess;
+  if (flyAxis_->moving_ || !flyAxis_->statusValid_) return asynSuccess;
+  axis = flyAxis_->axisNo_;
+  strcpy(message, "");
+
+  if (flyAxis_->lastFault_) {
+    sprintf(message, "Axis fault 0x%X", flyAxis_->lastFault_);
+    status = stopFlyScan(flyCapture_ && (flyState_ == ENSEMBLE_FLY_FLYING));
+    setFlyScanDone(PROFILE_STATUS_FAILURE, message);
+    return status;
+  }
+
+  if (flyState_ == ENSEMBLE_FLY_TAXIING) {
+    status = armFlyScan(message);
+    if (status) {
+      setFlyScanDone(PROFILE_STATUS_FAILURE, message);
+      return status;
+    }
+    flyState_ = ENSEMBLE_FLY_READY;
+    flyAxis_->setIntegerParam(EnsembleFlyState_, flyState_);
+    flyAxis_->setIntegerParam(EnsembleFlyStatus_, PROFILE_STATUS_SUCCESS);
+    flyAxis_->setIntegerParam(EnsembleFlyTaxi_, 0);
+    flyAxis_->callParamCallbacks();
+    return asynSuccess;
+  }
+
+  flyState_ = ENSEMBLE_FLY_READING;
+  flyAxis_->setIntegerParam(EnsembleFlyState_, flyState_);
+  flyAxis_->callParamCallbacks();
+  burst.add("PSOWINDOW @%d 1 OFF", flyAxis_->axisId_);
+  burst.add("PSOCONTROL @%d OFF", flyAxis_->axisId_);
+  status = writeBurst(&burst);
+  if (status) sprintf(message, "Error disabling the PSO");
+  flyNumCaptured_ = 0;
+  if (flyCapture_ && (status == asynSuccess)) status = readFlyScan(message);
+  flyAxis_->setIntegerParam(EnsembleFlyNumCaptured_, flyNumCaptured_);
+  doCallbacksFloat64Array(flyEncoderPositions_, flyNumCaptured_, EnsembleFlyEncoderPositions_, axis);
+  setFlyScanDone(status ? PROFILE_STATUS_FAILURE : PROFILE_STATUS_SUCCESS, message);
+  return status;
+}
+
+/** Ends the fly scan and clears the taxi and fly commands.
+  * \param[in] status The status, one of the ProfileStatus values
+  * \param[in] message The message */
+void EnsembleController::setFlyScanDone(int status, const char *message)
+{
+  if (!flyAxis_) return;
+  flyAxis_->setIntegerParam(EnsembleFlyStatus_, status);
+  flyAxis_->setStringParam(EnsembleFlyMessage_, message);
+  if (status != PROFILE_STATUS_SUCCESS) {
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+              "%s:flyScan: axis %d %s\n",
+              driverName, flyAxis_->axisNo_, message);
+  }
+  /* Clear the commands, these are "busy" records */
+  flyAxis_->setIntegerParam(EnsembleFlyTaxi_, 0);
+  flyAxis_->setIntegerParam(EnsembleFlyFly_, 0);
+  flyState_ = ENSEMBLE_FLY_IDLE;
+  flyAxis_->setIntegerParam(EnsembleFlyState_, flyState_);
+  flyAxis_->callParamCallbacks();
+  flyAxis_ = NULL;
+}
+
+
+// These are the EnsembleAxis methods
+
+/** Creates a new EnsembleAxis object.
+  * Reads the configuration of the axis from the controller.
+  * \param[in] pC Pointer to the EnsembleController to which this axis belongs.
+  * \param[in] axisNo Index number of this axis, range 0 to pC->numAxes_-1.
+  * \param[in] axisId Axis number on the controller.
+  */
+EnsembleAxis::EnsembleAxis(EnsembleController *pC, int axisNo, int axisId)
+  : AerotechAxis(pC, axisNo),
+    pC_(pC),
+    axisId_(axisId)
+{
+  int digits;
+
+  sprintf(axisName_, "@%d", axisId);
+  swconfig_.All = 0;
+  axisStatus_.All = 0;
+
+  if (getParameter(PARAMETERID_PositionFeedbackType) && (atoi(&pC_->inString_[1]) > 0)) {
+    setIntegerParam(pC_->motorStatusHasEncoder_, 1);
+  }
+  if (getParameter(PARAMETERID_CountsPerUnit)) stepSize_ = 1. / atof(&pC_->inString_[1]);
+  digits = (int) -log10(fabs(stepSize_)) + 2;
+  if (digits < 1) digits = 1;
+  maxDigits_ = digits;
+
+  if (getParameter(PARAMETERID_HomeOffset)) homePreset_ = atof(&pC_->inString_[1]);
+  if (getParameter(PARAMETERID_HomeSetup)) homeDirection_ = atoi(&pC_->inString_[1]);
+  if (getParameter(PARAMETERID_EndOfTravelLimitSetup)) swconfig_.All = atoi(&pC_->inString_[1]);
+  if (getParameter(PARAMETERID_ReverseMotionDirection)) reverseDirec_ = atoi(&pC_->inString_[1]) ? true : false;
+
+  sprintf(pC_->outString_, "RAMP MODE @%d RATE", axisId_);
+  pC_->sendAndReceive(pC_->outString_, pC_->inString_, sizeof(pC_->inString_));
+
+  // Set GAIN_SUPPORT on so that at least, CNEN functions
+  setIntegerParam(pC_->motorStatusGainSupport_, 1);
+}
+
+/** Reads a parameter of the axis into pC_->inString_.
+  * \param[in] parameterId The PARAMETERID_ of the parameter
+  * \return true if the controller acknowledged the query */
+bool EnsembleAxis::getParameter(int parameterId)
+{
+  sprintf(pC_->outString_, "GETPARM(@%d, %d)", axisId_, parameterId);
+  pC_->sendAndReceive(pC_->outString_, pC_->inString_, sizeof(pC_->inString_));
+  return (pC_->inString_[0] == ASCII_ACK_CHAR);
+}
+
+/** Reports on status of the axis
+  * \param[in] fp The file pointer on which report information will be written
+  * \param[in] level The level of report detail desired
+  *
+  * After printing device-specific information calls asynMotorAxis::report()
+  */
+void EnsembleAxis::report(FILE *fp, int level)
+{
+  if (level > 0) {
+    fprintf(fp, "  axis %d\n"
+                "    axis ID %d\n"
+                "    step size %g\n"
+                "    max digits %d\n"
+                "    reverse direction %d\n"
+                "    axis status 0x%x\n"
+                "    last fault 0x%x\n",
+            axisNo_, axisId_, stepSize_, maxDigits_, reverseDirec_,
+            axisStatus_.All, lastFault_);
+  }
+
+  // Call the base class method
+  asynMotorAxis::report(fp, level);
+}
+
+asynStatus EnsembleAxis::move(double position, int relative, double minVelocity, double maxVelocity, double acceleration)
+{
+  asynStatus status;
+
+  status = pC_->sendAndReceive(relative ? "INC" : "ABS", pC_->inString_, sizeof(pC_->inString_));
+  if (status) return status;
+  if (acceleration > 0) { /* only use the acceleration if > 0 */
+    sprintf(pC_->outString_, "RAMP RATE %.*f", maxDigits_, acceleration * fabs(stepSize_));
+    pC_->sendAndReceive(pC_->outString_, pC_->inString_, sizeof(pC_->inString_));
+  }
+  sprintf(pC_->outString_, "LINEAR @%d %.*f F%.*f", axisId_, maxDigits_, position * fabs(stepSize_),
+          maxDigits_, maxVelocity * fabs(stepSize_));
+  status = pC_->sendAndReceive(pC_->outString_, pC_->inString_, sizeof(pC_->inString_));
+  return status;
+}
+
+asynStatus EnsembleAxis::home(double minVelocity, double maxVelocity, double acceleration, int forwards)
+{
+  epicsUInt32 hparam;
+  asynStatus status;
+
+  if (maxVelocity > 0) {
+    sprintf(pC_->outString_, "SETPARM @%d, %d, %.*f", axisId_, PARAMETERID_HomeSpeed, maxDigits_,
+            maxVelocity * fabs(stepSize_));
+    pC_->sendAndReceive(pC_->outString_, pC_->inString_, sizeof(pC_->inString_));
+  }
+  if (acceleration > 0) {
+    sprintf(pC_->outString_, "SETPARM @%d, %d, %.*f", axisId_, PARAMETERID_HomeRampRate, maxDigits_,
+            acceleration * fabs(stepSize_));
+    pC_->sendAndReceive(pC_->outString_, pC_->inString_, sizeof(pC_->inString_));
+  }
+
+  // Adjust the home direction for the ReverseMotionDirection parameter
+  hparam = homeDirection_;
+  if (forwards == (int) reverseDirec_) hparam |= 0x00000001;
+  else                                 hparam &= 0xFFFFFFFE;
+  homeDirection_ = hparam;
+  sprintf(pC_->outString_, "SETPARM @%d, %d, %d", axisId_, PARAMETERID_HomeSetup, hparam);
+  pC_->sendAndReceive(pC_->outString_, pC_->inString_, sizeof(pC_->inString_));
+
+  // Set IGLOBAL(32) for one axis and IGLOBAL(33) for the axis number, according to the HomeAsync.ab protocol
+  pC_->sendAndReceive("IGLOBAL(32) = 1", pC_->inString_, sizeof(pC_->inString_));
+  sprintf(pC_->outString_, "IGLOBAL(33) = %d", axisId_);
+  pC_->sendAndReceive(pC_->outString_, pC_->inString_, sizeof(pC_->inString_));
+
+  status = pC_->sendAndReceive("PROGRAM RUN 5, \"HomeAsync.bcx\"", pC_->inString_, sizeof(pC_->inString_));
+  return status;
+}
+
+asynStatus EnsembleAxis::moveVelocity(double minVelocity, double maxVelocity, double acceleration)
+{
+  asynStatus status;
+
+  sprintf(pC_->outString_, "SETPARM @%d, %d, %.*f", axisId_, PARAMETERID_AbortDecelRate,
+          maxDigits_, acceleration * fabs(stepSize_));
+  pC_->sendAndReceive(pC_->outString_, pC_->inString_, sizeof(pC_->inString_));
+  sprintf(pC_->outString_, "RAMP RATE @%d %.*f", axisId_, maxDigits_, acceleration * fabs(stepSize_));
+  pC_->sendAndReceive(pC_->outString_, pC_->inString_, sizeof(pC_->inString_));
+  sprintf(pC_->outString_, "FREERUN @%d %.*f", axisId_, maxDigits_, maxVelocity * fabs(stepSize_));
+  status = pC_->sendAndReceive(pC_->outString_, pC_->inString_, sizeof(pC_->inString_));
+  return status;
+}
+
+asynStatus EnsembleAxis::stop(double acceleration)
+{
+  asynStatus status;
+
+  /* we can't accurately determine which type of motion is occurring on the controller,
+   * so don't worry about the acceleration rate, just stop the motion on the axis */
+  sprintf(pC_->outString_, "ABORT @%d", axisId_);
+  status = pC_->sendAndReceive(pC_->outString_, pC_->inString_, sizeof(pC_->inString_));
+  return status;
+}
+
+asynStatus EnsembleAxis::setPosition(double position)
+{
+  asynStatus status;
+
+  sprintf(pC_->outString_, "POSOFFSET SET @%d, %.*f", axisId_, maxDigits_, position * fabs(stepSize_));
+  status = pC_->sendAndReceive(pC_->outString_, pC_->inString_, sizeof(pC_->inString_));
+  return status;
+}
+
+asynStatus EnsembleAxis::setClosedLoop(bool closedLoop)
+{
+  asynStatus status;
+
+  if (!closedLoop) {
+    sprintf(pC_->outString_, "DISABLE @%d", axisId_);
+  } else {
+    sprintf(pC_->outString_, "AXISFAULT @%d", axisId_);
+    status = pC_->sendAndReceive(pC_->outString_, pC_->inString_, sizeof(pC_->inString_));
+    if ((status == asynSuccess) && (pC_->inString_[0] == ASCII_ACK_CHAR) && atoi(&pC_->inString_[1])) {
+      sprintf(pC_->outString_, "FAULTACK @%d", axisId_);
+      pC_->sendAndReceive(pC_->outString_, pC_->inString_, sizeof(pC_->inString_));
+    }
+    sprintf(pC_->outString_, "ENABLE @%d", axisId_);
+  }
+  status = pC_->sendAndReceive(pC_->outString_, pC_->inString_, sizeof(pC_->inString_));
+  // Set indicator to force status update when Enable does not work
+  setIntegerParam(pC_->motorStatusPowerOn_, closedLoop ? 1 : 0);
+
+  // Prevent ASCII interpreter from blocking during MOVEABS/INC commands
+  pC_->sendAndReceive("WAIT MODE NOWAIT", pC_->inString_, sizeof(pC_->inString_));
+  return status;
+}
+
+/** Polls the axis.
+  * This function publishes the status and positions that EnsembleController::poll() read in this cycle.
+  * It calls setIntegerParam() and setDoubleParam() for each item that it polls,
+  * and then calls callParamCallbacks() at the end.
+  * \param[out] moving A flag that is set indicating that the axis is moving (true) or done (false). */
+asynStatus EnsembleAxis::poll(bool *moving)
+{
+  int CW_sw_active, CCW_sw_active;
+
+  *moving = false;
+  if (!statusValid_) {
+    setIntegerParam(pC_->motorStatusCommsError_, 1);
+    callParamCallbacks();
+    return asynError;
+  }
+  setIntegerParam(pC_->motorStatusCommsError_, 0);
+
+  *moving = moving_;
+  setIntegerParam(pC_->motorStatusDone_, moving_ ? 0 : 1);
+  setIntegerParam(pC_->motorStatusPowerOn_, axisStatus_.Bits.axis_enabled);
+  setIntegerParam(pC_->motorStatusAtHome_, axisStatus_.Bits.home_limit);
+  if (reverseDirec_) setIntegerParam(pC_->motorStatusDirection_, axisStatus_.Bits.motion_ccw);
+  else               setIntegerParam(pC_->motorStatusDirection_, !axisStatus_.Bits.motion_ccw);
+
+  CW_sw_active  = !(axisStatus_.Bits.CW_limit  ^ swconfig_.Bits.CWEOTSWstate);
+  CCW_sw_active = !(axisStatus_.Bits.CCW_limit ^ swconfig_.Bits.CCWEOTSWstate);
+  setIntegerParam(pC_->motorStatusHighLimit_, reverseDirec_ ? CCW_sw_active : CW_sw_active);
+  setIntegerParam(pC_->motorStatusLowLimit_,  reverseDirec_ ? CW_sw_active : CCW_sw_active);
+
+  setDoubleParam(pC_->motorEncoderPosition_, encoderPos_);
+  setDoubleParam(pC_->motorPosition_, currentCmdPos_);
+  setIntegerParam(pC_->motorStatusProblem_, lastFault_ ? 1 : 0);
+  callParamCallbacks();
+  return asynSuccess;
+}
+
+/** Code for iocsh registration */
+static const iocshArg EnsembleCreateControllerArg0 = {"Port name", iocshArgString};
+static const iocshArg EnsembleCreateControllerArg1 = {"Ensemble port name", iocshArgString};
+static const iocshArg EnsembleCreateControllerArg2 = {"Number of axes", iocshArgInt};
+static const iocshArg EnsembleCreateControllerArg3 = {"Moving poll period (ms)", iocshArgInt};
+static const iocshArg EnsembleCreateControllerArg4 = {"Idle poll period (ms)", iocshArgInt};
+static const iocshArg * const EnsembleCreateControllerArgs[] = {&EnsembleCreateControllerArg0,
+                                                                &EnsembleCreateControllerArg1,
+                                                                &EnsembleCreateControllerArg2,
+                                                                &EnsembleCreateControllerArg3,
+                                                                &EnsembleCreateControllerArg4};
+static const iocshFuncDef EnsembleCreateControllerDef = {"EnsembleCreateController", 5, EnsembleCreateControllerArgs};
+static void EnsembleCreateControllerCallFunc(const iocshArgBuf *args)
+{
+  EnsembleCreateController(args[0].sval, args[1].sval, args[2].ival, args[3].ival, args[4].ival);
+}
+
+static const iocshArg EnsembleCreateProfileArg0 = {"Controller port name", iocshArgString};
+static const iocshArg EnsembleCreateProfileArg1 = {"Max points", iocshArgInt};
+static const iocshArg * const EnsembleCreateProfileArgs[] = {&EnsembleCreateProfileArg0,
+                                                             &EnsembleCreateProfileArg1};
+static const iocshFuncDef EnsembleCreateProfileDef = {"EnsembleCreateProfile", 2, EnsembleCreateProfileArgs};
+static void EnsembleCreateProfileCallFunc(const iocshArgBuf *args)
+{
+  EnsembleCreateProfile(args[0].sval, args[1].ival);
+}
+
+static const iocshArg EnsembleCreateFlyScanArg0 = {"Controller port name", iocshArgString};
+static const iocshArg EnsembleCreateFlyScanArg1 = {"Max pulses", iocshArgInt};
+static const iocshArg * const EnsembleCreateFlyScanArgs[] = {&EnsembleCreateFlyScanArg0,
+                                                             &EnsembleCreateFlyScanArg1};
+static const iocshFuncDef EnsembleCreateFlyScanDef = {"EnsembleCreateFlyScan", 2, EnsembleCreateFlyScanArgs};
+static void EnsembleCreateFlyScanCallFunc(const iocshArgBuf *args)
+{
+  EnsembleCreateFlyScan(args[0].sval, args[1].ival);
+}
+
+static void EnsembleMotorRegister(void)
+{
+  iocshRegister(&EnsembleCreateControllerDef, EnsembleCreateControllerCallFunc);
+  iocshRegister(&EnsembleCreateProfileDef, EnsembleCreateProfileCallFunc);
+  iocshRegister(&EnsembleCreateFlyScanDef, EnsembleCreateFlyScanCallFunc);
+}
+
+extern "C" {
+epicsExportRegistrar(EnsembleMotorRegister);
+}
@@ -0,0 +1,192 @@
+/*
+FILENAME...   EnsembleDriver.h
+USAGE...      asynMotorController driver for the Aerotech Ensemble.
+
+*/
+
+#ifndef EnsembleDriver_H
+#define EnsembleDriver_H
+
+#include "AerotechController.h"
+#include "drvEnsembleAsyn.h"
+
+#define ENSEMBLE_MAX_AXES          10
+#define ENSEMBLE_POLL_COMMANDS     4    /* Commands per axis in a poll burst */
+#define ENSEMBLE_MAX_PROFILE_AXES  4    /* Axes supported by the DOPROFILE command of doCommand.ab */
+
+/* The integer globals of the doCommand.ab protocol */
+#define ENSEMBLE_IGLOBAL_NUM_POINTS  41
+#define ENSEMBLE_IGLOBAL_NUM_IARG    44
+#define ENSEMBLE_IGLOBAL_CMD         45
+#define ENSEMBLE_IGLOBAL_IARG1       46
+#define ENSEMBLE_IGLOBAL_DATA        50   /* First IGLOBAL of the DATAACQ READ buffer */
+#define ENSEMBLE_CMD_DATAACQ_TRIG    20
+#define ENSEMBLE_CMD_DATAACQ_INP     21
+#define ENSEMBLE_CMD_DATAACQ_ON      22
+#define ENSEMBLE_CMD_DATAACQ_OFF     23
+#define ENSEMBLE_CMD_DATAACQ_READ    24
+#define ENSEMBLE_CMD_DOPROFILE       26
+#define ENSEMBLE_PROFILE_TASK        1
+#define ENSEMBLE_COMMAND_TIMEOUT     2.0  /* Time to wait for doCommand.bcx to finish a command */
+
+/* PSO fly scans */
+#define ENSEMBLE_PSO_INPUT           3    /* PSOTRACK/PSOWINDOW input, the primary encoder */
+#define ENSEMBLE_DATAACQ_TRIG_PSO    2    /* DATAACQ trigger on the PSO output */
+#define ENSEMBLE_DATAACQ_INP_ENCODER 0    /* DATAACQ input of the position feedback */
+
+/** drvInfo strings for the PSO fly scan parameters */
+#define EnsembleFlyStartString          "ENSEMBLE_FLY_START"
+#define EnsembleFlyEndString            "ENSEMBLE_FLY_END"
+#define EnsembleFlyStepString           "ENSEMBLE_FLY_STEP"
+#define EnsembleFlySpeedString          "ENSEMBLE_FLY_SPEED"
+#define EnsembleFlyAccelTimeString      "ENSEMBLE_FLY_ACCEL_TIME"
+#define EnsembleFlyPulseTypeString      "ENSEMBLE_FLY_PULSE_TYPE"
+#define EnsembleFlyTrigFracString       "ENSEMBLE_FLY_TRIG_FRAC"
+#define EnsembleFlyDetSetupString       "ENSEMBLE_FLY_DET_SETUP"
+#define EnsembleFlyCaptureString        "ENSEMBLE_FLY_CAPTURE"
+#define EnsembleFlyTaxiString           "ENSEMBLE_FLY_TAXI"
+#define EnsembleFlyFlyString            "ENSEMBLE_FLY_FLY"
+#define EnsembleFlyAbortString          "ENSEMBLE_FLY_ABORT"
+#define EnsembleFlyStateString          "ENSEMBLE_FLY_STATE"
+#define EnsembleFlyStatusString         "ENSEMBLE_FLY_STATUS"
+#define EnsembleFlyMessageString        "ENSEMBLE_FLY_MESSAGE"
+#define EnsembleFlyTaxiPositionString   "ENSEMBLE_FLY_TAXI_POSITION"
+#define EnsembleFlyEndPositionString    "ENSEMBLE_FLY_END_POSITION"
+#define EnsembleFlyWindowStartString    "ENSEMBLE_FLY_WINDOW_START"
+#define EnsembleFlyWindowEndString      "ENSEMBLE_FLY_WINDOW_END"
+#define EnsembleFlyNumPulsesString      "ENSEMBLE_FLY_NUM_PULSES"
+#define EnsembleFlyNumCapturedString    "ENSEMBLE_FLY_NUM_CAPTURED"
+#define EnsembleFlyPulsePositionsString "ENSEMBLE_FLY_PULSE_POSITIONS"
+#define EnsembleFlyEncoderPositionsString "ENSEMBLE_FLY_ENCODER_POSITIONS"
+
+enum EnsembleFlyPulseType {
+  ENSEMBLE_FLY_PULSE_TRIGGER,   /**< One short pulse per step */
+  ENSEMBLE_FLY_PULSE_GATE       /**< A gate that is high for the step less the detector setup time */
+};
+
+enum EnsembleFlyState {
+  ENSEMBLE_FLY_IDLE,
+  ENSEMBLE_FLY_TAXIING,
+  ENSEMBLE_FLY_READY,
+  ENSEMBLE_FLY_FLYING,
+  ENSEMBLE_FLY_READING
+};
+
+class epicsShareClass EnsembleAxis : public AerotechAxis
+{
+public:
+  /* These are the methods we override from the base class */
+  EnsembleAxis(class EnsembleController *pC, int axisNo, int axisId);
+  void report(FILE *fp, int level);
+  asynStatus move(double position, int relative, double min_velocity, double max_velocity, double acceleration);
+  asynStatus moveVelocity(double min_velocity, double max_velocity, double acceleration);
+  asynStatus home(double min_velocity, double max_velocity, double acceleration, int forwards);
+  asynStatus stop(double acceleration);
+  asynStatus poll(bool *moving);
+  asynStatus setPosition(double position);
+  asynStatus setClosedLoop(bool closedLoop);
+
+private:
+  bool getParameter(int parameterId);
+
+  EnsembleController *pC_;  /**< Pointer to the controller to which this axis belongs.
+                              *   Abbreviated because it is used very frequently */
+  int axisId_;              /**< Axis number on the controller, used as "@n" in commands */
+  Switch_Level swconfig_;   /**< EndOfTravelLimitSetup parameter of the axis */
+  Axis_Status axisStatus_;  /**< AXISSTATUS of the axis from the last poll */
+
+friend class EnsembleController;
+};
+
+class epicsShareClass EnsembleController : public AerotechController {
+public:
+  EnsembleController(const char *portName, const char *asynPortName, int numAxes, double movingPollPeriod, double idlePollPeriod);
+
+  /* These are the methods that we override from asynMotorDriver */
+  asynStatus writeInt32(asynUser *pasynUser, epicsInt32 value);
+  asynStatus readFloat64Array(asynUser *pasynUser, epicsFloat64 *value, size_t nElements, size_t *nRead);
+  void report(FILE *fp, int level);
+  EnsembleAxis* getAxis(asynUser *pasynUser);
+  EnsembleAxis* getAxis(int axisNo);
+  asynStatus poll();
+
+  /* These are the methods that are new to this class */
+  asynStatus initializeFlyScan(size_t maxPulses);
+
+protected:
+  int EnsembleFlyStart_;          /**< Start of the data range, controller units */
+#define FIRST_ENSEMBLE_PARAM EnsembleFlyStart_
+  int EnsembleFlyEnd_;            /**< End of the data range, controller units */
+  int EnsembleFlyStep_;           /**< Distance between pulses, controller units */
+  int EnsembleFlySpeed_;          /**< Speed during the data range, controller units/s */
+  int EnsembleFlyAccelTime_;      /**< Time to reach the speed */
+  int EnsembleFlyPulseType_;      /**< EnsembleFlyPulseType */
+  int EnsembleFlyTrigFrac_;       /**< Position of a trigger pulse within the step, 0 to 1 */
+  int EnsembleFlyDetSetup_;       /**< Time the detector needs between gates */
+  int EnsembleFlyCapture_;        /**< Record the encoder position at each pulse with DATAACQ */
+  int EnsembleFlyTaxi_;           /**< Move to the taxi position and arm the PSO */
+  int EnsembleFlyFly_;            /**< Move through the data range */
+  int EnsembleFlyAbort_;          /**< Abort the fly scan */
+  int EnsembleFlyState_;          /**< EnsembleFlyState */
+  int EnsembleFlyStatus_;         /**< ProfileStatus of the last taxi or fly */
+  int EnsembleFlyMessage_;        /**< Error message of the last taxi or fly */
+  int EnsembleFlyTaxiPosition_;   /**< Position from which the axis accelerates */
+  int EnsembleFlyEndPosition_;    /**< Position at which the axis has decelerated */
+  int EnsembleFlyWindowStart_;    /**< Start of the PSO window, relative to the taxi position */
+  int EnsembleFlyWindowEnd_;      /**< End of the PSO window, relative to the taxi position */
+  int EnsembleFlyNumPulses_;      /**< Number of pulses in the window */
+  int EnsembleFlyNumCaptured_;    /**< Number of encoder positions read back */
+  int EnsembleFlyPulsePositions_; /**< Nominal positions of the pulses */
+  int EnsembleFlyEncoderPositions_; /**< Encoder positions recorded at the pulses */
+#define LAST_ENSEMBLE_PARAM EnsembleFlyEncoderPositions_
+
+#define NUM_ENSEMBLE_PARAMS (&LAST_ENSEMBLE_PARAM - &FIRST_ENSEMBLE_PARAM + 1)
+
+  asynStatus checkProfile(int numProfileAxes, int numPoints, char *message);
+  asynStatus loadProfile(char *message);
+  asynStatus startProfile(char *message);
+  asynStatus runningProfile(bool *running, char *message);
+  asynStatus stopProfile();
+
+private:
+  asynStatus writeBurst(asynMotorBurst *pBurst);
+  asynStatus startCommandProgram(char *message);
+  asynStatus runCommand(int command, int numArgs, const int *args, char *message);
+  asynStatus computeFlyScan(EnsembleAxis *pAxis, char *message);
+  asynStatus taxiFlyScan(EnsembleAxis *pAxis);
+  asynStatus flyFlyScan(EnsembleAxis *pAxis);
+  asynStatus stopFlyScan(bool dataAcq);
+  asynStatus abortFlyScan();
+  asynStatus armFlyScan(char *message);
+  asynStatus readFlyScan(char *message);
+  asynStatus pollFlyScan();
+  void setFlyScanDone(int status, const char *message);
+
+  bool planeMoving_;          /**< Bit 0 of PLANESTATUS(0) from the last poll */
+  int globalDoubles_;         /**< Number of DGLOBAL variables of the controller */
+  int globalIntegers_;        /**< Number of IGLOBAL variables of the controller */
+  EnsembleAxis *flyAxis_;     /**< Axis of the active fly scan, NULL when idle */
+  int flyState_;              /**< EnsembleFlyState of flyAxis_ */
+  int flyPolls_;              /**< Polls since the move of flyAxis_ was started */
+  size_t maxFlyPulses_;       /**< Size of the pulse arrays */
+  double flyDirection_;       /**< 1 or -1 */
+  double flyTaxiPos_;         /**< Taxi position, controller units */
+  double flyEndPos_;          /**< Position at which the axis has decelerated, controller units */
+  double flyWindowStart_;     /**< PSO window relative to the taxi position, controller units */
+  double flyWindowEnd_;
+  double flySpeed_;
+  double flyStep_;
+  double flyAccel_;           /**< Acceleration of the fly move, controller units/s^2 */
+  int flyPulseType_;          /**< EnsembleFlyPulseType */
+  int flyPulsePeriod_;        /**< PSOPULSE period of a gate, us */
+  int flyPulseOn_;            /**< PSOPULSE on time of a gate, us */
+  int flyNumPulses_;          /**< Pulses in the PSO window */
+  int flyNumCaptured_;        /**< Encoder positions read back */
+  bool flyCapture_;           /**< DATAACQ is recording the fly scan */
+  double *flyPulsePositions_;   /**< Nominal positions of the pulses, controller units */
+  double *flyEncoderPositions_; /**< Encoder positions recorded at the pulses, controller units */
+
+friend class EnsembleAxis;
+};
+
+#endif /* EnsembleDriver_H */
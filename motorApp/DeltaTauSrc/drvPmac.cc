@@ -43,6 +43,11 @@ USAGE...	Driver level support for Delta Tau PMAC model.
  *		      `tree_list' not supported..." compiler error message.
  * .05 01/18/05 rls - Fix for R3.14.8 devLib.h prototype change for
  *		      pDevConnectInterruptVME().
+ * .06 10/19/26     - Read status and positions of all motors from the DPRAM
+ *		      fixed data buffer once per scan in start_status(); the
+ *		      ASCII mailbox is only used for commands.  Falls back to
+ *		      ASCII status queries when the buffer is not updated.
+ *		    - Use the position scale factor of the axis, not the card.
  */
 
 #include	<vxLib.h>
@@ -76,6 +81,10 @@ USAGE...	Driver level support for Delta Tau PMAC model.
 volatile int drvPmacdebug = 0;
 extern "C" {epicsExportAddress(int, drvPmacdebug);}
 
+/* Set to zero before iocInit to always query the status through the ASCII mailbox. */
+volatile int drvPmacFixedBuffer = 1;
+extern "C" {epicsExportAddress(int, drvPmacFixedBuffer);}
+
 /*----------------debugging-----------------*/
 
 static inline void Debug(int level, const char *format, ...) {
@@ -114,6 +123,8 @@ static double quantum;
 static long report(int);
 static long init();
 static void query_done(int, int, struct mess_node *);
+static void start_status(int);
+static void read_fixed_buffer(int);
 static int set_status(int, int);
 static RTN_STATUS send_mess(int, char const *, char *);
 static int recv_mess(int, char *, int);
@@ -144,7 +155,7 @@ struct driver_table Pmac_access =
     recv_mess,
     set_status,
     query_done,
-    NULL,
+    start_status,
     &initialized,
     Pmac_axis
 };
@@ -172,9 +183,18 @@ static long report(int level)
     {
 	for (card = 0; card < Pmac_num_cards; card++)
 	    if (motor_state[card])
+	    {
+		struct PMACcontroller *cntrl;
+
+		cntrl = (struct PMACcontroller *) motor_state[card]->DevicePrivate;
 		printf("    PMAC motor card %d @ 0x%X, id: %s \n",
 		       card, (uint_t) motor_state[card]->localaddr,
 		       motor_state[card]->ident);
+		if (level > 0)
+		    printf("      status from %s, %lu snapshots, %lu retries\n",
+			   cntrl->useFixedBuffer ? "fixed data buffer" : "ASCII queries",
+			   cntrl->fixed_reads, cntrl->fixed_retries);
+	    }
     }
     return (0);
 }
@@ -192,6 +212,104 @@ static void query_done(int card, int axis, struct mess_node *nodeptr)
 }
 
 
+/*********************************************************
+ * Read the status and positions of all motors on a card
+ * from the DPRAM fixed data buffer.
+ * start_status(int card)
+ *            if card == -1 then start all cards
+ *********************************************************/
+static void start_status(int card)
+{
+    int itera;
+
+    if (card >= 0)
+	read_fixed_buffer(card);
+    else
+    {
+	for (itera = 0; itera < total_cards; itera++)
+	    if (motor_state[itera])
+		read_fixed_buffer(itera);
+    }
+}
+
+
+/*
+ * FUNCTION... read_fixed_buffer(int card)
+ *
+ * LOGIC...
+ *  IF the fixed data buffer is not used on this card.
+ *	NORMAL RETURN.
+ *  ENDIF
+ *  IF the servo timer has not changed since the last snapshot.
+ *	IF no update for Pmac_STALE_TIMEOUT.
+ *	    Fall back to ASCII status queries.
+ *	ENDIF
+ *	NORMAL RETURN; the snapshot is current.
+ *  ENDIF
+ *  FOR up to Pmac_COPY_RETRIES copies.
+ *	Copy status and positions of all axes.
+ *	IF the servo timer is unchanged; i.e. PMAC did not update during the copy.
+ *	    Save the timer; NORMAL RETURN.
+ *	ENDIF
+ *  ENDFOR
+ */
+static void read_fixed_buffer(int card)
+{
+    volatile struct pmac_dpram *pmotor;
+    volatile struct pmac_motor_data *pdata;
+    struct PMACcontroller *cntrl;
+    struct pmac_motor_snapshot *psnap;
+    epicsTimeStamp now;
+    epicsUInt32 timer;
+    epicsInt32 hi;
+    int axis, trys;
+
+    cntrl = (struct PMACcontroller *) motor_state[card]->DevicePrivate;
+    if (cntrl->useFixedBuffer == false)
+	return;
+    pmotor = (struct pmac_dpram *) motor_state[card]->localaddr;
+
+    timer = pmotor->servo_timer;
+    epicsTimeGetCurrent(&now);
+    if (timer == cntrl->servo_timer)
+    {
+	if (epicsTimeDiffInSeconds(&now, &cntrl->update_time) > Pmac_STALE_TIMEOUT)
+	{
+	    cntrl->useFixedBuffer = false;
+	    errlogPrintf("%s(%d): card %d fixed data buffer not updated, using ASCII status queries\n",
+			 __FILE__, __LINE__, card);
+	}
+	return;
+    }
+
+    for (trys = 0; trys < Pmac_COPY_RETRIES; trys++)
+    {
+	for (axis = 0; axis < motor_state[card]->total_axis; axis++)
+	{
+	    pdata = &pmotor->motor_data[axis];
+	    psnap = &cntrl->snapshot[axis];
+	    psnap->status_x = pdata->status_x & 0xFFFFFF;
+	    psnap->status_y = pdata->status_y & 0xFFFFFF;
+	    /* Sign extend the upper 24 bits of the 48 bit positions. */
+	    hi = (epicsInt32) ((pdata->cmnd_pos_hi & 0xFFFFFF) << 8) >> 8;
+	    psnap->cmnd_pos = hi * 16777216.0 + (pdata->cmnd_pos_lo & 0xFFFFFF);
+	    hi = (epicsInt32) ((pdata->act_pos_hi & 0xFFFFFF) << 8) >> 8;
+	    psnap->act_pos = hi * 16777216.0 + (pdata->act_pos_lo & 0xFFFFFF);
+	}
+	if (pmotor->servo_timer == timer)
+	{
+	    cntrl->servo_timer = timer;
+	    cntrl->update_time = now;
+	    cntrl->fixed_reads++;
+	    return;
+	}
+	cntrl->fixed_retries++;
+	timer = pmotor->servo_timer;
+    }
+    Debug(2, "read_fixed_buffer: card %d, no coherent snapshot\n", card);
+}
+
+
 static int set_status(int card, int signal)
 {
     struct PMACcontroller *cntrl;
@@ -210,20 +328,33 @@ static int set_status(int card, int signal)
     nodeptr = motor_info->motor_motion;
     status.All = motor_info->status.All;
 
-    send_mess(card, "?", Pmac_axis[signal]);
-    recv_mess(card, buff, 1);
-    rtn_state = sscanf(buff, "%4hx%4hx%4hx", &motorstat.word1.All,
-		       &motorstat.word2.All, &motorstat.word3.All);
+    if (cntrl->useFixedBuffer == true)
+    {
+	struct pmac_motor_snapshot *psnap = &cntrl->snapshot[signal];
+
+	/* The 48 status bits of the "?" response; X word first. */
+	motorstat.word1.All = (epicsUInt16) (psnap->status_x >> 8);
+	motorstat.word2.All = (epicsUInt16) (((psnap->status_x & 0xFF) << 8) | (psnap->status_y >> 16));
+	motorstat.word3.All = (epicsUInt16) (psnap->status_y & 0xFFFF);
+	motorData = psnap->cmnd_pos;
+    }
+    else
+    {
+	send_mess(card, "?", Pmac_axis[signal]);
+	recv_mess(card, buff, 1);
+	rtn_state = sscanf(buff, "%4hx%4hx%4hx", &motorstat.word1.All,
+			   &motorstat.word2.All, &motorstat.word3.All);
+
+	sprintf(outbuf, "M%.2d61", (signal + 1));	// Get Commanded Position.
+	send_mess(card, outbuf, (char) NULL);
+	recv_mess(card, buff, 1);
+	motorData = atof(buff);
+    }
 
     status.Bits.RA_DONE     = (motorstat.word3.Bits.in_position == YES) ? 1 : 0;
     status.Bits.EA_POSITION = (motorstat.word1.Bits.amp_enabled == YES) ? 1 : 0;
 
-    sprintf(outbuf, "M%.2d61", (signal + 1));	// Get Commanded Position.
-    send_mess(card, outbuf, (char) NULL);
-    recv_mess(card, buff, 1);
-
-    motorData = atof(buff);
-    motorData /= cntrl->pos_scaleFac[card]; /* Shift out scale factor. */
+    motorData /= cntrl->pos_scaleFac[signal]; /* Shift out scale factor. */
 
     if (motorData == motor_info->position)
     {
@@ -268,10 +399,15 @@ static int set_status(int card, int signal)
     status.Bits.EA_SLIP_STALL = 0;
     status.Bits.EA_HOME	      = 0;
 
-    sprintf(outbuf, "M%.2d62", (signal + 1));
-    send_mess(card, outbuf, (char) NULL);	// Get Actual Position.
-    recv_mess(card, buff, 1);
-    motorData = atof(buff);
+    if (cntrl->useFixedBuffer == true)
+	motorData = cntrl->snapshot[signal].act_pos;
+    else
+    {
+	sprintf(outbuf, "M%.2d62", (signal + 1));
+	send_mess(card, outbuf, (char) NULL);	// Get Actual Position.
+	recv_mess(card, buff, 1);
+	motorData = atof(buff);
+    }
     motor_info->encoder_position = (int32_t) motorData;
 
     status.Bits.RA_PROBLEM	= 0;
@@ -820,6 +956,9 @@ static int motor_init()
 	    cntrl = (struct PMACcontroller *) malloc(sizeof(struct PMACcontroller));
 	    pmotorState->DevicePrivate = cntrl;
 	    cntrl->irqEnable = FALSE;
+	    cntrl->useFixedBuffer = false;
+	    cntrl->fixed_reads = 0;
+	    cntrl->fixed_retries = 0;
 
 	    /* Initialize DPRAM communication. */
 	    pmotor = (struct pmac_dpram *) pmotorState->localaddr;
@@ -878,6 +1017,18 @@ static int motor_init()
 	    pmotorState->total_axis = --total_axis;
 	    Debug(3, "Total axis = %d\n", total_axis);
 
+	    /* Use the fixed data buffer if PMAC updates it (I48=1). */
+	    cntrl->servo_timer = pmotor->servo_timer;
+	    epicsThreadSleep(0.1);
+	    if (drvPmacFixedBuffer != 0 && pmotor->servo_timer != cntrl->servo_timer)
+	    {
+		cntrl->useFixedBuffer = true;
+		cntrl->servo_timer = ~pmotor->servo_timer;	/* Force the first copy. */
+		epicsTimeGetCurrent(&cntrl->update_time);
+		start_status(card_index);
+	    }
+	    Debug(3, "Status from %s\n", cntrl->useFixedBuffer ? "fixed data buffer" : "ASCII queries");
+
 	    /*
 	     * Enable interrupt-when-done if selected - driver depends on
 	     * motor_state->total_axis  being set.
@@ -34,6 +34,7 @@ USAGE... This file contains Delta Tau PMAC driver "include" information.
 #ifndef	INCdrvPmach
 #define	INCdrvPmach 1
 
+#include <epicsTime.h>
 #include "motor.h"
 #include "motordrvCom.h"
 
@@ -55,11 +56,30 @@ USAGE... This file contains Delta Tau PMAC driver "include" information.
 
 #define AXIS_STOP "\\"
 
+/* Time without an update of the fixed data buffer before the driver falls
+ * back to ASCII status queries. */
+#define Pmac_STALE_TIMEOUT	1.0	/* seconds */
+#define Pmac_COPY_RETRIES	3	/* Snapshot copies overrun by a buffer update. */
+
+struct pmac_motor_snapshot
+{
+    epicsUInt32 status_x;	/* Motor status word X. */
+    epicsUInt32 status_y;	/* Motor status word Y. */
+    double cmnd_pos;		/* Commanded position (Mxx61). */
+    double act_pos;		/* Actual position (Mxx62). */
+};
+
 struct PMACcontroller
 {
     int	status;
     bool irqEnable;
     double pos_scaleFac[Pmac_MAX_AXES];	/* Position scale factor (Ixx08 * 32). */
+    bool useFixedBuffer;		/* Status is read from the DPRAM fixed data buffer. */
+    epicsUInt32 servo_timer;		/* Servo timer of the last snapshot. */
+    epicsTimeStamp update_time;		/* Time the servo timer last changed. */
+    unsigned long fixed_reads;		/* Snapshots copied from the fixed data buffer. */
+    unsigned long fixed_retries;	/* Copies overrun by a buffer update. */
+    struct pmac_motor_snapshot snapshot[Pmac_MAX_AXES];
 };
 
 typedef struct
@@ -198,10 +218,33 @@ typedef union
 } REPLY_STATUS;
 
 
+/*
+ * DPRAM motor data reporting ("fixed data") buffer, enabled with I48=1.
+ * PMAC updates the buffer for all motors every I47 servo cycles and
+ * increments the servo timer with each update.  Every PMAC word occupies 4
+ * bytes of the DPRAM, with the 24 data bits right justified; 48 bit positions
+ * occupy two words, least significant first.
+ */
+#define Pmac_FIXED_BUFFER	0x06C	/* Servo timer at $06001B. */
+
+struct pmac_motor_data
+{
+    epicsUInt32 status_x;	/* Motor status word X (first 24 bits of "?"). */
+    epicsUInt32 status_y;	/* Motor status word Y (last 24 bits of "?"). */
+    epicsUInt32 cmnd_pos_lo;	/* Commanded position, bits 0-23. */
+    epicsUInt32 cmnd_pos_hi;	/* Commanded position, bits 24-47. */
+    epicsUInt32 act_pos_lo;	/* Actual position, bits 0-23. */
+    epicsUInt32 act_pos_hi;	/* Actual position, bits 24-47. */
+};
+
 /* PMAC DPRAM structure. */
 struct pmac_dpram
 {
-    epicsUInt8 na0[0xE9C];
+    epicsUInt8 na00[Pmac_FIXED_BUFFER];
+    epicsUInt32 servo_timer;	/* Servo timer; changes with each buffer update. */
+    struct pmac_motor_data motor_data[Pmac_MAX_AXES];
+    epicsUInt8 na0[0xE9C - Pmac_FIXED_BUFFER - sizeof(epicsUInt32) -
+		   Pmac_MAX_AXES * sizeof(struct pmac_motor_data)];
     epicsUInt8 out_cntrl_wd;	/* Control Word at 0x0E9C. */
     epicsUInt8 na1;
     epicsUInt16 out_cntrl_char;	/* Control Character at 0x0E9E. */
@@ -55,6 +55,13 @@
 /*              function by (long) rather than (int) to suit 64bit Linux		*/
 /*              build. Also corrected the PROM reading. Added more info in      */
 /*              report when value > 0.                                          */
+/*  2.6         Interrupt coalescing                                            */
+/*              The ISR latches the CSR of the interrupting axes and sets      */
+/*              their bits in a pending mask instead of queueing a message per  */
+/*              interrupt. The interrupt task drains the mask in one pass and   */
+/*              publishes all flagged axes in a single locked section.          */
+/*              Added interrupt counters and a latency histogram to report and  */
+/*              the Hytec8601InjectInterrupt command for tests without a card.  */
 /*              				                                                */
 /********************************************************************************/
 
@@ -69,8 +76,9 @@
 #include <epicsTime.h>
 #include <epicsThread.h>
 #include <epicsMutex.h>
+#include <epicsEvent.h>
+#include <epicsInterrupt.h>
 #include <ellLib.h>
-#include <epicsMessageQueue.h>
 
 #include <drvSup.h>
 #include <devLib.h>
@@ -83,7 +91,6 @@
 static void ISR_8601(int pDrv);
 static void intQueuedTask( void *pDrv );
 
-#define MAX_MESSAGES  100           /* maximum number of messages */
 #define ENCODER_HARD_RATIO    0.25 	/* encoder hardware ratio, it is 1/4 since the quadrature encoder */
 
 
@@ -129,6 +136,13 @@ HytecMotorController::HytecMotorController(const char *portName, int numAxes,
     this->vector = vector & 0xFF;
     this->ip_carrier = ip_carrier;
 	this->useencoder = useencoder;
+	this->regbase = NULL;
+	this->intPending = 0;
+	this->intInjected = 0;
+	this->intReceived = 0;
+	this->intCoalesced = 0;
+	this->intPasses = 0;
+	this->intEventId = epicsEventMustCreate(epicsEventEmpty);
     
     // Create controller-specific parameters
     createParam(HytecPowerControlString,	asynParamInt32,  &this->HytecPowerControl_);
@@ -148,8 +162,7 @@ HytecMotorController::HytecMotorController(const char *portName, int numAxes,
     	pAxis = new HytecMotorAxis(this, axis, encoderRatio[axis], vector & 0xFF);
     }
     
-	// create a queue task for dealing interrupts
-    this->intMsgQId = epicsMessageQueueCreate(MAX_MESSAGES, (this->numAxes + 2)*sizeof(int));
+	// create a task for dealing interrupts
     if (epicsThreadCreate("drvHy8601intQueuedTask",
                          epicsThreadPriorityLow,
                          epicsThreadGetStackSize(epicsThreadStackMedium),
@@ -390,6 +403,10 @@ void HytecMotorController::report(FILE *fp, int level)
             fprintf(fp, "          Home limit hit = %s\n", home == 0 ? "No" : "Yes");
             fprintf(fp, "          Faulty = %s\n", fault == 0 ? "No" : "Yes");
         }
+        fprintf(fp, "  interrupts received = %lu, coalesced = %lu, axis updates = %lu in %lu passes\n",
+                this->intReceived, this->intCoalesced, this->intLatency.count(), this->intPasses);
+        fprintf(fp, "  max latency = %.3f ms\n", this->intLatency.maxTime() * 1000.);
+        this->intLatency.report(fp, "latency");
     }
 
     // Call the base class method
@@ -525,9 +542,8 @@ static void ISR_8601(int pDrv)
     HytecMotorController *pController = (HytecMotorController*) pDrv;
 	HytecMotorAxis * pAxis;
 	volatile char * chanbase;
-	epicsMessageQueueId	qID;
-    int data[4];
-    int axis;
+    int data[HY8601_NUM_AXES];
+    int axis, axisMask = 0;
 	int numOfAxes;
 
 	numOfAxes = pController->getNumAxes();
@@ -536,64 +552,135 @@ static void ISR_8601(int pDrv)
 		pAxis = pController->getAxis(axis);
 		chanbase = pAxis->getChanbase();
         data[axis] = GET_REG(chanbase, REG_CSR);
-        SET_REG(chanbase, REG_INTMASK, 0);             /* disable interrupt */
+        /* only the axes with an enabled source raise the interrupt, the others keep their mask */
+        if (GET_REG(chanbase, REG_INTMASK) & data[axis])
+        {
+            axisMask |= 1 << axis;
+            SET_REG(chanbase, REG_INTMASK, 0);             /* disable interrupt */
+        }
     }
 
-    /* wake up INT queue */
-	qID = pController->getINTMsgQID();
-    if (epicsMessageQueueTrySend(qID, data, sizeof(data)) == 0)
-        pController->increaseMsgSent();
-    else
-        pController->increaseMsgFail();
+    /* flag the axes and wake up the INT task */
+    pController->queueInterrupt(axisMask, data, false);
 }
 
-// Interrupt queue task
+// Interrupt task
 static void intQueuedTask( void *pDrv )
 {
     HytecMotorController *pController = (HytecMotorController*) pDrv;
-	HytecMotorAxis * pAxis;
-	epicsMessageQueueId	qID;
-    int data[4];
-    int axis;
-	int numOfAxes, ipslot, ipcarrier;
+	epicsEventId eventId;
+	int ipslot, ipcarrier;
 
-	qID = pController->getINTMsgQID();
-	numOfAxes = pController->getNumAxes();
+	eventId = pController->getINTEventId();
 	ipslot = pController->getIPSlot();
 	ipcarrier = pController->getIPCarrier();
 
     while(1) 
     {
         /* Wait for event from interrupt routine */
-        epicsMessageQueueReceive(qID, data, sizeof(data));
-                 
-        for (axis = 0; axis < numOfAxes; axis++) 
-        {
-			pAxis = pController->getAxis(axis);
-           	pController->drvHy8601GetAxisStatus( pAxis, data[axis] );
-        }
+        epicsEventMustWait(eventId);
+
+        /* all interrupts since the last pass are serviced together */
+        pController->serviceInterrupts();
 
         /* re-enable interrupt. for Linux IOCs */
         ipmIrqCmd(ipcarrier, ipslot, 0, ipac_irqEnable);
     }
 }
 
-// Interrupt queue task updates 
-void HytecMotorController::drvHy8601GetAxisStatus( HytecMotorAxis *pAxis, int csr_data )
+/* Called from the ISR: latch the CSR of the flagged axes and add them to the pending mask.
+ * An interrupt arriving before the task has drained the mask is coalesced into the same pass. */
+void HytecMotorController::queueInterrupt( int axisMask, const int *csr, bool injected )
 {
-    this->lock();
+	epicsTimeStamp now;
+	int axis, key;
+
+	epicsTimeGetCurrentInt(&now);
+	key = epicsInterruptLock();
+	this->intReceived++;
+	if (this->intPending != 0)
+		this->intCoalesced++;
+	for (axis = 0; axis < this->numAxes; axis++)
+	{
+		if (!(axisMask & (1 << axis))) continue;
+		if (!(this->intPending & (1 << axis)))
+			this->intTime[axis] = now;
+		this->intCsr[axis] = csr[axis];
+	}
+	this->intPending |= axisMask;
+	if (injected)
+		this->intInjected |= axisMask;
+	else
+		this->intInjected &= ~axisMask;
+	epicsInterruptUnlock(key);
+
+	epicsEventSignal(this->intEventId);
+}
 
-    setIntegerParam( pAxis->axisNo_, motorStatusDone_, 		((csr_data & CSR_DONE) != 0 ) );
-    setIntegerParam( pAxis->axisNo_, motorStatusHighLimit_, ((csr_data & CSR_MAXLMT) != 0 ) );
-    setIntegerParam( pAxis->axisNo_, motorStatusHome_,    	((csr_data & CSR_HOMELMT) != 0 ) );
+/* Called from the interrupt task: drain the pending mask and publish the status of all
+ * flagged axes in one locked section. */
+void HytecMotorController::serviceInterrupts()
+{
+	HytecMotorAxis *pAxis;
+	epicsTimeStamp isrTime[HY8601_NUM_AXES], now;
+	int csr[HY8601_NUM_AXES];
+	epicsUInt32 pending, injected;
+	double latency;
+	int axis, key;
+
+	key = epicsInterruptLock();
+	pending = this->intPending;
+	injected = this->intInjected;
+	this->intPending = 0;
+	this->intInjected = 0;
+	for (axis = 0; axis < this->numAxes; axis++)
+	{
+		if (!(pending & (1 << axis))) continue;
+		csr[axis] = this->intCsr[axis];
+		isrTime[axis] = this->intTime[axis];
+	}
+	epicsInterruptUnlock(key);
 
-    if (csr_data & CSR_HOMELMT) CSR_CLR(pAxis->chanbase, CSR_HOMESTOP);                     /* after home limit is reported, clear Stop at home */
+	if (pending == 0) return;
 
-    setIntegerParam( pAxis->axisNo_, motorStatusProblem_,   ((csr_data & CSR_DRVSTAT) != 0) );
-    setIntegerParam( pAxis->axisNo_, motorStatusLowLimit_,  ((csr_data & CSR_MINLMT) != 0) );
-    callParamCallbacks(pAxis->axisNo_);
+	this->lock();
+	for (axis = 0; axis < this->numAxes; axis++)
+	{
+		if (!(pending & (1 << axis))) continue;
+		pAxis = getAxis(axis);
+		/* the registers are read again here, injected interrupts use the given CSR */
+		if (pAxis && !(injected & (1 << axis)))
+			csr[axis] = GET_REG(pAxis->chanbase, REG_CSR);
+		drvHy8601GetAxisStatus( axis, csr[axis] );
+	}
 
-    this->unlock();
+	epicsTimeGetCurrent(&now);
+	this->intPasses++;
+	for (axis = 0; axis < this->numAxes; axis++)
+	{
+		if (!(pending & (1 << axis))) continue;
+		latency = epicsTimeDiffInSeconds(&now, &isrTime[axis]);
+		this->intLatency.add(latency);
+		callParamCallbacks(axis);
+	}
+	/* a poll reads the final positions */
+	wakeupPoller();
+	this->unlock();
+}
+
+// Interrupt task updates, called with the lock held
+void HytecMotorController::drvHy8601GetAxisStatus( int axis, int csr_data )
+{
+	HytecMotorAxis *pAxis = getAxis(axis);
+
+    setIntegerParam( axis, motorStatusDone_, 		((csr_data & CSR_DONE) != 0 ) );
+    setIntegerParam( axis, motorStatusHighLimit_, ((csr_data & CSR_MAXLMT) != 0 ) );
+    setIntegerParam( axis, motorStatusHome_,    	((csr_data & CSR_HOMELMT) != 0 ) );
+
+    if ((csr_data & CSR_HOMELMT) && pAxis) CSR_CLR(pAxis->chanbase, CSR_HOMESTOP);                     /* after home limit is reported, clear Stop at home */
+
+    setIntegerParam( axis, motorStatusProblem_,   ((csr_data & CSR_DRVSTAT) != 0) );
+    setIntegerParam( axis, motorStatusLowLimit_,  ((csr_data & CSR_MINLMT) != 0) );
 }
 
 int HytecMotorController::getNumAxes()
@@ -611,19 +698,9 @@ int HytecMotorController::getIPSlot()
 	return ipslot;
 }
 
-epicsMessageQueueId HytecMotorController::getINTMsgQID()
+epicsEventId HytecMotorController::getINTEventId()
 {
-	return intMsgQId;
-}
-
-void HytecMotorController::increaseMsgSent()
-{
-	messagesSent++;
-}
-
-void HytecMotorController::increaseMsgFail()
-{
-	messagesFailed++;
+	return intEventId;
 }
 
 
@@ -1103,9 +1180,51 @@ static void configHy8601CallFunc(const iocshArgBuf *args)
 			args[10].dval, args[11].dval, args[12].dval);
 }
 
+/**
+ * Software interrupt for tests without the 8601 hardware
+ *
+ * Passes the CSR value to the interrupt handling of the given axes
+ * as if the card had raised the interrupt.
+ *
+ * @param portName   asyn port name
+ * @param axisMask   bit0 for axis0 ... bit3 for axis3
+ * @param csr        CSR value of the axes, e.g. 0x2000 for done
+ */
+extern "C" int Hytec8601InjectInterrupt(const char *portName, int axisMask, int csr)
+{
+    HytecMotorController *pC;
+    int data[HY8601_NUM_AXES];
+    int axis;
+
+    pC = (HytecMotorController*) findAsynPortDriver(portName);
+    if (!pC)
+    {
+        printf("Hytec8601InjectInterrupt: port %s not found\n", portName);
+        return(asynError);
+    }
+    for (axis = 0; axis < HY8601_NUM_AXES; axis++)
+        data[axis] = csr;
+    pC->queueInterrupt(axisMask & ((1 << HY8601_NUM_AXES) - 1), data, true);
+    return(asynSuccess);
+}
+
+static const iocshArg Hy8601InjectArg0 = {"portName", iocshArgString};
+static const iocshArg Hy8601InjectArg1 = {"axisMask", iocshArgInt};
+static const iocshArg Hy8601InjectArg2 = {"csr", iocshArgInt};
+static const iocshArg * const Hy8601InjectArgs[] = {&Hy8601InjectArg0,
+                                                    &Hy8601InjectArg1,
+                                                    &Hy8601InjectArg2};
+
+static const iocshFuncDef injectHy8601 = {"Hytec8601InjectInterrupt", 3, Hy8601InjectArgs};
+static void injectHy8601CallFunc(const iocshArgBuf *args)
+{
+    Hytec8601InjectInterrupt(args[0].sval, args[1].ival, args[2].ival);
+}
+
 static void Hytec8601Register(void)
 {
     iocshRegister(&configHy8601, configHy8601CallFunc);
+    iocshRegister(&injectHy8601, injectHy8601CallFunc);
 }
 
 epicsExportRegistrar(Hytec8601Register);
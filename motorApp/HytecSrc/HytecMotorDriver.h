@@ -51,6 +51,7 @@
 
 #include "asynMotorController.h"
 #include "asynMotorAxis.h"
+#include "asynMotorHistogram.h"
 
 static const char *driverName = "HytecMotorDriver";
 
@@ -178,13 +179,13 @@ public:
     HytecMotorAxis* getAxis(int axisNo);
 
 	//the following are called from non-member function so they are here
-	void drvHy8601GetAxisStatus( HytecMotorAxis *pAxis, int csr_data );
+	void drvHy8601GetAxisStatus( int axis, int csr_data );
 	int getNumAxes();
 	int getIPCarrier();
 	int getIPSlot();
-	epicsMessageQueueId getINTMsgQID();
-	void increaseMsgSent();
-	void increaseMsgFail();
+	epicsEventId getINTEventId();
+	void queueInterrupt( int axisMask, const int *csr, bool injected );
+	void serviceInterrupts();
 	
 
 protected:
@@ -203,9 +204,17 @@ private:
 	int checkprom(char *pr,int expmodel);
 
     int numAxes;
-    epicsMessageQueueId intMsgQId;
-    int messagesSent;                       // for report
-    int messagesFailed;                     // for report
+
+    /* Interrupts are collected by the ISR and serviced together by the interrupt task */
+    epicsEventId intEventId;
+    volatile epicsUInt32 intPending;        // bit n set: axis n has an unserviced interrupt
+    volatile epicsUInt32 intInjected;       // pending interrupts from Hytec8601InjectInterrupt
+    volatile int intCsr[HY8601_NUM_AXES];   // CSR latched by the last interrupt of each axis
+    epicsTimeStamp intTime[HY8601_NUM_AXES];// time of the first unserviced interrupt of each axis
+    unsigned long intReceived;              // for report
+    unsigned long intCoalesced;             // for report, interrupts merged into a pending service pass
+    unsigned long intPasses;                // for report, service passes of the task
+    asynMotorHistogram intLatency;          // for report, latency of the axis updates published
     int ip_carrier;
     int ipslot;
 
@@ -34,22 +34,115 @@
 //
 //! @param[in] pC pointer to ImsMDrivePlusMotorController
 //! @param[in] axisNum axis number
+//! @param[in] pasynUser connection to the drive
+//! @param[in] link index of the connection in the controller
+//! @param[in] devName device name (DN) of the drive in party mode, "" if not used
 ////////////////////////////////////////////////////////
-ImsMDrivePlusMotorAxis::ImsMDrivePlusMotorAxis(ImsMDrivePlusMotorController *pC, int axisNum)
-  : asynMotorAxis(pC, axisNum), pController(pC)
+ImsMDrivePlusMotorAxis::ImsMDrivePlusMotorAxis(ImsMDrivePlusMotorController *pC, int axisNum, asynUser *pasynUser, int link, const char *devName)
+  : asynMotorAxis(pC, axisNum), pController(pC), pasynUser_(pasynUser), link_(link),
+    homeSwitchInput(-1), posLimitSwitchInput(-1), negLimitSwitchInput(-1),
+    pollStatus_(asynSuccess), position_(0), moving_(0), home_(0), highLimit_(0), lowLimit_(0)
 {
 	static const char *functionName = "ImsMDrivePlusMotorAxis()";
 	asynPrint(pC->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s: Create Axis %d\n", DRIVER_NAME, functionName, axisNum);
 
+	strncpy(deviceName, devName, sizeof(deviceName)-1);
+	deviceName[sizeof(deviceName)-1] = '\0';
+
     // run setup/initialize routines here
     // check communication, set moving status
 	if (configAxis() == asynError) {
     	asynPrint(pC->pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: controller config failed for motor port=%s\n", DRIVER_NAME, functionName, pController->motorName);
     	// TODO throw exception
     }
+
+	// read home and limit config from S1-S4
+	readHomeAndLimitConfig();
+	buildStatusCommand();
+
 	callParamCallbacks();
 }
 
+////////////////////////////////////////
+//! readHomeAndLimitConfig
+//! read home, positive limit, and neg limit switch configuration from MCode S1-S4 settings
+//! S1-S4 must be set up beforehand
+//! I1-I4 are used to read the status of S1-S4
+//  Use logic from existing drvMDrive.cc
+////////////////////////////////////////
+int ImsMDrivePlusMotorAxis::readHomeAndLimitConfig()
+{
+	asynStatus status = asynError;
+	char cmd[MAX_CMD_LEN];
+	char resp[MAX_BUFF_LEN];
+	size_t nread;
+	static const char *functionName = "readHomeAndLimitConfig()";
+	int type;
+
+	// iterate through S1-S4 and parse each configuration to see if home, pos, and neg limits are set
+	for (int i=1; i<=4; i++) {
+		sprintf(cmd, "PR S%d", i); // query S1-S4 setting
+		status = writeReadController(cmd, resp, sizeof(resp), &nread, IMS_TIMEOUT);
+		if (status) continue;
+		type = 0;
+		sscanf(resp, "%d", &type);
+		switch (type) {
+		case 0: break; // general purpose input
+		case 1: // home switch input
+			homeSwitchInput = i; break;
+		case 2: // positive limit switch input
+			posLimitSwitchInput = i; break;
+		case 3: // negative limit switch input
+			negLimitSwitchInput = i; break;
+		default:
+			printf("%s:%s: ERROR invalid data type for S%d=%d\n", DRIVER_NAME, functionName, i, type);
+		}
+	}
+
+	printf("%s: axis %d homeSwitchInput=%d, posLimitSwitchInput=%d, negLimitSwitchInput=%d\n", pController->motorName, axisNo_, homeSwitchInput, posLimitSwitchInput, negLimitSwitchInput);
+
+	return status;
+}
+
+////////////////////////////////////////
+//! buildStatusCommand()
+//! Compose the PR command that prints the position, the moving flag and the configured switch inputs
+//! separated by blanks, e.g. PR P," ",MV," ",I1," ",I2, so that one round trip reads the whole status
+////////////////////////////////////////
+void ImsMDrivePlusMotorAxis::buildStatusCommand()
+{
+	char *end = statusCmd;
+
+	end += sprintf(end, "PR P,\" \",MV");
+	if (homeSwitchInput != -1) end += sprintf(end, ",\" \",I%d", homeSwitchInput);
+	if (posLimitSwitchInput != -1) end += sprintf(end, ",\" \",I%d", posLimitSwitchInput);
+	if (negLimitSwitchInput != -1) end += sprintf(end, ",\" \",I%d", negLimitSwitchInput);
+}
+
+////////////////////////////////////////
+//! parseStatus()
+//! Parse the reply to statusCmd
+//
+//! @param[in] resp reply of the drive
+//! @return 0 on success, -1 if fields are missing
+////////////////////////////////////////
+int ImsMDrivePlusMotorAxis::parseStatus(const char *resp)
+{
+	int numFields = 2;
+	int inputs[3] = {0, 0, 0};
+	int n = 0;
+
+	if (homeSwitchInput != -1) numFields++;
+	if (posLimitSwitchInput != -1) numFields++;
+	if (negLimitSwitchInput != -1) numFields++;
+	if (sscanf(resp, "%lf %d %d %d %d", &position_, &moving_, &inputs[0], &inputs[1], &inputs[2]) < numFields)
+		return -1;
+	if (homeSwitchInput != -1) home_ = inputs[n++];
+	if (posLimitSwitchInput != -1) highLimit_ = inputs[n++];
+	if (negLimitSwitchInput != -1) lowLimit_ = inputs[n++];
+	return 0;
+}
+
 ////////////////////////////////////////
 //! configAxis()
 //! Used smarACTMCMotorDriver.cpp as reference
@@ -70,7 +163,7 @@ asynStatus ImsMDrivePlusMotorAxis::configAxis()
 	// try getting firmware version to make sure communication works
 	sprintf(cmd, "PR VR");
 	for (int i=0; i<maxRetries; i++) {
-		status = pController->writeReadController(cmd, resp, sizeof(resp), &nread, IMS_TIMEOUT);
+		status = writeReadController(cmd, resp, sizeof(resp), &nread, IMS_TIMEOUT);
 		asynPrint(pController->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s: Version retry.\n", DRIVER_NAME, functionName);
 		if (status == asynError) {
 			asynPrint(pController->pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: Version inquiry FAILED.\n", DRIVER_NAME, functionName);
@@ -87,7 +180,7 @@ asynStatus ImsMDrivePlusMotorAxis::configAxis()
 
 	// set encoder flags
 	sprintf(cmd, "PR EE");
-	status = pController->writeReadController(cmd, resp, sizeof(resp), &nread, IMS_TIMEOUT);
+	status = writeReadController(cmd, resp, sizeof(resp), &nread, IMS_TIMEOUT);
 	if (status == asynSuccess) {
 		int val = atoi(resp);
 		setIntegerParam(pController->motorStatusHasEncoder_, val ? 1:0);
@@ -125,20 +218,20 @@ asynStatus ImsMDrivePlusMotorAxis::setAxisMoveParameters(double minVelocity, dou
 		}
 		// set base velocity
 		sprintf(cmd, "VI=%ld", (long)minVelocity);
-		status = pController->writeController(cmd, IMS_TIMEOUT);
+		status = writeController(cmd, IMS_TIMEOUT);
 		if (status) goto bail;
 	}
 
 
 	// set velocity
 	sprintf(cmd, "VM=%ld", (long)maxVelocity);
-	status = pController->writeController(cmd, IMS_TIMEOUT);
+	status = writeController(cmd, IMS_TIMEOUT);
 	if (status) goto bail;
 
 	// set accceleration
 	if (acceleration != 0) {
 		sprintf(cmd, "A=%ld", (long)acceleration);
-		status = pController->writeController(cmd, IMS_TIMEOUT);
+		status = writeController(cmd, IMS_TIMEOUT);
 		if (status) goto bail;
 	}
 
@@ -181,7 +274,7 @@ asynStatus ImsMDrivePlusMotorAxis::move(double position, int relative, double mi
 	} else { // absolute move MA
 		sprintf(cmd, "MA %ld", (long)position);
 	}
-	status = pController->writeController(cmd, IMS_TIMEOUT);
+	status = writeController(cmd, IMS_TIMEOUT);
 	if (status) goto bail;
 
 	bail:
@@ -218,7 +311,7 @@ asynStatus ImsMDrivePlusMotorAxis::moveVelocity(double minVelocity, double maxVe
 	// move
 	asynPrint(pController->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s: VBASE=%f, VELO=%f, ACCL=%f\n", DRIVER_NAME, functionName, minVelocity, maxVelocity, acceleration);
 	sprintf(cmd, "SL %ld", (long)maxVelocity);
-	status = pController->writeController(cmd, IMS_TIMEOUT);
+	status = writeController(cmd, IMS_TIMEOUT);
 	if (status) goto bail;
 
 	bail:
@@ -248,13 +341,13 @@ asynStatus ImsMDrivePlusMotorAxis::stop(double acceleration)
 	// set accceleration
 	if (acceleration != 0) {
 		sprintf(cmd, "A=%ld", (long)acceleration);
-		status = pController->writeController(cmd, IMS_TIMEOUT);
+		status = writeController(cmd, IMS_TIMEOUT);
 		if (status) goto bail;
 	}
 
 	// move
 	sprintf(cmd, "SL 0");
-	status = pController->writeController(cmd, IMS_TIMEOUT);
+	status = writeController(cmd, IMS_TIMEOUT);
 	if (status) goto bail;
 
 	bail:
@@ -300,7 +393,7 @@ asynStatus ImsMDrivePlusMotorAxis::home(double minVelocity, double maxVelocity,
 		}
 	} else { // base velocity needs to be set because creeping back to home switch at base velocity, so make sure it's nonzero
 		sprintf(cmd, "PR VI");  // get base velocity setting
-		status = pController->writeReadController(cmd, resp, sizeof(resp), &nread, IMS_TIMEOUT);
+		status = writeReadController(cmd, resp, sizeof(resp), &nread, IMS_TIMEOUT);
 		if (status) goto bail;
 		baseVelocity = atof(resp);
 		if (baseVelocity == 0) { // set to factory default of 1000
@@ -317,7 +410,7 @@ asynStatus ImsMDrivePlusMotorAxis::home(double minVelocity, double maxVelocity,
 	}
 	asynPrint(pController->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s: VBASE=%f, VELO=%f, ACCL=%f, forwards=%d\n", DRIVER_NAME, functionName, minVelocity, maxVelocity, acceleration, forwards);
 	sprintf(cmd, "HM %d", direction);
-	status  = pController->writeController(cmd, IMS_TIMEOUT);
+	status  = writeController(cmd, IMS_TIMEOUT);
 	if (status) goto bail;
 
 	bail:
@@ -347,7 +440,7 @@ asynStatus ImsMDrivePlusMotorAxis::setPosition(double position)
 	// set position
 	asynPrint(pController->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s: position=%f\n", DRIVER_NAME, functionName, position);
 	sprintf(cmd, "P=%ld", (long)position);
-	status = pController->writeController(cmd, IMS_TIMEOUT);
+	status = writeController(cmd, IMS_TIMEOUT);
 	if (status) goto bail;
 
 	bail:
@@ -373,91 +466,31 @@ asynStatus ImsMDrivePlusMotorAxis::setPosition(double position)
 ////////////////////////////////////////////////////////
 asynStatus ImsMDrivePlusMotorAxis::poll(bool *moving)
 {
-	asynStatus status = asynError;
-	char cmd[MAX_CMD_LEN];
-	char resp[MAX_BUFF_LEN];
-	size_t nread;
-	int val=0;
-	double position;
-	*moving = false;
+	asynStatus status = pollStatus_;
 	static const char *functionName = "poll()";
-	//epicsTime currentTime;
 
-	// get position
-	sprintf(cmd, "PR P");
-	status = pController->writeReadController(cmd, resp, sizeof(resp), &nread, IMS_TIMEOUT);
+	// status was read by ImsMDrivePlusMotorController::poll()
+	*moving = (moving_ == 1);
 	if (status) goto bail;
-	position = atof(resp);
+
 	// update motor record position values, just update encoder's even if not using one
-	setDoubleParam(pController->motorEncoderPosition_, position);
-	setDoubleParam(pController->motorPosition_, position);
+	setDoubleParam(pController->motorEncoderPosition_, position_);
+	setDoubleParam(pController->motorPosition_, position_);
 
-	// get moving flag
-	sprintf(cmd, "PR MV");
-	status = pController->writeReadController(cmd, resp, sizeof(resp), &nread, IMS_TIMEOUT);
-	if (status) goto bail;
-	val = atoi(resp);
-	if (val == 1) *moving = true;  	// updating moving flag
-/*	else { // not moving
-		if (prevMovingState == 1) {// state changed, moving before, start idle timer
-			idleTimeStart = epicsTime::getCurrent();
-		}
-	}
-	prevMovingState = val;
-*/
 	// update motor record status done with moving status
 	setIntegerParam(pController->motorStatusDone_, ! *moving );
 
-/*
-	// if position has changed and moving stopped for over 30sec, update NVM with current position so the motor will remember
-	// its location just in case its power dies
-	currentTime = epicsTime::getCurrent();
-	idleTime = currentTime - idleTimeStart;
-	//printf("prevPos=%f, pos=%f, moving=%d, idleTime=%f\n", prevPosition, position, *moving, idleTime);
-	if (prevPosition != position && *moving == false && idleTime > 30) {
-		sprintf(cmd, "S");
-		if (status = pController->writeController(cmd, IMS_TIMEOUT)) {
-			asynPrint(pController->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:poll(): ERROR saving position to NVM\n", DRIVER_NAME);
-			goto bail;
-		}
-		asynPrint(pController->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:poll(): saving parameters to NVM\n", DRIVER_NAME);
-		idleTimeStart = epicsTime::getCurrent();
-		prevPosition = position;
-	}
-*/
-
-	// get home switch value
-	if (pController->homeSwitchInput != -1) {
-		sprintf(cmd, "PR I%d", pController->homeSwitchInput);
-		status = pController->writeReadController(cmd, resp, sizeof(resp), &nread, IMS_TIMEOUT);
-		if (status) goto bail;
-		val = atoi(resp);
-		setIntegerParam(pController->motorStatusHome_, val);
-	}
-
-	// get positive limit switch value
-	if (pController->posLimitSwitchInput != -1) {
-		sprintf(cmd, "PR I%d", pController->posLimitSwitchInput);
-		status = pController->writeReadController(cmd, resp, sizeof(resp), &nread, IMS_TIMEOUT);
-		if (status) goto bail;
-		val = atoi(resp);
-		setIntegerParam(pController->motorStatusHighLimit_, val);
-	}
-
-	// get negative limit switch value
-	if (pController->negLimitSwitchInput != -1) {
-		sprintf(cmd, "PR I%d", pController->negLimitSwitchInput);
-		status = pController->writeReadController(cmd, resp, sizeof(resp), &nread, IMS_TIMEOUT);
-		if (status) goto bail;
-		val = atoi(resp);
-		setIntegerParam(pController->motorStatusLowLimit_, val);
-	}
+	// home and limit switch values
+	if (homeSwitchInput != -1) setIntegerParam(pController->motorStatusHome_, home_);
+	if (posLimitSwitchInput != -1) setIntegerParam(pController->motorStatusHighLimit_, highLimit_);
+	if (negLimitSwitchInput != -1) setIntegerParam(pController->motorStatusLowLimit_, lowLimit_);
 
 	// error polling
 	bail:
 	if (status) {
 		char buff[LOCAL_LINE_LEN];
 		sprintf(buff, "%s:%s: ERROR polling motor", DRIVER_NAME, functionName);
+		setIntegerParam(pController->motorStatusCommsError_, 1);
 		handleAxisError(buff);
 	}
 
@@ -471,13 +504,74 @@ asynStatus ImsMDrivePlusMotorAxis::poll(bool *moving)
 	callParamCallbacks();
 
 	int mstat;
-	pController->getIntegerParam(pController->motorStatus_, &mstat);
-	asynPrint(pController->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s: POS=%f, MSTAT=%d\n", DRIVER_NAME, functionName, position, mstat);
+	pController->getIntegerParam(axisNo_, pController->motorStatus_, &mstat);
+	asynPrint(pController->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s: axis=%d, POS=%f, MSTAT=%d\n", DRIVER_NAME, functionName, axisNo_, position_, mstat);
 
 	return status;
 
 }
 
+////////////////////////////////////////
+//! writeController()
+//! reference ACRMotorDriver
+//
+//! Writes a string to the drive.
+//! Prepends deviceName to command string, if party mode not enabled, set device name to ""
+//! @param[in] output the string to be written.
+//! @param[in] timeout Timeout before returning an error.
+////////////////////////////////////////
+asynStatus ImsMDrivePlusMotorAxis::writeController(const char *output, double timeout)
+{
+	size_t nwrite;
+	asynStatus status;
+	char outbuff[MAX_BUFF_LEN];
+	static const char *functionName = "writeController()";
+
+	if (!pasynUser_) return asynError;
+
+	// in party-mode Line Feed must follow command string
+	sprintf(outbuff, "%s%s", deviceName, output);
+	asynPrint(pController->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s: deviceName=%s, command=%s\n", DRIVER_NAME, functionName, deviceName, outbuff);
+	status = pasynOctetSyncIO->write(pasynUser_, outbuff, strlen(outbuff), timeout, &nwrite);
+	if (status) { // update comm flag
+		setIntegerParam(pController->motorStatusCommsError_, 1);
+	}
+	return status ;
+}
+
+////////////////////////////////////////
+//! writeReadController()
+//! reference ACRMotorDriver
+//
+//! Writes a string to the drive and reads a response.
+//! Prepends deviceName to command string, if party mode not enabled, set device name to ""
+//! param[in] output Pointer to the output string.
+//! param[out] input Pointer to the input string location.
+//! param[in] maxChars Size of the input buffer.
+//! param[out] nread Number of characters read.
+//! param[out] timeout Timeout before returning an error.*/
+////////////////////////////////////////
+asynStatus ImsMDrivePlusMotorAxis::writeReadController(const char *output, char *input, size_t maxChars, size_t *nread, double timeout)
+{
+	size_t nwrite;
+	asynStatus status;
+	int eomReason;
+	char outbuff[MAX_BUFF_LEN];
+	static const char *functionName = "writeReadController()";
+
+	input[0] = '\0';
+	if (!pasynUser_) return asynError;
+
+	// in party-mode Line Feed must follow command string
+	sprintf(outbuff, "%s%s", deviceName, output);
+	status = pasynOctetSyncIO->writeRead(pasynUser_, outbuff, strlen(outbuff), input, maxChars, timeout, &nwrite, nread, &eomReason);
+	if (status) { // update comm flag
+		setIntegerParam(pController->motorStatusCommsError_, 1);
+	}
+	asynPrint(pController->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s: deviceName=%s, command=%s, response=%s\n", DRIVER_NAME, functionName, deviceName, outbuff, input);
+	return status;
+}
+
 ////////////////////////////////////////////////////////
 //! saveToNVM()
 //! Save user variables and flags to non-volatile RAM in case of power loss
@@ -491,7 +585,7 @@ asynStatus ImsMDrivePlusMotorAxis::saveToNVM()
 
 	// send save command
 	sprintf(cmd, "S");
-	status = pController->writeController(cmd, IMS_TIMEOUT);
+	status = writeController(cmd, IMS_TIMEOUT);
 	if (status) goto bail;
 	asynPrint(pController->pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s: Saved to NVM\n", DRIVER_NAME, functionName);
 
@@ -527,7 +621,7 @@ void ImsMDrivePlusMotorAxis::handleAxisError(char *errMsg)
 
 	// read error code
 	sprintf(cmd, "PR ER");
-	pController->writeReadController(cmd, resp, sizeof(resp), &nread, IMS_TIMEOUT);
+	writeReadController(cmd, resp, sizeof(resp), &nread, IMS_TIMEOUT);
 	errCode = atoi(resp);
 
 	switch (errCode) {
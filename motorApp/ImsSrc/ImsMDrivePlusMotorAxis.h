@@ -12,6 +12,7 @@
 #define DRIVER_NAME "ImsMDrivePlusMotorDriver"
 
 #define NUM_AXES 1
+#define IMS_MAX_AXES 64   // drives of one controller, see ImsMDrivePlusCreateController()
 #define DEFAULT_NUM_CARDS 32
 #define MAX_MESSAGES 100
 #define IMS_TIMEOUT 2
@@ -32,7 +33,7 @@ public:
 	///////////////////////////////////
 	// Override asynMotorAxis functions
 	///////////////////////////////////
-	ImsMDrivePlusMotorAxis(ImsMDrivePlusMotorController *pC, int axis);
+	ImsMDrivePlusMotorAxis(ImsMDrivePlusMotorController *pC, int axis, asynUser *pasynUser, int link, const char *devName);
 	asynStatus move(double position, int relative, double min_velocity, double max_velocity, double acceleration);
 	asynStatus moveVelocity(double min_velocity, double max_velocity, double acceleration);
  	asynStatus home(double min_velocity, double max_velocity, double acceleration, int forwards);
@@ -44,11 +45,29 @@ public:
 	// IMS MDrivePlus specific functions
 	////////////////////////////////////////////////////
   	asynStatus saveToNVM();
+	asynStatus writeReadController(const char *output, char *input, size_t maxChars, size_t *nread, double timeout);
+	asynStatus writeController(const char *output, double timeout);
+
 protected:
 
 
 private:
 	ImsMDrivePlusMotorController *pController;
+	asynUser *pasynUser_;                   //! connection to the drive, shared by the drives of a party-mode link
+	int link_;                              //! index of the connection; drives on the same link are polled one after the other
+	char deviceName[MAX_NAME_LEN];          //! device name (DN) prepended to commands in party mode, "" if not used
+	int homeSwitchInput;
+	int posLimitSwitchInput;
+	int negLimitSwitchInput;
+	char statusCmd[MAX_CMD_LEN];            //! one PR command that reads position, moving flag and switch inputs
+
+	// status read by ImsMDrivePlusMotorController::poll()
+	asynStatus pollStatus_;
+	double position_;
+	int moving_;
+	int home_;
+	int highLimit_;
+	int lowLimit_;
 
 	//int useEncoder;                         //! using encoder flag
 	// FIXME handle lost position in driver or ioc??
@@ -60,6 +79,9 @@ private:
 	// IMS MDrivePlus specific functions
 	////////////////////////////////////////////////////
 	asynStatus configAxis();
+	int readHomeAndLimitConfig();  // read home, positive limit, and neg limit switch configuration from controller (S1-S4 settings)
+	void buildStatusCommand();
+	int parseStatus(const char *resp);
 	asynStatus setAxisMoveParameters(double min_velocity, double max_velocity, double acceleration);
 	void handleAxisError(char *errMsg);
 
@@ -9,7 +9,8 @@
 //!
 //!  Assumptions :
 //!    1) Like all controllers, the MDrivePlus must be powered-on when EPICS is first booted up.
-//!    2) Assume single controller-card-axis relationship; 1 controller = 1 axis.  
+//!    2) One axis per drive.  A controller may have several drives, either in party mode on one IO port
+//!       (list of device names) or each on its own IO port (list of IO ports), and polls them from one thread.
 //!    3) Append Line Feed (ctrl-J) to end of command string for party mode support
 //!    4) If not using device name to address device, config ImsMDrivePlusCreateController() with empty string "" for deviceName
 //
@@ -25,6 +26,7 @@
 #include <string.h>
 #include <exception>
 #include <epicsThread.h>
+#include <epicsString.h>
 #include <iocsh.h>
 #include <asynOctetSyncIO.h>
 
@@ -35,10 +37,57 @@
 #include <epicsExport.h>
 #include "ImsMDrivePlusMotorController.h"
 
+////////////////////////////////////////////////////////
+//! splitNames()
+//! Split a comma separated list of names in place
+//
+//! @param[in,out] list      copy of the list, the commas are replaced by '\0'
+//! @param[out]    names     pointers to the names, an empty list is one empty name
+//! @return number of names, at most IMS_MAX_AXES
+////////////////////////////////////////////////////////
+static int splitNames(char *list, char **names)
+{
+	char *tokState;
+	char *name;
+	int num = 0;
+
+	names[0] = list;
+	for (name = epicsStrtok_r(list, ",", &tokState); name && num < IMS_MAX_AXES; name = epicsStrtok_r(NULL, ",", &tokState))
+		names[num++] = name;
+	if (num == 0) {
+		list[0] = '\0';
+		num = 1;
+	}
+	return num;
+}
+
+////////////////////////////////////////////////////////
+//! numDrives()
+//! Number of drives (axes) configured by the IO port and device name lists
+//! A single IO port or device name is used for all drives, otherwise the lists pair up
+////////////////////////////////////////////////////////
+static int numDrives(const char *IOPortName, const char *devName)
+{
+	char ports[LOCAL_LINE_LEN], names[LOCAL_LINE_LEN];
+	char *portList[IMS_MAX_AXES], *nameList[IMS_MAX_AXES];
+	int numPorts, numNames;
+
+	strncpy(ports, IOPortName ? IOPortName : "", sizeof(ports)-1); ports[sizeof(ports)-1] = '\0';
+	strncpy(names, devName ? devName : "", sizeof(names)-1); names[sizeof(names)-1] = '\0';
+	numPorts = splitNames(ports, portList);
+	numNames = splitNames(names, nameList);
+	if (numPorts == 1) return numNames;
+	if (numNames == 1) return numPorts;
+	return (numPorts < numNames) ? numPorts : numNames;
+}
+
 ////////////////////////////////////////////////////////
 //! @ImsMDrivePlusMotorController()
 //! Constructor
-//! Driver assumes only 1 axis configured per controller for now...
+//! Creates one axis per drive; IOPortName and devName may be comma separated lists:
+//!   one IO port and several device names: drives in party mode on one link
+//!   several IO ports (one device name or ""): one drive per link, e.g. one TCP connection each
+//!   several IO ports and as many device names: paired up
 //!
 //! @param[in] motorPortName     Name assigned to the port created to communicate with the motor
 //! @param[in] IOPortName        Name assigned to the asyn IO port, name that was assigned in drvAsynIPPortConfigure()
@@ -48,38 +97,54 @@
 //! @param[in] idlePollPeriod    Idle polling period in milliseconds
 ////////////////////////////////////////////////////////
 ImsMDrivePlusMotorController::ImsMDrivePlusMotorController(const char *motorPortName, const char *IOPortName, const char *devName, double movingPollPeriod, double idlePollPeriod)
-    : asynMotorController(motorPortName, NUM_AXES, NUM_IMS_PARAMS,
+    : asynMotorController(motorPortName, numDrives(IOPortName, devName), NUM_IMS_PARAMS,
 						  asynInt32Mask | asynFloat64Mask | asynUInt32DigitalMask,
 						  asynInt32Mask | asynFloat64Mask | asynUInt32DigitalMask,
 						  ASYN_CANBLOCK | ASYN_MULTIDEVICE,
 						  1, // autoconnect
 						  0, 0),  // Default priority and stack size
-    pAsynUserIMS(0)
+    numLinks(0), numPollRounds(0)
 {
 	static const char *functionName = "ImsMDrivePlusMotorController()";
 	asynStatus status;
 	ImsMDrivePlusMotorAxis *pAxis;
+	char ports[LOCAL_LINE_LEN], names[LOCAL_LINE_LEN];
+	char *portList[IMS_MAX_AXES], *nameList[IMS_MAX_AXES];
+	asynUser *pasynUserLink[IMS_MAX_AXES];
+	int numNames, axis, link;
 	// asynMotorController constructor calloc's memory for array of axis pointers
 	pAxes_ = (ImsMDrivePlusMotorAxis **)(asynMotorController::pAxes_);
 
 	// copy names
 	strcpy(motorName, motorPortName);
-
-	// setup communication
-	status = pasynOctetSyncIO->connect(IOPortName, 0, &pAsynUserIMS, NULL);
-	if (status != asynSuccess) {
-		printf("\n\n%s:%s: ERROR connecting to Controller's IO port=%s\n\n", DRIVER_NAME, functionName, IOPortName);
-		// TODO would be good to implement exceptions
-		// TODO THROW_(SmarActMCSException(MCSConnectionError, "SmarActMCSController: unable to connect serial channel"));
-	}
+	strncpy(ports, IOPortName ? IOPortName : "", sizeof(ports)-1); ports[sizeof(ports)-1] = '\0';
+	strncpy(names, devName ? devName : "", sizeof(names)-1); names[sizeof(names)-1] = '\0';
+	numLinks = splitNames(ports, portList);
+	numNames = splitNames(names, nameList);
+	if (numLinks > 1 && numNames > 1 && numLinks != numNames)
+		printf("\n\n%s:%s: ERROR %d IO ports but %d device names, using %d drives\n\n", DRIVER_NAME, functionName, numLinks, numNames, numAxes_);
 
 	// write version, cannot use asynPrint() in constructor since controller (motorPortName) hasn't been created yet
 	printf("%s:%s: motorPortName=%s, IOPortName=%s, devName=%s \n", DRIVER_NAME, functionName, motorPortName, IOPortName, devName);
 
+	// setup communication
+	for (link=0; link<numLinks; link++) {
+		pasynUserLink[link] = NULL;
+		status = pasynOctetSyncIO->connect(portList[link], 0, &pasynUserLink[link], NULL);
+		if (status != asynSuccess) {
+			printf("\n\n%s:%s: ERROR connecting to Controller's IO port=%s\n\n", DRIVER_NAME, functionName, portList[link]);
+			// TODO would be good to implement exceptions
+			// TODO THROW_(SmarActMCSException(MCSConnectionError, "SmarActMCSController: unable to connect serial channel"));
+			pasynUserLink[link] = NULL;
+			continue;
+		}
 
-	// init
-	pasynOctetSyncIO->setInputEos(pAsynUserIMS, "\n", 1);
-	pasynOctetSyncIO->setOutputEos(pAsynUserIMS, "\r\n", 2); 
+		// init
+		pasynOctetSyncIO->setInputEos(pasynUserLink[link], "\n", 1);
+		pasynOctetSyncIO->setOutputEos(pasynUserLink[link], "\r\n", 2); 
+		// flush io buffer
+		pasynOctetSyncIO->flush(pasynUserLink[link]);
+	}
 
 	// Create controller-specific parameters
 	createParam(ImsMDrivePlusSaveToNVMControlString, asynParamInt32, &ImsMDrivePlusSaveToNVM_);
@@ -87,86 +152,137 @@ ImsMDrivePlusMotorController::ImsMDrivePlusMotorController(const char *motorPort
 	createParam(ImsMDrivePlusClearMCodeControlString, asynParamOctet, &this->ImsMDrivePlusClearMCode_);
 
 	// Check the validity of the arguments and init controller object
-	initController(devName, movingPollPeriod, idlePollPeriod);
-
-	// Create axis
-	// Assuming single axis per controller the way drvAsynIPPortConfigure( "M06", "ts-b34-nw08:2101", 0, 0 0 ) is called in st.cmd script
-	pAxis = new ImsMDrivePlusMotorAxis(this, 0);
-	pAxis = NULL;  // asynMotorController constructor tracking array of axis pointers
+	initController(movingPollPeriod, idlePollPeriod);
 
-	// read home and limit config from S1-S4
-	readHomeAndLimitConfig();
+	// Create one axis per drive, the axis reads its home and limit config from S1-S4
+	for (axis=0; axis<numAxes_; axis++) {
+		link = (numLinks == 1) ? 0 : axis;
+		pAxis = new ImsMDrivePlusMotorAxis(this, axis, pasynUserLink[link], link, nameList[(numNames == 1) ? 0 : axis]);
+		pAxis = NULL;  // asynMotorController constructor tracking array of axis pointers
+	}
 
 	startPoller(movingPollPeriod, idlePollPeriod, 2);
 }
 
 ////////////////////////////////////////
 //! initController()
-//! config controller variables - axis, etc.
-//! only support single axis per controller
+//! config controller variables
 //
-//! @param[in] devName Name of device (DN) used to identify axis within controller for Party Mode
 //! @param[in] movingPollPeriod  Moving polling period in milliseconds
 //! @param[in] idlePollPeriod    Idle polling period in milliseconds
 ////////////////////////////////////////
-void ImsMDrivePlusMotorController::initController(const char *devName, double movingPollPeriod, double idlePollPeriod)
+void ImsMDrivePlusMotorController::initController(double movingPollPeriod, double idlePollPeriod)
 {
-	strcpy(this->deviceName, devName);
-
 	// initialize asynMotorController variables
-	this->numAxes_ = NUM_AXES;  // only support single axis
 	this->movingPollPeriod_ = movingPollPeriod;
 	this->idlePollPeriod_ = idlePollPeriod;
+}
 
-	// initialize switch inputs
-	this->homeSwitchInput=-1;
-	this->posLimitSwitchInput=-1;
-	this->negLimitSwitchInput=-1;
-
-	// flush io buffer
-	pasynOctetSyncIO->flush(pAsynUserIMS);
+////////////////////////////////////////
+//! poll()
+//! Override asynMotorController function to read the status of all drives
+//
+//! Each drive answers one PR command with all its status fields.  The drives are read in rounds of one drive
+//! per link: the commands of a round are written to all links first and the replies are read afterwards, so
+//! the round trips of drives on different TCP connections overlap.  Drives in party mode on the same link are
+//! read in consecutive rounds.  ImsMDrivePlusMotorAxis::poll() publishes what was read.
+////////////////////////////////////////
+asynStatus ImsMDrivePlusMotorController::poll()
+{
+	ImsMDrivePlusMotorAxis *pending[IMS_MAX_AXES];
+	bool linkBusy[IMS_MAX_AXES];
+	bool done[IMS_MAX_AXES];
+	int axis, numPending, remaining;
+
+	for (axis=0; axis<numAxes_; axis++) done[axis] = (pAxes_[axis] == NULL);
+	remaining = numAxes_;
+	while (remaining > 0) {
+		memset(linkBusy, 0, sizeof(linkBusy));
+		numPending = 0;
+		for (axis=0; axis<numAxes_; axis++) {
+			if (done[axis]) continue;
+			if (linkBusy[pAxes_[axis]->link_]) continue;
+			linkBusy[pAxes_[axis]->link_] = true;
+			pending[numPending++] = pAxes_[axis];
+			done[axis] = true;
+		}
+		remaining = 0;
+		for (axis=0; axis<numAxes_; axis++) if (!done[axis]) remaining++;
+		if (numPending > 0) {
+			readStatus(pending, numPending);
+			numPollRounds++;
+		}
+	}
+	return asynSuccess;
 }
 
 ////////////////////////////////////////
-//! readHomeAndLimitConfig
-//! read home, positive limit, and neg limit switch configuration from MCode S1-S4 settings
-//! S1-S4 must be set up beforehand
-//! I1-I4 are used to read the status of S1-S4
-//  Use logic from existing drvMDrive.cc
+//! readStatus()
+//! Write the status command of each drive, then read the replies
+//! The drives must be on different links
+//! The ports are not locked: all I/O of this driver is done with the controller locked,
+//! and lockPort() would deadlock asynOctetSyncIO on a port that can block
+//
+//! @param[in] pAxes       drives to read
+//! @param[in] numPending  number of drives
 ////////////////////////////////////////
-int ImsMDrivePlusMotorController::readHomeAndLimitConfig()
+void ImsMDrivePlusMotorController::readStatus(ImsMDrivePlusMotorAxis **pAxes, int numPending)
 {
-	asynStatus status = asynError;
-	char cmd[MAX_CMD_LEN];
+	ImsMDrivePlusMotorAxis *pAxis;
+	char outbuff[MAX_BUFF_LEN];
 	char resp[MAX_BUFF_LEN];
-	size_t nread;
-	static const char *functionName = "readHomeAndLimitConfig()";
-	int type;
-
-	// iterate through S1-S4 and parse each configuration to see if home, pos, and neg limits are set
-	for (int i=1; i<=4; i++) {
-		sprintf(cmd, "PR S%d", i); // query S1-S4 setting
-		status = this->writeReadController(cmd, resp, sizeof(resp), &nread, IMS_TIMEOUT);
-		sscanf(resp, "%d", &type);
-		//asynPrint(pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s: S%d: type=%d\n", DRIVER_NAME, functionName, i, type);
-		if (type != 0)
-			//printf("%s:%s: S%d: type=%d\n", DRIVER_NAME, functionName, i, type);
-		switch (type) {
-		case 0: break; // general purpose input
-		case 1: // home switch input
-			homeSwitchInput = i; break;
-		case 2: // positive limit switch input
-			posLimitSwitchInput = i; break;
-		case 3: // negative limit switch input
-			negLimitSwitchInput = i; break;
-		default:
-			printf("%s:%s: ERROR invalid data type for S%d=%d\n", DRIVER_NAME, functionName, i, type);
+	size_t nwrite, nread;
+	int eomReason;
+	int i;
+	static const char *functionName = "readStatus()";
+
+	for (i=0; i<numPending; i++) {
+		pAxis = pAxes[i];
+		if (!pAxis->pasynUser_) {
+			pAxis->pollStatus_ = asynError;
+			continue;
+		}
+		pasynOctetSyncIO->flush(pAxis->pasynUser_);
+		// in party-mode Line Feed must follow command string
+		sprintf(outbuff, "%s%s", pAxis->deviceName, pAxis->statusCmd);
+		pAxis->pollStatus_ = pasynOctetSyncIO->write(pAxis->pasynUser_, outbuff, strlen(outbuff), IMS_TIMEOUT, &nwrite);
+	}
+
+	for (i=0; i<numPending; i++) {
+		pAxis = pAxes[i];
+		if (!pAxis->pasynUser_) continue;
+		if (pAxis->pollStatus_ == asynSuccess) {
+			pAxis->pollStatus_ = pasynOctetSyncIO->read(pAxis->pasynUser_, resp, sizeof(resp)-1, IMS_TIMEOUT, &nread, &eomReason);
+			if (pAxis->pollStatus_ == asynSuccess) {
+				resp[nread] = '\0';
+				if (pAxis->parseStatus(resp)) pAxis->pollStatus_ = asynError;
+			}
 		}
+		asynPrint(pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s: axis=%d, deviceName=%s, command=%s, status=%d, response=%s\n",
+		          DRIVER_NAME, functionName, pAxis->axisNo_, pAxis->deviceName, pAxis->statusCmd, pAxis->pollStatus_,
+		          pAxis->pollStatus_ ? "" : resp);
 	}
+}
+
+////////////////////////////////////////
+//! report()
+//! Override asynMotorController function to print the drives and their links
+////////////////////////////////////////
+void ImsMDrivePlusMotorController::report(FILE *fp, int level)
+{
+	ImsMDrivePlusMotorAxis *pAxis;
 
-	printf("homeSwitchInput=%d, posLimitSwitchInput=%d, negLimitSwitchInput=%d\n", homeSwitchInput, posLimitSwitchInput, negLimitSwitchInput);
+	fprintf(fp, "%s: %s, %d drives on %d links, %lu poll rounds\n", DRIVER_NAME, motorName, numAxes_, numLinks, numPollRounds);
+	if (level > 0) {
+		for (int axis=0; axis<numAxes_; axis++) {
+			if (!(pAxis = pAxes_[axis])) continue;
+			fprintf(fp, "  axis %d: link %d, deviceName=\"%s\", status command \"%s\"\n",
+			        axis, pAxis->link_, pAxis->deviceName, pAxis->statusCmd);
+		}
+	}
 
-	return status;
+	// Call the base class method
+	asynMotorController::report(fp, level);
 }
 
 ////////////////////////////////////////
@@ -241,62 +357,6 @@ asynStatus ImsMDrivePlusMotorController::writeInt32(asynUser *pasynUser, epicsIn
 	return (asynStatus)status;
 }
 
-////////////////////////////////////////
-//! writeController()
-//! reference ACRMotorDriver
-//
-//! Writes a string to the IMS controller.
-//! Prepends deviceName to command string, if party mode not enabled, set device name to ""
-//! @param[in] output the string to be written.
-//! @param[in] timeout Timeout before returning an error.
-////////////////////////////////////////
-asynStatus ImsMDrivePlusMotorController::writeController(const char *output, double timeout)
-{
-	size_t nwrite;
-	asynStatus status;
-	char outbuff[MAX_BUFF_LEN];
-	static const char *functionName = "writeController()";
-
-	// in party-mode Line Feed must follow command string
-	sprintf(outbuff, "%s%s", deviceName, output);
-	asynPrint(pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s: deviceName=%s, command=%s\n", DRIVER_NAME, functionName, deviceName, outbuff);
-	status = pasynOctetSyncIO->write(pAsynUserIMS, outbuff, strlen(outbuff), timeout, &nwrite);
-	if (status) { // update comm flag
-		setIntegerParam(this->motorStatusCommsError_, 1);
-	}
-	return status ;
-}
-
-////////////////////////////////////////
-//! writeReadController()
-//! reference ACRMotorDriver
-//
-//! Writes a string to the IMS controller and reads a response.
-//! Prepends deviceName to command string, if party mode not enabled, set device name to ""
-//! param[in] output Pointer to the output string.
-//! param[out] input Pointer to the input string location.
-//! param[in] maxChars Size of the input buffer.
-//! param[out] nread Number of characters read.
-//! param[out] timeout Timeout before returning an error.*/
-////////////////////////////////////////
-asynStatus ImsMDrivePlusMotorController::writeReadController(const char *output, char *input, size_t maxChars, size_t *nread, double timeout)
-{
-	size_t nwrite;
-	asynStatus status;
-	int eomReason;
-	char outbuff[MAX_BUFF_LEN];
-	static const char *functionName = "writeReadController()";
-
-	// in party-mode Line Feed must follow command string
-	sprintf(outbuff, "%s%s", deviceName, output);
-	status = pasynOctetSyncIO->writeRead(pAsynUserIMS, outbuff, strlen(outbuff), input, maxChars, timeout, &nwrite, nread, &eomReason);
-	if (status) { // update comm flag
-		setIntegerParam(this->motorStatusCommsError_, 1);
-	}
-	asynPrint(pasynUserSelf, ASYN_TRACEIO_DRIVER, "%s:%s: deviceName=%s, command=%s, response=%s\n", DRIVER_NAME, functionName, deviceName, outbuff, input);
-	return status;
-}
-
 ////////////////////////////////////////////////////////
 // Start code for iocsh Registration :
 // Available Functions :
@@ -313,6 +373,7 @@ asynStatus ImsMDrivePlusMotorController::writeReadController(const char *output,
 //! @param[in] IOPortName        User-specific name of port that was configured by drvAsynIPPortConfigure()
 //! @param[in] deviceName        Name of device, used to address motor by MCODE in party mode
 //                              If not using party mode, config ImsMDrivePlusCreateController() with empty string "" for deviceName
+//                              IOPortName and deviceName may be comma separated lists to create one axis per drive
 //! @param[in] movingPollPeriod  time in ms between polls when any axis is moving
 //! @param[in] idlePollPeriod    time in ms between polls when no axis is moving
 ////////////////////////////////////////////////////////
@@ -22,16 +22,10 @@ public:
 	ImsMDrivePlusMotorController(const char *motorPortName, const char *IOPortName, const char *deviceName, double movingPollPeriod, double idlePollPeriod);
 	ImsMDrivePlusMotorAxis* getAxis(asynUser *pasynUser);
 	ImsMDrivePlusMotorAxis* getAxis(int axisNo);
-	//void report(FILE *fp, int level);
+	void report(FILE *fp, int level);
 	asynStatus writeInt32(asynUser *pasynUser, epicsInt32 value);
+	asynStatus poll();
 
-	/////////////////////////////////////////
-	// IMS specific functions
-	/////////////////////////////////////////
-	asynStatus writeReadController(const char *output, char *input, size_t maxChars, size_t *nread, double timeout);
-	asynStatus writeController(const char *output, double timeout);
-
-	
 
 protected:
 	 ImsMDrivePlusMotorAxis **pAxes_;       // Array of pointers to axis objects
@@ -54,15 +48,12 @@ private:
 #define ImsMDrivePlusClearMCodeControlString	"IMS_CLEARMCODE"   // NOT SUPPORTED YET
 #define ImsMDrivePlusSaveToNVMControlString	"IMS_SAVETONVM"
 
-	asynUser *pAsynUserIMS;
 	char motorName[MAX_NAME_LEN];
-	char deviceName[MAX_NAME_LEN];
-	int homeSwitchInput;
-	int posLimitSwitchInput;
-	int negLimitSwitchInput;
+	int numLinks;                   //! number of IO ports the drives are connected to
+	unsigned long numPollRounds;    //! rounds of overlapped status reads, one drive per link in each round
 
-	void initController(const char *devName, double movingPollPeriod, double idlePollPeriod);
-	int readHomeAndLimitConfig();  // read home, positive limit, and neg limit switch configuration from controller (S1-S4 settings)
+	void initController(double movingPollPeriod, double idlePollPeriod);
+	void readStatus(ImsMDrivePlusMotorAxis **pAxes, int numPending);
 
 	friend class ImsMDrivePlusMotorAxis;
 };
@@ -0,0 +1,785 @@
+/*
+FILENAME...   kinematicDriver.cpp
+USAGE...      Virtual motor controller that composes real asyn motors into virtual axes
+              through compiled kinematic transforms.
+
+This driver replaces the record chains in pseudoMotor.db, sumDiff2D.db and coordTrans2D.db.
+Each group of virtual axes is computed from a set of real motors on other asynMotorController
+ports.  The poller reads the MotorStatus of every real motor in a group once, and evaluates the
+forward transform for all virtual axes of the group in one pass.  A move evaluates the inverse
+transform once for the whole group, and scales the real motor velocities so that they all
+arrive at the same time.
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <iocsh.h>
+#include <epicsString.h>
+
+#include <asynFloat64SyncIO.h>
+#include <asynInt32SyncIO.h>
+#include <asynGenericPointerSyncIO.h>
+
+#include "asynMotorController.h"
+#include "asynMotorAxis.h"
+
+#include <epicsExport.h>
+#include "kinematicDriver.h"
+
+/* These must match the order of the motorStatus parameters in asynMotorController */
+#define STATUS_DONE        (1 << 1)
+#define STATUS_HIGH_LIMIT  (1 << 2)
+#define STATUS_PROBLEM     (1 << 9)
+#define STATUS_MOVING      (1 << 10)
+#define STATUS_LOW_LIMIT   (1 << 13)
+
+#define MIN_COUPLING 1e-12
+
+static const char *driverName = "kinematicDriver";
+
+
+// These are the kinematicRealMotor methods
+
+kinematicRealMotor::kinematicRealMotor()
+  : portName_(NULL), axis_(0), resolution_(1.0), offset_(0.0), direction_(0), ok_(false),
+    pasynUserStatus_(NULL), pasynUserResolution_(NULL), pasynUserOffset_(NULL), pasynUserDirection_(NULL),
+    pasynUserMoveAbs_(NULL), pasynUserMoveVel_(NULL),
+    pasynUserVelBase_(NULL), pasynUserVelocity_(NULL), pasynUserAccel_(NULL), pasynUserStop_(NULL)
+{
+  memset(&status_, 0, sizeof(status_));
+}
+
+/** Connects to a real motor axis.
+  * \param[in] portName The asyn port name of the real motor controller.
+  * \param[in] axis The axis number on the real motor controller. */
+asynStatus kinematicRealMotor::connect(const char *portName, int axis)
+{
+  int status;
+  static const char *functionName = "connect";
+
+  portName_ = epicsStrDup(portName);
+  axis_ = axis;
+  status  = pasynGenericPointerSyncIO->connect(portName, axis, &pasynUserStatus_,     motorStatusString);
+  status |= pasynFloat64SyncIO->connect(portName, axis, &pasynUserResolution_, motorRecResolutionString);
+  status |= pasynFloat64SyncIO->connect(portName, axis, &pasynUserOffset_,     motorRecOffsetString);
+  status |= pasynInt32SyncIO->connect(portName, axis, &pasynUserDirection_,    motorRecDirectionString);
+  status |= pasynFloat64SyncIO->connect(portName, axis, &pasynUserMoveAbs_,    motorMoveAbsString);
+  status |= pasynFloat64SyncIO->connect(portName, axis, &pasynUserMoveVel_,    motorMoveVelString);
+  status |= pasynFloat64SyncIO->connect(portName, axis, &pasynUserVelBase_,    motorVelBaseString);
+  status |= pasynFloat64SyncIO->connect(portName, axis, &pasynUserVelocity_,   motorVelocityString);
+  status |= pasynFloat64SyncIO->connect(portName, axis, &pasynUserAccel_,      motorAccelString);
+  status |= pasynInt32SyncIO->connect(portName, axis, &pasynUserStop_,         motorStopString);
+  if (status) {
+    printf("%s:%s: cannot connect to port %s axis %d\n",
+      driverName, functionName, portName, axis);
+    return asynError;
+  }
+  return asynSuccess;
+}
+
+/** Reads the aggregate MotorStatus, and the resolution, offset and direction of the real motor record.
+  * The motor record writes these to the driver of the real motor through the Resolution, Offset and
+  * Direction records of asyn_motor.db. */
+asynStatus kinematicRealMotor::readStatus()
+{
+  int status, readStatus;
+  double resolution, offset;
+  epicsInt32 direction;
+
+  status  = pasynGenericPointerSyncIO->read(pasynUserStatus_, &status_, DEFAULT_CONTROLLER_TIMEOUT);
+  readStatus = pasynFloat64SyncIO->read(pasynUserResolution_, &resolution, DEFAULT_CONTROLLER_TIMEOUT);
+  if (!readStatus && (resolution != 0.0)) resolution_ = resolution;
+  status |= readStatus;
+  readStatus = pasynFloat64SyncIO->read(pasynUserOffset_, &offset, DEFAULT_CONTROLLER_TIMEOUT);
+  if (!readStatus) offset_ = offset;
+  status |= readStatus;
+  readStatus = pasynInt32SyncIO->read(pasynUserDirection_, &direction, DEFAULT_CONTROLLER_TIMEOUT);
+  if (!readStatus) direction_ = direction;
+  status |= readStatus;
+  ok_ = status ? false : true;
+  return status ? asynError : asynSuccess;
+}
+
+/** Returns the resolution in user coordinates (user EGU/step), negative if the direction of the
+  * real motor record is Neg. */
+double kinematicRealMotor::userResolution()
+{
+  return direction_ ? -resolution_ : resolution_;
+}
+
+/** Converts a position in real motor steps to the user coordinates of the real motor record,
+  * the same way as the motor record, user = steps*MRES*(DIR ? -1 : 1) + OFF.
+  * \param[in] steps The position in steps. */
+double kinematicRealMotor::toUser(double steps)
+{
+  return steps*userResolution() + offset_;
+}
+
+/** Converts a position in the user coordinates of the real motor record to real motor steps.
+  * \param[in] user The position in user EGU. */
+double kinematicRealMotor::toSteps(double user)
+{
+  return (user - offset_)/userResolution();
+}
+
+/** Moves the real motor to an absolute position.
+  * \param[in] position The position to move to, in user EGU of the real motor record.
+  * \param[in] baseVelocity The base velocity, in EGU/s.
+  * \param[in] velocity The slew velocity, in EGU/s.
+  * \param[in] acceleration The acceleration, in EGU/s/s. */
+asynStatus kinematicRealMotor::move(double position, double baseVelocity, double velocity, double acceleration)
+{
+  int status;
+  double scale = fabs(resolution_);
+
+  status  = pasynFloat64SyncIO->write(pasynUserVelBase_,  baseVelocity/scale, DEFAULT_CONTROLLER_TIMEOUT);
+  status |= pasynFloat64SyncIO->write(pasynUserVelocity_, velocity/scale,     DEFAULT_CONTROLLER_TIMEOUT);
+  status |= pasynFloat64SyncIO->write(pasynUserAccel_,    acceleration/scale, DEFAULT_CONTROLLER_TIMEOUT);
+  status |= pasynFloat64SyncIO->write(pasynUserMoveAbs_,  toSteps(position), DEFAULT_CONTROLLER_TIMEOUT);
+  return status ? asynError : asynSuccess;
+}
+
+/** Moves the real motor at a fixed velocity.
+  * \param[in] baseVelocity The base velocity, in EGU/s.
+  * \param[in] velocity The signed velocity, in user EGU/s of the real motor record.
+  * \param[in] acceleration The acceleration, in EGU/s/s. */
+asynStatus kinematicRealMotor::moveVelocity(double baseVelocity, double velocity, double acceleration)
+{
+  int status;
+  double scale = fabs(resolution_);
+
+  status  = pasynFloat64SyncIO->write(pasynUserVelBase_, baseVelocity/scale, DEFAULT_CONTROLLER_TIMEOUT);
+  status |= pasynFloat64SyncIO->write(pasynUserAccel_,   acceleration/scale, DEFAULT_CONTROLLER_TIMEOUT);
+  status |= pasynFloat64SyncIO->write(pasynUserMoveVel_, velocity/userResolution(), DEFAULT_CONTROLLER_TIMEOUT);
+  return status ? asynError : asynSuccess;
+}
+
+asynStatus kinematicRealMotor::stop()
+{
+  return pasynInt32SyncIO->write(pasynUserStop_, 1, DEFAULT_CONTROLLER_TIMEOUT);
+}
+
+
+// These are the kinematicGroup methods
+
+/** Creates a new kinematicGroup object.
+  * \param[in] pTransform The transform relating the real motors to the virtual axes.
+  * \param[in] firstAxis The first virtual axis number of this group. */
+kinematicGroup::kinematicGroup(kinematicTransform *pTransform, int firstAxis)
+  : pTransform_(pTransform), firstAxis_(firstAxis), numAxes_(pTransform->numAxes_),
+    anyMoving_(false), ok_(false)
+{
+  int i;
+
+  for (i=0; i<MAX_KINEMATIC_GROUP_AXES; i++) {
+    realPositions_[i]  = 0.0;
+    realEncoders_[i]   = 0.0;
+    virtPositions_[i]  = 0.0;
+    virtEncoders_[i]   = 0.0;
+    virtTargets_[i]    = 0.0;
+    moveRequested_[i]  = false;
+    baseVelocities_[i] = 0.0;
+    velocities_[i]     = 0.0;
+    accelerations_[i]  = 0.0;
+  }
+  memset(jacobian_, 0, sizeof(jacobian_));
+}
+
+/** Reads all real motors and evaluates the transform for all virtual axes in one pass.
+  * When the group is idle the virtual setpoints follow the readbacks, so that a move of one
+  * virtual axis does not pull the others back to stale setpoints. */
+asynStatus kinematicGroup::update()
+{
+  int i;
+  kinematicRealMotor *pReal;
+
+  ok_ = true;
+  anyMoving_ = false;
+  for (i=0; i<numAxes_; i++) {
+    pReal = &realMotors_[i];
+    if (pReal->readStatus()) ok_ = false;
+    realPositions_[i] = pReal->toUser(pReal->status_.position);
+    realEncoders_[i]  = pReal->toUser(pReal->status_.encoderPosition);
+    if ((pReal->status_.status & STATUS_MOVING) || !(pReal->status_.status & STATUS_DONE)) anyMoving_ = true;
+  }
+  pTransform_->forward(realPositions_, virtPositions_);
+  pTransform_->forward(realEncoders_, virtEncoders_);
+  pTransform_->inverseJacobian(virtPositions_, jacobian_);
+
+  if (!anyMoving_) {
+    for (i=0; i<numAxes_; i++) {
+      if (!moveRequested_[i]) virtTargets_[i] = virtPositions_[i];
+    }
+  }
+  return ok_ ? asynSuccess : asynError;
+}
+
+/** Starts the moves of all virtual axes that have a move requested.
+  * The inverse transform is evaluated once for the whole group.  The move time is set by the slowest
+  * requested virtual axis, and each real motor velocity is scaled so that all real motors finish together. */
+asynStatus kinematicGroup::startMove()
+{
+  double realTargets[MAX_KINEMATIC_GROUP_AXES];
+  double moveTime = 0.0, accelTime = 0.0, baseRatio = 0.0, maxVelocity = 0.0;
+  double distance, velocity;
+  int i;
+  int status = 0;
+  kinematicRealMotor *pReal;
+
+  pTransform_->inverse(virtTargets_, realTargets);
+
+  for (i=0; i<numAxes_; i++) {
+    if (!moveRequested_[i] || (velocities_[i] <= 0.0)) continue;
+    distance = fabs(virtTargets_[i] - virtPositions_[i]);
+    if (distance/velocities_[i] > moveTime) moveTime = distance/velocities_[i];
+    if ((accelerations_[i] > 0.0) && (velocities_[i]/accelerations_[i] > accelTime))
+      accelTime = velocities_[i]/accelerations_[i];
+    if (baseVelocities_[i]/velocities_[i] > baseRatio) baseRatio = baseVelocities_[i]/velocities_[i];
+    if (velocities_[i] > maxVelocity) maxVelocity = velocities_[i];
+  }
+  if (baseRatio > 1.0) baseRatio = 1.0;
+
+  for (i=0; i<numAxes_; i++) {
+    pReal = &realMotors_[i];
+    distance = fabs(realTargets[i] - realPositions_[i]);
+    // Don't command real motors that would move by less than half a step
+    if (distance < 0.5*fabs(pReal->resolution_)) continue;
+    velocity = (moveTime > 0.0) ? distance/moveTime : maxVelocity;
+    status |= pReal->move(realTargets[i], velocity*baseRatio, velocity,
+                          (accelTime > 0.0) ? velocity/accelTime : 0.0);
+  }
+
+  for (i=0; i<numAxes_; i++) moveRequested_[i] = false;
+  return status ? asynError : asynSuccess;
+}
+
+/** Starts a constant velocity move of one virtual axis.
+  * The real motor velocities are computed from the Jacobian at the current position.
+  * \param[in] index Index of the virtual axis in this group.
+  * \param[in] baseVelocity The base velocity, in EGU/s.
+  * \param[in] velocity The signed velocity, in EGU/s.
+  * \param[in] acceleration The acceleration, in EGU/s/s. */
+asynStatus kinematicGroup::startVelocity(int index, double baseVelocity, double velocity, double acceleration)
+{
+  double coupling;
+  int i;
+  int status = 0;
+
+  for (i=0; i<numAxes_; i++) {
+    coupling = jacobian_[i*numAxes_ + index];
+    if (fabs(coupling) < MIN_COUPLING) continue;
+    status |= realMotors_[i].moveVelocity(fabs(coupling)*baseVelocity, coupling*velocity,
+                                          fabs(coupling)*acceleration);
+  }
+  return status ? asynError : asynSuccess;
+}
+
+/** Replaces the transform of the group with one of the same type built from new parameters.
+  * This is refused while any real motor is moving or a move is pending, because the virtual positions
+  * jump when the transform changes.
+  * \param[in] parameters The transform parameters, see kinematicTransform::create() */
+asynStatus kinematicGroup::setParameters(const char *parameters)
+{
+  kinematicTransform *pTransform;
+  int i;
+
+  if (anyMoving_) return asynError;
+  for (i=0; i<numAxes_; i++) {
+    if (moveRequested_[i]) return asynError;
+  }
+  pTransform = kinematicTransform::create(pTransform_->type_, numAxes_, parameters);
+  if (!pTransform) return asynError;
+  delete pTransform_;
+  pTransform_ = pTransform;
+  update();
+  return asynSuccess;
+}
+
+/** Stops all real motors in the group and discards pending moves. */
+asynStatus kinematicGroup::stop()
+{
+  int i;
+  int status = 0;
+
+  for (i=0; i<numAxes_; i++) {
+    status |= realMotors_[i].stop();
+    moveRequested_[i] = false;
+  }
+  return status ? asynError : asynSuccess;
+}
+
+
+/** Creates a new kinematicController object.
+  * \param[in] portName          The name of the asyn port that will be created for this driver
+  * \param[in] numAxes           The number of virtual axes that this controller supports
+  * \param[in] movingPollPeriod  The time between polls when any axis is moving
+  * \param[in] idlePollPeriod    The time between polls when no axis is moving
+  */
+kinematicController::kinematicController(const char *portName, int numAxes,
+                                         double movingPollPeriod, double idlePollPeriod)
+  :  asynMotorController(portName, numAxes, NUM_KINEMATIC_PARAMS,
+                         0, // No additional interfaces beyond those in base class
+                         0, // No additional callback interfaces beyond those in base class
+                         ASYN_CANBLOCK | ASYN_MULTIDEVICE,
+                         1, // autoconnect
+                         0, 0),  // Default priority and stack size
+     numGroups_(0), movesDeferred_(false)
+{
+  int axis;
+
+  createParam(kinematicTypeString,       asynParamOctet, &kinematicType_);
+  createParam(kinematicParametersString, asynParamOctet, &kinematicParameters_);
+
+  pGroups_ = (kinematicGroup **)calloc(numAxes, sizeof(kinematicGroup *));
+  for (axis=0; axis<numAxes; axis++) {
+    new kinematicAxis(this, axis);
+  }
+
+  startPoller(movingPollPeriod, idlePollPeriod, 2);
+}
+
+
+/** Creates a new kinematicController object.
+  * Configuration command, called directly or from iocsh
+  * \param[in] portName          The name of the asyn port that will be created for this driver
+  * \param[in] numAxes           The number of virtual axes that this controller supports
+  * \param[in] movingPollPeriod  The time in ms between polls when any axis is moving
+  * \param[in] idlePollPeriod    The time in ms between polls when no axis is moving
+  */
+extern "C" int kinematicCreateController(const char *portName, int numAxes,
+                                         int movingPollPeriod, int idlePollPeriod)
+{
+  new kinematicController(portName, numAxes, movingPollPeriod/1000., idlePollPeriod/1000.);
+  return(asynSuccess);
+}
+
+/** Adds a group of virtual axes to a kinematicController.
+  * Configuration command, called directly or from iocsh
+  * \param[in] portName    The name of the kinematicController asyn port
+  * \param[in] firstAxis   The first virtual axis of the group
+  * \param[in] type        The transform type, see kinematicTransform::create()
+  * \param[in] realMotors  The real motors, as "port:axis" separated by spaces, e.g. "motorSim2:0 motorSim2:1"
+  * \param[in] parameters  The transform parameters, see kinematicTransform::create()
+  */
+extern "C" int kinematicConfigGroup(const char *portName, int firstAxis, const char *type,
+                                    const char *realMotors, const char *parameters)
+{
+  kinematicController *pC;
+  static const char *functionName = "kinematicConfigGroup";
+
+  pC = (kinematicController*) findAsynPortDriver(portName);
+  if (!pC) {
+    printf("%s:%s: Error port %s not found\n", driverName, functionName, portName);
+    return asynError;
+  }
+  return pC->configGroup(firstAxis, type, realMotors, parameters);
+}
+
+/** Adds a group of virtual axes.
+  * The group uses one virtual axis for each real motor, starting at firstAxis.
+  * See kinematicConfigGroup() for a description of the arguments. */
+asynStatus kinematicController::configGroup(int firstAxis, const char *type, const char *realMotors,
+                                            const char *parameters)
+{
+  char *names[MAX_KINEMATIC_GROUP_AXES];
+  int axes[MAX_KINEMATIC_GROUP_AXES];
+  char *buffer, *token, *last, *colon;
+  int numReal = 0;
+  int i;
+  kinematicTransform *pTransform;
+  kinematicGroup *pGroup;
+  asynStatus status = asynSuccess;
+  static const char *functionName = "configGroup";
+
+  if (!realMotors || !type) return asynError;
+  buffer = epicsStrDup(realMotors);
+  for (token = epicsStrtok_r(buffer, " ,", &last); token; token = epicsStrtok_r(NULL, " ,", &last)) {
+    colon = strrchr(token, ':');
+    if (!colon || (numReal >= MAX_KINEMATIC_GROUP_AXES)) {
+      printf("%s:%s: invalid real motor %s, must be port:axis, maximum %d motors\n",
+        driverName, functionName, token, MAX_KINEMATIC_GROUP_AXES);
+      free(buffer);
+      return asynError;
+    }
+    *colon = '\0';
+    if (strcmp(token, this->portName) == 0) {
+      printf("%s:%s: real motor cannot be on this port (%s)\n", driverName, functionName, token);
+      free(buffer);
+      return asynError;
+    }
+    names[numReal] = token;
+    axes[numReal] = atoi(colon+1);
+    numReal++;
+  }
+  if ((numReal == 0) || (firstAxis < 0) || (firstAxis + numReal > numAxes_)) {
+    printf("%s:%s: invalid first axis %d for %d real motors\n", driverName, functionName, firstAxis, numReal);
+    free(buffer);
+    return asynError;
+  }
+  for (i=0; i<numReal; i++) {
+    if (getAxis(firstAxis+i)->pGroup_) {
+      printf("%s:%s: axis %d is already in a group\n", driverName, functionName, firstAxis+i);
+      free(buffer);
+      return asynError;
+    }
+  }
+
+  pTransform = kinematicTransform::create(type, numReal, parameters);
+  if (!pTransform) {
+    free(buffer);
+    return asynError;
+  }
+  pGroup = new kinematicGroup(pTransform, firstAxis);
+  for (i=0; i<numReal; i++) {
+    if (pGroup->realMotors_[i].connect(names[i], axes[i])) status = asynError;
+  }
+  free(buffer);
+  if (status) {
+    delete pGroup;
+    delete pTransform;
+    return status;
+  }
+
+  lock();
+  for (i=0; i<numReal; i++) {
+    getAxis(firstAxis+i)->pGroup_ = pGroup;
+    getAxis(firstAxis+i)->index_ = i;
+  }
+  pGroups_[numGroups_++] = pGroup;
+  pGroup->update();
+  setGroupStrings(pGroup, parameters);
+  unlock();
+  wakeupPoller();
+  return asynSuccess;
+}
+
+/** Sets the type and parameter string parameters of all axes of a group and does the callbacks.
+  * \param[in] pGroup The group
+  * \param[in] parameters The transform parameters of the group */
+void kinematicController::setGroupStrings(kinematicGroup *pGroup, const char *parameters)
+{
+  int i;
+
+  for (i=0; i<pGroup->numAxes_; i++) {
+    setStringParam(pGroup->firstAxis_+i, kinematicType_, pGroup->pTransform_->type_);
+    setStringParam(pGroup->firstAxis_+i, kinematicParameters_, parameters ? parameters : "");
+    callParamCallbacks(pGroup->firstAxis_+i);
+  }
+}
+
+/** Called when asyn clients call pasynOctet->write().
+  * Writing KINEMATIC_PARAMETERS to any axis of a group rebuilds the transform of the group with the
+  * new parameters, e.g. the weights of a sumDiff group.
+  * \param[in] pasynUser asynUser structure that encodes the reason and address.
+  * \param[in] value Address of the string to write.
+  * \param[in] nChars Number of characters to write.
+  * \param[out] nActual Number of characters actually written. */
+asynStatus kinematicController::writeOctet(asynUser *pasynUser, const char *value, size_t nChars, size_t *nActual)
+{
+  int function = pasynUser->reason;
+  kinematicAxis *pAxis;
+  char parameters[MAX_CONTROLLER_STRING_SIZE];
+  asynStatus status;
+  static const char *functionName = "writeOctet";
+
+  if (function != kinematicParameters_) return asynMotorController::writeOctet(pasynUser, value, nChars, nActual);
+
+  pAxis = getAxis(pasynUser);
+  if (!pAxis || !pAxis->pGroup_) return asynError;
+  if (nChars >= sizeof(parameters)) nChars = sizeof(parameters) - 1;
+  memcpy(parameters, value, nChars);
+  parameters[nChars] = '\0';
+  *nActual = nChars;
+
+  status = pAxis->pGroup_->setParameters(parameters);
+  if (status) {
+    asynPrint(pasynUser, ASYN_TRACE_ERROR,
+      "%s:%s: cannot set parameters \"%s\" of axis %d, group is moving or parameters are invalid\n",
+      driverName, functionName, parameters, pAxis->axisNo_);
+    return status;
+  }
+  setGroupStrings(pAxis->pGroup_, parameters);
+  wakeupPoller();
+  return asynSuccess;
+}
+
+/** Reports on status of the driver
+  * \param[in] fp The file pointer on which report information will be written
+  * \param[in] level The level of report detail desired
+  *
+  * If details > 0 then information is printed about each group and real motor.
+  * After printing controller-specific information calls asynMotorController::report()
+  */
+void kinematicController::report(FILE *fp, int level)
+{
+  int i, j;
+  kinematicGroup *pGroup;
+  kinematicRealMotor *pReal;
+
+  fprintf(fp, "Kinematic motor driver %s, numAxes=%d, numGroups=%d, moving poll period=%f, idle poll period=%f\n",
+    this->portName, numAxes_, numGroups_, movingPollPeriod_, idlePollPeriod_);
+
+  if (level > 0) {
+    for (i=0; i<numGroups_; i++) {
+      pGroup = pGroups_[i];
+      fprintf(fp, "  group %d, virtual axes %d-%d, moving=%d, ok=%d\n",
+        i, pGroup->firstAxis_, pGroup->firstAxis_ + pGroup->numAxes_ - 1, pGroup->anyMoving_, pGroup->ok_);
+      pGroup->pTransform_->report(fp, level);
+      for (j=0; j<pGroup->numAxes_; j++) {
+        pReal = &pGroup->realMotors_[j];
+        fprintf(fp, "    real %s:%d resolution=%g offset=%g direction=%d position=%f status=0x%x, virtual position=%f target=%f\n",
+          pReal->portName_, pReal->axis_, pReal->resolution_, pReal->offset_, pReal->direction_,
+          pGroup->realPositions_[j], pReal->status_.status,
+          pGroup->virtPositions_[j], pGroup->virtTargets_[j]);
+      }
+    }
+  }
+
+  // Call the base class method
+  asynMotorController::report(fp, level);
+}
+
+/** Returns a pointer to a kinematicAxis object.
+  * Returns NULL if the axis number encoded in pasynUser is invalid.
+  * \param[in] pasynUser asynUser structure that encodes the axis index number. */
+kinematicAxis* kinematicController::getAxis(asynUser *pasynUser)
+{
+  return static_cast<kinematicAxis*>(asynMotorController::getAxis(pasynUser));
+}
+
+/** Returns a pointer to a kinematicAxis object.
+  * Returns NULL if the axis number encoded in pasynUser is invalid.
+  * \param[in] axisNo Axis index number. */
+kinematicAxis* kinematicController::getAxis(int axisNo)
+{
+  return static_cast<kinematicAxis*>(asynMotorController::getAxis(axisNo));
+}
+
+/** Polls the controller.
+  * Reads all real motors of each group and evaluates the transforms.  The axis poll() methods
+  * then just extract their values from the group. */
+asynStatus kinematicController::poll()
+{
+  int i;
+
+  for (i=0; i<numGroups_; i++) {
+    pGroups_[i]->update();
+  }
+  return asynSuccess;
+}
+
+/** Processes deferred moves.
+  * While moves are deferred the virtual setpoints are only recorded.  When moves are released the inverse
+  * transform is evaluated once per group and all real motors are started together.
+  * \param[in] deferMoves defer moves till later (true) or process moves now (false) */
+asynStatus kinematicController::setDeferredMoves(bool deferMoves)
+{
+  int i, j;
+  int status = 0;
+
+  if (!deferMoves && movesDeferred_) {
+    for (i=0; i<numGroups_; i++) {
+      for (j=0; j<pGroups_[i]->numAxes_; j++) {
+        if (pGroups_[i]->moveRequested_[j]) {
+          status |= pGroups_[i]->startMove();
+          break;
+        }
+      }
+    }
+    wakeupPoller();
+  }
+  movesDeferred_ = deferMoves;
+  return status ? asynError : asynSuccess;
+}
+
+
+// These are the kinematicAxis methods
+
+/** Creates a new kinematicAxis object.
+  * \param[in] pC Pointer to the kinematicController to which this axis belongs.
+  * \param[in] axisNo Index number of this axis, range 0 to pC->numAxes_-1.
+  */
+kinematicAxis::kinematicAxis(kinematicController *pC, int axisNo)
+  : asynMotorAxis(pC, axisNo),
+    pC_(pC), pGroup_(NULL), index_(0), offset_(0.0)
+{
+}
+
+/** Reports on status of the axis
+  * \param[in] fp The file pointer on which report information will be written
+  * \param[in] level The level of report detail desired
+  */
+void kinematicAxis::report(FILE *fp, int level)
+{
+  if (level > 0) {
+    fprintf(fp, "  axis %d\n"
+            "    group first axis=%d, index=%d\n"
+            "    offset=%f\n",
+            axisNo_, pGroup_ ? pGroup_->firstAxis_ : -1, index_, offset_);
+  }
+
+  // Call the base class method
+  asynMotorAxis::report(fp, level);
+}
+
+/** Returns the resolution (EGU/step) of this virtual axis, as set by the motor record. */
+double kinematicAxis::getResolution()
+{
+  double resolution = 0.0;
+
+  pC_->getDoubleParam(axisNo_, pC_->motorRecResolution_, &resolution);
+  if (resolution == 0.0) resolution = 1.0;
+  return resolution;
+}
+
+asynStatus kinematicAxis::move(double position, int relative, double minVelocity, double maxVelocity, double acceleration)
+{
+  double resolution = getResolution();
+  double scale = fabs(resolution);
+  static const char *functionName = "move";
+
+  if (!pGroup_) {
+    asynPrint(pasynUser_, ASYN_TRACE_ERROR,
+      "%s:%s: axis %d is not in a group\n", driverName, functionName, axisNo_);
+    return asynError;
+  }
+  if (relative) pGroup_->virtTargets_[index_] += position*resolution;
+  else          pGroup_->virtTargets_[index_] = position*resolution - offset_;
+  pGroup_->baseVelocities_[index_] = fabs(minVelocity)*scale;
+  pGroup_->velocities_[index_]     = fabs(maxVelocity)*scale;
+  pGroup_->accelerations_[index_]  = fabs(acceleration)*scale;
+  pGroup_->moveRequested_[index_]  = true;
+
+  if (pC_->movesDeferred_) return asynSuccess;
+  return pGroup_->startMove();
+}
+
+asynStatus kinematicAxis::moveVelocity(double minVelocity, double maxVelocity, double acceleration)
+{
+  double resolution = getResolution();
+  double scale = fabs(resolution);
+
+  if (!pGroup_) return asynError;
+  return pGroup_->startVelocity(index_, fabs(minVelocity)*scale, maxVelocity*resolution, fabs(acceleration)*scale);
+}
+
+asynStatus kinematicAxis::home(double minVelocity, double maxVelocity, double acceleration, int forwards)
+{
+  static const char *functionName = "home";
+
+  asynPrint(pasynUser_, ASYN_TRACE_ERROR,
+    "%s:%s: virtual axis %d cannot be homed, home the real motors instead\n",
+    driverName, functionName, axisNo_);
+  return asynError;
+}
+
+asynStatus kinematicAxis::stop(double acceleration)
+{
+  if (!pGroup_) return asynError;
+  return pGroup_->stop();
+}
+
+/** Sets the position of the virtual axis.
+  * The real motors are not changed, an offset is added to the transform output instead. */
+asynStatus kinematicAxis::setPosition(double position)
+{
+  if (!pGroup_) return asynError;
+  offset_ = position*getResolution() - pGroup_->virtPositions_[index_];
+  return asynSuccess;
+}
+
+/** Polls the axis.
+  * The positions have already been computed by kinematicController::poll().  A virtual axis is moving
+  * if any real motor that it depends on is moving.  A real motor limit is mapped onto the high or
+  * low limit of each virtual axis that depends on it, depending on the sign of the coupling.
+  * \param[out] moving A flag that is set indicating that the axis is moving (true) or done (false). */
+asynStatus kinematicAxis::poll(bool *moving)
+{
+  double resolution;
+  double coupling;
+  int i, n;
+  int highLimit = 0, lowLimit = 0, problem = 0;
+  bool axisMoving = false;
+  epicsUInt32 realStatus;
+
+  *moving = false;
+  if (!pGroup_) {
+    setIntegerParam(pC_->motorStatusProblem_, 1);
+    callParamCallbacks();
+    return asynSuccess;
+  }
+
+  resolution = getResolution();
+  n = pGroup_->numAxes_;
+  for (i=0; i<n; i++) {
+    coupling = pGroup_->jacobian_[i*n + index_] * resolution / pGroup_->realMotors_[i].userResolution();
+    if (fabs(coupling) < MIN_COUPLING) continue;
+    realStatus = pGroup_->realMotors_[i].status_.status;
+    if ((realStatus & STATUS_MOVING) || !(realStatus & STATUS_DONE)) axisMoving = true;
+    if (realStatus & STATUS_PROBLEM) problem = 1;
+    if (realStatus & STATUS_HIGH_LIMIT) {
+      if (coupling > 0) highLimit = 1; else lowLimit = 1;
+    }
+    if (realStatus & STATUS_LOW_LIMIT) {
+      if (coupling > 0) lowLimit = 1; else highLimit = 1;
+    }
+  }
+  if (!pGroup_->ok_) problem = 1;
+
+  setDoubleParam(pC_->motorPosition_,        (pGroup_->virtPositions_[index_] + offset_)/resolution);
+  setDoubleParam(pC_->motorEncoderPosition_, (pGroup_->virtEncoders_[index_] + offset_)/resolution);
+  setIntegerParam(pC_->motorStatusDone_,     (!axisMoving && !pGroup_->moveRequested_[index_]) ? 1:0);
+  setIntegerParam(pC_->motorStatusMoving_,   axisMoving ? 1:0);
+  setIntegerParam(pC_->motorStatusHighLimit_, highLimit);
+  setIntegerParam(pC_->motorStatusLowLimit_,  lowLimit);
+  setIntegerParam(pC_->motorStatusProblem_,   problem);
+  setIntegerParam(pC_->motorStatusCommsError_, pGroup_->ok_ ? 0:1);
+  callParamCallbacks();
+  *moving = axisMoving;
+  return asynSuccess;
+}
+
+/** Code for iocsh registration */
+static const iocshArg kinematicCreateControllerArg0 = {"Port name", iocshArgString};
+static const iocshArg kinematicCreateControllerArg1 = {"Number of axes", iocshArgInt};
+static const iocshArg kinematicCreateControllerArg2 = {"Moving poll period (ms)", iocshArgInt};
+static const iocshArg kinematicCreateControllerArg3 = {"Idle poll period (ms)", iocshArgInt};
+static const iocshArg * const kinematicCreateControllerArgs[] = {&kinematicCreateControllerArg0,
+                                                                 &kinematicCreateControllerArg1,
+                                                                 &kinematicCreateControllerArg2,
+                                                                 &kinematicCreateControllerArg3};
+static const iocshFuncDef kinematicCreateControllerDef = {"kinematicCreateController", 4, kinematicCreateControllerArgs};
+static void kinematicCreateContollerCallFunc(const iocshArgBuf *args)
+{
+  kinematicCreateController(args[0].sval, args[1].ival, args[2].ival, args[3].ival);
+}
+
+static const iocshArg kinematicConfigGroupArg0 = {"Port name", iocshArgString};
+static const iocshArg kinematicConfigGroupArg1 = {"First axis", iocshArgInt};
+static const iocshArg kinematicConfigGroupArg2 = {"Transform type", iocshArgString};
+static const iocshArg kinematicConfigGroupArg3 = {"Real motors (port:axis ...)", iocshArgString};
+static const iocshArg kinematicConfigGroupArg4 = {"Transform parameters", iocshArgString};
+static const iocshArg * const kinematicConfigGroupArgs[] = {&kinematicConfigGroupArg0,
+                                                            &kinematicConfigGroupArg1,
+                                                            &kinematicConfigGroupArg2,
+                                                            &kinematicConfigGroupArg3,
+                                                            &kinematicConfigGroupArg4};
+static const iocshFuncDef kinematicConfigGroupDef = {"kinematicConfigGroup", 5, kinematicConfigGroupArgs};
+static void kinematicConfigGroupCallFunc(const iocshArgBuf *args)
+{
+  kinematicConfigGroup(args[0].sval, args[1].ival, args[2].sval, args[3].sval, args[4].sval);
+}
+
+static void kinematicMotorRegister(void)
+{
+  iocshRegister(&kinematicCreateControllerDef, kinematicCreateContollerCallFunc);
+  iocshRegister(&kinematicConfigGroupDef,      kinematicConfigGroupCallFunc);
+}
+
+extern "C" {
+epicsExportRegistrar(kinematicMotorRegister);
+}
@@ -0,0 +1,134 @@
+/*
+FILENAME...   kinematicDriver.h
+USAGE...      Virtual motor controller that composes real asyn motors into virtual axes
+              through compiled kinematic transforms.
+
+*/
+
+#include "asynMotorController.h"
+#include "asynMotorAxis.h"
+#include "kinematicTransform.h"
+
+/** drvInfo strings for extra parameters that the kinematic controller supports */
+#define kinematicTypeString        "KINEMATIC_TYPE"
+#define kinematicParametersString  "KINEMATIC_PARAMETERS"
+
+/** A real motor on another asynMotorController port, accessed through the asyn SyncIO interfaces */
+class kinematicRealMotor {
+public:
+  kinematicRealMotor();
+  asynStatus connect(const char *portName, int axis);
+  asynStatus readStatus();
+  asynStatus move(double position, double baseVelocity, double velocity, double acceleration);
+  asynStatus moveVelocity(double baseVelocity, double velocity, double acceleration);
+  asynStatus stop();
+  double toUser(double steps);
+  double toSteps(double user);
+  double userResolution();
+
+  char *portName_;                /**< asyn port of the real motor controller */
+  int axis_;                      /**< Axis number on the real motor controller */
+  MotorStatus status_;            /**< Last status read from the real motor, in real motor steps */
+  double resolution_;             /**< Real motor resolution (EGU/step), from MOTOR_REC_RESOLUTION */
+  double offset_;                 /**< Real motor user offset (EGU), from MOTOR_REC_OFFSET */
+  int direction_;                 /**< Real motor user direction (0=Pos, 1=Neg), from MOTOR_REC_DIRECTION */
+  bool ok_;                       /**< false if the last read failed */
+
+private:
+  asynUser *pasynUserStatus_;
+  asynUser *pasynUserResolution_;
+  asynUser *pasynUserOffset_;
+  asynUser *pasynUserDirection_;
+  asynUser *pasynUserMoveAbs_;
+  asynUser *pasynUserMoveVel_;
+  asynUser *pasynUserVelBase_;
+  asynUser *pasynUserVelocity_;
+  asynUser *pasynUserAccel_;
+  asynUser *pasynUserStop_;
+};
+
+/** A set of real motors and the virtual axes computed from them by one transform */
+class kinematicGroup {
+public:
+  kinematicGroup(kinematicTransform *pTransform, int firstAxis);
+  asynStatus update();
+  asynStatus startMove();
+  asynStatus startVelocity(int index, double baseVelocity, double velocity, double acceleration);
+  asynStatus stop();
+  asynStatus setParameters(const char *parameters);
+
+  kinematicTransform *pTransform_;
+  int firstAxis_;                                         /**< First virtual axis number of this group */
+  int numAxes_;                                           /**< Number of real motors = number of virtual axes */
+  kinematicRealMotor realMotors_[MAX_KINEMATIC_GROUP_AXES];
+  double realPositions_[MAX_KINEMATIC_GROUP_AXES];        /**< Real positions in user EGU of the real motor records */
+  double realEncoders_[MAX_KINEMATIC_GROUP_AXES];         /**< Real encoder positions in user EGU */
+  double virtPositions_[MAX_KINEMATIC_GROUP_AXES];        /**< Virtual positions in EGU, from forward() */
+  double virtEncoders_[MAX_KINEMATIC_GROUP_AXES];         /**< Virtual encoder positions in EGU, from forward() */
+  double virtTargets_[MAX_KINEMATIC_GROUP_AXES];          /**< Virtual setpoints in EGU */
+  double jacobian_[MAX_KINEMATIC_GROUP_AXES*MAX_KINEMATIC_GROUP_AXES]; /**< d(real)/d(virt) at current position */
+  bool moveRequested_[MAX_KINEMATIC_GROUP_AXES];          /**< Virtual axis has a pending move */
+  double baseVelocities_[MAX_KINEMATIC_GROUP_AXES];       /**< Requested base velocity per virtual axis, EGU/s */
+  double velocities_[MAX_KINEMATIC_GROUP_AXES];           /**< Requested velocity per virtual axis, EGU/s */
+  double accelerations_[MAX_KINEMATIC_GROUP_AXES];        /**< Requested acceleration per virtual axis, EGU/s/s */
+  bool anyMoving_;                                        /**< Any real motor in the group is moving */
+  bool ok_;                                               /**< All real motors were read successfully */
+};
+
+class epicsShareClass kinematicAxis : public asynMotorAxis
+{
+public:
+  /* These are the methods we override from the base class */
+  kinematicAxis(class kinematicController *pC, int axis);
+  void report(FILE *fp, int level);
+  asynStatus move(double position, int relative, double min_velocity, double max_velocity, double acceleration);
+  asynStatus moveVelocity(double min_velocity, double max_velocity, double acceleration);
+  asynStatus home(double min_velocity, double max_velocity, double acceleration, int forwards);
+  asynStatus stop(double acceleration);
+  asynStatus poll(bool *moving);
+  asynStatus setPosition(double position);
+
+private:
+  double getResolution();
+
+  kinematicController *pC_;  /**< Pointer to the asynMotorController to which this axis belongs.
+                                *   Abbreviated because it is used very frequently */
+  kinematicGroup *pGroup_;   /**< Group this axis belongs to, NULL if not configured */
+  int index_;                /**< Index of this axis within pGroup_ */
+  double offset_;            /**< Offset added to the transform output, set by setPosition() */
+
+friend class kinematicController;
+};
+
+class epicsShareClass kinematicController : public asynMotorController {
+public:
+  kinematicController(const char *portName, int numAxes, double movingPollPeriod, double idlePollPeriod);
+
+  /* These are the methods that we override from asynMotorDriver */
+  void report(FILE *fp, int level);
+  kinematicAxis* getAxis(asynUser *pasynUser);
+  kinematicAxis* getAxis(int axisNo);
+  asynStatus writeOctet(asynUser *pasynUser, const char *value, size_t nChars, size_t *nActual);
+  asynStatus poll();
+  asynStatus setDeferredMoves(bool defer);
+
+  /* These are the methods that are new to this class */
+  asynStatus configGroup(int firstAxis, const char *type, const char *realMotors, const char *parameters);
+
+protected:
+  int kinematicType_;         /**< Transform type of the group of the axis, read only */
+#define FIRST_KINEMATIC_PARAM kinematicType_
+  int kinematicParameters_;   /**< Transform parameters of the group of the axis */
+#define LAST_KINEMATIC_PARAM kinematicParameters_
+
+#define NUM_KINEMATIC_PARAMS (&LAST_KINEMATIC_PARAM - &FIRST_KINEMATIC_PARAM + 1)
+
+private:
+  void setGroupStrings(kinematicGroup *pGroup, const char *parameters);
+
+  kinematicGroup **pGroups_;  /**< Array of up to numAxes_ configured groups */
+  int numGroups_;             /**< Number of configured groups */
+  bool movesDeferred_;        /**< Virtual moves are being collected, see setDeferredMoves() */
+
+friend class kinematicAxis;
+};
@@ -0,0 +1,276 @@
+/*
+FILENAME...   kinematicTransform.cpp
+USAGE...      Compiled forward/inverse transforms used by the kinematic motor controller.
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <epicsString.h>
+
+#define epicsExportSharedSymbols
+#include <shareLib.h>
+#include "kinematicTransform.h"
+
+#define DEG_TO_RAD 0.017453292519943295
+
+static const char *driverName = "kinematicTransform";
+
+/** Parses a list of numbers separated by spaces or commas.
+  * \param[in] string The string to parse, may be NULL.
+  * \param[out] values Array to receive the numbers.
+  * \param[in] maxValues Size of the values array.
+  * \return The number of values parsed. */
+static int parseValues(const char *string, double *values, int maxValues)
+{
+  const char *p = string;
+  char *end;
+  int n = 0;
+
+  if (!p) return 0;
+  while (*p && (n < maxValues)) {
+    while ((*p == ' ') || (*p == ',') || (*p == '\t')) p++;
+    if (!*p) break;
+    values[n] = strtod(p, &end);
+    if (end == p) break;
+    n++;
+    p = end;
+  }
+  return n;
+}
+
+/** Creates a new kinematicTransform object.
+  * \param[in] type Name of the transform type.
+  * \param[in] numAxes Number of real motors and virtual axes. */
+kinematicTransform::kinematicTransform(const char *type, int numAxes)
+  : type_(epicsStrDup(type)), numAxes_(numAxes)
+{
+}
+
+kinematicTransform::~kinematicTransform()
+{
+  free((void *)type_);
+}
+
+/** Computes the derivatives of the real positions with respect to the virtual positions.
+  * This default implementation uses central differences around virt, which costs 2*numAxes_
+  * calls to inverse().
+  * \param[in] virt Array of numAxes_ virtual axis positions.
+  * \param[out] jacobian Array of numAxes_*numAxes_ values, jacobian[real*numAxes_+virt]. */
+void kinematicTransform::inverseJacobian(const double *virt, double *jacobian)
+{
+  double v[MAX_KINEMATIC_GROUP_AXES];
+  double rPlus[MAX_KINEMATIC_GROUP_AXES];
+  double rMinus[MAX_KINEMATIC_GROUP_AXES];
+  double h;
+  int i, j;
+
+  memcpy(v, virt, numAxes_*sizeof(double));
+  for (j=0; j<numAxes_; j++) {
+    h = 1e-6 * (fabs(virt[j]) > 1.0 ? fabs(virt[j]) : 1.0);
+    v[j] = virt[j] + h;
+    inverse(v, rPlus);
+    v[j] = virt[j] - h;
+    inverse(v, rMinus);
+    v[j] = virt[j];
+    for (i=0; i<numAxes_; i++) {
+      jacobian[i*numAxes_ + j] = (rPlus[i] - rMinus[i]) / (2.0*h);
+    }
+  }
+}
+
+void kinematicTransform::report(FILE *fp, int level)
+{
+  fprintf(fp, "    transform=%s, numAxes=%d\n", type_, numAxes_);
+}
+
+/** Creates a transform by name.
+  * \param[in] type One of "sumDiff", "slit", "rotation2D" or "matrix".
+  * \param[in] numAxes Number of real motors and virtual axes.
+  * \param[in] parameters Transform-specific numbers, separated by spaces or commas:
+  *   - sumDiff: optional weights c1, c2 of the sum and scale e of the difference, default "1 1 1".
+  *     virt0=(c1*real0+c2*real1)/(c1+c2), virt1=(real0-real1)*e, same convention as sumDiff2D.db.
+  *   - slit: none.  virt0=real0+real1 (gap), virt1=(real0-real1)/2 (center).
+  *   - rotation2D: angle (degrees), x0, y0.  Same convention as coordTrans2D.db.
+  *   - matrix: numAxes*numAxes forward matrix elements (row-major), optionally followed by numAxes offsets.
+  * \return Pointer to the new transform, or NULL on error. */
+kinematicTransform *kinematicTransform::create(const char *type, int numAxes, const char *parameters)
+{
+  double values[MAX_KINEMATIC_GROUP_AXES*(MAX_KINEMATIC_GROUP_AXES+1)];
+  double matrix[MAX_KINEMATIC_GROUP_AXES*MAX_KINEMATIC_GROUP_AXES];
+  double offsets[MAX_KINEMATIC_GROUP_AXES];
+  int numValues;
+  int i;
+  kinematicLinearTransform *pTransform;
+  static const char *functionName = "create";
+
+  if (!type || (numAxes < 1) || (numAxes > MAX_KINEMATIC_GROUP_AXES)) {
+    printf("%s:%s: invalid transform type or numAxes=%d\n", driverName, functionName, numAxes);
+    return NULL;
+  }
+  numValues = parseValues(parameters, values, MAX_KINEMATIC_GROUP_AXES*(MAX_KINEMATIC_GROUP_AXES+1));
+  memset(offsets, 0, sizeof(offsets));
+
+  if ((strcmp(type, "sumDiff") == 0) || (strcmp(type, "slit") == 0)) {
+    if (numAxes != 2) {
+      printf("%s:%s: %s transform requires 2 axes\n", driverName, functionName, type);
+      return NULL;
+    }
+    if (strcmp(type, "sumDiff") == 0) {
+      double c1 = (numValues >= 1) ? values[0] : 1.0;
+      double c2 = (numValues >= 2) ? values[1] : 1.0;
+      double e  = (numValues >= 3) ? values[2] : 1.0;
+      if ((c1 + c2 == 0.0) || (e == 0.0)) {
+        printf("%s:%s: sumDiff weights c1+c2 and scale e must not be 0\n", driverName, functionName);
+        return NULL;
+      }
+      matrix[0] = c1/(c1+c2); matrix[1] = c2/(c1+c2);
+      matrix[2] = e;          matrix[3] = -e;
+    } else {
+      matrix[0] = 1.0; matrix[1] = 1.0;
+      matrix[2] = 0.5; matrix[3] = -0.5;
+    }
+  } else if (strcmp(type, "rotation2D") == 0) {
+    double angle, c, s;
+    if ((numAxes != 2) || (numValues < 1)) {
+      printf("%s:%s: rotation2D transform requires 2 axes and angle [x0 y0]\n", driverName, functionName);
+      return NULL;
+    }
+    angle = values[0] * DEG_TO_RAD;
+    c = cos(angle);
+    s = sin(angle);
+    matrix[0] = c;  matrix[1] = s;
+    matrix[2] = -s; matrix[3] = c;
+    if (numValues >= 3) {
+      offsets[0] = -(c*values[1] + s*values[2]);
+      offsets[1] = -(-s*values[1] + c*values[2]);
+    }
+  } else if (strcmp(type, "matrix") == 0) {
+    if (numValues < numAxes*numAxes) {
+      printf("%s:%s: matrix transform requires %d elements, got %d\n",
+        driverName, functionName, numAxes*numAxes, numValues);
+      return NULL;
+    }
+    memcpy(matrix, values, numAxes*numAxes*sizeof(double));
+    for (i=0; (i<numAxes) && (numAxes*numAxes+i < numValues); i++) {
+      offsets[i] = values[numAxes*numAxes + i];
+    }
+  } else {
+    printf("%s:%s: unknown transform type %s\n", driverName, functionName, type);
+    return NULL;
+  }
+
+  pTransform = new kinematicLinearTransform(type, numAxes, matrix, offsets);
+  if (!pTransform->isValid()) {
+    printf("%s:%s: %s transform matrix is singular\n", driverName, functionName, type);
+    delete pTransform;
+    return NULL;
+  }
+  return pTransform;
+}
+
+
+/** Creates a new kinematicLinearTransform object.
+  * The inverse matrix is computed once here with Gauss-Jordan elimination, so that forward() and
+  * inverse() are plain matrix-vector products.
+  * \param[in] type Name of the transform type.
+  * \param[in] numAxes Number of real motors and virtual axes.
+  * \param[in] matrix Forward matrix, numAxes*numAxes elements, row-major.
+  * \param[in] offsets Forward offsets, numAxes elements. */
+kinematicLinearTransform::kinematicLinearTransform(const char *type, int numAxes,
+                                                   const double *matrix, const double *offsets)
+  : kinematicTransform(type, numAxes), valid_(true)
+{
+  double work[MAX_KINEMATIC_GROUP_AXES*MAX_KINEMATIC_GROUP_AXES];
+  double tmp, pivot;
+  int i, j, k, best;
+  int n = numAxes;
+
+  memcpy(matrix_, matrix, n*n*sizeof(double));
+  memcpy(offsets_, offsets, n*sizeof(double));
+  memcpy(work, matrix, n*n*sizeof(double));
+  for (i=0; i<n; i++) {
+    for (j=0; j<n; j++) inverse_[i*n + j] = (i == j) ? 1.0 : 0.0;
+  }
+
+  for (k=0; k<n; k++) {
+    best = k;
+    for (i=k+1; i<n; i++) {
+      if (fabs(work[i*n + k]) > fabs(work[best*n + k])) best = i;
+    }
+    if (fabs(work[best*n + k]) < 1e-12) {
+      valid_ = false;
+      return;
+    }
+    if (best != k) {
+      for (j=0; j<n; j++) {
+        tmp = work[k*n + j];    work[k*n + j] = work[best*n + j];       work[best*n + j] = tmp;
+        tmp = inverse_[k*n + j]; inverse_[k*n + j] = inverse_[best*n + j]; inverse_[best*n + j] = tmp;
+      }
+    }
+    pivot = work[k*n + k];
+    for (j=0; j<n; j++) {
+      work[k*n + j] /= pivot;
+      inverse_[k*n + j] /= pivot;
+    }
+    for (i=0; i<n; i++) {
+      if (i == k) continue;
+      tmp = work[i*n + k];
+      if (tmp == 0.0) continue;
+      for (j=0; j<n; j++) {
+        work[i*n + j] -= tmp * work[k*n + j];
+        inverse_[i*n + j] -= tmp * inverse_[k*n + j];
+      }
+    }
+  }
+}
+
+bool kinematicLinearTransform::isValid()
+{
+  return valid_;
+}
+
+void kinematicLinearTransform::forward(const double *real, double *virt)
+{
+  int i, j;
+  int n = numAxes_;
+
+  for (i=0; i<n; i++) {
+    virt[i] = offsets_[i];
+    for (j=0; j<n; j++) virt[i] += matrix_[i*n + j] * real[j];
+  }
+}
+
+void kinematicLinearTransform::inverse(const double *virt, double *real)
+{
+  int i, j;
+  int n = numAxes_;
+
+  for (i=0; i<n; i++) {
+    real[i] = 0.0;
+    for (j=0; j<n; j++) real[i] += inverse_[i*n + j] * (virt[j] - offsets_[j]);
+  }
+}
+
+/** The Jacobian of a linear transform is the constant inverse matrix. */
+void kinematicLinearTransform::inverseJacobian(const double *virt, double *jacobian)
+{
+  memcpy(jacobian, inverse_, numAxes_*numAxes_*sizeof(double));
+}
+
+void kinematicLinearTransform::report(FILE *fp, int level)
+{
+  int i, j;
+
+  kinematicTransform::report(fp, level);
+  if (level > 1) {
+    for (i=0; i<numAxes_; i++) {
+      fprintf(fp, "      ");
+      for (j=0; j<numAxes_; j++) fprintf(fp, " %10.6f", matrix_[i*numAxes_ + j]);
+      fprintf(fp, "  + %10.6f\n", offsets_[i]);
+    }
+  }
+}
@@ -0,0 +1,62 @@
+/*
+FILENAME...   kinematicTransform.h
+USAGE...      Compiled forward/inverse transforms used by the kinematic motor controller.
+
+The transforms replace the chains of transform and calc records in pseudoMotor.db,
+sumDiff2D.db and coordTrans2D.db.  Each transform maps N real motor positions onto
+N virtual axis positions, in engineering units.
+
+*/
+#ifndef kinematicTransform_H
+#define kinematicTransform_H
+
+#include <stdio.h>
+
+#include <shareLib.h>
+
+#define MAX_KINEMATIC_GROUP_AXES 8
+
+/** Base class for all kinematic transforms.
+  * Derived classes must implement forward() and inverse().  They may override inverseJacobian()
+  * if the derivatives are known analytically; the default uses finite differences. */
+class epicsShareClass kinematicTransform {
+public:
+  kinematicTransform(const char *type, int numAxes);
+  virtual ~kinematicTransform();
+
+  /** Computes all virtual positions from all real positions in one pass.
+    * \param[in] real Array of numAxes_ real motor positions.
+    * \param[out] virt Array of numAxes_ virtual axis positions. */
+  virtual void forward(const double *real, double *virt) = 0;
+  /** Computes all real positions from all virtual positions in one pass.
+    * \param[in] virt Array of numAxes_ virtual axis positions.
+    * \param[out] real Array of numAxes_ real motor positions. */
+  virtual void inverse(const double *virt, double *real) = 0;
+  virtual void inverseJacobian(const double *virt, double *jacobian);
+  virtual void report(FILE *fp, int level);
+
+  static kinematicTransform *create(const char *type, int numAxes, const char *parameters);
+
+  const char *type_;  /**< Name of the transform type, e.g. "rotation2D" */
+  int numAxes_;       /**< Number of real motors, which equals the number of virtual axes */
+};
+
+/** Affine transform, virt = M*real + b.
+  * The sumDiff, slit and rotation2D transforms are special cases of this one. */
+class epicsShareClass kinematicLinearTransform : public kinematicTransform {
+public:
+  kinematicLinearTransform(const char *type, int numAxes, const double *matrix, const double *offsets);
+  void forward(const double *real, double *virt);
+  void inverse(const double *virt, double *real);
+  void inverseJacobian(const double *virt, double *jacobian);
+  void report(FILE *fp, int level);
+  bool isValid();
+
+private:
+  double matrix_[MAX_KINEMATIC_GROUP_AXES*MAX_KINEMATIC_GROUP_AXES];   /**< Forward matrix, row-major */
+  double inverse_[MAX_KINEMATIC_GROUP_AXES*MAX_KINEMATIC_GROUP_AXES];  /**< Inverse of matrix_, row-major */
+  double offsets_[MAX_KINEMATIC_GROUP_AXES];                           /**< Forward offsets */
+  bool valid_;                                                         /**< false if matrix_ is singular */
+};
+
+#endif /* kinematicTransform_H */
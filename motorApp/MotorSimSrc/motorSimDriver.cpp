@@ -35,6 +35,161 @@ December 13, 2009
 
 static const char *driverName = "motorSimDriver";
 
+/** Starts a new streaming profile.
+  * The simulated controller holds up to MOTOR_SIM_STREAM_QUEUE points, like the trajectory
+  * buffer of a real controller. */
+asynStatus motorSimController::buildStreamProfile(char *message)
+{
+  if (streamRunning_) {
+    sprintf(message, "Streaming profile is executing");
+    return asynError;
+  }
+  queueReceived_ = 0;
+  queueDone_ = 0;
+  return asynSuccess;
+}
+
+/** Copies as many points as fit into the queue of the simulated controller. */
+asynStatus motorSimController::appendStreamSegment(size_t firstPoint, size_t numPoints, size_t *numAccepted,
+                                                   char *message)
+{
+  size_t i, q, numFree;
+  int axis;
+
+  *numAccepted = 0;
+  if (firstPoint != queueReceived_) {
+    sprintf(message, "Expected point %lu, got point %lu", (unsigned long)queueReceived_, (unsigned long)firstPoint);
+    return asynError;
+  }
+  numFree = MOTOR_SIM_STREAM_QUEUE - (queueReceived_ - queueDone_);
+  if (numPoints > numFree) numPoints = numFree;
+  for (i=0; i<numPoints; i++) {
+    q = (firstPoint + i) % MOTOR_SIM_STREAM_QUEUE;
+    queueTimes_[q] = streamTime(firstPoint + i);
+    for (axis=0; axis<numAxes_; axis++) {
+      if (!streamUsesAxis(axis)) continue;
+      queuePositions_[axis*MOTOR_SIM_STREAM_QUEUE + q] = streamPosition(axis, firstPoint + i);
+    }
+  }
+  queueReceived_ += numPoints;
+  *numAccepted = numPoints;
+  return asynSuccess;
+}
+
+/** Starts moving the axes of the stream from their current positions to the queued points. */
+asynStatus motorSimController::executeStreamProfile(char *message)
+{
+  int axis;
+  motorSimAxis *pAxis;
+
+  for (axis=0; axis<numAxes_; axis++) {
+    if (!streamUsesAxis(axis)) continue;
+    pAxis = getAxis(axis);
+    pAxis->streaming_ = true;
+    pAxis->streamStart_ = pAxis->nextpoint_.axis[0].p + pAxis->enc_offset_;
+    pAxis->nextpoint_.axis[0].v = 0.;
+  }
+  pointElapsed_ = 0.;
+  streamRunning_ = true;
+  return asynSuccess;
+}
+
+asynStatus motorSimController::abortStreamProfile()
+{
+  stopStream();
+  return asynSuccess;
+}
+
+/** Stops the axes of the stream where they are and hands them back to the route planner. */
+void motorSimController::stopStream()
+{
+  int axis;
+  motorSimAxis *pAxis;
+
+  streamRunning_ = false;
+  for (axis=0; axis<numAxes_; axis++) {
+    pAxis = getAxis(axis);
+    if (!pAxis->streaming_) continue;
+    pAxis->streaming_ = false;
+    pAxis->nextpoint_.axis[0].v = 0.;
+    pAxis->endpoint_.axis[0].p = pAxis->nextpoint_.axis[0].p;
+    pAxis->endpoint_.axis[0].v = 0.;
+    pAxis->reroute_ = ROUTE_NEW_ROUTE;
+  }
+}
+
+/** Advances a streaming profile by one simulation step.
+  * The demand moves linearly from point to point and the axes follow it with a lag, so the
+  * readback of each point is the simulated axis position when the point is reached.
+  * When the queue runs empty the demand holds until more points are appended, which the base
+  * class reports as an underrun if the client did not append in time.
+  * \param[in] delta Time in seconds since the last step. */
+void motorSimController::processStream(double delta)
+{
+  int axis;
+  motorSimAxis *pAxis;
+  size_t q;
+  double remaining = delta;
+  double target, demand, fraction, readback;
+  double elapsed;
+  double stepDone = 0.;
+
+  if (!streamRunning_) return;
+  while (remaining > 0.) {
+    if (queueDone_ >= queueReceived_) {
+      queueStarved_++;
+      break;
+    }
+    q = queueDone_ % MOTOR_SIM_STREAM_QUEUE;
+    if (pointElapsed_ + remaining < queueTimes_[q]) {
+      pointElapsed_ += remaining;
+      break;
+    }
+    /* The point is reached in this step */
+    elapsed = pointElapsed_;
+    remaining -= queueTimes_[q] - pointElapsed_;
+    pointElapsed_ = 0.;
+    for (axis=0; axis<numAxes_; axis++) {
+      pAxis = getAxis(axis);
+      if (!pAxis->streaming_) continue;
+      target = queuePositions_[axis*MOTOR_SIM_STREAM_QUEUE + q];
+      pAxis->followStream(target, queueTimes_[q] - elapsed);
+      pAxis->streamStart_ = target;
+      readback = pAxis->nextpoint_.axis[0].p + pAxis->enc_offset_;
+      setStreamReadback(axis, queueDone_, readback, readback - target);
+    }
+    queueDone_++;
+    stepDone = delta - remaining;
+  }
+
+  for (axis=0; axis<numAxes_; axis++) {
+    pAxis = getAxis(axis);
+    if (!pAxis->streaming_) continue;
+    demand = pAxis->streamStart_;
+    if (queueDone_ < queueReceived_) {
+      q = queueDone_ % MOTOR_SIM_STREAM_QUEUE;
+      target = queuePositions_[axis*MOTOR_SIM_STREAM_QUEUE + q];
+      fraction = pointElapsed_ / queueTimes_[q];
+      demand += (target - pAxis->streamStart_) * fraction;
+    }
+    pAxis->followStream(demand, delta - stepDone);
+  }
+  setStreamPointsDone(queueDone_);
+}
+
+/** Moves a streaming axis towards its demand as a first order lag with time constant MOTOR_SIM_STREAM_LAG.
+  * \param[in] demand Demanded position, controller units including the encoder offset.
+  * \param[in] delta Time in seconds over which the axis follows the demand. */
+void motorSimAxis::followStream(double demand, double delta)
+{
+  double position = nextpoint_.axis[0].p;
+
+  if (delta <= 0.) return;
+  position += (demand - enc_offset_ - position) * (1. - exp(-delta / MOTOR_SIM_STREAM_LAG));
+  nextpoint_.axis[0].v = (position - nextpoint_.axis[0].p) / delta;
+  nextpoint_.axis[0].p = position;
+}
+
 static void motorSimTaskC(void *drvPvt);
 
 typedef struct motorSimControllerNode {
@@ -66,17 +221,20 @@ motorSimAxis::motorSimAxis(motorSimController *pController, int axis, double low
   nextpoint_.T = 0;
   nextpoint_.axis[0].p = start;
   route_ = routeNew( &(this->endpoint_), &pars );
-  deferred_move_ = 0;
+  streaming_ = false;
+  streamStart_ = 0.;
 }
 
 
-motorSimController::motorSimController(const char *portName, int numAxes, int priority, int stackSize)
+motorSimController::motorSimController(const char *portName, int numAxes, int priority, int stackSize,
+                                       double initDelay, double axisInitDelay)
   :  asynMotorController(portName, numAxes, NUM_SIM_CONTROLLER_PARAMS, 
                          asynInt32Mask | asynFloat64Mask, 
                          asynInt32Mask | asynFloat64Mask,
                          ASYN_CANBLOCK | ASYN_MULTIDEVICE, 
                          1, // autoconnect
-                         priority, stackSize)
+                         priority, stackSize),
+     initDelay_(initDelay), axisInitDelay_(axisInitDelay)
 {
   int axis;
   motorSimControllerNode *pNode;
@@ -94,7 +252,13 @@ motorSimController::motorSimController(const char *portName, int numAxes, int pr
 
   if (numAxes < 1 ) numAxes = 1;
   numAxes_ = numAxes;
-  this->movesDeferred_ = 0;
+  queueTimes_ = (double *)calloc(MOTOR_SIM_STREAM_QUEUE, sizeof(double));
+  queuePositions_ = (double *)calloc(MOTOR_SIM_STREAM_QUEUE*numAxes, sizeof(double));
+  queueReceived_ = 0;
+  queueDone_ = 0;
+  pointElapsed_ = 0.;
+  streamRunning_ = false;
+  queueStarved_ = 0;
   for (axis=0; axis<numAxes; axis++) {
     new motorSimAxis(this, axis, DEFAULT_LOW_LIMIT, DEFAULT_HI_LIMIT, DEFAULT_HOME, DEFAULT_START);
     setDoubleParam(axis, this->motorPosition_, DEFAULT_START);
@@ -104,6 +268,26 @@ motorSimController::motorSimController(const char *portName, int numAxes, int pr
                                          epicsThreadPriorityLow,
                                          epicsThreadGetStackSize(epicsThreadStackMedium),
                                          (EPICSTHREADFUNC) motorSimTaskC, (void *) this);
+
+  // This is the last thing in the constructor because it calls init() and initAxis() in another thread
+  startInit();
+}
+
+/** Simulates the connection to a real controller, which can be slow.
+  * Sleeps for initDelay_ seconds. */
+asynStatus motorSimController::init()
+{
+  if (initDelay_ > 0.) epicsThreadSleep(initDelay_);
+  return asynSuccess;
+}
+
+/** Simulates the per-axis queries done by a real controller at startup.
+  * Sleeps for axisInitDelay_ seconds.
+  * \param[in] axisNo Axis index number. */
+asynStatus motorSimController::initAxis(int axisNo)
+{
+  if (axisInitDelay_ > 0.) epicsThreadSleep(axisInitDelay_);
+  return asynSuccess;
 }
 
 void motorSimController::report(FILE *fp, int level)
@@ -142,76 +326,15 @@ void motorSimController::report(FILE *fp, int level)
       if (pAxis->homing_) fprintf(fp, "    Currently homing axis\n" );
     }
   }
+  if (level > 0) {
+    fprintf(fp, "  Stream queue: running=%d, received=%lu, done=%lu, starved steps=%lu\n",
+            streamRunning_, (unsigned long)queueReceived_, (unsigned long)queueDone_, queueStarved_);
+  }
 
   // Call the base class method
   asynMotorController::report(fp, level);
 }
 
-asynStatus motorSimController::processDeferredMoves()
-{
-  asynStatus status = asynError;
-  double position = 0.0;
-  int axis;
-  motorSimAxis *pAxis;
-
-  for (axis=0; axis<numAxes_; axis++)
-  {
-    pAxis = getAxis(axis);
-    if (pAxis->deferred_move_) {
-      position = pAxis->deferred_position_;
-      /* Check to see if in hard limits */
-      if ((pAxis->nextpoint_.axis[0].p >= pAxis->hiHardLimit_  &&  position > pAxis->nextpoint_.axis[0].p) ||
-          (pAxis->nextpoint_.axis[0].p <= pAxis->lowHardLimit_ &&  position < pAxis->nextpoint_.axis[0].p)) return asynError;
-      pAxis->endpoint_.axis[0].p = position - pAxis->enc_offset_;
-      pAxis->endpoint_.axis[0].v = 0.0;    
-      setIntegerParam(axis, motorStatusDone_, 0);
-      pAxis->deferred_move_ = 0;
-    }
-  }
-  return status;
-}
-
-asynStatus motorSimController::writeInt32(asynUser *pasynUser, epicsInt32 value)
-{
-  int function = pasynUser->reason;
-  asynStatus status = asynSuccess;
-  motorSimAxis *pAxis = this->getAxis(pasynUser);
-  static const char *functionName = "writeInt32";
-  
-  
-  /* Set the parameter and readback in the parameter library.  This may be overwritten when we read back the
-   * status at the end, but that's OK */
-  pAxis->setIntegerParam(function, value);
-  
-  if (function == motorDeferMoves_)
-  {
-    asynPrint(pasynUser, ASYN_TRACE_FLOW,
-              "%s:%s: %sing Deferred Move flag on driver %s\n",
-              value != 0.0?"Sett":"Clear",
-              driverName, functionName, this->portName);
-    if (value == 0.0 && movesDeferred_ != 0)
-    {
-      processDeferredMoves();
-    }
-    movesDeferred_ = value;
-  } else {
-    /* Call base class call its method (if we have our parameters check this here) */
-    status = asynMotorController::writeInt32(pasynUser, value);
-  }
-  
-  /* Do callbacks so higher layers see any changes */
-  pAxis->callParamCallbacks();
-  if (status) 
-    asynPrint(pasynUser, ASYN_TRACE_ERROR, 
-              "%s:%s: error, status=%d function=%d, value=%d\n", 
-              driverName, functionName, status, function, value);
-  else        
-    asynPrint(pasynUser, ASYN_TRACEIO_DRIVER, 
-              "%s:%s: function=%d, value=%d\n", 
-              driverName, functionName, function, value);
-  return status;
-}
-
 motorSimAxis* motorSimController::getAxis(asynUser *pasynUser)
 {
   return static_cast<motorSimAxis*>(asynMotorController::getAxis(pasynUser));
@@ -247,6 +370,8 @@ void motorSimController::motorSimTask()
   int axis;
   motorSimAxis *pAxis;
 
+  waitInit(0.);
+  epicsTimeGetCurrent(&prevTime_);
   while ( 1 )
   {
     /* Get a new timestamp */
@@ -257,6 +382,12 @@ void motorSimController::motorSimTask()
     if ( delta > (DELTA/4.0) && delta <= (4.0*DELTA) )
     {
       /* A reasonable time has elapsed, it's not a time step in the clock */
+      /* motorSim does not use the base class poller, so it services the streaming profile itself */
+      this->lock();
+      processStream(delta);
+      pollStreamProfile();
+      if (streamRunning_ && !streamExecuting_) stopStream();
+      this->unlock();
       for (axis=0; axis<numAxes_; axis++) 
       {     
         this->lock();
@@ -280,14 +411,8 @@ asynStatus motorSimAxis::move(double position, int relative, double minVelocity,
   if ((nextpoint_.axis[0].p >= hiHardLimit_  &&  position > nextpoint_.axis[0].p) ||
     (nextpoint_.axis[0].p <= lowHardLimit_ &&  position < nextpoint_.axis[0].p)  ) return asynError;
 
-  if (pC_->movesDeferred_ == 0) { /*Normal move.*/
-    endpoint_.axis[0].p = position - enc_offset_;
-    endpoint_.axis[0].v = 0.0;
-  } else { /*Deferred moves.*/
-    deferred_position_ = position;
-    deferred_move_ = 1;
-    deferred_relative_ = relative;
-  }
+  endpoint_.axis[0].p = position - enc_offset_;
+  endpoint_.axis[0].v = 0.0;
   routeGetParams(route_, &pars);
   if (maxVelocity != 0) pars.axis[0].Vmax = fabs(maxVelocity);
   if (acceleration != 0) pars.axis[0].Amax = fabs(acceleration);
@@ -351,7 +476,6 @@ asynStatus motorSimAxis::stop(double acceleration )
   // static const char *functionName = "moveVelocityAxis";
 
   setVelocity(0.0, acceleration );
-  deferred_move_ = 0;
   return asynSuccess;
 }
 
@@ -395,10 +519,13 @@ void motorSimAxis::process(double delta )
   double nowTimeSecs = 0.0;
 
   lastpos = nextpoint_.axis[0].p;
-  nextpoint_.T += delta;
-  routeFind( route_, reroute_, &endpoint_, &nextpoint_ );
-  /*  if (reroute_ == ROUTE_NEW_ROUTE) routePrint( route_, reroute_, &endpoint_, &nextpoint_, stdout ); */
-  reroute_ = ROUTE_CALC_ROUTE;
+  /* While a streaming profile is executing the position is set by motorSimController::processStream() */
+  if (!streaming_) {
+    nextpoint_.T += delta;
+    routeFind( route_, reroute_, &endpoint_, &nextpoint_ );
+    /*  if (reroute_ == ROUTE_NEW_ROUTE) routePrint( route_, reroute_, &endpoint_, &nextpoint_, stdout ); */
+    reroute_ = ROUTE_CALC_ROUTE;
+  }
 
   /* No, do a limits check */
   if (homing_ && 
@@ -431,11 +558,9 @@ void motorSimAxis::process(double delta )
     }
   }
 
-  if (nextpoint_.axis[0].v ==  0) {
-    if (!deferred_move_) {
-      if (!delayedDone_) {
-	done = 1;
-      }
+  if ((nextpoint_.axis[0].v ==  0) && !streaming_) {
+    if (!delayedDone_) {
+      done = 1;
     }
   } else {
     done = 0;
@@ -473,9 +598,10 @@ void motorSimAxis::process(double delta )
 }
 
 /** Configuration command, called directly or from iocsh */
-extern "C" int motorSimCreateController(const char *portName, int numAxes, int priority, int stackSize)
+extern "C" int motorSimCreateController(const char *portName, int numAxes, int priority, int stackSize,
+                                        double initDelay, double axisInitDelay)
 {
-  new motorSimController(portName,numAxes, priority, stackSize);
+  new motorSimController(portName,numAxes, priority, stackSize, initDelay, axisInitDelay);
   return(asynSuccess);
 }
 
@@ -509,14 +635,18 @@ static const iocshArg motorSimCreateControllerArg0 = {"Port name", iocshArgStrin
 static const iocshArg motorSimCreateControllerArg1 = {"Number of axes", iocshArgInt};
 static const iocshArg motorSimCreateControllerArg2 = {"priority", iocshArgInt};
 static const iocshArg motorSimCreateControllerArg3 = {"stackSize", iocshArgInt};
+static const iocshArg motorSimCreateControllerArg4 = {"Init delay (s)", iocshArgDouble};
+static const iocshArg motorSimCreateControllerArg5 = {"Axis init delay (s)", iocshArgDouble};
 static const iocshArg * const motorSimCreateControllerArgs[] =  {&motorSimCreateControllerArg0,
                                                                  &motorSimCreateControllerArg1,
                                                                  &motorSimCreateControllerArg2,
-                                                                 &motorSimCreateControllerArg3};
-static const iocshFuncDef motorSimCreateControllerDef = {"motorSimCreateController", 4, motorSimCreateControllerArgs};
+                                                                 &motorSimCreateControllerArg3,
+                                                                 &motorSimCreateControllerArg4,
+                                                                 &motorSimCreateControllerArg5};
+static const iocshFuncDef motorSimCreateControllerDef = {"motorSimCreateController", 6, motorSimCreateControllerArgs};
 static void motorSimCreateContollerCallFunc(const iocshArgBuf *args)
 {
-  motorSimCreateController(args[0].sval, args[1].ival, args[2].ival, args[3].ival);
+  motorSimCreateController(args[0].sval, args[1].ival, args[2].ival, args[3].ival, args[4].dval, args[5].dval);
 }
 
 static const iocshArg motorSimConfigAxisArg0 = { "Post name",     iocshArgString};
@@ -18,6 +18,8 @@ March 28, 2010
 #include "route.h"
 
 #define NUM_SIM_CONTROLLER_PARAMS 0
+#define MOTOR_SIM_STREAM_QUEUE    100   /* Points of a streaming profile the simulated controller can hold */
+#define MOTOR_SIM_STREAM_LAG      0.02  /* Time constant in seconds with which a streaming axis follows its demand */
 
 class epicsShareClass motorSimAxis : public asynMotorAxis
 {
@@ -49,12 +51,12 @@ private:
   double home_;
   int homing_;
   epicsTimeStamp tLast_;
-  double deferred_position_;
-  int deferred_move_;
-  int deferred_relative_;
   double lastTimeSecs_;
   int delayedDone_;
   int lastDone_;
+  bool streaming_;           /**< The position is set by a streaming profile */
+  double streamStart_;       /**< Demand at the start of the current profile point, controller units */
+  void followStream(double demand, double delta);
   
 friend class motorSimController;
 };
@@ -63,22 +65,38 @@ class epicsShareClass motorSimController : asynMotorController {
 public:
 
   /* These are the fucntions we override from the base class */
-  motorSimController(const char *portName, int numAxes, int priority, int stackSize);
-  asynStatus writeInt32(asynUser *pasynUser, epicsInt32 value);
+  motorSimController(const char *portName, int numAxes, int priority, int stackSize,
+                     double initDelay, double axisInitDelay);
   void report(FILE *fp, int level);
   motorSimAxis* getAxis(asynUser *pasynUser);
   motorSimAxis* getAxis(int axisNo);
   asynStatus profileMove(asynUser *pasynUser, int npoints, double positions[], double times[], int relative, int trigger);
   asynStatus triggerProfile(asynUser *pasynUser);
+  asynStatus init();
+  asynStatus initAxis(int axisNo);
+  asynStatus buildStreamProfile(char *message);
+  asynStatus appendStreamSegment(size_t firstPoint, size_t numPoints, size_t *numAccepted, char *message);
+  asynStatus executeStreamProfile(char *message);
+  asynStatus abortStreamProfile();
 
   /* These are the functions that are new to this class */
   void motorSimTask();  // Should be pivate, but called from non-member function
 
 private:
-  asynStatus processDeferredMoves();
+  void processStream(double delta);
+  void stopStream();
+
   epicsThreadId motorThread_;
   epicsTimeStamp prevTime_;
-  int movesDeferred_;
+  double initDelay_;       /**< Simulated time to connect to the controller in init() */
+  double axisInitDelay_;   /**< Simulated time to query each axis in initAxis() */
+  double *queueTimes_;     /**< Times of the streaming profile points held by the simulated controller */
+  double *queuePositions_; /**< Positions of the points held, MOTOR_SIM_STREAM_QUEUE per axis */
+  size_t queueReceived_;   /**< Points received since the stream was built */
+  size_t queueDone_;       /**< Points executed since the stream was built */
+  double pointElapsed_;    /**< Time spent moving to the current point */
+  bool streamRunning_;     /**< A streaming profile is executing */
+  unsigned long queueStarved_; /**< Simulation steps in which the queue was empty while executing */
   
 friend class motorSimAxis;
 };
@@ -9,6 +9,7 @@
 #include <string.h>
 
 #include <epicsThread.h>
+#include <epicsTime.h>
 
 #include <asynPortDriver.h>
 #define epicsExportSharedSymbols
@@ -44,9 +45,14 @@ asynMotorAxis::asynMotorAxis(class asynMotorController *pC, int axisNo)
   }
   pC->pAxes_[axisNo] = this;
   status_.status = 0;
+  deferredMovePending_ = 0;
   profilePositions_       = NULL;
   profileReadbacks_       = NULL;
   profileFollowingErrors_ = NULL;
+  streamPositions_        = NULL;
+  streamReadbacks_        = NULL;
+  streamFollowingErrors_  = NULL;
+  streamUse_              = false;
   
   /* Used to keep track of referencing mode in the driver.*/
   referencingMode_ = 0;
@@ -57,6 +63,16 @@ asynMotorAxis::asynMotorAxis(class asynMotorController *pC, int axisNo)
   disableFlag_ = 0;
   lastEndOfMoveTime_ = 0;
 
+  /* The position history buffer is disabled until initializeHistory() is called */
+  history_ = NULL;
+  historySize_ = 0;
+  historyWriteCount_ = 0;
+  historyReadCount_ = 0;
+  historyOverruns_ = 0;
+  historyPending_ = 0;
+  historyArrays_ = NULL;
+  historyNumRead_ = 0;
+
   // Create the asynUser, connect to this axis
   pasynUser_ = pasynManager->createAsynUser(NULL, NULL);
   pasynManager->connectDevice(pasynUser_, pC->portName, axisNo);
@@ -193,6 +209,10 @@ asynStatus asynMotorAxis::setEncoderRatio(double ratio)
 
 void asynMotorAxis::report(FILE *fp, int details)
 {
+  if ((details > 1) && history_) {
+    fprintf(fp, "    history buffer size=%d, unread samples=%d, overruns=%d\n",
+            (int)historySize_, (int)getHistoryCount(), (int)historyOverruns_);
+  }
 }
 
 
@@ -240,12 +260,14 @@ int  asynMotorAxis::getReferencingModeMove()
   * (motorStatusDirection_, motorStatusHomed_, etc.).  In that case it sets or clears the appropriate
   * bit in its private MotorStatus.status structure and if that status has changed sets a flag to
   * do callbacks to devMotorAsyn when callParamCallbacks() is called.
+  * While the axis has a deferred move pending, motorStatusDone_ is forced to 0.
   * \param[in] function The function (parameter) number 
   * \param[in] value Value to set */
 asynStatus asynMotorAxis::setIntegerParam(int function, int value)
 {
   int mask;
   epicsUInt32 status=0;
+  if ((function == pC_->motorStatusDone_) && deferredMovePending_) value = 0;
   // This assumes the parameters defined above are in the same order as the bits the motor record expects!
   if (function >= pC_->motorStatusDirection_ && 
       function <= pC_->motorStatusHomed_) {
@@ -266,24 +288,13 @@ asynStatus asynMotorAxis::setIntegerParam(int function, int value)
 
 
 /** Sets the value for a double for this axis in the parameter library.
-  * This function takes special action if the parameter is motorPosition_ or motorEncoderPosition_.  
-  * In that case it sets the value in the private MotorStatus structure and if the value has changed
-  * then sets a flag to do callbacks to devMotorAsyn when callParamCallbacks() is called.
+  * asynMotorController::setDoubleParam() takes special action if the parameter is motorPosition_ or
+  * motorEncoderPosition_.  In that case it sets the value in the private MotorStatus structure and if
+  * the value has changed then sets a flag to do callbacks to devMotorAsyn when callParamCallbacks() is called.
   * \param[in] function The function (parameter) number 
   * \param[in] value Value to set */
 asynStatus asynMotorAxis::setDoubleParam(int function, double value)
 {
-  if (function == pC_->motorPosition_) {
-    if (value != status_.position) {
-        statusChanged_ = 1;
-        status_.position = value;
-    }
-  } else if (function == pC_->motorEncoderPosition_) {
-    if (value != status_.encoderPosition) {
-        statusChanged_ = 1;
-        status_.encoderPosition = value;
-    }
-  }  
   // Call the base class method
   return pC_->setDoubleParam(axisNo_, function, value);
 }   
@@ -302,9 +313,15 @@ asynStatus asynMotorAxis::setStringParam(int function, const char *value)
 
 /** Calls the callbacks for any parameters that have changed for this axis in the parameter library.
   * This function takes special action if the aggregate MotorStatus structure has changed.
-  * In that case it does callbacks on the asynGenericPointer interface, typically to devMotorAsyn. */  
+  * In that case it does callbacks on the asynGenericPointer interface, typically to devMotorAsyn.
+  * If the position history buffer is enabled and a position was set since the last call, 
+  * a sample is added to the history buffer. */  
 asynStatus asynMotorAxis::callParamCallbacks()
 {
+  if (historyPending_) {
+    historyPending_ = 0;
+    addHistorySample();
+  }
   if (statusChanged_) {
     statusChanged_ = 0;
     pC_->doCallbacksGenericPointer((void *)&status_, pC_->motorStatus_, axisNo_);
@@ -325,6 +342,25 @@ asynStatus asynMotorAxis::initializeProfile(size_t maxProfilePoints)
 }
   
 
+/** Allocates the ring buffers for streaming profile moves of this axis.
+  * \param[in] maxPoints Number of points in the ring buffers, 0 to free them. */
+asynStatus asynMotorAxis::initializeStreamProfile(size_t maxPoints)
+{
+  if (streamPositions_)       free(streamPositions_);
+  if (streamReadbacks_)       free(streamReadbacks_);
+  if (streamFollowingErrors_) free(streamFollowingErrors_);
+  streamPositions_       = NULL;
+  streamReadbacks_       = NULL;
+  streamFollowingErrors_ = NULL;
+  streamUse_             = false;
+  if (maxPoints == 0) return asynSuccess;
+  streamPositions_       = (double *)calloc(maxPoints, sizeof(double));
+  streamReadbacks_       = (double *)calloc(maxPoints, sizeof(double));
+  streamFollowingErrors_ = (double *)calloc(maxPoints, sizeof(double));
+  if (!streamPositions_ || !streamReadbacks_ || !streamFollowingErrors_) return asynError;
+  return asynSuccess;
+}
+
 
 /** Function to define the motor positions for a profile move. 
   * This base class function converts the positions from user units
@@ -435,6 +471,139 @@ asynStatus asynMotorAxis::readbackProfile()
   return asynSuccess;
 }
 
+/* These are the functions for the position history buffer */
+
+/** Allocates the position history buffer for this axis.
+  * The buffer is allocated once here, so adding samples in the poller never allocates memory.
+  * The caller must have the controller locked.
+  * \param[in] maxSamples Number of samples in the buffer, 0 disables the buffer. */
+asynStatus asynMotorAxis::initializeHistory(size_t maxSamples)
+{
+  if (history_) free(history_);
+  history_ = NULL;
+  if (historyArrays_) free(historyArrays_);
+  historyArrays_ = NULL;
+  historySize_ = 0;
+  historyWriteCount_ = 0;
+  historyReadCount_ = 0;
+  historyOverruns_ = 0;
+  historyNumRead_ = 0;
+  if (maxSamples > 0) {
+    history_ = (MotorHistorySample *)calloc(maxSamples, sizeof(MotorHistorySample));
+    /* Times, positions, encoder positions, velocities and status of the last chunk read */
+    historyArrays_ = (double *)calloc(5*maxSamples, sizeof(double));
+    if (!history_ || !historyArrays_) return asynError;
+    historySize_ = maxSamples;
+  }
+  pC_->setIntegerParam(axisNo_, pC_->motorHistoryNumSamples_, 0);
+  pC_->setIntegerParam(axisNo_, pC_->motorHistoryOverruns_, 0);
+  pC_->setIntegerParam(axisNo_, pC_->motorHistoryNumRead_, 0);
+  return asynSuccess;
+}
+
+/** Adds a sample with the current time, positions and status to the position history buffer.
+  * Called from callParamCallbacks() with the controller locked.  When the buffer is full the
+  * oldest sample is overwritten and the overrun counter is incremented. */
+void asynMotorAxis::addHistorySample()
+{
+  MotorHistorySample *pSample, *pLast;
+  epicsTimeStamp now;
+  double dt;
+
+  if (!history_) return;
+  epicsTimeGetCurrent(&now);
+  pSample = &history_[historyWriteCount_ % historySize_];
+  pSample->time = now.secPastEpoch + now.nsec/1.e9;
+  pSample->position = status_.position;
+  pSample->encoderPosition = status_.encoderPosition;
+  pSample->status = status_.status;
+  pSample->velocity = 0.0;
+  if (historyWriteCount_ > 0) {
+    pLast = &history_[(historyWriteCount_ - 1) % historySize_];
+    dt = pSample->time - pLast->time;
+    if (dt > 0.) {
+      // Use the encoder if there is one, the status bits are in the order of the parameters, see setIntegerParam()
+      if (status_.status & (1 << (pC_->motorStatusHasEncoder_ - pC_->motorStatusDirection_)))
+        pSample->velocity = (pSample->encoderPosition - pLast->encoderPosition) / dt;
+      else
+        pSample->velocity = (pSample->position - pLast->position) / dt;
+    }
+  }
+  historyWriteCount_++;
+  if (historyWriteCount_ - historyReadCount_ > historySize_) {
+    historyReadCount_ = historyWriteCount_ - historySize_;
+    historyOverruns_++;
+    pC_->setIntegerParam(axisNo_, pC_->motorHistoryOverruns_, (int)historyOverruns_);
+  }
+  pC_->setIntegerParam(axisNo_, pC_->motorHistoryNumSamples_, (int)getHistoryCount());
+}
+
+/** Returns the number of unread samples in the position history buffer. */
+size_t asynMotorAxis::getHistoryCount()
+{
+  return historyWriteCount_ - historyReadCount_;
+}
+
+/** Reads the oldest unread samples from the position history buffer.
+  * This is the chunked read API for C++ clients.  It can be called repeatedly to drain the buffer.
+  * The caller must have the controller locked.
+  * \param[out] samples Array to receive the samples, oldest first.
+  * \param[in] maxSamples Maximum number of samples to read.
+  * \return The number of samples actually read. */
+size_t asynMotorAxis::readHistory(MotorHistorySample *samples, size_t maxSamples)
+{
+  size_t i, numRead;
+
+  if (!history_) return 0;
+  numRead = getHistoryCount();
+  if (numRead > maxSamples) numRead = maxSamples;
+  for (i=0; i<numRead; i++) {
+    samples[i] = history_[(historyReadCount_ + i) % historySize_];
+  }
+  historyReadCount_ += numRead;
+  pC_->setIntegerParam(axisNo_, pC_->motorHistoryNumSamples_, (int)getHistoryCount());
+  return numRead;
+}
+
+/** Reads a chunk of samples from the position history buffer into the MOTOR_HISTORY_* arrays
+  * and does callbacks on the arrays.  Called when MOTOR_HISTORY_READ is written.
+  * \param[in] maxSamples Maximum number of samples to read, 0 to read as many as fit in the arrays. */
+asynStatus asynMotorAxis::readHistoryChunk(size_t maxSamples)
+{
+  double *times, *positions, *encoders, *velocities, *status;
+  MotorHistorySample *pSample;
+  size_t i, numRead;
+
+  if (!history_) return asynError;
+  if ((maxSamples == 0) || (maxSamples > historySize_)) maxSamples = historySize_;
+  times      = historyArrays_;
+  positions  = historyArrays_ + historySize_;
+  encoders   = historyArrays_ + 2*historySize_;
+  velocities = historyArrays_ + 3*historySize_;
+  status     = historyArrays_ + 4*historySize_;
+  numRead = getHistoryCount();
+  if (numRead > maxSamples) numRead = maxSamples;
+  // Copy straight from the ring buffer, the number of unread samples is updated once
+  for (i=0; i<numRead; i++) {
+    pSample = &history_[(historyReadCount_ + i) % historySize_];
+    times[i]      = pSample->time;
+    positions[i]  = pSample->position;
+    encoders[i]   = pSample->encoderPosition;
+    velocities[i] = pSample->velocity;
+    status[i]     = pSample->status;
+  }
+  historyReadCount_ += numRead;
+  pC_->setIntegerParam(axisNo_, pC_->motorHistoryNumSamples_, (int)getHistoryCount());
+  historyNumRead_ = numRead;
+  pC_->setIntegerParam(axisNo_, pC_->motorHistoryNumRead_, (int)historyNumRead_);
+  pC_->doCallbacksFloat64Array(times,      historyNumRead_, pC_->motorHistoryTimes_,      axisNo_);
+  pC_->doCallbacksFloat64Array(positions,  historyNumRead_, pC_->motorHistoryPositions_,  axisNo_);
+  pC_->doCallbacksFloat64Array(encoders,   historyNumRead_, pC_->motorHistoryEncoders_,   axisNo_);
+  pC_->doCallbacksFloat64Array(velocities, historyNumRead_, pC_->motorHistoryVelocities_, axisNo_);
+  pC_->doCallbacksFloat64Array(status,     historyNumRead_, pC_->motorHistoryStatus_,     axisNo_);
+  return asynSuccess;
+}
+
 /****************************************************************************/
 /* The following functions are used by the automatic drive power control in the 
    base class poller in the asynMotorController class.*/
@@ -52,6 +52,11 @@ class epicsShareClass asynMotorAxis {
   virtual asynStatus executeProfile();
   virtual asynStatus abortProfile();
   virtual asynStatus readbackProfile();
+  virtual asynStatus initializeStreamProfile(size_t maxPoints);
+
+  virtual asynStatus initializeHistory(size_t maxSamples);
+  size_t readHistory(MotorHistorySample *samples, size_t maxSamples);
+  size_t getHistoryCount();
 
   void setReferencingModeMove(int distance);
   int getReferencingModeMove();
@@ -71,10 +76,26 @@ class epicsShareClass asynMotorAxis {
   double *profilePositions_;         /**< Array of target positions for profile moves */
   double *profileReadbacks_;         /**< Array of readback positions for profile moves */
   double *profileFollowingErrors_;   /**< Array of following errors for profile moves */   
+  double *streamPositions_;          /**< Ring buffer of target positions for streaming profile moves */
+  double *streamReadbacks_;          /**< Ring buffer of readback positions for streaming profile moves */
+  double *streamFollowingErrors_;    /**< Ring buffer of following errors for streaming profile moves */
+  bool streamUse_;                   /**< The axis is used by the streaming profile that was built */
   int referencingMode_;
 
   MotorStatus status_;
   int statusChanged_;
+  int deferredMovePending_;          /**< A move for this axis is held in the controller deferred move list */
+
+  void addHistorySample();
+  asynStatus readHistoryChunk(size_t maxSamples);
+  MotorHistorySample *history_;      /**< Ring buffer of position history samples, NULL if disabled */
+  size_t historySize_;               /**< Number of samples in history_ */
+  size_t historyWriteCount_;         /**< Total number of samples written to history_ */
+  size_t historyReadCount_;          /**< Total number of samples read or discarded from history_ */
+  size_t historyOverruns_;           /**< Number of samples overwritten before they were read */
+  int historyPending_;               /**< A position was set since the last history sample */
+  double *historyArrays_;            /**< Arrays of the last chunk read, for the MOTOR_HISTORY_* waveforms */
+  size_t historyNumRead_;            /**< Number of samples in historyArrays_ */
 
   private:
   int referencingModeMove_;
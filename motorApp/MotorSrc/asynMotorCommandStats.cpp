@@ -0,0 +1,76 @@
+/* asynMotorCommandStats.cpp
+ *
+ * This file implements the timing statistics of controller commands, one entry per
+ * command mnemonic, printed by the report() of a driver.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include <epicsMutex.h>
+
+#define epicsExportSharedSymbols
+#include <shareLib.h>
+#include "asynMotorCommandStats.h"
+
+/** Creates empty statistics. */
+asynMotorCommandStats::asynMotorCommandStats()
+  : numStats_(0)
+{
+  mutex_ = epicsMutexMustCreate();
+}
+
+asynMotorCommandStats::~asynMotorCommandStats()
+{
+  epicsMutexDestroy(mutex_);
+}
+
+/** Adds the time of one command to the statistics.
+  * \param[in] name The command mnemonic, it need not be terminated.
+  * \param[in] len The length of the mnemonic, a longer mnemonic is truncated.
+  * \param[in] elapsed Time in seconds from writing the command to reading the reply. */
+void asynMotorCommandStats::add(const char *name, size_t len, double elapsed)
+{
+  char mnemonic[MAX_COMMAND_NAME];
+  int i;
+
+  if (len >= sizeof(mnemonic)) len = sizeof(mnemonic)-1;
+  memcpy(mnemonic, name, len);
+  mnemonic[len] = '\0';
+
+  epicsMutexLock(mutex_);
+  for (i=0; i<numStats_; i++) {
+    if (strcmp(stats_[i].name, mnemonic) == 0) break;
+  }
+  if (i == numStats_) {
+    /* The last entry collects the mnemonics that do not fit */
+    if (numStats_ == MAX_COMMAND_STATS) {
+      i = MAX_COMMAND_STATS - 1;
+    } else {
+      if (numStats_ == MAX_COMMAND_STATS - 1) strcpy(mnemonic, "(other)");
+      strcpy(stats_[i].name, mnemonic);
+      stats_[i].count = 0;
+      stats_[i].totalTime = 0.;
+      stats_[i].maxTime = 0.;
+      numStats_++;
+    }
+  }
+  stats_[i].count++;
+  stats_[i].totalTime += elapsed;
+  if (elapsed > stats_[i].maxTime) stats_[i].maxTime = elapsed;
+  epicsMutexUnlock(mutex_);
+}
+
+/** Prints one line per command with the count, mean and maximum time.
+  * \param[in] fp File pointer passed by caller where information is written to. */
+void asynMotorCommandStats::report(FILE *fp)
+{
+  int i;
+
+  epicsMutexLock(mutex_);
+  fprintf(fp, "  command        count   mean [ms]    max [ms]\n");
+  for (i=0; i<numStats_; i++) {
+    fprintf(fp, "  %-11s %8lu %11.3f %11.3f\n", stats_[i].name, stats_[i].count,
+            1000. * stats_[i].totalTime / stats_[i].count, 1000. * stats_[i].maxTime);
+  }
+  epicsMutexUnlock(mutex_);
+}
@@ -0,0 +1,42 @@
+/* asynMotorCommandStats.h
+ *
+ * This file defines the timing statistics of controller commands, one entry per
+ * command mnemonic, printed by the report() of a driver.
+ */
+#ifndef asynMotorCommandStats_H
+#define asynMotorCommandStats_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <epicsMutex.h>
+#include <shareLib.h>
+
+#define MAX_COMMAND_STATS 32
+#define MAX_COMMAND_NAME  12
+
+#ifdef __cplusplus
+
+/** Timing statistics of the commands sent to a controller.
+  * When all entries are used the times of further mnemonics are counted in a last entry "(other)". */
+class epicsShareClass asynMotorCommandStats {
+  public:
+  asynMotorCommandStats();
+  ~asynMotorCommandStats();
+  void add(const char *name, size_t len, double elapsed);
+  void report(FILE *fp);
+  int numCommands() {return numStats_;};
+
+  private:
+  struct CommandStats {
+    char name[MAX_COMMAND_NAME];   /**< Command mnemonic */
+    unsigned long count;           /**< Number of times the command was sent */
+    double totalTime;              /**< Total time in seconds */
+    double maxTime;                /**< Longest time in seconds */
+  };
+  epicsMutexId mutex_;                     /**< Protects the statistics, add() is called from several threads */
+  CommandStats stats_[MAX_COMMAND_STATS];
+  int numStats_;                           /**< Number of entries used in stats_ */
+};
+
+#endif /* __cplusplus */
+#endif /* asynMotorCommandStats_H */
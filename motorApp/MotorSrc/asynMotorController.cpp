@@ -9,6 +9,11 @@
 #include <string.h>
 
 #include <epicsThread.h>
+#include <epicsMutex.h>
+#include <epicsStdio.h>
+#include <epicsString.h>
+#include <ellLib.h>
+#include <initHooks.h>
 #include <iocsh.h>
 
 #include <asynPortDriver.h>
@@ -22,7 +27,177 @@
 static const char *driverName = "asynMotorController";
 static void asynMotorPollerC(void *drvPvt);
 static void asynMotorMoveToHomeC(void *drvPvt);
+static void asynMotorInitTaskC(void *drvPvt);
+static void asynMotorPollWorkerC(void *drvPvt);
+
+/* List of the controllers that have called startInit(), used for the barrier before iocInit */
+typedef struct motorInitNode {
+  ELLNODE node;
+  asynMotorController *pController;
+} motorInitNode;
+
+static ELLLIST motorInitList;
+static epicsMutexId motorInitListLock;
+static epicsThreadOnceId motorInitOnceId = EPICS_THREAD_ONCE_INIT;
+static int motorInitParallel = 1;          /* Run init() in a separate thread for each controller */
+static double motorInitTimeout = 300.;     /* Timeout for the barrier at the start of iocInit */
+static epicsTimeStamp motorInitFirstStart; /* Time of the first call to startInit() */
+static epicsTimeStamp motorInitLastDone;   /* Time the last init thread completed */
+extern "C" asynStatus asynMotorInitWait(double timeout);
+
+static void motorInitHook(initHookState state)
+{
+  if (state == initHookAtBeginning) asynMotorInitWait(motorInitTimeout);
+}
+
+static void motorInitOnce(void *arg)
+{
+  ellInit(&motorInitList);
+  motorInitListLock = epicsMutexMustCreate();
+  initHookRegister(motorInitHook);
+}
+
+/* Shared poller pool, see asynMotorPollerConfig() and asynMotorSharedPoller().
+ * Each controller in the pool has one motorPollNode.  A node is either in the queue, which is ordered by
+ * deadline, or being polled by exactly one worker, or idle waiting for wakeupPoller(), so a
+ * controller that blocks in poll() only ever holds one worker. */
+#define MOTOR_POLL_INIT_RETRY 0.1  /* Time between checks whether a controller has been initialized */
+
+typedef struct motorPollNode {
+  ELLNODE node;                    /* Must be first, used for the queue */
+  struct motorPollNode *pNext;     /* List of all controllers in the pool */
+  asynMotorController *pController;
+  epicsTimeStamp deadline;         /* Time at which the next poll is due */
+  epicsTimeStamp pollStart;        /* Time at which the current poll was started */
+  int queued;                      /* The node is in motorPollQueue */
+  int running;                     /* A worker is polling the controller */
+  int wakeup;                      /* wakeupPoller() was called since the last poll started */
+  unsigned long numPolls;          /* Number of polls */
+  double latencySum;               /* Total time from the deadlines to the starts of the polls */
+  double latencyMax;               /* Longest time from a deadline to the start of the poll */
+  double pollTimeSum;              /* Total time spent in the polls */
+  double pollTimeMax;              /* Longest poll */
+} motorPollNode;
+
+static ELLLIST motorPollQueue;
+static motorPollNode *motorPollFirst;
+static epicsMutexId motorPollLock;
+static epicsEventId motorPollEvent;
+static epicsThreadOnceId motorPollOnceId = EPICS_THREAD_ONCE_INIT;
+static int motorPollNumThreads = 0;        /* Number of workers, 0 for one thread per controller */
+static int motorPollBusy = 0;              /* Number of workers that are polling a controller */
+
+/* Ports that asynMotorSharedPoller() has selected for the pool.  The list is only changed from the
+ * startup script, before the controllers are created. */
+typedef struct motorPollPort {
+  ELLNODE node;
+  char *portName;
+  int joined;                      /* The controller has started polling in the pool */
+} motorPollPort;
+
+static ELLLIST motorPollPorts;
+
+static motorPollPort *motorPollFindPort(const char *portName)
+{
+  motorPollPort *pPort = (motorPollPort *)ellFirst(&motorPollPorts);
+
+  while (pPort && strcmp(pPort->portName, portName)) pPort = (motorPollPort *)ellNext((ELLNODE *)pPort);
+  return pPort;
+}
+
+static void motorPollOnce(void *arg)
+{
+  int i;
+  char name[32];
+
+  ellInit(&motorPollQueue);
+  motorPollLock = epicsMutexMustCreate();
+  motorPollEvent = epicsEventMustCreate(epicsEventEmpty);
+  for (i=0; i<motorPollNumThreads; i++) {
+    epicsSnprintf(name, sizeof(name), "motorPoller%d", i);
+    epicsThreadCreate(name,
+                      epicsThreadPriorityLow,
+                      epicsThreadGetStackSize(epicsThreadStackMedium),
+                      (EPICSTHREADFUNC)asynMotorPollWorkerC, NULL);
+  }
+}
+
+/* Inserts a node into the queue in deadline order.  Must be called with motorPollLock held. */
+static void motorPollEnqueue(motorPollNode *pNode)
+{
+  motorPollNode *pNext = (motorPollNode *)ellFirst(&motorPollQueue);
 
+  while (pNext && (epicsTimeDiffInSeconds(&pNext->deadline, &pNode->deadline) <= 0.))
+    pNext = (motorPollNode *)ellNext((ELLNODE *)pNext);
+  if (pNext) ellInsert(&motorPollQueue, ellPrevious((ELLNODE *)pNext), (ELLNODE *)pNode);
+  else       ellAdd(&motorPollQueue, (ELLNODE *)pNode);
+  pNode->queued = 1;
+}
+
+static void asynMotorPollWorkerC(void *drvPvt)
+{
+  motorPollNode *pNode;
+  asynMotorController *pC;
+  epicsTimeStamp now;
+  double delay, latency, elapsed, period;
+  bool wokenUp;
+
+  while (1) {
+    epicsMutexLock(motorPollLock);
+    pNode = (motorPollNode *)ellFirst(&motorPollQueue);
+    if (!pNode) {
+      epicsMutexUnlock(motorPollLock);
+      epicsEventWait(motorPollEvent);
+      continue;
+    }
+    epicsTimeGetCurrent(&now);
+    delay = epicsTimeDiffInSeconds(&pNode->deadline, &now);
+    if (delay > 0.) {
+      epicsMutexUnlock(motorPollLock);
+      epicsEventWaitWithTimeout(motorPollEvent, delay);
+      continue;
+    }
+    ellDelete(&motorPollQueue, (ELLNODE *)pNode);
+    pNode->queued = 0;
+    pC = pNode->pController;
+    pNode->running = 1;
+    pNode->pollStart = now;
+    wokenUp = (pNode->wakeup != 0);
+    pNode->wakeup = 0;
+    latency = -delay;
+    motorPollBusy++;
+    /* Let another worker look at the next node */
+    if (ellCount(&motorPollQueue) > 0) epicsEventSignal(motorPollEvent);
+    epicsMutexUnlock(motorPollLock);
+
+    period = pC->pollOnce(wokenUp);
+
+    epicsTimeGetCurrent(&now);
+    elapsed = epicsTimeDiffInSeconds(&now, &pNode->pollStart);
+    epicsMutexLock(motorPollLock);
+    motorPollBusy--;
+    pNode->running = 0;
+    pNode->numPolls++;
+    pNode->latencySum += latency;
+    if (latency > pNode->latencyMax) pNode->latencyMax = latency;
+    pNode->pollTimeSum += elapsed;
+    if (elapsed > pNode->pollTimeMax) pNode->pollTimeMax = elapsed;
+    if (period >= 0.) {
+      if (pNode->wakeup) {
+        pNode->deadline = now;
+      } else if (period > 0.) {
+        /* Keep the polls periodic unless this poll took longer than the period */
+        pNode->deadline = pNode->pollStart;
+        epicsTimeAddSeconds(&pNode->deadline, period);
+        if (epicsTimeDiffInSeconds(&pNode->deadline, &now) < 0.) pNode->deadline = now;
+      }
+      /* A period of 0 means poll only when woken up, as for the poller thread */
+      if (pNode->wakeup || (period > 0.)) motorPollEnqueue(pNode);
+    }
+    epicsMutexUnlock(motorPollLock);
+    epicsEventSignal(motorPollEvent);
+  }
+}
 
 
 /** Creates a new asynMotorController object.
@@ -43,6 +218,8 @@ asynMotorController::asynMotorController(const char *portName, int numAxes, int
 {
   static const char *functionName = "asynMotorController";
 
+  epicsTimeGetCurrent(&createTime_);
+
   /* Create the base set of motor parameters */
   createParam(motorMoveRelString,                asynParamFloat64,    &motorMoveRel_);
   createParam(motorMoveAbsString,                asynParamFloat64,    &motorMoveAbs_);
@@ -87,6 +264,9 @@ asynMotorController::asynMotorController(const char *portName, int numAxes, int
   createParam(motorStatusLowLimitString,         asynParamInt32,      &motorStatusLowLimit_);
   createParam(motorStatusHomedString,            asynParamInt32,      &motorStatusHomed_);
 
+  // This is a per-controller parameter to stop all axes
+  createParam(motorStopAllString,                asynParamInt32,      &motorStopAll_);
+
   // These are per-axis parameters for passing additional motor record information to the driver
   createParam(motorRecResolutionString,        asynParamFloat64,      &motorRecResolution_);
   createParam(motorRecDirectionString,           asynParamInt32,      &motorRecDirection_);
@@ -120,22 +300,86 @@ asynMotorController::asynMotorController(const char *portName, int numAxes, int
   createParam(profileReadbackStatusString,       asynParamInt32,      &profileReadbackStatus_);
   createParam(profileReadbackMessageString,      asynParamOctet,      &profileReadbackMessage_);
 
+  // These are the per-controller parameters for streaming profile moves
+  createParam(profileStreamString,               asynParamInt32,      &profileStream_);
+  createParam(profileStreamSizeString,           asynParamInt32,      &profileStreamSize_);
+  createParam(profileAppendString,               asynParamInt32,      &profileAppend_);
+  createParam(profileStreamEndString,            asynParamInt32,      &profileStreamEnd_);
+  createParam(profileStreamLowWaterString,       asynParamInt32,      &profileStreamLowWater_);
+  createParam(profileStreamHighWaterString,      asynParamInt32,      &profileStreamHighWater_);
+  createParam(profileStreamRefillString,         asynParamInt32,      &profileStreamRefill_);
+  createParam(profileStreamFreeString,           asynParamInt32,      &profileStreamFree_);
+  createParam(profileStreamAppendedString,       asynParamInt32,      &profileStreamAppended_);
+  createParam(profileStreamSentString,           asynParamInt32,      &profileStreamSent_);
+  createParam(profileStreamUnderrunsString,      asynParamInt32,      &profileStreamUnderruns_);
+  createParam(profileStreamUnreadString,         asynParamInt32,      &profileStreamUnread_);
+  createParam(profileStreamReadbackFirstString,  asynParamInt32,      &profileStreamReadbackFirst_);
+  createParam(profileStreamOverrunsString,       asynParamInt32,      &profileStreamOverruns_);
+
   // These are the per-axis parameters for profile moves
   createParam(profileUseAxisString,              asynParamInt32,      &profileUseAxis_);
   createParam(profilePositionsString,     asynParamFloat64Array,      &profilePositions_);
   createParam(profileReadbacksString,     asynParamFloat64Array,      &profileReadbacks_);
   createParam(profileFollowingErrorsString, asynParamFloat64Array,    &profileFollowingErrors_);
 
+  // These are the per-axis parameters for the position history buffer
+  createParam(motorHistoryNumSamplesString,      asynParamInt32,      &motorHistoryNumSamples_);
+  createParam(motorHistoryOverrunsString,        asynParamInt32,      &motorHistoryOverruns_);
+  createParam(motorHistoryReadString,            asynParamInt32,      &motorHistoryRead_);
+  createParam(motorHistoryNumReadString,         asynParamInt32,      &motorHistoryNumRead_);
+  createParam(motorHistoryTimesString,      asynParamFloat64Array,    &motorHistoryTimes_);
+  createParam(motorHistoryPositionsString,  asynParamFloat64Array,    &motorHistoryPositions_);
+  createParam(motorHistoryEncodersString,   asynParamFloat64Array,    &motorHistoryEncoders_);
+  createParam(motorHistoryVelocitiesString, asynParamFloat64Array,    &motorHistoryVelocities_);
+  createParam(motorHistoryStatusString,     asynParamFloat64Array,    &motorHistoryStatus_);
+
   pAxes_ = (asynMotorAxis**) calloc(numAxes, sizeof(asynMotorAxis*));
   pollEventId_ = epicsEventMustCreate(epicsEventEmpty);
+  forcedFastPollsLeft_ = 0;
+  pollNode_ = NULL;
   moveToHomeId_ = epicsEventMustCreate(epicsEventEmpty);
 
   maxProfilePoints_ = 0;
   profileTimes_ = NULL;
   setIntegerParam(profileExecuteState_, PROFILE_EXECUTE_DONE);
 
+  streamSize_ = 0;
+  streamTimes_ = NULL;
+  streamBuilt_ = false;
+  streamExecuting_ = false;
+  streamEnd_ = false;
+  streamRefill_ = false;
+  streamAppended_ = 0;
+  streamSent_ = 0;
+  streamDone_ = 0;
+  streamReadbackRead_ = 0;
+  streamUnderruns_ = 0;
+  streamOverruns_ = 0;
+
   moveToHomeAxis_ = 0;
 
+  deferringMoves_ = false;
+  deferredMoves_ = (MotorDeferredMove *) calloc(numAxes, sizeof(MotorDeferredMove));
+  numDeferredMoves_ = 0;
+
+  initEventId_ = epicsEventMustCreate(epicsEventEmpty);
+  initLock_ = epicsMutexMustCreate();
+  initState_ = MOTOR_INIT_NONE;
+  initStatus_ = asynSuccess;
+  constructTime_ = 0.;
+  initLockTime_ = 0.;
+  initTime_ = 0.;
+  initAxisTime_ = 0.;
+  initAxisMaxTime_ = 0.;
+  initAxisMaxAxis_ = -1;
+
+  burstPipelining_ = false;
+  commandStatsMutex_ = epicsMutexMustCreate();
+  numBursts_ = 0;
+  numBurstCommands_ = 0;
+  burstTotalTime_ = 0.;
+  burstMaxTime_ = 0.;
+
   asynPrint(this->pasynUserSelf, ASYN_TRACE_FLOW,
     "%s:%s: constructor complete\n",
     driverName, functionName);
@@ -160,6 +404,10 @@ void asynMotorController::report(FILE *fp, int level)
     if (!pAxis) continue; 
     pAxis->report(fp, level);
   }
+  if (getInitState() != MOTOR_INIT_NONE) initReport(fp);
+  if ((level > 0) && (commandStats_.numCommands() > 0)) commandReport(fp);
+  if ((level > 0) && (streamSize_ > 0)) streamReport(fp);
+  if (level > 0) pollerReport(fp);
 
   // Call the base class method
   asynPortDriver::report(fp, level);
@@ -183,6 +431,7 @@ asynStatus asynMotorController::writeInt32(asynUser *pasynUser, epicsInt32 value
   asynStatus status=asynSuccess;
   asynMotorAxis *pAxis;
   int axis;
+  int stream = 0;
   static const char *functionName = "writeInt32";
 
   pAxis = getAxis(pasynUser);
@@ -194,9 +443,14 @@ asynStatus asynMotorController::writeInt32(asynUser *pasynUser, epicsInt32 value
 
   if (function == motorStop_) {
     double accel;
+    cancelDeferredMove(pAxis);
     getDoubleParam(axis, motorAccel_, &accel);
     status = pAxis->stop(accel);
   
+  } else if (function == motorStopAll_) {
+    status = stopAllAxes();
+    wakeupPoller();
+
   } else if (function == motorDeferMoves_) {
     status = setDeferredMoves(value);
   
@@ -211,16 +465,30 @@ asynStatus asynMotorController::writeInt32(asynUser *pasynUser, epicsInt32 value
     pAxis->statusChanged_ = 1;
 
   } else if (function == profileBuild_) {
-    status = buildProfile();
+    getIntegerParam(profileStream_, &stream);
+    status = stream ? streamBuild() : buildProfile();
 
   } else if (function == profileExecute_) {
-    status = executeProfile();
+    getIntegerParam(profileStream_, &stream);
+    status = stream ? streamExecute() : executeProfile();
 
   } else if (function == profileAbort_) {
-    status = abortProfile();
+    getIntegerParam(profileStream_, &stream);
+    status = stream ? streamAbort() : abortProfile();
 
   } else if (function == profileReadback_) {
-    status = readbackProfile();
+    getIntegerParam(profileStream_, &stream);
+    status = stream ? streamReadback() : readbackProfile();
+
+  } else if (function == profileAppend_) {
+    status = streamAppend();
+
+  } else if (function == profileStreamEnd_) {
+    if (value && streamBuilt_) streamEnd_ = true;
+    pollStreamProfile();
+
+  } else if (function == motorHistoryRead_) {
+    status = pAxis->readHistoryChunk(value < 0 ? 0 : value);
 
   } else if (function == motorMoveToHome_) {
     if (value == 1) {
@@ -285,7 +553,11 @@ asynStatus asynMotorController::writeFloat64(asynUser *pasynUser, epicsFloat64 v
     getDoubleParam(axis, motorVelBase_, &baseVelocity);
     getDoubleParam(axis, motorVelocity_, &velocity);
     getDoubleParam(axis, motorAccel_, &acceleration);
-    status = pAxis->move(value, 1, baseVelocity, velocity, acceleration);
+    if (deferringMoves_) {
+      status = deferMove(pAxis, value, 1, baseVelocity, velocity, acceleration);
+    } else {
+      status = pAxis->move(value, 1, baseVelocity, velocity, acceleration);
+    }
     pAxis->setIntegerParam(motorStatusDone_, 0);
     pAxis->callParamCallbacks();
     wakeupPoller();
@@ -301,7 +573,11 @@ asynStatus asynMotorController::writeFloat64(asynUser *pasynUser, epicsFloat64 v
     getDoubleParam(axis, motorVelBase_, &baseVelocity);
     getDoubleParam(axis, motorVelocity_, &velocity);
     getDoubleParam(axis, motorAccel_, &acceleration);
-    status = pAxis->move(value, 0, baseVelocity, velocity, acceleration);
+    if (deferringMoves_) {
+      status = deferMove(pAxis, value, 0, baseVelocity, velocity, acceleration);
+    } else {
+      status = pAxis->move(value, 0, baseVelocity, velocity, acceleration);
+    }
     pAxis->setIntegerParam(motorStatusDone_, 0);
     pAxis->callParamCallbacks();
     wakeupPoller();
@@ -446,7 +722,8 @@ asynStatus asynMotorController::writeFloat64Array(asynUser *pasynUser, epicsFloa
 }
 
 /** Called when asyn clients call pasynFloat64Array->read().
-  * Returns the readbacks or following error arrays from profile moves.
+  * Returns the readbacks or following error arrays from profile moves,
+  * or the arrays from the last chunk read from the position history buffer.
   * \param[in] pasynUser pasynUser structure that encodes the reason and address.
   * \param[in] value Pointer to the array to read.
   * \param[in] nElements Maximum number of elements to read. 
@@ -462,6 +739,15 @@ asynStatus asynMotorController::readFloat64Array(asynUser *pasynUser, epicsFloat
   pAxis = getAxis(pasynUser);
   if (!pAxis) return asynError;
   
+  if ((function >= motorHistoryTimes_) && (function <= motorHistoryStatus_)) {
+    if (!pAxis->historyArrays_) return asynError;
+    *nRead = pAxis->historyNumRead_;
+    if (*nRead > nElements) *nRead = nElements;
+    memcpy(value, pAxis->historyArrays_ + (function - motorHistoryTimes_)*pAxis->historySize_, 
+           *nRead*sizeof(double));
+    return asynSuccess;
+  }
+
   getIntegerParam(profileNumReadbacks_, &numReadbacks);
   *nRead = numReadbacks;
   if (*nRead > nElements) *nRead = nElements;
@@ -509,6 +795,47 @@ asynStatus asynMotorController::readGenericPointer(asynUser *pasynUser, void *po
   return asynSuccess;
 }  
 
+/** Sets the value for a double for address 0 in the parameter library.
+  * \param[in] function The function (parameter) number
+  * \param[in] value Value to set */
+asynStatus asynMotorController::setDoubleParam(int function, double value)
+{
+  return setDoubleParam(0, function, value);
+}
+
+/** Sets the value for a double in the parameter library.
+  * This function takes special action if the parameter is motorPosition_ or motorEncoderPosition_.
+  * In that case it sets the value in the MotorStatus structure of the axis, so that devMotorAsyn gets
+  * a callback if the value has changed, and marks a sample for the position history buffer of the axis.
+  * asynMotorAxis::setDoubleParam() calls this function, so the positions are handled the same whether
+  * a driver sets them through the axis or through the controller.
+  * \param[in] list The parameter list number, which is the axis number
+  * \param[in] function The function (parameter) number
+  * \param[in] value Value to set */
+asynStatus asynMotorController::setDoubleParam(int list, int function, double value)
+{
+  asynMotorAxis *pAxis;
+
+  if ((function == motorPosition_) || (function == motorEncoderPosition_)) {
+    pAxis = getAxis(list);
+    if (pAxis) {
+      if (function == motorPosition_) {
+        if (value != pAxis->status_.position) {
+          pAxis->statusChanged_ = 1;
+          pAxis->status_.position = value;
+        }
+      } else {
+        if (value != pAxis->status_.encoderPosition) {
+          pAxis->statusChanged_ = 1;
+          pAxis->status_.encoderPosition = value;
+        }
+      }
+      pAxis->historyPending_ = 1;
+    }
+  }
+  return asynPortDriver::setDoubleParam(list, function, value);
+}
+
 /** Returns a pointer to an asynMotorAxis object.
   * Returns NULL if the axis number encoded in pasynUser is invalid.
   * Derived classes will reimplement this function to return a pointer to the derived
@@ -523,12 +850,138 @@ asynMotorAxis* asynMotorController::getAxis(asynUser *pasynUser)
 }
 
 /** Processes deferred moves.
+  * This base class implementation collects the absolute and relative moves that are requested while
+  * moves are deferred.  When moves are no longer deferred it starts all of the collected moves by calling
+  * startDeferredMoves() once, and then wakes up the poller.
+  * Derived classes with their own deferred move handling can reimplement this function.
   * \param[in] deferMoves defer moves till later (true) or process moves now (false) */
 asynStatus asynMotorController::setDeferredMoves(bool deferMoves)
 {
+  asynStatus status = asynSuccess;
+  int i;
+  asynMotorAxis *pAxis;
+  static const char *functionName = "setDeferredMoves";
+
+  if (deferMoves) {
+    deferringMoves_ = true;
+    return asynSuccess;
+  }
+  if (!deferringMoves_) return asynSuccess;
+  deferringMoves_ = false;
+  if (numDeferredMoves_ == 0) return asynSuccess;
+
+  asynPrint(pasynUserSelf, ASYN_TRACE_FLOW,
+    "%s:%s: port %s starting %d deferred moves\n",
+    driverName, functionName, portName, numDeferredMoves_);
+  status = startDeferredMoves(deferredMoves_, numDeferredMoves_);
+  for (i=0; i<numDeferredMoves_; i++) {
+    pAxis = deferredMoves_[i].pAxis;
+    pAxis->deferredMovePending_ = 0;
+    pAxis->setIntegerParam(motorStatusDone_, 0);
+    pAxis->callParamCallbacks();
+  }
+  numDeferredMoves_ = 0;
+  wakeupPoller();
+  return status;
+}
+
+/** Starts a set of moves that were collected while moves were deferred.
+  * Derived classes that can start several axes with a single command should reimplement this function.
+  * This base class implementation calls asynMotorAxis::move() for each axis back-to-back.  It is called 
+  * with the controller locked, so no other command to the controller can come between the moves.
+  * \param[in] moves Array of the moves to start.
+  * \param[in] numMoves The number of moves in the array. */
+asynStatus asynMotorController::startDeferredMoves(MotorDeferredMove *moves, int numMoves)
+{
+  int i;
+  int status = 0;
+
+  for (i=0; i<numMoves; i++) {
+    status |= moves[i].pAxis->move(moves[i].position, moves[i].relative, 
+                                   moves[i].minVelocity, moves[i].maxVelocity, moves[i].acceleration);
+  }
+  return status ? asynError : asynSuccess;
+}
+
+/** Adds a move to the list of deferred moves.
+  * If the axis already has a deferred move then it is replaced, or for a relative move it is added to.
+  * The axis reports that it is not done until the move is started or cancelled.
+  * \param[in] pAxis The axis to move.
+  * See asynMotorAxis::move() for the other arguments. */
+asynStatus asynMotorController::deferMove(asynMotorAxis *pAxis, double position, int relative,
+                                          double minVelocity, double maxVelocity, double acceleration)
+{
+  int i;
+  MotorDeferredMove *pMove = NULL;
+  static const char *functionName = "deferMove";
+
+  for (i=0; i<numDeferredMoves_; i++) {
+    if (deferredMoves_[i].pAxis == pAxis) {
+      pMove = &deferredMoves_[i];
+      break;
+    }
+  }
+  if (pMove) {
+    if (relative) position += pMove->position;
+    relative = relative && pMove->relative;
+  } else {
+    if (!deferredMoves_ || (numDeferredMoves_ >= maxAddr)) {
+      asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+        "%s:%s: port %s too many deferred moves\n",
+        driverName, functionName, portName);
+      return asynError;
+    }
+    pMove = &deferredMoves_[numDeferredMoves_++];
+    pMove->pAxis = pAxis;
+  }
+  pMove->position     = position;
+  pMove->relative     = relative;
+  pMove->minVelocity  = minVelocity;
+  pMove->maxVelocity  = maxVelocity;
+  pMove->acceleration = acceleration;
+  pAxis->deferredMovePending_ = 1;
   return asynSuccess;
 }
 
+/** Removes any deferred move for an axis, for example when the axis is told to stop.
+  * \param[in] pAxis The axis. */
+void asynMotorController::cancelDeferredMove(asynMotorAxis *pAxis)
+{
+  int i;
+
+  if (!pAxis->deferredMovePending_) return;
+  for (i=0; i<numDeferredMoves_; i++) {
+    if (deferredMoves_[i].pAxis == pAxis) {
+      deferredMoves_[i] = deferredMoves_[--numDeferredMoves_];
+      break;
+    }
+  }
+  pAxis->deferredMovePending_ = 0;
+}
+
+/** Stops all axes on the controller.
+  * Called when MOTOR_STOP_ALL is written.  Any deferred moves are discarded.
+  * Derived classes that can stop all axes with a single command should reimplement this function,
+  * and can call this base class method to fall back to stopping the axes one at a time.
+  * This base class implementation calls asynMotorAxis::stop() for each axis back-to-back,
+  * with the acceleration of each axis. */
+asynStatus asynMotorController::stopAllAxes()
+{
+  int axis;
+  int status = 0;
+  double accel;
+  asynMotorAxis *pAxis;
+
+  for (axis=0; axis<numAxes_; axis++) {
+    pAxis = getAxis(axis);
+    if (!pAxis) continue;
+    cancelDeferredMove(pAxis);
+    getDoubleParam(axis, motorAccel_, &accel);
+    status |= pAxis->stop(accel);
+  }
+  return status ? asynError : asynSuccess;
+}
+
 /** Returns a pointer to an asynMotorAxis object.
   * Returns NULL if the axis number is invalid.
   * Derived classes will reimplement this function to return a pointer to the derived
@@ -548,12 +1001,36 @@ asynMotorAxis* asynMotorController::getAxis(int axisNo)
   * \param[in] idlePollPeriod The time between polls when no axis is moving.
   * \param[in] forcedFastPolls The number of times to force the movingPollPeriod after waking up the poller.  
   * This can need to be non-zero for controllers that do not immediately
-  * report that an axis is moving after it has been told to start. */
+  * report that an axis is moving after it has been told to start.
+  * If asynMotorPollerConfig() has been called with a non-zero number of threads and the port was selected
+  * with asynMotorSharedPoller() before the controller was created then the controller is polled by the
+  * shared pool of poller threads rather than by a thread of its own.
+  * Controllers that reimplement startPoller() keep their own poller thread. */
 asynStatus asynMotorController::startPoller(double movingPollPeriod, double idlePollPeriod, int forcedFastPolls)
 {
+  motorPollNode *pNode;
+  motorPollPort *pPort;
+
   movingPollPeriod_ = movingPollPeriod;
   idlePollPeriod_   = idlePollPeriod;
   forcedFastPolls_  = forcedFastPolls;
+  pPort = motorPollFindPort(portName);
+  if ((motorPollNumThreads > 0) && pPort) {
+    pPort->joined = 1;
+    epicsThreadOnce(&motorPollOnceId, motorPollOnce, NULL);
+    pNode = (motorPollNode *) calloc(1, sizeof(motorPollNode));
+    pNode->pController = this;
+    epicsTimeGetCurrent(&pNode->deadline);
+    pNode->wakeup = 1;  /* Force on poll at startup */
+    epicsMutexLock(motorPollLock);
+    pNode->pNext = motorPollFirst;
+    motorPollFirst = pNode;
+    pollNode_ = pNode;
+    motorPollEnqueue(pNode);
+    epicsMutexUnlock(motorPollLock);
+    epicsEventSignal(motorPollEvent);
+    return asynSuccess;
+  }
   epicsThreadCreate("motorPoller", 
                     epicsThreadPriorityLow,
                     epicsThreadGetStackSize(epicsThreadStackMedium),
@@ -564,10 +1041,27 @@ asynStatus asynMotorController::startPoller(double movingPollPeriod, double idle
 
 /** Wakes up the poller thread to make it start polling at the movingPollingPeriod_.
   * This is typically called after an axis has been told to move, so the poller immediately
-  * starts polling quickly. */
+  * starts polling quickly.  Drivers must call this rather than signal pollEventId_, which nothing
+  * waits for when the controller is polled by the shared pool. */
 asynStatus asynMotorController::wakeupPoller()
 {
-  epicsEventSignal(pollEventId_);
+  motorPollNode *pNode = pollNode_;
+
+  if (!pNode) {
+    epicsEventSignal(pollEventId_);
+    return asynSuccess;
+  }
+  /* Shared pool: move the deadline to now.  If a worker is polling the controller right now
+   * it requeues the controller with an immediate deadline when it is done. */
+  epicsMutexLock(motorPollLock);
+  pNode->wakeup = 1;
+  if (!pNode->running) {
+    if (pNode->queued) ellDelete(&motorPollQueue, (ELLNODE *)pNode);
+    epicsTimeGetCurrent(&pNode->deadline);
+    motorPollEnqueue(pNode);
+  }
+  epicsMutexUnlock(motorPollLock);
+  epicsEventSignal(motorPollEvent);
   return asynSuccess;
 }
 
@@ -595,13 +1089,37 @@ static void asynMotorPollerC(void *drvPvt)
   * It polls at the idlePollPeriod_ when no axes are moving, and at the movingPollPeriod_ when
   * any axis is moving.  It will immediately do a poll when asynMotorController::wakeupPoller() is
   * called, and will then do forcedFastPolls_ loops at the movingPollPeriod, before reverting back
-  * to the idlePollPeriod_ if no axes are moving. It takes the lock on the port driver when it is polling.
+  * to the idlePollPeriod_ if no axes are moving. The polling itself is done by pollOnce().
   */
 void asynMotorController::asynMotorPoller()
+{
+  double timeout;
+  int status;
+
+  timeout = idlePollPeriod_;
+  wakeupPoller();  /* Force on poll at startup */
+
+  while(1) {
+    if (timeout != 0.) status = epicsEventWaitWithTimeout(pollEventId_, timeout);
+    else               status = epicsEventWait(pollEventId_);
+    /* Don't poll the hardware before it has been initialized */
+    if (getInitState() == MOTOR_INIT_PENDING) waitInit(0.);
+    timeout = pollOnce(status == epicsEventWaitOK);
+    if (timeout < 0.) break;
+  }
+}
+
+/** Polls the controller and all axes once.
+  * This is called by the poller thread of the controller, or by a thread of the shared poller pool.
+  * It takes the lock on the port driver, calls poll() and then asynMotorAxis::poll() for each axis,
+  * and handles the automatic power off of the axes.
+  * \param[in] wokenUp The poll was requested by wakeupPoller() rather than by the poll period.
+  * \return The time until the next poll, 0 to poll only after the next wakeupPoller(),
+  * or -1 if the IOC is shutting down. */
+double asynMotorController::pollOnce(bool wokenUp)
 {
   double timeout;
   int i;
-  int forcedFastPolls=0;
   bool anyMoving;
   bool moving;
   epicsTimeStamp nowTime;
@@ -609,75 +1127,302 @@ void asynMotorController::asynMotorPoller()
   asynMotorAxis *pAxis;
   int autoPower = 0;
   double autoPowerOffDelay = 0.0;
-  int status;
 
-  timeout = idlePollPeriod_;
-  wakeupPoller();  /* Force on poll at startup */
+  if (wokenUp) {
+    /* We got an event, rather than a timeout.  This is because other software
+     * knows that an axis should have changed state (started moving, etc.).
+     * Force a minimum number of fast polls, because the controller status
+     * might not have changed the first few polls
+     */
+    forcedFastPollsLeft_ = forcedFastPolls_;
+  }
+  /* The shared pool does not block a thread waiting for the initialization, it tries again later */
+  if (getInitState() == MOTOR_INIT_PENDING) return MOTOR_POLL_INIT_RETRY;
 
-  while(1) {
-    if (timeout != 0.) status = epicsEventWaitWithTimeout(pollEventId_, timeout);
-    else               status = epicsEventWait(pollEventId_);
-    if (status == epicsEventWaitOK) {
-      /* We got an event, rather than a timeout.  This is because other software
-       * knows that an axis should have changed state (started moving, etc.).
-       * Force a minimum number of fast polls, because the controller status
-       * might not have changed the first few polls
-       */
-      forcedFastPolls = forcedFastPolls_;
-    }
-    anyMoving = false;
-    lock();
-    if (shuttingDown_) {
-      unlock();
-      break;
-    }
+  anyMoving = false;
+  lock();
+  if (shuttingDown_) {
+    unlock();
+    return -1.;
+  }
 
-    poll();
-    for (i=0; i<numAxes_; i++) {
-      pAxis=getAxis(i);
-      if (!pAxis) continue;
-      
-      getIntegerParam(i, motorPowerAutoOnOff_, &autoPower);
-      getDoubleParam(i, motorPowerOffDelay_, &autoPowerOffDelay);
-      
-      pAxis->poll(&moving);
-      if (moving) {
-	anyMoving = true;
-	pAxis->setWasMovingFlag(1);
-      } else {
-	if ((pAxis->getWasMovingFlag() == 1) && (autoPower == 1)) {
-	  pAxis->setDisableFlag(1);
-          pAxis->setWasMovingFlag(0);
-          epicsTimeGetCurrent(&nowTime);
-          pAxis->setLastEndOfMoveTime(nowTime.secPastEpoch + (nowTime.nsec / 1.e9));
-	}
+  poll();
+  for (i=0; i<numAxes_; i++) {
+    pAxis=getAxis(i);
+    if (!pAxis) continue;
+    
+    getIntegerParam(i, motorPowerAutoOnOff_, &autoPower);
+    getDoubleParam(i, motorPowerOffDelay_, &autoPowerOffDelay);
+    
+    pAxis->poll(&moving);
+    /* Drivers that set the positions and do the callbacks through the controller never call
+     * asynMotorAxis::callParamCallbacks(), take the history sample for them here */
+    if (pAxis->historyPending_) {
+      pAxis->historyPending_ = 0;
+      pAxis->addHistorySample();
+    }
+    if (moving) {
+      anyMoving = true;
+      pAxis->setWasMovingFlag(1);
+    } else {
+      if ((pAxis->getWasMovingFlag() == 1) && (autoPower == 1)) {
+        pAxis->setDisableFlag(1);
+        pAxis->setWasMovingFlag(0);
+        epicsTimeGetCurrent(&nowTime);
+        pAxis->setLastEndOfMoveTime(nowTime.secPastEpoch + (nowTime.nsec / 1.e9));
       }
+    }
 
-      //Auto power off drive, if:
-      //  We have detected an end of move
-      //  We are not moving again
-      //  Auto power off is enabled
-      //  Auto power off delay timer has expired
-      if ((!moving) && (autoPower == 1) && (pAxis->getDisableFlag() == 1)) {
-	epicsTimeGetCurrent(&nowTime);
-	nowTimeSecs = nowTime.secPastEpoch + (nowTime.nsec / 1.e9);
-	if ((nowTimeSecs - pAxis->getLastEndOfMoveTime()) >= autoPowerOffDelay) {
-	  pAxis->setClosedLoop(0);
-	  pAxis->setDisableFlag(0);
-	}
+    //Auto power off drive, if:
+    //  We have detected an end of move
+    //  We are not moving again
+    //  Auto power off is enabled
+    //  Auto power off delay timer has expired
+    if ((!moving) && (autoPower == 1) && (pAxis->getDisableFlag() == 1)) {
+      epicsTimeGetCurrent(&nowTime);
+      nowTimeSecs = nowTime.secPastEpoch + (nowTime.nsec / 1.e9);
+      if ((nowTimeSecs - pAxis->getLastEndOfMoveTime()) >= autoPowerOffDelay) {
+        pAxis->setClosedLoop(0);
+        pAxis->setDisableFlag(0);
       }
+    }
+
+  }
+  if (streamSize_ > 0) pollStreamProfile();
+  if (forcedFastPollsLeft_ > 0) {
+    timeout = movingPollPeriod_;
+    forcedFastPollsLeft_--;
+  } else if (anyMoving || streamExecuting_) {
+    timeout = movingPollPeriod_;
+  } else {
+    timeout = idlePollPeriod_;
+  }
+  unlock();
+  return timeout;
+}
+
+/** Prints the latency and duration of the polls by the shared poller pool.
+  * \param[in] fp FILE pointer. */
+void asynMotorController::pollerReport(FILE *fp)
+{
+  motorPollNode *pNode = pollNode_;
+  epicsTimeStamp now;
+
+  if (!pNode) return;
+  epicsTimeGetCurrent(&now);
+  epicsMutexLock(motorPollLock);
+  fprintf(fp, "%s: shared poller, polls=%lu, latency mean=%.3f ms max=%.3f ms, poll time mean=%.3f ms max=%.3f ms",
+          portName, pNode->numPolls,
+          pNode->numPolls ? 1000.*pNode->latencySum/pNode->numPolls : 0.,
+          1000.*pNode->latencyMax,
+          pNode->numPolls ? 1000.*pNode->pollTimeSum/pNode->numPolls : 0.,
+          1000.*pNode->pollTimeMax);
+  if (pNode->running)
+    fprintf(fp, ", polling for %.3f s", epicsTimeDiffInSeconds(&now, &pNode->pollStart));
+  else if (pNode->queued)
+    fprintf(fp, ", next poll in %.3f s", epicsTimeDiffInSeconds(&pNode->deadline, &now));
+  fprintf(fp, "\n");
+  epicsMutexUnlock(motorPollLock);
+}
+
+/** Initializes the controller.
+  * Derived classes should move the slow part of their start-up, i.e. the queries of the hardware that are
+  * now done in their constructor, into this method and then call startInit().  
+  * It is called from the thread created by startInit(), with the port lock held, before initAxis() is called
+  * for each axis.  The port lock is released between init() and each call to initAxis().
+  * This base class implementation does nothing. */
+asynStatus asynMotorController::init()
+{
+  return asynSuccess;
+}
+
+/** Initializes one axis of the controller.
+  * This is called from the thread created by startInit() for each axis that exists, after init() has
+  * been called, with the port lock held.
+  * This base class implementation does nothing.
+  * \param[in] axisNo Axis index number. */
+asynStatus asynMotorController::initAxis(int axisNo)
+{
+  return asynSuccess;
+}
+
+/** Starts the initialization of the controller.
+  * This runs init() and then initAxis() for each axis in a separate thread, so that the initialization of
+  * several controllers can proceed in parallel while the startup script continues.  
+  * If parallel initialization has been disabled with asynMotorInitConfig() then they are called before
+  * this method returns.  
+  * The poller does not poll the controller until the initialization is complete, and iocInit
+  * waits for all controllers to complete their initialization before any records are initialized.  
+  * This must be called after the object is fully constructed, i.e. at the end of the constructor of the
+  * most derived class or from the configuration command, because it calls virtual methods. */
+asynStatus asynMotorController::startInit()
+{
+  motorInitNode *pNode;
+  epicsTimeStamp now;
+  static const char *functionName = "startInit";
+
+  epicsMutexLock(initLock_);
+  if (initState_ != MOTOR_INIT_NONE) {
+    epicsMutexUnlock(initLock_);
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+      "%s:%s: port %s initialization already started\n",
+      driverName, functionName, portName);
+    return asynError;
+  }
+  epicsTimeGetCurrent(&now);
+  constructTime_ = epicsTimeDiffInSeconds(&now, &createTime_);
+  initState_ = MOTOR_INIT_PENDING;
+  epicsMutexUnlock(initLock_);
+  epicsThreadOnce(&motorInitOnceId, motorInitOnce, NULL);
+
+  pNode = (motorInitNode *) calloc(1, sizeof(motorInitNode));
+  pNode->pController = this;
+  epicsMutexLock(motorInitListLock);
+  if (ellCount(&motorInitList) == 0) motorInitFirstStart = now;
+  ellAdd(&motorInitList, (ELLNODE *)pNode);
+  epicsMutexUnlock(motorInitListLock);
+
+  if (motorInitParallel) {
+    epicsThreadCreate("motorInit", 
+                      epicsThreadPriorityMedium,
+                      epicsThreadGetStackSize(epicsThreadStackMedium),
+                      (EPICSTHREADFUNC)asynMotorInitTaskC, (void *)this);
+  } else {
+    asynMotorInitTask();
+  }
+  return asynSuccess;
+}
+
+/** Waits for the initialization started by startInit() to complete.
+  * Returns immediately if startInit() has not been called.
+  * \param[in] timeout The maximum time to wait in seconds, 0 to wait forever. */
+asynStatus asynMotorController::waitInit(double timeout)
+{
+  epicsEventWaitStatus status;
+
+  if (getInitState() != MOTOR_INIT_PENDING) return asynSuccess;
+  if (timeout > 0.) status = epicsEventWaitWithTimeout(initEventId_, timeout);
+  else              status = epicsEventWait(initEventId_);
+  if (status != epicsEventWaitOK) return asynTimeout;
+  /* Signal the event again so any other thread waiting for it is also released */
+  epicsEventSignal(initEventId_);
+  return asynSuccess;
+}
+
+/** Returns the state of the initialization, one of the MotorInitState values.
+  * This can be called from any thread, the state is set by the init thread without the port lock. */
+int asynMotorController::getInitState()
+{
+  int state;
+
+  epicsMutexLock(initLock_);
+  state = initState_;
+  epicsMutexUnlock(initLock_);
+  return state;
+}
+
+/** Returns the result of the initialization.
+  * \param[out] initTime The total time spent waiting for the port lock, in init() and in initAxis(), in seconds.
+  * \return The status returned by init(), or the first error returned by initAxis(). */
+asynStatus asynMotorController::getInitStatus(double *initTime)
+{
+  asynStatus status;
+
+  epicsMutexLock(initLock_);
+  *initTime = initLockTime_ + initTime_ + initAxisTime_;
+  status = initStatus_;
+  epicsMutexUnlock(initLock_);
+  return status;
+}
+
+/** Prints the time spent in each phase of the initialization.
+  * \param[in] fp FILE pointer. */
+void asynMotorController::initReport(FILE *fp)
+{
+  epicsMutexLock(initLock_);
+  fprintf(fp, "%s: init %s, status=%d, constructor=%.3f s, lock wait=%.3f s, init()=%.3f s, initAxis()=%.3f s",
+          portName, (initState_ == MOTOR_INIT_DONE) ? "done" : (initState_ == MOTOR_INIT_PENDING) ? "pending" : "not used",
+          initStatus_, constructTime_, initLockTime_, initTime_, initAxisTime_);
+  if (initAxisMaxAxis_ >= 0) fprintf(fp, " (max %.3f s axis %d)", initAxisMaxTime_, initAxisMaxAxis_);
+  fprintf(fp, "\n");
+  epicsMutexUnlock(initLock_);
+}
 
+static void asynMotorInitTaskC(void *drvPvt)
+{
+  asynMotorController *pController = (asynMotorController*)drvPvt;
+  pController->asynMotorInitTask();
+}
+
+/** Initialization function that runs in the thread created by startInit().
+  * It takes the lock on the port driver and calls init(), and then takes the lock again for initAxis() of
+  * each axis, so other threads can use the port between the steps.  It records the time spent in each phase.
+  * The poller does not poll the controller before the state is MOTOR_INIT_DONE. */
+void asynMotorController::asynMotorInitTask()
+{
+  epicsTimeStamp start, t0, t1;
+  asynStatus status;
+  double elapsed, lockTime;
+  int axis;
+  static const char *functionName = "asynMotorInitTask";
+
+  epicsTimeGetCurrent(&start);
+  lock();
+  epicsTimeGetCurrent(&t0);
+  lockTime = epicsTimeDiffInSeconds(&t0, &start);
+  status = init();
+  unlock();
+  epicsTimeGetCurrent(&t1);
+  epicsMutexLock(initLock_);
+  initLockTime_ = lockTime;
+  initTime_ = epicsTimeDiffInSeconds(&t1, &t0);
+  initStatus_ = status;
+  epicsMutexUnlock(initLock_);
+  if (status) {
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+      "%s:%s: port %s init() failed, status=%d\n",
+      driverName, functionName, portName, status);
+  }
+
+  for (axis=0; axis<numAxes_; axis++) {
+    if (!getAxis(axis)) continue;
+    epicsTimeGetCurrent(&t0);
+    lock();
+    epicsTimeGetCurrent(&t1);
+    lockTime = epicsTimeDiffInSeconds(&t1, &t0);
+    t0 = t1;
+    status = initAxis(axis);
+    unlock();
+    epicsTimeGetCurrent(&t1);
+    elapsed = epicsTimeDiffInSeconds(&t1, &t0);
+    epicsMutexLock(initLock_);
+    initLockTime_ += lockTime;
+    initAxisTime_ += elapsed;
+    if (elapsed > initAxisMaxTime_ || initAxisMaxAxis_ < 0) {
+      initAxisMaxTime_ = elapsed;
+      initAxisMaxAxis_ = axis;
     }
-    if (forcedFastPolls > 0) {
-      timeout = movingPollPeriod_;
-      forcedFastPolls--;
-    } else if (anyMoving) {
-      timeout = movingPollPeriod_;
-    } else {
-      timeout = idlePollPeriod_;
+    if (status && (initStatus_ == asynSuccess)) initStatus_ = status;
+    epicsMutexUnlock(initLock_);
+    if (status) {
+      asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+        "%s:%s: port %s initAxis(%d) failed, status=%d\n",
+        driverName, functionName, portName, axis, status);
     }
-    unlock();
   }
+  epicsMutexLock(initLock_);
+  initState_ = MOTOR_INIT_DONE;
+  epicsMutexUnlock(initLock_);
+
+  epicsMutexLock(motorInitListLock);
+  motorInitLastDone = t1;
+  epicsMutexUnlock(motorInitListLock);
+  epicsEventSignal(initEventId_);
+  wakeupPoller();
+
+  asynPrint(pasynUserSelf, ASYN_TRACE_FLOW,
+    "%s:%s: port %s initialization complete, %.3f s\n",
+    driverName, functionName, portName, epicsTimeDiffInSeconds(&t1, &start));
 }
 
 /**
@@ -771,60 +1516,293 @@ asynStatus asynMotorController::writeReadController(const char *output, char *in
   size_t nwrite;
   asynStatus status;
   int eomReason;
+  epicsTimeStamp start, end;
   // const char *functionName="writeReadController";
   
+  epicsTimeGetCurrent(&start);
   status = pasynOctetSyncIO->writeRead(pasynUserController_, output,
                                        strlen(output), input, maxChars, timeout,
                                        &nwrite, nread, &eomReason);
+  epicsTimeGetCurrent(&end);
+  addCommandTime(output, epicsTimeDiffInSeconds(&end, &start));
                         
   return status;
 }
 
-
-
-/* These are the functions for profile moves */
-/** Initialize a profile move of multiple axes. */
-asynStatus asynMotorController::initializeProfile(size_t maxProfilePoints)
+/** Writes a burst of commands to the controller and reads the replies in order.
+  * Calls writeReadBurst() with the commands of the burst object.
+  * \param[in] pBurst The burst, the replies are read into its own buffers.
+  * \param[in] timeout Timeout for each command. */
+asynStatus asynMotorController::writeReadBurst(asynMotorBurst *pBurst, double timeout)
 {
-  int axis;
-  asynMotorAxis *pAxis;
-  // static const char *functionName = "initializeProfile";
-  
-  maxProfilePoints_ = maxProfilePoints;
-  if (profileTimes_) free(profileTimes_);
-  profileTimes_ = (double *)calloc(maxProfilePoints, sizeof(double));
-  for (axis=0; axis<numAxes_; axis++) {
-    pAxis = getAxis(axis);
-    if (!pAxis) continue;
-    pAxis->initializeProfile(maxProfilePoints);
-  }
-  return asynSuccess;
+  return writeReadBurst(pBurst->commands_, pBurst->numCommands_, timeout);
 }
-  
-/** Build a profile move of multiple axes. */
-asynStatus asynMotorController::buildProfile()
+
+/** Writes a burst of commands to the controller and reads the replies in order.
+  * The asyn port of the controller is locked once for the whole burst, so no other client can
+  * interleave its I/O.  While the port is locked the asynOctet interface of the port is called
+  * directly, because asynOctetSyncIO would queue a request to the port thread, which is blocked
+  * by the lock held here.
+  * Without pipelining each command is written and its reply read before the next command.
+  * With pipelining, see setBurstPipelining(), all commands are written first and the replies are
+  * read afterwards, which saves the turnaround of the controller on every command but is only
+  * allowed for controllers that buffer their input and reply to every command in order.
+  * The burst stops at the first error, the remaining commands get the status asynError.
+  * \param[in,out] commands Array of commands, nread and status are set for each command.
+  * \param[in] numCommands Number of commands.
+  * \param[in] timeout Timeout for each command.
+  * \return The status of the first command that failed, or asynSuccess. */
+asynStatus asynMotorController::writeReadBurst(MotorBurstCommand *commands, int numCommands, double timeout)
 {
-  //static const char *functionName = "buildProfile";
-  asynMotorAxis *pAxis;
+  epicsTimeStamp burstStart, start, end;
+  asynInterface *pasynInterface;
+  asynOctet *pasynOctet;
+  void *octetPvt;
+  double savedTimeout;
+  size_t nwrite;
+  int eomReason;
   int i;
-  int status=0;
-  double time;
-  int timeMode;
-  int numPoints;
+  asynStatus status = asynSuccess;
+  static const char *functionName = "writeReadBurst";
 
-  status |= getIntegerParam(profileTimeMode_, &timeMode);
-  status |= getDoubleParam(profileFixedTime_, &time);
-  status |= getIntegerParam(profileNumPoints_, &numPoints);
-  if (status) return asynError;
-  if (timeMode == PROFILE_TIME_MODE_FIXED) {
-    memset(profileTimes_, 0, maxProfilePoints_*sizeof(double));
-    for (i=0; i<numPoints; i++) {
-      profileTimes_[i] = time;
-    }
+  for (i=0; i<numCommands; i++) {
+    commands[i].nread = 0;
+    commands[i].status = asynError;
+    if (commands[i].input) commands[i].input[0] = '\0';
   }
-  for (i=0; i<numAxes_; i++) {
-    pAxis = getAxis(i);
-    if (!pAxis) continue;
+
+  pasynInterface = pasynManager->findInterface(pasynUserController_, asynOctetType, 1);
+  if (!pasynInterface) {
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+      "%s:%s: %s no asynOctet interface\n",
+      driverName, functionName, portName);
+    return asynError;
+  }
+  pasynOctet = (asynOctet *)pasynInterface->pinterface;
+  octetPvt = pasynInterface->drvPvt;
+
+  epicsTimeGetCurrent(&burstStart);
+  status = pasynManager->lockPort(pasynUserController_);
+  if (status) {
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+      "%s:%s: %s cannot lock port, %s\n",
+      driverName, functionName, portName, pasynUserController_->errorMessage);
+    return status;
+  }
+  savedTimeout = pasynUserController_->timeout;
+  pasynUserController_->timeout = timeout;
+  start = burstStart;
+  if (burstPipelining_) {
+    pasynOctet->flush(octetPvt, pasynUserController_);
+    for (i=0; i<numCommands; i++) {
+      status = pasynOctet->write(octetPvt, pasynUserController_, commands[i].output,
+                                 strlen(commands[i].output), &nwrite);
+      if (status) break;
+      if (!commands[i].input) commands[i].status = asynSuccess;
+    }
+    /* The time of each command is from the end of the previous reply to the end of its own */
+    for (i=0; (status == asynSuccess) && (i<numCommands); i++) {
+      if (!commands[i].input) continue;
+      status = pasynOctet->read(octetPvt, pasynUserController_, commands[i].input, commands[i].maxInput-1,
+                                &commands[i].nread, &eomReason);
+      commands[i].status = status;
+      if (status) break;
+      commands[i].input[commands[i].nread] = '\0';
+      epicsTimeGetCurrent(&end);
+      addCommandTime(commands[i].output, epicsTimeDiffInSeconds(&end, &start));
+      start = end;
+    }
+  } else {
+    for (i=0; i<numCommands; i++) {
+      epicsTimeGetCurrent(&start);
+      if (commands[i].input) pasynOctet->flush(octetPvt, pasynUserController_);
+      status = pasynOctet->write(octetPvt, pasynUserController_, commands[i].output,
+                                 strlen(commands[i].output), &nwrite);
+      if ((status == asynSuccess) && commands[i].input) {
+        status = pasynOctet->read(octetPvt, pasynUserController_, commands[i].input,
+                                  commands[i].maxInput-1, &commands[i].nread, &eomReason);
+        if (status == asynSuccess) commands[i].input[commands[i].nread] = '\0';
+      }
+      commands[i].status = status;
+      if (status) break;
+      epicsTimeGetCurrent(&end);
+      addCommandTime(commands[i].output, epicsTimeDiffInSeconds(&end, &start));
+    }
+  }
+  pasynUserController_->timeout = savedTimeout;
+  pasynManager->unlockPort(pasynUserController_);
+  epicsTimeGetCurrent(&end);
+
+  if (status) {
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+      "%s:%s: %s command %d \"%s\" failed, status=%d\n",
+      driverName, functionName, portName, i, (i < numCommands) ? commands[i].output : "", status);
+  }
+
+  epicsMutexLock(commandStatsMutex_);
+  numBursts_++;
+  numBurstCommands_ += numCommands;
+  double elapsed = epicsTimeDiffInSeconds(&end, &burstStart);
+  burstTotalTime_ += elapsed;
+  if (elapsed > burstMaxTime_) burstMaxTime_ = elapsed;
+  epicsMutexUnlock(commandStatsMutex_);
+  return status;
+}
+
+/** Selects whether writeReadBurst() writes all commands before reading the replies.
+  * Drivers call this for controllers that buffer their input and answer every command in order.
+  * \param[in] pipelining true to pipeline the commands of a burst, false for one writeRead() per command. */
+void asynMotorController::setBurstPipelining(bool pipelining)
+{
+  burstPipelining_ = pipelining;
+}
+
+/** Adds the time of one command to the statistics printed by report().
+  * The statistics are collected per command mnemonic: leading axis numbers are skipped
+  * and the mnemonic ends at the first blank or digit, so "1TP" counts as "TP" and "?P12290" as "?P".
+  * \param[in] output The command.
+  * \param[in] elapsed Time in seconds from writing the command to reading the reply. */
+void asynMotorController::addCommandTime(const char *output, double elapsed)
+{
+  output += strspn(output, " 0123456789");
+  commandStats_.add(output, strcspn(output, " \r\n0123456789"), elapsed);
+}
+
+/** Prints the timing statistics of the controller commands and bursts.
+  * \param[in] fp FILE pointer. */
+void asynMotorController::commandReport(FILE *fp)
+{
+  fprintf(fp, "%s: command statistics\n", portName);
+  commandStats_.report(fp);
+  epicsMutexLock(commandStatsMutex_);
+  if (numBursts_ > 0) {
+    fprintf(fp, "  bursts=%lu, commands/burst=%.1f, mean=%.3f ms, max=%.3f ms, pipelining=%s\n",
+            numBursts_, (double)numBurstCommands_ / numBursts_, 1000. * burstTotalTime_ / numBursts_,
+            1000. * burstMaxTime_, burstPipelining_ ? "yes" : "no");
+  }
+  epicsMutexUnlock(commandStatsMutex_);
+}
+
+
+/** Constructor for a burst of commands, the burst is empty. */
+asynMotorBurst::asynMotorBurst()
+{
+  clear();
+}
+
+/** Removes all commands from the burst. */
+void asynMotorBurst::clear()
+{
+  numCommands_ = 0;
+}
+
+/** Adds a command with a reply to the burst.
+  * \param[in] format printf format of the command, followed by its arguments.
+  * \return The index of the command for reply() and status(), or -1 if the burst is full. */
+int asynMotorBurst::add(const char *format, ...)
+{
+  va_list args;
+  int index;
+
+  va_start(args, format);
+  index = addCommand(true, format, args);
+  va_end(args);
+  return index;
+}
+
+/** Adds a command without a reply to the burst.
+  * \param[in] format printf format of the command, followed by its arguments.
+  * \return The index of the command, or -1 if the burst is full. */
+int asynMotorBurst::addWrite(const char *format, ...)
+{
+  va_list args;
+  int index;
+
+  va_start(args, format);
+  index = addCommand(false, format, args);
+  va_end(args);
+  return index;
+}
+
+int asynMotorBurst::addCommand(bool hasReply, const char *format, va_list args)
+{
+  int index = numCommands_;
+  MotorBurstCommand *pCommand;
+
+  if (index >= MAX_BURST_COMMANDS) return -1;
+  pCommand = &commands_[index];
+  epicsVsnprintf(outputs_[index], sizeof(outputs_[index]), format, args);
+  pCommand->output = outputs_[index];
+  pCommand->input = hasReply ? inputs_[index] : NULL;
+  pCommand->maxInput = hasReply ? sizeof(inputs_[index]) : 0;
+  pCommand->nread = 0;
+  pCommand->status = asynError;
+  inputs_[index][0] = '\0';
+  numCommands_++;
+  return index;
+}
+
+/** Returns the reply of a command after asynMotorController::writeReadBurst(), "" if there is none.
+  * \param[in] index The index returned by add(). */
+const char *asynMotorBurst::reply(int index)
+{
+  if ((index < 0) || (index >= numCommands_) || !commands_[index].input) return "";
+  return commands_[index].input;
+}
+
+/** Returns the status of a command after asynMotorController::writeReadBurst().
+  * \param[in] index The index returned by add() or addWrite(). */
+asynStatus asynMotorBurst::status(int index)
+{
+  if ((index < 0) || (index >= numCommands_)) return asynError;
+  return commands_[index].status;
+}
+
+
+
+/* These are the functions for profile moves */
+/** Initialize a profile move of multiple axes. */
+asynStatus asynMotorController::initializeProfile(size_t maxProfilePoints)
+{
+  int axis;
+  asynMotorAxis *pAxis;
+  // static const char *functionName = "initializeProfile";
+  
+  maxProfilePoints_ = maxProfilePoints;
+  if (profileTimes_) free(profileTimes_);
+  profileTimes_ = (double *)calloc(maxProfilePoints, sizeof(double));
+  for (axis=0; axis<numAxes_; axis++) {
+    pAxis = getAxis(axis);
+    if (!pAxis) continue;
+    pAxis->initializeProfile(maxProfilePoints);
+  }
+  return asynSuccess;
+}
+  
+/** Build a profile move of multiple axes. */
+asynStatus asynMotorController::buildProfile()
+{
+  //static const char *functionName = "buildProfile";
+  asynMotorAxis *pAxis;
+  int i;
+  int status=0;
+  double time;
+  int timeMode;
+  int numPoints;
+
+  status |= getIntegerParam(profileTimeMode_, &timeMode);
+  status |= getDoubleParam(profileFixedTime_, &time);
+  status |= getIntegerParam(profileNumPoints_, &numPoints);
+  if (status) return asynError;
+  if (timeMode == PROFILE_TIME_MODE_FIXED) {
+    memset(profileTimes_, 0, maxProfilePoints_*sizeof(double));
+    for (i=0; i<numPoints; i++) {
+      profileTimes_[i] = time;
+    }
+  }
+  for (i=0; i<numAxes_; i++) {
+    pAxis = getAxis(i);
+    if (!pAxis) continue;
     pAxis->buildProfile();
   }
   return asynSuccess;
@@ -875,6 +1853,487 @@ asynStatus asynMotorController::readbackProfile()
   return asynSuccess;
 }
 
+/* These are the functions for streaming profile moves.
+ * A streaming profile is not limited to maxProfilePoints_: the client appends segments of up to
+ * maxProfilePoints_ points, which are defined with the usual PROFILE_TIME_ARRAY and PROFILE_POSITIONS
+ * arrays, to a ring buffer of initializeStreamProfile() points while the controller executes the
+ * points appended earlier.  PROFILE_STREAM selects streaming for PROFILE_BUILD, PROFILE_EXECUTE,
+ * PROFILE_ABORT and PROFILE_READBACK. */
+
+/** Allocates the ring buffers for streaming profile moves.
+  * This is called by asynMotorEnableProfileStream() or from the constructor of a derived class,
+  * after initializeProfile(), because the segments are defined with the profile arrays.
+  * \param[in] maxPoints Number of points in the ring buffer, 0 to disable streaming. */
+asynStatus asynMotorController::initializeStreamProfile(size_t maxPoints)
+{
+  int axis;
+  asynMotorAxis *pAxis;
+  int status = 0;
+  static const char *functionName = "initializeStreamProfile";
+
+  if (streamExecuting_) return asynError;
+  if ((maxPoints > 0) && (maxPoints < maxProfilePoints_)) {
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+      "%s:%s: ring buffer of %d points is smaller than a segment of %d points\n",
+      driverName, functionName, (int)maxPoints, (int)maxProfilePoints_);
+    return asynError;
+  }
+  if (streamTimes_) free(streamTimes_);
+  streamTimes_ = NULL;
+  streamSize_ = 0;
+  streamBuilt_ = false;
+  streamEnd_ = false;
+  streamRefill_ = false;
+  streamAppended_ = 0;
+  streamSent_ = 0;
+  streamDone_ = 0;
+  streamReadbackRead_ = 0;
+  for (axis=0; axis<numAxes_; axis++) {
+    pAxis = getAxis(axis);
+    if (!pAxis) continue;
+    status |= pAxis->initializeStreamProfile(maxPoints);
+  }
+  if (maxPoints > 0) {
+    streamTimes_ = (double *)calloc(maxPoints, sizeof(double));
+    if (!streamTimes_) status = asynError;
+  }
+  if (status) return asynError;
+  streamSize_ = maxPoints;
+  setIntegerParam(profileStreamSize_, (int)maxPoints);
+  setIntegerParam(profileStreamLowWater_, (int)(maxPoints/4));
+  setIntegerParam(profileStreamHighWater_, (int)(3*maxPoints/4));
+  pollStreamProfile();
+  return asynSuccess;
+}
+
+/** Prepares the controller for a streaming profile move of the axes that have PROFILE_USE_AXIS set.
+  * Derived classes that support streaming implement this to check and set up the controller.
+  * \param[out] message The error message if the build fails.
+  * This base class implementation returns an error. */
+asynStatus asynMotorController::buildStreamProfile(char *message)
+{
+  sprintf(message, "Streaming profile moves are not supported by this driver");
+  return asynError;
+}
+
+/** Passes points of a streaming profile to the controller.
+  * This is called with the port locked by appending, by executing and by pollStreamProfile()
+  * while there are points that the controller has not accepted yet.
+  * The points are read with streamTime() and streamPosition() and are in controller units.
+  * \param[in] firstPoint Number of the first point, the points are numbered from 0 in each stream.
+  * \param[in] numPoints Number of points available from firstPoint.
+  * \param[out] numAccepted Number of points the controller accepted, 0 if its queue is full.
+  * \param[out] message The error message if the points cannot be passed to the controller.
+  * This base class implementation returns an error. */
+asynStatus asynMotorController::appendStreamSegment(size_t firstPoint, size_t numPoints, size_t *numAccepted,
+                                                    char *message)
+{
+  *numAccepted = 0;
+  sprintf(message, "Streaming profile moves are not supported by this driver");
+  return asynError;
+}
+
+/** Starts the execution of a streaming profile move.
+  * The driver then reports the executed points with setStreamPointsDone() and their readbacks
+  * with setStreamReadback().
+  * \param[out] message The error message if the profile cannot be started.
+  * This base class implementation returns an error. */
+asynStatus asynMotorController::executeStreamProfile(char *message)
+{
+  sprintf(message, "Streaming profile moves are not supported by this driver");
+  return asynError;
+}
+
+/** Stops a streaming profile move.
+  * This is called on PROFILE_ABORT and when the client does not append points in time.
+  * This base class implementation returns an error. */
+asynStatus asynMotorController::abortStreamProfile()
+{
+  return asynError;
+}
+
+/** Starts a new stream: records the axes that are used, clears the ring buffer and calls buildStreamProfile(). */
+asynStatus asynMotorController::streamBuild()
+{
+  asynMotorAxis *pAxis;
+  int axis;
+  int useAxis;
+  int numStreamAxes = 0;
+  bool buildOK = false;
+  char message[MAX_CONTROLLER_STRING_SIZE];
+  static const char *functionName = "streamBuild";
+
+  strcpy(message, "");
+  setStringParam(profileBuildMessage_, message);
+  setIntegerParam(profileBuildState_, PROFILE_BUILD_BUSY);
+  setIntegerParam(profileBuildStatus_, PROFILE_STATUS_UNDEFINED);
+  callParamCallbacks();
+
+  if (streamExecuting_) {
+    sprintf(message, "Streaming profile is executing");
+    goto done;
+  }
+  streamBuilt_ = false;
+  if (streamSize_ == 0) {
+    sprintf(message, "Streaming is not enabled, see asynMotorEnableProfileStream");
+    goto done;
+  }
+  for (axis=0; axis<numAxes_; axis++) {
+    pAxis = getAxis(axis);
+    if (!pAxis) continue;
+    getIntegerParam(axis, profileUseAxis_, &useAxis);
+    pAxis->streamUse_ = (useAxis != 0);
+    if (useAxis) numStreamAxes++;
+  }
+  if (numStreamAxes == 0) {
+    sprintf(message, "No axis used in profile");
+    goto done;
+  }
+  streamEnd_ = false;
+  streamRefill_ = false;
+  streamAppended_ = 0;
+  streamSent_ = 0;
+  streamDone_ = 0;
+  streamReadbackRead_ = 0;
+  if (buildStreamProfile(message)) goto done;
+  streamBuilt_ = true;
+  buildOK = true;
+
+  done:
+  setIntegerParam(profileBuildStatus_, buildOK ? PROFILE_STATUS_SUCCESS : PROFILE_STATUS_FAILURE);
+  setStringParam(profileBuildMessage_, message);
+  if (!buildOK) {
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+              "%s:%s: %s\n",
+              driverName, functionName, message);
+  }
+  setIntegerParam(profileBuild_, 0);
+  setIntegerParam(profileBuildState_, PROFILE_BUILD_DONE);
+  pollStreamProfile();
+  return buildOK ? asynSuccess : asynError;
+}
+
+/** Appends the PROFILE_NUM_POINTS points of the profile arrays to the ring buffer.
+  * The result is reported in PROFILE_BUILD_STATUS and PROFILE_BUILD_MESSAGE. */
+asynStatus asynMotorController::streamAppend()
+{
+  asynMotorAxis *pAxis;
+  int axis;
+  int i;
+  int numPoints;
+  int timeMode;
+  double fixedTime;
+  double time;
+  size_t point;
+  size_t numFree;
+  bool appendOK = false;
+  char message[MAX_CONTROLLER_STRING_SIZE];
+  static const char *functionName = "streamAppend";
+
+  strcpy(message, "");
+  getIntegerParam(profileNumPoints_, &numPoints);
+  getIntegerParam(profileTimeMode_, &timeMode);
+  getDoubleParam(profileFixedTime_, &fixedTime);
+  if (!streamBuilt_) {
+    sprintf(message, "Streaming profile is not built");
+    goto done;
+  }
+  if (streamEnd_) {
+    sprintf(message, "The last segment has already been appended");
+    goto done;
+  }
+  if ((numPoints < 1) || ((size_t)numPoints > maxProfilePoints_)) {
+    sprintf(message, "Number of points must be 1 to %d", (int)maxProfilePoints_);
+    goto done;
+  }
+  numFree = streamSize_ - (streamAppended_ - streamDone_);
+  if ((size_t)numPoints > numFree) {
+    sprintf(message, "Only %d points free in the stream buffer", (int)numFree);
+    goto done;
+  }
+  for (i=0; i<numPoints; i++) {
+    time = (timeMode == PROFILE_TIME_MODE_FIXED) ? fixedTime : profileTimes_[i];
+    if (time <= 0.) {
+      sprintf(message, "Time of point %d is not positive", i+1);
+      goto done;
+    }
+  }
+  for (i=0; i<numPoints; i++) {
+    point = (streamAppended_ + i) % streamSize_;
+    streamTimes_[point] = (timeMode == PROFILE_TIME_MODE_FIXED) ? fixedTime : profileTimes_[i];
+    for (axis=0; axis<numAxes_; axis++) {
+      pAxis = getAxis(axis);
+      if (!pAxis || !pAxis->streamUse_) continue;
+      pAxis->streamPositions_[point] = pAxis->profilePositions_[i];
+    }
+  }
+  streamAppended_ += numPoints;
+  appendOK = true;
+
+  done:
+  setIntegerParam(profileBuildStatus_, appendOK ? PROFILE_STATUS_SUCCESS : PROFILE_STATUS_FAILURE);
+  setStringParam(profileBuildMessage_, message);
+  if (!appendOK) {
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+              "%s:%s: %s\n",
+              driverName, functionName, message);
+  }
+  setIntegerParam(profileAppend_, 0);
+  /* Pass the new points to the controller right away */
+  pollStreamProfile();
+  return appendOK ? asynSuccess : asynError;
+}
+
+/** Starts the execution of the points appended so far. */
+asynStatus asynMotorController::streamExecute()
+{
+  char message[MAX_CONTROLLER_STRING_SIZE];
+
+  strcpy(message, "");
+  setStringParam(profileExecuteMessage_, message);
+  setIntegerParam(profileExecuteState_, PROFILE_EXECUTE_EXECUTING);
+  setIntegerParam(profileExecuteStatus_, PROFILE_STATUS_UNDEFINED);
+  callParamCallbacks();
+
+  if (!streamBuilt_) {
+    streamDone(PROFILE_STATUS_FAILURE, "Streaming profile is not built");
+    return asynError;
+  }
+  if (streamExecuting_) {
+    streamDone(PROFILE_STATUS_FAILURE, "Streaming profile is already executing");
+    return asynError;
+  }
+  if (streamAppended_ == 0) {
+    streamDone(PROFILE_STATUS_FAILURE, "No points have been appended");
+    return asynError;
+  }
+  streamExecuting_ = true;
+  if (executeStreamProfile(message)) {
+    streamDone(PROFILE_STATUS_FAILURE, message);
+    return asynError;
+  }
+  pollStreamProfile();
+  wakeupPoller();
+  return asynSuccess;
+}
+
+/** Stops an executing streaming profile. */
+asynStatus asynMotorController::streamAbort()
+{
+  asynStatus status;
+
+  if (!streamExecuting_) return asynSuccess;
+  status = abortStreamProfile();
+  streamDone(PROFILE_STATUS_ABORT, "Profile aborted");
+  return status;
+}
+
+/** Reads the oldest unread readbacks and following errors, up to maxProfilePoints_ points, into
+  * the PROFILE_READBACKS and PROFILE_FOLLOWING_ERRORS arrays in user units.
+  * PROFILE_STREAM_READBACK_FIRST is the number of the first point in the arrays.  This can be done
+  * while the profile is executing, and must be repeated until PROFILE_STREAM_UNREAD is 0. */
+asynStatus asynMotorController::streamReadback()
+{
+  asynMotorAxis *pAxis;
+  int axis;
+  size_t i, point;
+  size_t numRead;
+  double resolution;
+  double offset;
+  int direction;
+  int status;
+
+  setIntegerParam(profileReadbackState_, PROFILE_READBACK_BUSY);
+  setIntegerParam(profileReadbackStatus_, PROFILE_STATUS_UNDEFINED);
+  setStringParam(profileReadbackMessage_, "");
+  callParamCallbacks();
+
+  numRead = streamDone_ - streamReadbackRead_;
+  if (numRead > maxProfilePoints_) numRead = maxProfilePoints_;
+  setIntegerParam(profileNumReadbacks_, (int)numRead);
+  setIntegerParam(profileStreamReadbackFirst_, (int)streamReadbackRead_);
+  for (axis=0; axis<numAxes_; axis++) {
+    pAxis = getAxis(axis);
+    if (!pAxis || !pAxis->streamUse_ || !pAxis->profileReadbacks_) continue;
+    status  = getDoubleParam(axis, motorRecResolution_, &resolution);
+    status |= getDoubleParam(axis, motorRecOffset_, &offset);
+    status |= getIntegerParam(axis, motorRecDirection_, &direction);
+    if (status) {
+      resolution = 1.;
+      offset = 0.;
+      direction = 0;
+    }
+    // Convert to user units
+    if (direction != 0) resolution = -resolution;
+    for (i=0; i<numRead; i++) {
+      point = (streamReadbackRead_ + i) % streamSize_;
+      pAxis->profileReadbacks_[i] = pAxis->streamReadbacks_[point] * resolution + offset;
+      pAxis->profileFollowingErrors_[i] = pAxis->streamFollowingErrors_[point] * resolution;
+    }
+    doCallbacksFloat64Array(pAxis->profileReadbacks_,       numRead, profileReadbacks_,       axis);
+    doCallbacksFloat64Array(pAxis->profileFollowingErrors_, numRead, profileFollowingErrors_, axis);
+  }
+  streamReadbackRead_ += numRead;
+
+  setIntegerParam(profileReadbackStatus_, PROFILE_STATUS_SUCCESS);
+  setIntegerParam(profileReadback_, 0);
+  setIntegerParam(profileReadbackState_, PROFILE_READBACK_DONE);
+  pollStreamProfile();
+  return asynSuccess;
+}
+
+/** Ends the execution of a streaming profile.
+  * The stream must be built again before it can be executed again.
+  * \param[in] status The execute status, one of the ProfileStatus values
+  * \param[in] message The execute message */
+void asynMotorController::streamDone(int status, const char *message)
+{
+  static const char *functionName = "streamDone";
+
+  streamExecuting_ = false;
+  streamBuilt_ = false;
+  setIntegerParam(profileExecuteStatus_, status);
+  setStringParam(profileExecuteMessage_, message);
+  if (status != PROFILE_STATUS_SUCCESS) {
+    asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+              "%s:%s: %s\n",
+              driverName, functionName, message);
+  }
+  setIntegerParam(profileExecute_, 0);
+  setIntegerParam(profileExecuteState_, PROFILE_EXECUTE_DONE);
+  callParamCallbacks();
+}
+
+/** Services a streaming profile move.
+  * This is called with the port locked by the poller after the axes have been polled, and after the
+  * client appends, executes or reads back.  Drivers that do not use the base class poller call
+  * it themselves.  It passes the points that the controller has not accepted yet to
+  * appendStreamSegment(), ends the profile when the last point has been executed or when the
+  * controller has executed every appended point before the client marked the end of the stream
+  * (an underrun), and sets PROFILE_STREAM_REFILL when fewer than PROFILE_STREAM_LOW_WATER points
+  * remain to be executed until there are PROFILE_STREAM_HIGH_WATER points again. */
+void asynMotorController::pollStreamProfile()
+{
+  size_t numAccepted;
+  size_t numQueued;
+  int lowWater, highWater;
+  char message[MAX_CONTROLLER_STRING_SIZE];
+
+  if (streamSize_ == 0) return;
+  while (streamBuilt_ && (streamSent_ < streamAppended_)) {
+    numAccepted = 0;
+    strcpy(message, "");
+    if (appendStreamSegment(streamSent_, streamAppended_ - streamSent_, &numAccepted, message)) {
+      if (streamExecuting_) {
+        abortStreamProfile();
+        streamDone(PROFILE_STATUS_FAILURE, message);
+      } else {
+        streamBuilt_ = false;
+        setIntegerParam(profileBuildStatus_, PROFILE_STATUS_FAILURE);
+        setStringParam(profileBuildMessage_, message);
+      }
+      break;
+    }
+    if (numAccepted == 0) break;
+    streamSent_ += numAccepted;
+  }
+  if (streamExecuting_ && (streamDone_ >= streamAppended_)) {
+    if (streamEnd_) {
+      streamDone(PROFILE_STATUS_SUCCESS, "");
+    } else {
+      streamUnderruns_++;
+      abortStreamProfile();
+      epicsSnprintf(message, sizeof(message), "Underrun at point %lu", (unsigned long)streamDone_);
+      streamDone(PROFILE_STATUS_FAILURE, message);
+    }
+  }
+
+  numQueued = streamAppended_ - streamDone_;
+  getIntegerParam(profileStreamLowWater_, &lowWater);
+  getIntegerParam(profileStreamHighWater_, &highWater);
+  if (!streamBuilt_ || streamEnd_)           streamRefill_ = false;
+  else if ((int)numQueued <= lowWater)       streamRefill_ = true;
+  else if ((int)numQueued >= highWater)      streamRefill_ = false;
+  setIntegerParam(profileStreamRefill_,    streamRefill_ ? 1 : 0);
+  setIntegerParam(profileStreamEnd_,       streamEnd_ ? 1 : 0);
+  setIntegerParam(profileStreamFree_,      (int)(streamSize_ - numQueued));
+  setIntegerParam(profileStreamAppended_,  (int)streamAppended_);
+  setIntegerParam(profileStreamSent_,      (int)streamSent_);
+  setIntegerParam(profileCurrentPoint_,    (int)streamDone_);
+  setIntegerParam(profileStreamUnderruns_, (int)streamUnderruns_);
+  setIntegerParam(profileStreamUnread_,    (int)(streamDone_ - streamReadbackRead_));
+  setIntegerParam(profileStreamOverruns_,  (int)streamOverruns_);
+  callParamCallbacks();
+}
+
+/** Returns the time to move to a point of the streaming profile from the previous point,
+  * or from the start position for point 0.
+  * \param[in] point Number of the point. */
+double asynMotorController::streamTime(size_t point)
+{
+  return streamTimes_[point % streamSize_];
+}
+
+/** Returns the target position of an axis at a point of the streaming profile, in controller units.
+  * \param[in] axis Axis index number.
+  * \param[in] point Number of the point. */
+double asynMotorController::streamPosition(int axis, size_t point)
+{
+  asynMotorAxis *pAxis = getAxis(axis);
+
+  if (!pAxis || !pAxis->streamPositions_) return 0.;
+  return pAxis->streamPositions_[point % streamSize_];
+}
+
+/** Returns whether an axis is used by the streaming profile that was built.
+  * \param[in] axis Axis index number. */
+bool asynMotorController::streamUsesAxis(int axis)
+{
+  asynMotorAxis *pAxis = getAxis(axis);
+
+  return pAxis && pAxis->streamUse_;
+}
+
+/** Stores the readback position and following error of an axis at an executed point.
+  * \param[in] axis Axis index number.
+  * \param[in] point Number of the point.
+  * \param[in] readback Actual position in controller units.
+  * \param[in] followingError Following error in controller units. */
+void asynMotorController::setStreamReadback(int axis, size_t point, double readback, double followingError)
+{
+  asynMotorAxis *pAxis = getAxis(axis);
+
+  if (!pAxis || !pAxis->streamReadbacks_) return;
+  pAxis->streamReadbacks_[point % streamSize_] = readback;
+  pAxis->streamFollowingErrors_[point % streamSize_] = followingError;
+}
+
+/** Reports the number of points of the streaming profile that the controller has executed.
+  * The readbacks of these points must have been stored with setStreamReadback().
+  * Readbacks that are more than the size of the ring buffer behind are discarded.
+  * \param[in] numDone Number of points executed since the start of the stream. */
+void asynMotorController::setStreamPointsDone(size_t numDone)
+{
+  if (numDone > streamSent_) numDone = streamSent_;
+  if (numDone <= streamDone_) return;
+  streamDone_ = numDone;
+  if (streamDone_ - streamReadbackRead_ > streamSize_) {
+    streamReadbackRead_ = streamDone_ - streamSize_;
+    streamOverruns_++;
+  }
+}
+
+/** Prints the state of the streaming profile ring buffer.
+  * \param[in] fp FILE pointer. */
+void asynMotorController::streamReport(FILE *fp)
+{
+  fprintf(fp, "%s: profile stream size=%d, built=%d, executing=%d, end=%d, appended=%lu, sent=%lu, done=%lu, unread=%lu, underruns=%lu, overruns=%lu\n",
+          portName, (int)streamSize_, streamBuilt_, streamExecuting_, streamEnd_,
+          (unsigned long)streamAppended_, (unsigned long)streamSent_, (unsigned long)streamDone_,
+          (unsigned long)(streamDone_ - streamReadbackRead_),
+          (unsigned long)streamUnderruns_, (unsigned long)streamOverruns_);
+}
+
 /** Set the moving poll period (in secs) at runtime.*/
 asynStatus asynMotorController::setMovingPollPeriod(double movingPollPeriod)
 {
@@ -968,6 +2427,225 @@ asynStatus asynMotorEnableMoveToHome(const char *portName, int axis, int distanc
   return asynSuccess;
 }
 
+asynStatus asynMotorEnableHistory(const char *portName, int axis, int numSamples)
+{
+  asynMotorController *pC = NULL;
+  asynMotorAxis *pA = NULL;
+  asynStatus status = asynSuccess;
+  int i;
+  int numFound = 0;
+  static const char *functionName = "asynMotorEnableHistory";
+
+  pC = (asynMotorController*) findAsynPortDriver(portName);
+  if (!pC) {
+    printf("%s:%s: Error port %s not found\n", driverName, functionName, portName);
+    return asynError;
+  }
+  if (numSamples < 0) {
+    printf("%s:%s: Error number of samples must not be negative axis=%d\n", driverName, functionName, axis);
+    return asynError;
+  }
+
+  // axis=-1 enables the history buffer on all axes
+  pC->lock();
+  for (i=0; i<pC->maxAddr; i++) {
+    if ((axis >= 0) && (i != axis)) continue;
+    pA = pC->getAxis(i);
+    if (!pA) continue;
+    numFound++;
+    if (pA->initializeHistory(numSamples)) {
+      printf("%s:%s: Error allocating %d samples for axis %d\n", driverName, functionName, numSamples, i);
+      status = asynError;
+    }
+    pA->callParamCallbacks();
+  }
+  pC->unlock();
+  if (numFound == 0) {
+    printf("%s:%s: Error axis %d not found\n", driverName, functionName, axis);
+    return asynError;
+  }
+
+  return status;
+}
+
+/** Enables streaming profile moves on a controller.
+  * \param[in] portName The controller port name.
+  * \param[in] numPoints Number of points in the ring buffer, 0 to disable streaming.
+  * \param[in] segmentPoints Maximum number of points in one appended segment, 0 to keep the size of the
+  * profile arrays allocated by the driver. */
+asynStatus asynMotorEnableProfileStream(const char *portName, int numPoints, int segmentPoints)
+{
+  asynMotorController *pC = NULL;
+  asynStatus status = asynSuccess;
+  static const char *functionName = "asynMotorEnableProfileStream";
+
+  pC = (asynMotorController*) findAsynPortDriver(portName);
+  if (!pC) {
+    printf("%s:%s: Error port %s not found\n", driverName, functionName, portName);
+    return asynError;
+  }
+  if ((numPoints < 0) || (segmentPoints < 0)) {
+    printf("%s:%s: Error number of points must not be negative\n", driverName, functionName);
+    return asynError;
+  }
+
+  pC->lock();
+  if (segmentPoints > 0) status = pC->initializeProfile(segmentPoints);
+  if (!status) status = pC->initializeStreamProfile(numPoints);
+  pC->unlock();
+  if (status) {
+    printf("%s:%s: Error allocating %d points for port %s\n", driverName, functionName, numPoints, portName);
+  }
+  return status;
+}
+
+asynStatus asynMotorInitConfig(int parallel, double timeout)
+{
+  motorInitParallel = parallel;
+  if (timeout > 0.) motorInitTimeout = timeout;
+  return asynSuccess;
+}
+
+/** Waits for all controllers that have called startInit() to complete their initialization.
+  * This is called automatically at the start of iocInit, and can also be called from the startup script.
+  * \param[in] timeout The maximum total time to wait in seconds, 0 to wait forever. */
+asynStatus asynMotorInitWait(double timeout)
+{
+  motorInitNode *pNode;
+  epicsTimeStamp start, now;
+  double remaining = 0.;
+  double wallTime, sumTime = 0.;
+  int numControllers = 0;
+  asynStatus status = asynSuccess;
+  static const char *functionName = "asynMotorInitWait";
+
+  epicsThreadOnce(&motorInitOnceId, motorInitOnce, NULL);
+  epicsTimeGetCurrent(&start);
+  /* Controllers are only ever added to the list, so it is safe to walk it without the lock */
+  pNode = (motorInitNode *)ellFirst(&motorInitList);
+  while (pNode) {
+    asynMotorController *pC = pNode->pController;
+    if (timeout > 0.) {
+      epicsTimeGetCurrent(&now);
+      remaining = timeout - epicsTimeDiffInSeconds(&now, &start);
+      if (remaining <= 0.) remaining = 0.001;
+    }
+    if (pC->waitInit(remaining)) {
+      printf("%s:%s: Error timeout waiting for port %s to initialize\n", driverName, functionName, pC->portName);
+      status = asynTimeout;
+    }
+    numControllers++;
+    pNode = (motorInitNode *)ellNext((ELLNODE *)pNode);
+  }
+  if (numControllers == 0) return asynSuccess;
+
+  epicsMutexLock(motorInitListLock);
+  wallTime = epicsTimeDiffInSeconds(&motorInitLastDone, &motorInitFirstStart);
+  epicsMutexUnlock(motorInitListLock);
+  pNode = (motorInitNode *)ellFirst(&motorInitList);
+  while (pNode) {
+    asynMotorController *pC = pNode->pController;
+    double initTime;
+    asynStatus initStatus = pC->getInitStatus(&initTime);
+    sumTime += initTime;
+    if (initStatus) {
+      printf("%s:%s: Error port %s initialization failed, status=%d\n", driverName, functionName, pC->portName, initStatus);
+      status = asynError;
+    }
+    pNode = (motorInitNode *)ellNext((ELLNODE *)pNode);
+  }
+  if (status != asynTimeout) {
+    printf("%s:%s: %d controllers initialized in %.3f s, sum of initialization times %.3f s\n",
+           driverName, functionName, numControllers, wallTime, sumTime);
+  }
+  return status;
+}
+
+asynStatus asynMotorInitReport()
+{
+  motorInitNode *pNode;
+
+  epicsThreadOnce(&motorInitOnceId, motorInitOnce, NULL);
+  pNode = (motorInitNode *)ellFirst(&motorInitList);
+  while (pNode) {
+    pNode->pController->initReport(stdout);
+    pNode = (motorInitNode *)ellNext((ELLNODE *)pNode);
+  }
+  return asynSuccess;
+}
+
+/** Sets the size of the shared poller pool.
+  * \param[in] numThreads 0 for one poller thread per controller (the default), or the number of threads
+  * of a pool that is shared by the controllers selected with asynMotorSharedPoller().  A controller that
+  * blocks in its poll only holds one thread of the pool, so the pool should have more threads than
+  * controllers that can block at the same time.  The size of the pool is fixed when the first controller
+  * starts its poller. */
+asynStatus asynMotorPollerConfig(int numThreads)
+{
+  static const char *functionName = "asynMotorPollerConfig";
+
+  if (numThreads < 0) numThreads = 0;
+  if (motorPollFirst && (numThreads != motorPollNumThreads)) {
+    printf("%s:%s: Error the poller pool already has %d threads\n", driverName, functionName, motorPollNumThreads);
+    return asynError;
+  }
+  motorPollNumThreads = numThreads;
+  return asynSuccess;
+}
+
+/** Selects a controller to be polled by the shared poller pool, see asynMotorPollerConfig().
+  * This must be called before the controller is created.  The controllers that are not selected,
+  * and the controllers that reimplement startPoller(), keep a poller thread of their own.
+  * \param[in] portName The name of the asyn port of the controller */
+asynStatus asynMotorSharedPoller(const char *portName)
+{
+  motorPollPort *pPort;
+  static const char *functionName = "asynMotorSharedPoller";
+
+  if (!portName || !portName[0]) {
+    printf("%s:%s: Error a port name is required\n", driverName, functionName);
+    return asynError;
+  }
+  if (findAsynPortDriver(portName)) {
+    printf("%s:%s: Error port %s already exists, call this before creating the controller\n",
+           driverName, functionName, portName);
+    return asynError;
+  }
+  if (motorPollFindPort(portName)) return asynSuccess;
+  pPort = (motorPollPort *) calloc(1, sizeof(motorPollPort));
+  pPort->portName = epicsStrDup(portName);
+  ellAdd(&motorPollPorts, (ELLNODE *)pPort);
+  return asynSuccess;
+}
+
+/** Prints the state of the shared poller pool and the poll latency of each controller in it. */
+asynStatus asynMotorPollerReport()
+{
+  motorPollNode *pNode;
+  motorPollPort *pPort;
+  int busy, queued;
+
+  for (pPort = (motorPollPort *)ellFirst(&motorPollPorts); pPort; pPort = (motorPollPort *)ellNext((ELLNODE *)pPort)) {
+    if (pPort->joined) continue;
+    printf("%s: selected for the shared poller but %s\n", pPort->portName,
+           findAsynPortDriver(pPort->portName) ? "polled by its own thread" : "not created");
+  }
+  if (!motorPollFirst) {
+    printf("No controllers use the shared poller pool\n");
+    return asynSuccess;
+  }
+  epicsMutexLock(motorPollLock);
+  busy = motorPollBusy;
+  queued = ellCount(&motorPollQueue);
+  epicsMutexUnlock(motorPollLock);
+  printf("Shared poller pool: %d threads, %d busy, %d controllers queued\n", motorPollNumThreads, busy, queued);
+  /* Controllers are only ever added at the head of the list, so it is safe to walk it without the lock */
+  for (pNode = motorPollFirst; pNode; pNode = pNode->pNext) {
+    pNode->pController->pollerReport(stdout);
+  }
+  return asynSuccess;
+}
+
 
 /* setMovingPollPeriod */
 static const iocshArg setMovingPollPeriodArg0 = {"Controller port name", iocshArgString};
@@ -1009,11 +2687,113 @@ static void enableMoveToHomeCallFunc(const iocshArgBuf *args)
 }
 
 
+/* asynMotorEnableHistory */
+static const iocshArg asynMotorEnableHistoryArg0 = {"Controller port name", iocshArgString};
+static const iocshArg asynMotorEnableHistoryArg1 = {"Axis number (-1=all)", iocshArgInt};
+static const iocshArg asynMotorEnableHistoryArg2 = {"Number of samples", iocshArgInt};
+static const iocshArg * const asynMotorEnableHistoryArgs[] = {&asynMotorEnableHistoryArg0,
+                                                              &asynMotorEnableHistoryArg1,
+                                                              &asynMotorEnableHistoryArg2};
+static const iocshFuncDef enableHistory = {"asynMotorEnableHistory", 3, asynMotorEnableHistoryArgs};
+
+static void enableHistoryCallFunc(const iocshArgBuf *args)
+{
+  asynMotorEnableHistory(args[0].sval, args[1].ival, args[2].ival);
+}
+
+
+/* asynMotorEnableProfileStream */
+static const iocshArg asynMotorEnableProfileStreamArg0 = {"Controller port name", iocshArgString};
+static const iocshArg asynMotorEnableProfileStreamArg1 = {"Number of points", iocshArgInt};
+static const iocshArg asynMotorEnableProfileStreamArg2 = {"Points per segment", iocshArgInt};
+static const iocshArg * const asynMotorEnableProfileStreamArgs[] = {&asynMotorEnableProfileStreamArg0,
+                                                                    &asynMotorEnableProfileStreamArg1,
+                                                                    &asynMotorEnableProfileStreamArg2};
+static const iocshFuncDef enableProfileStream = {"asynMotorEnableProfileStream", 3, asynMotorEnableProfileStreamArgs};
+
+static void enableProfileStreamCallFunc(const iocshArgBuf *args)
+{
+  asynMotorEnableProfileStream(args[0].sval, args[1].ival, args[2].ival);
+}
+
+
+/* asynMotorInitConfig */
+static const iocshArg asynMotorInitConfigArg0 = {"Parallel initialization", iocshArgInt};
+static const iocshArg asynMotorInitConfigArg1 = {"Timeout at iocInit", iocshArgDouble};
+static const iocshArg * const asynMotorInitConfigArgs[] = {&asynMotorInitConfigArg0,
+                                                           &asynMotorInitConfigArg1};
+static const iocshFuncDef initConfig = {"asynMotorInitConfig", 2, asynMotorInitConfigArgs};
+
+static void initConfigCallFunc(const iocshArgBuf *args)
+{
+  asynMotorInitConfig(args[0].ival, args[1].dval);
+}
+
+
+/* asynMotorInitWait */
+static const iocshArg asynMotorInitWaitArg0 = {"Timeout", iocshArgDouble};
+static const iocshArg * const asynMotorInitWaitArgs[] = {&asynMotorInitWaitArg0};
+static const iocshFuncDef initWait = {"asynMotorInitWait", 1, asynMotorInitWaitArgs};
+
+static void initWaitCallFunc(const iocshArgBuf *args)
+{
+  asynMotorInitWait(args[0].dval);
+}
+
+
+/* asynMotorInitReport */
+static const iocshFuncDef initReport = {"asynMotorInitReport", 0, NULL};
+
+static void initReportCallFunc(const iocshArgBuf *args)
+{
+  asynMotorInitReport();
+}
+
+
+/* asynMotorPollerConfig */
+static const iocshArg asynMotorPollerConfigArg0 = {"Number of threads (0=one per controller)", iocshArgInt};
+static const iocshArg * const asynMotorPollerConfigArgs[] = {&asynMotorPollerConfigArg0};
+static const iocshFuncDef pollerConfig = {"asynMotorPollerConfig", 1, asynMotorPollerConfigArgs};
+
+static void pollerConfigCallFunc(const iocshArgBuf *args)
+{
+  asynMotorPollerConfig(args[0].ival);
+}
+
+
+/* asynMotorSharedPoller */
+static const iocshArg asynMotorSharedPollerArg0 = {"Controller port name", iocshArgString};
+static const iocshArg * const asynMotorSharedPollerArgs[] = {&asynMotorSharedPollerArg0};
+static const iocshFuncDef sharedPoller = {"asynMotorSharedPoller", 1, asynMotorSharedPollerArgs};
+
+static void sharedPollerCallFunc(const iocshArgBuf *args)
+{
+  asynMotorSharedPoller(args[0].sval);
+}
+
+
+/* asynMotorPollerReport */
+static const iocshFuncDef pollerReport = {"asynMotorPollerReport", 0, NULL};
+
+static void pollerReportCallFunc(const iocshArgBuf *args)
+{
+  asynMotorPollerReport();
+}
+
+
 static void asynMotorControllerRegister(void)
 {
   iocshRegister(&setMovingPollPeriodDef, setMovingPollPeriodCallFunc);
   iocshRegister(&setIdlePollPeriodDef, setIdlePollPeriodCallFunc);
   iocshRegister(&enableMoveToHome, enableMoveToHomeCallFunc);
+  iocshRegister(&enableHistory, enableHistoryCallFunc);
+  iocshRegister(&enableProfileStream, enableProfileStreamCallFunc);
+  iocshRegister(&initConfig, initConfigCallFunc);
+  iocshRegister(&initWait, initWaitCallFunc);
+  iocshRegister(&initReport, initReportCallFunc);
+  iocshRegister(&pollerConfig, pollerConfigCallFunc);
+  iocshRegister(&sharedPoller, sharedPollerCallFunc);
+  iocshRegister(&pollerReport, pollerReportCallFunc);
 }
 epicsExportRegistrar(asynMotorControllerRegister);
 
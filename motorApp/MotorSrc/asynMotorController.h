@@ -13,6 +13,8 @@
 
 #define MAX_CONTROLLER_STRING_SIZE 256
 #define DEFAULT_CONTROLLER_TIMEOUT 2.0
+#define MAX_BURST_COMMANDS 16
+#define MAX_BURST_STRING_SIZE 80
 
 /** Strings defining parameters for the driver. 
   * These are the values passed to drvUserCreate. 
@@ -61,6 +63,9 @@
 #define motorStatusLowLimitString       "MOTOR_STATUS_LOW_LIMIT"
 #define motorStatusHomedString          "MOTOR_STATUS_HOMED"
 
+/* This is a per-controller parameter to stop all axes with one command */
+#define motorStopAllString              "MOTOR_STOP_ALL"
+
 /* These are per-axis parameters for passing additional motor record information to the driver */
 #define motorRecResolutionString        "MOTOR_REC_RESOLUTION"
 #define motorRecDirectionString         "MOTOR_REC_DIRECTION"
@@ -94,12 +99,39 @@
 #define profileReadbackStatusString     "PROFILE_READBACK_STATUS"
 #define profileReadbackMessageString    "PROFILE_READBACK_MESSAGE"
 
+/* These are the per-controller parameters for streaming profile moves, see initializeStreamProfile() */
+#define profileStreamString             "PROFILE_STREAM"
+#define profileStreamSizeString         "PROFILE_STREAM_SIZE"
+#define profileAppendString             "PROFILE_APPEND"
+#define profileStreamEndString          "PROFILE_STREAM_END"
+#define profileStreamLowWaterString     "PROFILE_STREAM_LOW_WATER"
+#define profileStreamHighWaterString    "PROFILE_STREAM_HIGH_WATER"
+#define profileStreamRefillString       "PROFILE_STREAM_REFILL"
+#define profileStreamFreeString         "PROFILE_STREAM_FREE"
+#define profileStreamAppendedString     "PROFILE_STREAM_APPENDED"
+#define profileStreamSentString         "PROFILE_STREAM_SENT"
+#define profileStreamUnderrunsString    "PROFILE_STREAM_UNDERRUNS"
+#define profileStreamUnreadString       "PROFILE_STREAM_UNREAD"
+#define profileStreamReadbackFirstString "PROFILE_STREAM_READBACK_FIRST"
+#define profileStreamOverrunsString     "PROFILE_STREAM_OVERRUNS"
+
 /* These are the per-axis parameters for profile moves */
 #define profileUseAxisString            "PROFILE_USE_AXIS"
 #define profilePositionsString          "PROFILE_POSITIONS"
 #define profileReadbacksString          "PROFILE_READBACKS"
 #define profileFollowingErrorsString    "PROFILE_FOLLOWING_ERRORS"
 
+/* These are the per-axis parameters for the position history buffer */
+#define motorHistoryNumSamplesString    "MOTOR_HISTORY_NUM_SAMPLES"
+#define motorHistoryOverrunsString      "MOTOR_HISTORY_OVERRUNS"
+#define motorHistoryReadString          "MOTOR_HISTORY_READ"
+#define motorHistoryNumReadString       "MOTOR_HISTORY_NUM_READ"
+#define motorHistoryTimesString         "MOTOR_HISTORY_TIMES"
+#define motorHistoryPositionsString     "MOTOR_HISTORY_POSITIONS"
+#define motorHistoryEncodersString      "MOTOR_HISTORY_ENCODERS"
+#define motorHistoryVelocitiesString    "MOTOR_HISTORY_VELOCITIES"
+#define motorHistoryStatusString        "MOTOR_HISTORY_STATUS"
+
 /** The structure that is passed back to devMotorAsyn when the status changes. */
 typedef struct MotorStatus {
   double position;           /**< Commanded motor position */
@@ -108,6 +140,15 @@ typedef struct MotorStatus {
   epicsUInt32 status;        /**< Word containing status bits (motion done, limits, etc.) */
 } MotorStatus;
 
+/** One sample in the per-axis position history buffer. */
+typedef struct MotorHistorySample {
+  double time;               /**< Time of the sample, seconds past the EPICS epoch */
+  double position;           /**< Commanded motor position */
+  double encoderPosition;    /**< Actual encoder position */
+  double velocity;           /**< Velocity computed from successive samples */
+  epicsUInt32 status;        /**< Word containing status bits (motion done, limits, etc.) */
+} MotorHistorySample;
+
 enum ProfileTimeMode{
   PROFILE_TIME_MODE_FIXED,
   PROFILE_TIME_MODE_ARRAY
@@ -147,10 +188,63 @@ enum ProfileStatus {
   PROFILE_STATUS_TIMEOUT
 };
 
+/* States of the controller initialization, see asynMotorController::startInit() */
+enum MotorInitState {
+  MOTOR_INIT_NONE,
+  MOTOR_INIT_PENDING,
+  MOTOR_INIT_DONE
+};
+
 #ifdef __cplusplus
+#include <stdarg.h>
 #include <asynPortDriver.h>
+#include <epicsTime.h>
+#include <epicsMutex.h>
+#include <epicsStdio.h>
+
+#include "asynMotorCommandStats.h"
 
 class asynMotorAxis;
+struct motorPollNode;
+
+/** A move collected by the base class while moves are deferred. */
+typedef struct MotorDeferredMove {
+  asynMotorAxis *pAxis;      /**< Axis to move */
+  double position;           /**< Absolute position (if relative=0) or distance (if relative=1). Units=steps */
+  int relative;              /**< Flag indicating relative move (1) or absolute move (0) */
+  double minVelocity;        /**< Base velocity. Units=steps/sec */
+  double maxVelocity;        /**< Slew velocity. Units=steps/sec */
+  double acceleration;       /**< Acceleration. Units=steps/sec/sec */
+} MotorDeferredMove;
+
+/** One command of a burst written with asynMotorController::writeReadBurst(). */
+typedef struct MotorBurstCommand {
+  const char *output;        /**< Command to write, without the output terminator */
+  char *input;               /**< Buffer for the reply, NULL if the command has no reply */
+  size_t maxInput;           /**< Size of the reply buffer */
+  size_t nread;              /**< Number of characters read */
+  asynStatus status;         /**< Status of this command */
+} MotorBurstCommand;
+
+/** A burst of commands with its own command and reply buffers, so that polling several values
+  * does not go through the shared outString_ and inString_ of the controller. */
+class epicsShareClass asynMotorBurst {
+  public:
+  asynMotorBurst();
+  void clear();
+  int add(const char *format, ...) EPICS_PRINTF_STYLE(2,3);
+  int addWrite(const char *format, ...) EPICS_PRINTF_STYLE(2,3);
+  const char *reply(int index);
+  asynStatus status(int index);
+
+  int numCommands_;                                     /**< Number of commands in the burst */
+  MotorBurstCommand commands_[MAX_BURST_COMMANDS];      /**< The commands, in the order they are written */
+
+  private:
+  int addCommand(bool hasReply, const char *format, va_list args);
+  char outputs_[MAX_BURST_COMMANDS][MAX_BURST_STRING_SIZE];
+  char inputs_[MAX_BURST_COMMANDS][MAX_BURST_STRING_SIZE];
+};
 
 class epicsShareClass asynMotorController : public asynPortDriver {
 
@@ -168,6 +262,8 @@ class epicsShareClass asynMotorController : public asynPortDriver {
   virtual asynStatus writeFloat64Array(asynUser *pasynUser, epicsFloat64 *value, size_t nElements);
   virtual asynStatus readFloat64Array(asynUser *pasynUser, epicsFloat64 *value, size_t nElements, size_t *nRead);
   virtual asynStatus readGenericPointer(asynUser *pasynUser, void *pointer);
+  virtual asynStatus setDoubleParam(int function, double value);
+  virtual asynStatus setDoubleParam(int list, int function, double value);
   virtual void report(FILE *fp, int details);
 
   /* These are the methods that are new to this class */
@@ -177,7 +273,10 @@ class epicsShareClass asynMotorController : public asynPortDriver {
   virtual asynStatus wakeupPoller();
   virtual asynStatus poll();
   virtual asynStatus setDeferredMoves(bool defer);
+  virtual asynStatus startDeferredMoves(MotorDeferredMove *moves, int numMoves);
+  virtual asynStatus stopAllAxes();
   void asynMotorPoller();  // This should be private but is called from C function
+  double pollOnce(bool wokenUp);  // This should be private but is called from C function
   
   /* Functions to deal with moveToHome.*/
   virtual asynStatus startMoveToHomeThread();
@@ -189,10 +288,32 @@ class epicsShareClass asynMotorController : public asynPortDriver {
   virtual asynStatus executeProfile();
   virtual asynStatus abortProfile();
   virtual asynStatus readbackProfile();
+
+  /* These are the functions for streaming profile moves.
+   * Drivers that support streaming implement the segment-level hooks buildStreamProfile(),
+   * appendStreamSegment(), executeStreamProfile() and abortStreamProfile(), and report progress
+   * with setStreamReadback() and setStreamPointsDone() */
+  virtual asynStatus initializeStreamProfile(size_t maxPoints);
+  virtual asynStatus buildStreamProfile(char *message);
+  virtual asynStatus appendStreamSegment(size_t firstPoint, size_t numPoints, size_t *numAccepted, char *message);
+  virtual asynStatus executeStreamProfile(char *message);
+  virtual asynStatus abortStreamProfile();
+  void pollStreamProfile();
   
   virtual asynStatus setMovingPollPeriod(double movingPollPeriod);
   virtual asynStatus setIdlePollPeriod(double idlePollPeriod);
 
+  /* These are the functions for deferred controller initialization */
+  virtual asynStatus init();
+  virtual asynStatus initAxis(int axisNo);
+  asynStatus startInit();
+  asynStatus waitInit(double timeout);
+  int getInitState();
+  asynStatus getInitStatus(double *initTime);
+  void initReport(FILE *fp);
+  void pollerReport(FILE *fp);
+  void asynMotorInitTask();  // This should be private but is called from C function
+
   int shuttingDown_;   /**< Flag indicating that IOC is shutting down.  Stops poller */
 
   protected:
@@ -245,6 +366,9 @@ class epicsShareClass asynMotorController : public asynPortDriver {
   int motorStatusLowLimit_;
   int motorStatusHomed_;
 
+  // This is a per-controller parameter to stop all axes
+  int motorStopAll_;
+
   // These are per-axis parameters for passing additional motor record information to the driver
   int motorRecResolution_;
   int motorRecDirection_;
@@ -278,12 +402,39 @@ class epicsShareClass asynMotorController : public asynPortDriver {
   int profileReadbackStatus_;
   int profileReadbackMessage_;
 
+  // These are the per-controller parameters for streaming profile moves
+  int profileStream_;
+  int profileStreamSize_;
+  int profileAppend_;
+  int profileStreamEnd_;
+  int profileStreamLowWater_;
+  int profileStreamHighWater_;
+  int profileStreamRefill_;
+  int profileStreamFree_;
+  int profileStreamAppended_;
+  int profileStreamSent_;
+  int profileStreamUnderruns_;
+  int profileStreamUnread_;
+  int profileStreamReadbackFirst_;
+  int profileStreamOverruns_;
+
   // These are the per-axis parameters for profile moves
   int profileUseAxis_;
   int profilePositions_;
   int profileReadbacks_;
   int profileFollowingErrors_;
-  #define LAST_MOTOR_PARAM profileFollowingErrors_
+
+  // These are the per-axis parameters for the position history buffer
+  int motorHistoryNumSamples_;
+  int motorHistoryOverruns_;
+  int motorHistoryRead_;
+  int motorHistoryNumRead_;
+  int motorHistoryTimes_;
+  int motorHistoryPositions_;
+  int motorHistoryEncoders_;
+  int motorHistoryVelocities_;
+  int motorHistoryStatus_;
+  #define LAST_MOTOR_PARAM motorHistoryStatus_
 
   int numAxes_;                 /**< Number of axes this controller supports */
   asynMotorAxis **pAxes_;       /**< Array of pointers to axis objects */
@@ -292,21 +443,85 @@ class epicsShareClass asynMotorController : public asynPortDriver {
   double idlePollPeriod_;       /**< The time between polls when no axes are moving */
   double movingPollPeriod_;     /**< The time between polls when any axis is moving */
   int    forcedFastPolls_;      /**< The number of forced fast polls when the poller wakes up */
+  int    forcedFastPollsLeft_;  /**< The number of forced fast polls still to be done */
+  struct motorPollNode *pollNode_; /**< Entry in the shared poller pool, NULL if polled by its own thread */
  
   size_t maxProfilePoints_;     /**< Maximum number of profile points */
   double *profileTimes_;        /**< Array of times per profile point */
 
   int moveToHomeAxis_;
 
+  /* These are used by the base class implementation of streaming profile moves.
+   * Points are numbered from 0 at buildProfile(); point n is stored at n % streamSize_ */
+  asynStatus streamBuild();
+  asynStatus streamAppend();
+  asynStatus streamExecute();
+  asynStatus streamAbort();
+  asynStatus streamReadback();
+  void streamDone(int status, const char *message);
+  void streamReport(FILE *fp);
+  double streamTime(size_t point);
+  double streamPosition(int axis, size_t point);
+  bool streamUsesAxis(int axis);
+  void setStreamReadback(int axis, size_t point, double readback, double followingError);
+  void setStreamPointsDone(size_t numDone);
+  size_t streamSize_;           /**< Number of points in the ring buffer, 0 if streaming is disabled */
+  double *streamTimes_;         /**< Ring buffer of the times of the points */
+  bool streamBuilt_;            /**< buildProfile() succeeded in streaming mode */
+  bool streamExecuting_;        /**< The streaming profile is executing */
+  bool streamEnd_;              /**< The client has appended the last segment */
+  bool streamRefill_;           /**< The client has been asked to append more segments */
+  size_t streamAppended_;       /**< Number of points appended by the client */
+  size_t streamSent_;           /**< Number of points accepted by appendStreamSegment() */
+  size_t streamDone_;           /**< Number of points executed by the controller */
+  size_t streamReadbackRead_;   /**< Number of points whose readbacks were read or discarded */
+  size_t streamUnderruns_;      /**< Number of streams stopped because the client did not append in time */
+  size_t streamOverruns_;       /**< Number of readbacks overwritten before they were read */
+
+  /* These are used by the base class implementation of deferred moves */
+  asynStatus deferMove(asynMotorAxis *pAxis, double position, int relative,
+                       double minVelocity, double maxVelocity, double acceleration);
+  void cancelDeferredMove(asynMotorAxis *pAxis);
+  bool deferringMoves_;                /**< Moves are being collected until setDeferredMoves(false) */
+  MotorDeferredMove *deferredMoves_;   /**< Moves collected while deferringMoves_ is true */
+  int numDeferredMoves_;               /**< Number of moves in deferredMoves_ */
+
+  /* These are used by the deferred initialization, see startInit() */
+  epicsEventId initEventId_;    /**< Event ID signalled when init() and initAxis() have completed */
+  epicsMutexId initLock_;       /**< Protects initState_, initStatus_ and the times, the port lock is released between the steps */
+  int initState_;               /**< One of the MotorInitState values */
+  asynStatus initStatus_;       /**< Status returned by init(), or the first error from initAxis() */
+  epicsTimeStamp createTime_;   /**< Time at which the constructor was entered */
+  double constructTime_;        /**< Seconds from entering the constructor to startInit() */
+  double initLockTime_;         /**< Seconds the init thread waited for the port lock */
+  double initTime_;             /**< Seconds spent in init() */
+  double initAxisTime_;         /**< Total seconds spent in initAxis() for all axes */
+  double initAxisMaxTime_;      /**< Longest time spent in initAxis() for one axis */
+  int initAxisMaxAxis_;         /**< Axis for which initAxisMaxTime_ was measured */
+
   /* These are convenience functions for controllers that use asynOctet interfaces to the hardware */
   asynStatus writeController();
   asynStatus writeController(const char *output, double timeout);
   asynStatus writeReadController();
   asynStatus writeReadController(const char *output, char *response, size_t maxResponseLen, size_t *responseLen, double timeout);
+  asynStatus writeReadBurst(asynMotorBurst *pBurst, double timeout=DEFAULT_CONTROLLER_TIMEOUT);
+  asynStatus writeReadBurst(MotorBurstCommand *commands, int numCommands, double timeout);
+  void setBurstPipelining(bool pipelining);
   asynUser *pasynUserController_;
   char outString_[MAX_CONTROLLER_STRING_SIZE];
   char inString_[MAX_CONTROLLER_STRING_SIZE];
 
+  /* These are the command timing statistics printed by report() */
+  void addCommandTime(const char *output, double elapsed);
+  void commandReport(FILE *fp);
+  bool burstPipelining_;               /**< Bursts write all commands before reading the replies */
+  asynMotorCommandStats commandStats_; /**< Timing per command mnemonic */
+  epicsMutexId commandStatsMutex_;     /**< Protects the burst statistics below */
+  unsigned long numBursts_;            /**< Number of calls to writeReadBurst() */
+  unsigned long numBurstCommands_;     /**< Total number of commands written in bursts */
+  double burstTotalTime_;              /**< Total time spent in writeReadBurst() */
+  double burstMaxTime_;                /**< Longest time spent in one writeReadBurst() */
+
   friend class asynMotorAxis;
 };
 #define NUM_MOTOR_DRIVER_PARAMS (&LAST_MOTOR_PARAM - &FIRST_MOTOR_PARAM + 1)
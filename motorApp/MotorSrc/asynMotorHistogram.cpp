@@ -0,0 +1,51 @@
+/* asynMotorHistogram.cpp
+ *
+ * This file implements a histogram of durations with bins of powers of two milliseconds,
+ * used by drivers to report e.g. poll times or interrupt latencies.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#define epicsExportSharedSymbols
+#include <shareLib.h>
+#include "asynMotorHistogram.h"
+
+/** Creates an empty histogram. */
+asynMotorHistogram::asynMotorHistogram()
+{
+  clear();
+}
+
+/** Enters a duration into the histogram.
+  * \param[in] seconds The duration in seconds. */
+void asynMotorHistogram::add(double seconds)
+{
+  int bin;
+
+  for (bin=0; (bin < MOTOR_HISTOGRAM_BINS - 1) && (seconds >= 0.001 * (1 << bin)); bin++);
+  bins_[bin]++;
+  count_++;
+  if (seconds > maxTime_) maxTime_ = seconds;
+}
+
+/** Removes all entries from the histogram. */
+void asynMotorHistogram::clear()
+{
+  memset(bins_, 0, sizeof(bins_));
+  count_ = 0;
+  maxTime_ = 0.;
+}
+
+/** Prints the bins on one line, e.g. "  latency (ms): <1:10 <2:3 ... >=1024:0".
+  * \param[in] fp File pointer passed by caller where information is written to.
+  * \param[in] name The name printed in front of the bins. */
+void asynMotorHistogram::report(FILE *fp, const char *name)
+{
+  int bin;
+
+  fprintf(fp, "  %s (ms):", name);
+  for (bin=0; bin < MOTOR_HISTOGRAM_BINS; bin++)
+    fprintf(fp, " %s%d:%lu", (bin == MOTOR_HISTOGRAM_BINS - 1) ? ">=" : "<",
+            (bin == MOTOR_HISTOGRAM_BINS - 1) ? (1 << (bin - 1)) : (1 << bin), bins_[bin]);
+  fprintf(fp, "\n");
+}
@@ -0,0 +1,34 @@
+/* asynMotorHistogram.h
+ *
+ * This file defines a histogram of durations with bins of powers of two milliseconds,
+ * used by drivers to report e.g. poll times or interrupt latencies.
+ */
+#ifndef asynMotorHistogram_H
+#define asynMotorHistogram_H
+
+#include <stdio.h>
+#include <shareLib.h>
+
+/** Number of bins: <1ms, <2ms, <4ms ... >=1024ms */
+#define MOTOR_HISTOGRAM_BINS 12
+
+#ifdef __cplusplus
+
+/** Histogram of durations, with the number of entries and the maximum. */
+class epicsShareClass asynMotorHistogram {
+  public:
+  asynMotorHistogram();
+  void add(double seconds);
+  void clear();
+  void report(FILE *fp, const char *name);
+  unsigned long count() {return count_;};
+  double maxTime() {return maxTime_;};
+
+  private:
+  unsigned long bins_[MOTOR_HISTOGRAM_BINS];  /**< Bin n counts durations < 2^n ms, the last bin the rest */
+  unsigned long count_;                       /**< Number of durations entered */
+  double maxTime_;                            /**< Longest duration entered, seconds */
+};
+
+#endif /* __cplusplus */
+#endif /* asynMotorHistogram_H */
@@ -48,6 +48,10 @@ USAGE...        This file contains driver functions that are common
  *                  messages.
  * .07 11/30/12 rls In process_messages(), pass commanded velocity from
  *                  motor_info->velocity to node->velocity with INFO request.
+ * .08 10/19/26     For drivers with isr_pending_used, query the axes flagged
+ *                  by the ISR immediately, without waiting for the next scan.
+ *                  Flagged axes still inside the stale data delay are flagged
+ *                  again, and queried after the delay.
  */
 
 
@@ -55,6 +59,7 @@ USAGE...        This file contains driver functions that are common
 #include        <string.h>
 #include        <callback.h>
 #include        <epicsThread.h>
+#include        <epicsInterrupt.h>
 #include        <epicsExport.h>
 
 #include        "motor.h"
@@ -79,7 +84,9 @@ static inline void Debug(int level, const char *format, ...) {
 }
 
 /* Function declarations. */
-static double query_axis(int, struct driver_table *, epicsTime, double);
+static double query_axis(int, struct driver_table *, epicsTime, double, epicsUInt32);
+static epicsUInt32 get_isr_pending(struct controller *);
+static void put_isr_pending(struct controller *, epicsUInt32);
 static void process_messages(struct driver_table *, epicsTime, double);
 static struct mess_node *get_head_node(struct driver_table *);
 static struct mess_node *motor_malloc(struct circ_queue *, epicsEvent *);
@@ -109,16 +116,23 @@ static struct mess_node *motor_malloc(struct circ_queue *, epicsEvent *);
  *      IF wait_time nonzero.
  *          Pend on semaphore with "wait_time" timeout argument.
  *      ENDIF
- *      Update "previous_time".
- *      IF the "any_motor_in_motion" indicator is true.
- *          IF VME58 instance of this task.
- *              Start data area update on all cards - Call start_status().
- *          ENDIF
- *          FOR each OMS board.
- *              IF motor data structure defined, AND, motor-in-motion indicator true.
- *                  Update OMS board status - call query_axis().
- *              ENDIF
+ *      IF the ISR flagged axes (isr_pending), AND, the scan time has not lapsed.
+ *          FOR each OMS board with flagged axes in motion.
+ *              Start data area update on this card - Call start_status().
+ *              Update status of the flagged axes only - call query_axis().
  *          ENDFOR
+ *      ELSE
+ *          Update "previous_time".
+ *          IF the "any_motor_in_motion" indicator is true.
+ *              IF VME58 instance of this task.
+ *                  Start data area update on all cards - Call start_status().
+ *              ENDIF
+ *              FOR each OMS board.
+ *                  IF motor data structure defined, AND, motor-in-motion indicator true.
+ *                      Update OMS board status - call query_axis().
+ *                  ENDIF
+ *              ENDFOR
+ *          ENDIF
  *      ENDIF
  *      Process commands - call process_messages().
  *  ENDWHILE
@@ -133,6 +147,8 @@ epicsShareFunc int motor_task(struct thread_args *args)
     bool sem_ret;
     epicsTime previous_time, current_time;
     double scan_sec, wait_time, time_lapse, stale_data_max_delay, stale_data_delay = 0.0;
+    double delay;
+    bool isr_wakeup;
     const double quantum = epicsThreadSleepQuantum();
     double half_quantum;
     int itera;
@@ -177,9 +193,37 @@ epicsShareFunc int motor_task(struct thread_args *args)
 
         if (wait_time != 0.0)
             sem_ret = tabptr->semptr->wait(wait_time);
-        previous_time = epicsTime::getCurrent();
+        current_time = epicsTime::getCurrent();
+
+        /* Interrupt wakeup before the scan time; query only the flagged axes. */
+        isr_wakeup = false;
+        if (tabptr->isr_pending_used && *tabptr->any_inmotion_ptr &&
+            (current_time - previous_time) < (scan_sec - half_quantum))
+        {
+            for (itera = 0; itera < *tabptr->cardcnt_ptr; itera++)
+            {
+                struct controller *brdptr = (*tabptr->card_array)[itera];
+                epicsUInt32 pending;
+
+                if (brdptr == NULL || brdptr->motor_in_motion == 0)
+                    continue;
+                pending = get_isr_pending(brdptr);
+                if (pending == 0)
+                    continue;
+                Debug(5, "motor_task: card %d ISR pending axes 0x%x\n", itera, pending);
+                isr_wakeup = true;
+                if (tabptr->strtstat != NULL)
+                    (*tabptr->strtstat) (itera);
+                delay = query_axis(itera, tabptr, current_time, stale_data_max_delay, pending);
+                if (delay > stale_data_delay)
+                    stale_data_delay = delay;
+            }
+        }
+
+        if (isr_wakeup == false)
+            previous_time = current_time;
 
-        if (*tabptr->any_inmotion_ptr)
+        if (isr_wakeup == false && *tabptr->any_inmotion_ptr)
         {
             if (tabptr->strtstat != NULL)
                 (*tabptr->strtstat) (ALL_CARDS);        /* Start data area update on motor cards */
@@ -187,8 +231,10 @@ epicsShareFunc int motor_task(struct thread_args *args)
             for (itera = 0; itera < *tabptr->cardcnt_ptr; itera++)
             {
                 struct controller *brdptr = (*tabptr->card_array)[itera];
+                if (brdptr != NULL && tabptr->isr_pending_used)
+                    get_isr_pending(brdptr);    /* Full scan covers them. */
                 if (brdptr != NULL && brdptr->motor_in_motion)
-                    stale_data_delay = query_axis(itera, tabptr, previous_time, stale_data_max_delay);
+                    stale_data_delay = query_axis(itera, tabptr, previous_time, stale_data_max_delay, ALL_AXES);
             }
         }
         process_messages(tabptr, previous_time, stale_data_max_delay);
@@ -197,11 +243,43 @@ epicsShareFunc int motor_task(struct thread_args *args)
 }
 
 
+/*
+ * Take and clear the axes flagged by the ISR; interrupts are locked out, since
+ * the ISR sets isr_pending asynchronously.
+ */
+static epicsUInt32 get_isr_pending(struct controller *brdptr)
+{
+    epicsUInt32 pending;
+    int key;
+
+    key = epicsInterruptLock();
+    pending = brdptr->isr_pending;
+    brdptr->isr_pending = 0;
+    epicsInterruptUnlock(key);
+    return(pending);
+}
+
+
+/*
+ * Flag axes again that were taken by get_isr_pending() but could not be
+ * queried yet.
+ */
+static void put_isr_pending(struct controller *brdptr, epicsUInt32 axes)
+{
+    int key;
+
+    key = epicsInterruptLock();
+    brdptr->isr_pending |= axes;
+    epicsInterruptUnlock(key);
+}
+
+
 static double query_axis(int card, struct driver_table *tabptr, epicsTime tick,
-                         double max_delay)
+                         double max_delay, epicsUInt32 axes)
 {
     struct controller *brdptr;
     double rtndelay = 0.0;
+    epicsUInt32 skipped = 0;
     int index;
 
     Debug(5, "query_axis: enter\n");
@@ -214,6 +292,9 @@ static double query_axis(int card, struct driver_table *tabptr, epicsTime tick,
         register struct mess_node *motor_motion;
         double delay = 0.0;
 
+        if ((axes & (1UL << index)) == 0)
+            continue;
+
         motor_info = &(brdptr->motor_info[index]);
         motor_motion = motor_info->motor_motion;
         if (motor_motion != 0)
@@ -228,6 +309,7 @@ static double query_axis(int card, struct driver_table *tabptr, epicsTime tick,
                 delay = max_delay - delay;
                 if (delay > rtndelay)
                     rtndelay = delay;
+                skipped |= (1UL << index);
             }
             else if ((*tabptr->setstat) (card, index))
             {
@@ -284,6 +366,10 @@ static double query_axis(int card, struct driver_table *tabptr, epicsTime tick,
             }
         }
     }
+    /* An ISR flagged axis inside the stale data delay is queried after the
+     * delay, otherwise its interrupt would wait for the next full scan. */
+    if (axes != ALL_AXES && skipped != 0)
+        put_isr_pending(brdptr, skipped);
     Debug(5, "query_axis: exit\n");
     return(rtndelay);
 }
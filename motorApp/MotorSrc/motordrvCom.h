@@ -39,6 +39,8 @@ USAGE...	This file contains definitions and structures that
  * .04 09-20-04 rls support for 32 axes / controller, maximum.
  * .05 05/10/05 rls Added "update_delay" for "Stale data delay" bug fix.
  * .06 10/18/05 rls Added MAX_TIMEOUT for all devices drivers.
+ * .07 10/19/26     Added isr_pending axes to controller and isr_pending_used
+ *                  to driver_table for interrupt driven status updates.
  */
 
 
@@ -95,6 +97,7 @@ enum msg_types {
 
 /* Misc. defines. */
 #define ALL_CARDS -1
+#define ALL_AXES  0xFFFFFFFF	/* query_axis() mask of all axes. */
 
 #define	FLUSH -1 /* The 3rd argument of driver_table's getmsg() can indicate
 		either FLUSH the buffer or the # of commands to process. */
@@ -174,6 +177,8 @@ struct controller	/* Controller board information. */
     bool cmnd_response; /* Indicates controller communication response
 	    * to VELOCITY, MOTION and MOVE_TERM type commands. */
     void *DevicePrivate; /* Pointer to device specific structure. */
+    volatile epicsUInt32 isr_pending; /* Axes with done/overtravel interrupts
+	    * not yet queried; set by the ISR, cleared by motor_task(). */
     struct mess_info motor_info[MAX_AXIS];
 };
 
@@ -203,6 +208,7 @@ struct driver_table
     void (*strtstat) (int);			/* Optional; start status function or NULL. */
     const bool *const init_indicator;		/* Driver initialized indicator. */
     char **axis_names;				/* Axis name array or NULL. */
+    bool isr_pending_used;			/* ISR sets controller isr_pending. */
 };
 
 
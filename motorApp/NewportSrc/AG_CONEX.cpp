@@ -53,6 +53,8 @@ AG_CONEXController::AG_CONEXController(const char *portName, const char *serialP
   asynStatus status;
   static const char *functionName = "AG_CONEXController::AG_CONEXController";
 
+  bus_ = NewportBus::find(serialPortName);
+
   /* Connect to CONEX controller */
   status = pasynOctetSyncIO->connect(serialPortName, 0, &pasynUserController_, NULL);
   if (status) {
@@ -139,6 +141,7 @@ void AG_CONEXController::report(FILE *fp, int level)
   fprintf(fp, "CONEX motor driver %s, controllerID=%d, version=\"%s\n"
               "  moving poll period=%f, idle poll period=%f\n", 
     this->portName, controllerID_, controllerVersion_, movingPollPeriod_, idlePollPeriod_);
+  bus_->report(fp, level);
 
   // Call the base class method
   asynMotorController::report(fp, level);
@@ -316,6 +319,7 @@ asynStatus AG_CONEXAxis::move(double position, int relative, double minVelocity,
     sprintf(pC_->outString_, "%dPA%f", pC_->controllerID_, position*stepSize_);
   }
   status = pC_->writeCONEX();
+  pC_->bus_->setMoving(pC_->controllerID_);
   return status;
 }
 
@@ -343,6 +347,7 @@ asynStatus AG_CONEXAxis::home(double minVelocity, double maxVelocity, double acc
 
   sprintf(pC_->outString_, "%dOR", pC_->controllerID_);
   status = pC_->writeCONEX();
+  pC_->bus_->setMoving(pC_->controllerID_);
   return status;
 }
 
@@ -358,6 +363,7 @@ asynStatus AG_CONEXAxis::moveVelocity(double minVelocity, double maxVelocity, do
   
   sprintf(pC_->outString_, "%dPA%f", pC_->controllerID_, position);
   status = pC_->writeCONEX();
+  pC_->bus_->setMoving(pC_->controllerID_);
   return status;
 }
 
@@ -464,6 +470,8 @@ asynStatus AG_CONEXAxis::setDGain(double dGain)
   * and the drive power-on status. 
   * It calls setIntegerParam() and setDoubleParam() for each item that it polls,
   * and then calls callParamCallbacks() at the end.
+  * The scheduler of the serial chain decides whether the controller is polled in this cycle,
+  * a skipped controller keeps its last status.
   * \param[out] moving A flag that is set indicating that the axis is moving (true) or done (false). */
 asynStatus AG_CONEXAxis::poll(bool *moving)
 { 
@@ -474,11 +482,19 @@ asynStatus AG_CONEXAxis::poll(bool *moving)
   int highLimit=0, lowLimit=0;
   int count;
   bool closedLoop;
+  double timeout;
+  size_t nread;
   asynStatus comStatus;
 
+  if (!pC_->bus_->startPoll(pC_->controllerID_, &timeout)) {
+    *moving = pC_->bus_->isMoving(pC_->controllerID_);
+    return asynSuccess;
+  }
+  *moving = false;
+
   // Read the current motor position
   sprintf(pC_->outString_, "%dTP", pC_->controllerID_);
-  comStatus = pC_->writeReadController();
+  comStatus = pC_->writeReadController(pC_->outString_, pC_->inString_, sizeof(pC_->inString_), &nread, timeout);
   if (comStatus) goto skip;
   // The response string is of the form "1TPxxx"
   position = atof(&pC_->inString_[3]);
@@ -487,7 +503,7 @@ asynStatus AG_CONEXAxis::poll(bool *moving)
 
   // Read the moving status of this motor
   sprintf(pC_->outString_, "%dTS", pC_->controllerID_);
-  comStatus = pC_->writeReadController();
+  comStatus = pC_->writeReadController(pC_->outString_, pC_->inString_, sizeof(pC_->inString_), &nread, timeout);
   if (comStatus) goto skip;
   // The response string is of the form "1TSabcdef"
   count = sscanf(pC_->inString_, "%*dTS%*4c%x", &status);
@@ -513,6 +529,7 @@ asynStatus AG_CONEXAxis::poll(bool *moving)
   setIntegerParam(pC_->motorStatusPowerOn_, closedLoop ? 1:0);
 
   skip:
+  pC_->bus_->endPoll(pC_->controllerID_, *moving, comStatus);
   setIntegerParam(pC_->motorStatusProblem_, comStatus ? 1:0);
   callParamCallbacks();
   return comStatus ? asynError : asynSuccess;
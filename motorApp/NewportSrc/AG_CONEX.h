@@ -9,6 +9,7 @@ April 11, 2013
 
 #include "asynMotorController.h"
 #include "asynMotorAxis.h"
+#include "NewportBus.h"
 
 typedef enum {
   ModelConexAGP,
@@ -75,6 +76,7 @@ public:
 private:
   int controllerID_;
   char controllerVersion_[40];
+  NewportBus *bus_;      /**< Poll scheduler shared by all controllers on the serial chain */
 
   friend class AG_CONEXAxis;
 };
@@ -0,0 +1,272 @@
+/*
+FILENAME... NewportBus.cpp
+USAGE...    Poll scheduler for Newport SMC100 and CONEX controllers daisy-chained on one serial bus.
+
+The SMC100 and the CONEX controllers can be daisy-chained on one RS-485 or USB chain and are
+selected by the address prefix of each command.  A chain is either one SMC100Controller with
+several axes or several AG_CONEXController objects using the same serial port; in both cases
+all polls go through the same NewportBus object, which is found by the serial port name.
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <iocsh.h>
+#include <epicsString.h>
+
+#include "asynMotorController.h"
+
+#include <epicsExport.h>
+#include "NewportBus.h"
+
+#define DEFAULT_IDLE_BUDGET   0.25
+#define DEFAULT_PROBE_TIMEOUT 0.2
+#define DEFAULT_MAX_BACKOFF   10.0
+#define MIN_BACKOFF           0.5
+#define INITIAL_POLL_TIME     0.02
+#define MAX_IDLE_AGE          10.0
+#define UTILIZATION_WINDOW    10.0
+
+static NewportBus *busList = NULL;
+
+/** Returns the bus object of a serial port, the object is created on the first call.
+  * \param[in] serialPortName The name of the asyn port of the serial chain */
+NewportBus* NewportBus::find(const char *serialPortName)
+{
+  NewportBus *pBus;
+
+  for (pBus = busList; pBus; pBus = pBus->next_) {
+    if (strcmp(pBus->serialPortName_, serialPortName) == 0) return pBus;
+  }
+  pBus = new NewportBus(serialPortName);
+  pBus->next_ = busList;
+  busList = pBus;
+  return pBus;
+}
+
+NewportBus::NewportBus(const char *serialPortName)
+  : serialPortName_(epicsStrDup(serialPortName)),
+    next_(NULL),
+    idleBudget_(DEFAULT_IDLE_BUDGET),
+    probeTimeout_(DEFAULT_PROBE_TIMEOUT),
+    maxBackoff_(DEFAULT_MAX_BACKOFF),
+    idleTokens_(1.),
+    meanPollTime_(INITIAL_POLL_TIME),
+    busyTime_(0.),
+    windowBusyTime_(0.),
+    utilization_(0.)
+{
+  memset(addresses_, 0, sizeof(addresses_));
+  epicsTimeGetCurrent(&createTime_);
+  tokenTime_ = createTime_;
+  windowStart_ = createTime_;
+}
+
+/** Sets the scheduling parameters of the bus.
+  * \param[in] idleBudget   Fraction of the bus time that may be spent polling idle axes, 0 to 1
+  * \param[in] probeTimeout Timeout in seconds for an address whose last poll failed
+  * \param[in] maxBackoff   Longest time in seconds between retries of an address that does not answer */
+void NewportBus::configure(double idleBudget, double probeTimeout, double maxBackoff)
+{
+  mutex_.lock();
+  if ((idleBudget > 0.) && (idleBudget <= 1.)) idleBudget_ = idleBudget;
+  if (probeTimeout > 0.) probeTimeout_ = probeTimeout;
+  if (maxBackoff >= MIN_BACKOFF) maxBackoff_ = maxBackoff;
+  mutex_.unlock();
+}
+
+/** Called by an axis before it polls the controller.
+  * \param[in] address The address of the controller on the chain
+  * \param[out] timeout The timeout to use for the commands of this poll
+  * \return true if the axis should poll now, false if it should keep its last status */
+bool NewportBus::startPoll(int address, double *timeout)
+{
+  NewportBusAddress *pAddr, *pOther;
+  epicsTimeStamp now;
+  int i, numIdle=0;
+  bool poll = true;
+
+  if ((address < 0) || (address >= NEWPORT_BUS_MAX_ADDRESSES)) return false;
+  epicsTimeGetCurrent(&now);
+  mutex_.lock();
+  pAddr = &addresses_[address];
+  if (!pAddr->used) {
+    // A new address is polled at once and then takes its turn
+    pAddr->used = true;
+    pAddr->lastPoll = now;
+  }
+  else if ((pAddr->failures > 0) && (epicsTimeLessThan(&now, &pAddr->retryTime))) {
+    poll = false;
+  }
+  else if (!pAddr->moving && (epicsTimeDiffInSeconds(&now, &pAddr->lastPoll) < MAX_IDLE_AGE)) {
+    // The least recently polled idle address is next
+    for (i=0; i<NEWPORT_BUS_MAX_ADDRESSES; i++) {
+      pOther = &addresses_[i];
+      if (!pOther->used || pOther->moving) continue;
+      numIdle++;
+      if ((pOther->failures > 0) && epicsTimeLessThan(&now, &pOther->retryTime)) continue;
+      if (epicsTimeLessThan(&pOther->lastPoll, &pAddr->lastPoll)) poll = false;
+    }
+    // Idle polls earn tokens at the rate the idle budget allows
+    idleTokens_ += epicsTimeDiffInSeconds(&now, &tokenTime_) * idleBudget_ / meanPollTime_;
+    if (idleTokens_ > numIdle) idleTokens_ = numIdle;
+    tokenTime_ = now;
+    if (idleTokens_ < 1.) poll = false;
+    if (poll) idleTokens_ -= 1.;
+  }
+
+  if (poll) {
+    pAddr->lastPoll = now;
+    pAddr->startTime = now;
+    *timeout = (pAddr->failures > 0) ? probeTimeout_ : DEFAULT_CONTROLLER_TIMEOUT;
+  } else {
+    pAddr->skipped++;
+  }
+  mutex_.unlock();
+  return poll;
+}
+
+/** Called by an axis after a poll that was allowed by startPoll().
+  * \param[in] address The address of the controller on the chain
+  * \param[in] moving The axis is moving
+  * \param[in] status The status of the communication during the poll */
+void NewportBus::endPoll(int address, bool moving, asynStatus status)
+{
+  NewportBusAddress *pAddr;
+  epicsTimeStamp now;
+  double elapsed, backoff;
+  int i;
+
+  if ((address < 0) || (address >= NEWPORT_BUS_MAX_ADDRESSES)) return;
+  epicsTimeGetCurrent(&now);
+  mutex_.lock();
+  pAddr = &addresses_[address];
+  elapsed = epicsTimeDiffInSeconds(&now, &pAddr->startTime);
+  pAddr->polls++;
+  pAddr->busyTime += elapsed;
+  busyTime_ += elapsed;
+  windowBusyTime_ += elapsed;
+  if (status) {
+    // Back off exponentially, the first retries are quick to ride out a single lost reply
+    pAddr->errors++;
+    pAddr->failures++;
+    pAddr->moving = false;
+    backoff = MIN_BACKOFF;
+    for (i=1; (i<pAddr->failures) && (backoff < maxBackoff_); i++) backoff *= 2.;
+    if (backoff > maxBackoff_) backoff = maxBackoff_;
+    pAddr->retryTime = now;
+    epicsTimeAddSeconds(&pAddr->retryTime, backoff);
+  } else {
+    pAddr->failures = 0;
+    pAddr->moving = moving;
+    meanPollTime_ = 0.9*meanPollTime_ + 0.1*elapsed;
+  }
+  updateUtilization(&now);
+  mutex_.unlock();
+}
+
+/** Marks an address as moving, so that it is polled at once after a move command.
+  * \param[in] address The address of the controller on the chain */
+void NewportBus::setMoving(int address)
+{
+  if ((address < 0) || (address >= NEWPORT_BUS_MAX_ADDRESSES)) return;
+  mutex_.lock();
+  addresses_[address].moving = true;
+  mutex_.unlock();
+}
+
+/** Returns the moving status of an address from its last poll.
+  * \param[in] address The address of the controller on the chain */
+bool NewportBus::isMoving(int address)
+{
+  bool moving;
+
+  if ((address < 0) || (address >= NEWPORT_BUS_MAX_ADDRESSES)) return false;
+  mutex_.lock();
+  moving = addresses_[address].moving;
+  mutex_.unlock();
+  return moving;
+}
+
+void NewportBus::updateUtilization(epicsTimeStamp *now)
+{
+  double elapsed = epicsTimeDiffInSeconds(now, &windowStart_);
+
+  if (elapsed < UTILIZATION_WINDOW) return;
+  utilization_ = windowBusyTime_ / elapsed;
+  windowBusyTime_ = 0.;
+  windowStart_ = *now;
+}
+
+/** Reports the bus utilization and, if level > 0, the statistics of each address.
+  * \param[in] fp The file pointer on which report information will be written
+  * \param[in] level The level of report detail desired */
+void NewportBus::report(FILE *fp, int level)
+{
+  NewportBusAddress *pAddr;
+  epicsTimeStamp now;
+  int i;
+
+  epicsTimeGetCurrent(&now);
+  mutex_.lock();
+  fprintf(fp, "  bus %s: utilization=%.1f%% (total %.1f%%), mean poll=%.3f ms\n"
+              "    idle budget=%.2f, probe timeout=%.3f s, max backoff=%.1f s\n",
+          serialPortName_, 100.*utilization_,
+          100.*busyTime_/epicsTimeDiffInSeconds(&now, &createTime_), 1000.*meanPollTime_,
+          idleBudget_, probeTimeout_, maxBackoff_);
+  if (level > 0) {
+    for (i=0; i<NEWPORT_BUS_MAX_ADDRESSES; i++) {
+      pAddr = &addresses_[i];
+      if (!pAddr->used) continue;
+      fprintf(fp, "    address %d: %s, polls=%lu, skipped=%lu, errors=%lu, mean=%.3f ms%s\n",
+              i, pAddr->moving ? "moving" : "idle", pAddr->polls, pAddr->skipped, pAddr->errors,
+              pAddr->polls ? 1000.*pAddr->busyTime/pAddr->polls : 0.,
+              (pAddr->failures > 0) ? ", not responding" : "");
+    }
+  }
+  mutex_.unlock();
+}
+
+
+/** Sets the scheduling parameters of a serial chain.
+  * Configuration command, called directly or from iocsh, before or after the controllers are created.
+  * \param[in] serialPortName The name of the asyn port of the serial chain
+  * \param[in] idleBudget     Fraction of the bus time that may be spent polling idle axes, 0 to 1
+  * \param[in] probeTimeout   Timeout in seconds for an address whose last poll failed
+  * \param[in] maxBackoff     Longest time in seconds between retries of an address that does not answer
+  */
+extern "C" int NewportBusConfig(const char *serialPortName, double idleBudget, double probeTimeout, double maxBackoff)
+{
+  if (!serialPortName) {
+    printf("NewportBusConfig: serial port name missing\n");
+    return asynError;
+  }
+  NewportBus::find(serialPortName)->configure(idleBudget, probeTimeout, maxBackoff);
+  return asynSuccess;
+}
+
+/** Code for iocsh registration */
+static const iocshArg NewportBusConfigArg0 = {"Serial port name", iocshArgString};
+static const iocshArg NewportBusConfigArg1 = {"Idle poll budget (0-1)", iocshArgDouble};
+static const iocshArg NewportBusConfigArg2 = {"Probe timeout (s)", iocshArgDouble};
+static const iocshArg NewportBusConfigArg3 = {"Maximum backoff (s)", iocshArgDouble};
+static const iocshArg * const NewportBusConfigArgs[] = {&NewportBusConfigArg0,
+                                                        &NewportBusConfigArg1,
+                                                        &NewportBusConfigArg2,
+                                                        &NewportBusConfigArg3};
+static const iocshFuncDef NewportBusConfigDef = {"NewportBusConfig", 4, NewportBusConfigArgs};
+static void NewportBusConfigCallFunc(const iocshArgBuf *args)
+{
+  NewportBusConfig(args[0].sval, args[1].dval, args[2].dval, args[3].dval);
+}
+
+static void NewportBusRegister(void)
+{
+  iocshRegister(&NewportBusConfigDef, NewportBusConfigCallFunc);
+}
+
+extern "C" {
+epicsExportRegistrar(NewportBusRegister);
+}
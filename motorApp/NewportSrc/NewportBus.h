@@ -0,0 +1,67 @@
+/*
+FILENAME...   NewportBus.h
+USAGE...      Poll scheduler for Newport SMC100 and CONEX controllers daisy-chained on one serial bus.
+
+*/
+
+#ifndef NewportBus_H
+#define NewportBus_H
+
+#include <stdio.h>
+#include <epicsMutex.h>
+#include <epicsTime.h>
+#include <asynDriver.h>
+
+#define NEWPORT_BUS_MAX_ADDRESSES 32
+
+/** The scheduling state and statistics of one controller address on the bus. */
+typedef struct NewportBusAddress {
+  bool used;                  /**< The address has been polled at least once */
+  bool moving;                /**< The axis was moving at the last poll */
+  int failures;               /**< Number of consecutive failed polls */
+  epicsTimeStamp lastPoll;    /**< Start of the last poll */
+  epicsTimeStamp retryTime;   /**< An address with failures is not polled before this time */
+  epicsTimeStamp startTime;   /**< Start of the poll in progress */
+  unsigned long polls;        /**< Number of polls */
+  unsigned long skipped;      /**< Number of polls skipped by the scheduler */
+  unsigned long errors;       /**< Number of failed polls */
+  double busyTime;            /**< Total time of the polls of this address */
+} NewportBusAddress;
+
+/** Shares the bandwidth of one serial chain between all SMC100 axes or CONEX controllers on it.
+  * Moving axes are polled on every call of their poller. Idle axes are polled round-robin,
+  * least recently polled first, within a budget for the fraction of bus time spent on idle polls.
+  * An address that does not answer is polled with a short timeout and backed off exponentially,
+  * so that it does not stall the other units on the chain. */
+class epicsShareClass NewportBus {
+public:
+  static NewportBus* find(const char *serialPortName);
+  void configure(double idleBudget, double probeTimeout, double maxBackoff);
+  bool startPoll(int address, double *timeout);
+  void endPoll(int address, bool moving, asynStatus status);
+  void setMoving(int address);
+  bool isMoving(int address);
+  void report(FILE *fp, int level);
+
+private:
+  NewportBus(const char *serialPortName);
+  void updateUtilization(epicsTimeStamp *now);
+
+  char *serialPortName_;
+  NewportBus *next_;
+  epicsMutex mutex_;
+  NewportBusAddress addresses_[NEWPORT_BUS_MAX_ADDRESSES];
+  double idleBudget_;          /**< Fraction of the bus time allowed for polls of idle axes */
+  double probeTimeout_;        /**< Timeout for an address that failed its last poll */
+  double maxBackoff_;          /**< Longest time between retries of an address that does not answer */
+  double idleTokens_;          /**< Idle polls currently allowed by the budget */
+  epicsTimeStamp tokenTime_;   /**< Time at which idleTokens_ was last updated */
+  double meanPollTime_;        /**< Running mean of the time of one successful poll */
+  double busyTime_;            /**< Total time of all polls */
+  double windowBusyTime_;      /**< Time of the polls in the current utilization window */
+  epicsTimeStamp windowStart_; /**< Start of the current utilization window */
+  epicsTimeStamp createTime_;  /**< Time the bus was created */
+  double utilization_;         /**< Bus utilization in the last complete window */
+};
+
+#endif /* NewportBus_H */
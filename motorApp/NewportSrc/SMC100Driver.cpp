@@ -8,6 +8,7 @@ March 1, 2012
 
 K. Goetze 2012-03-23  Initial version
           2013-06-07  Allow motor resolution to be set using "SMC100CreateController" at boot time
+          Poll the axes through the NewportBus scheduler of the serial chain
 
 */
 
@@ -59,6 +60,7 @@ SMC100Controller::SMC100Controller(const char *portName, const char *SMC100PortN
       "%s: cannot connect to SMC100 controller\n",
       functionName);
   }
+  bus_ = NewportBus::find(SMC100PortName);
   for (axis=0; axis<numAxes; axis++) {
   //for (axis=1; axis < (numAxes + 1); axis++) {
     pAxis = new SMC100Axis(this, axis, stepSize);
@@ -104,6 +106,7 @@ void SMC100Controller::report(FILE *fp, int level)
 {
   fprintf(fp, "SMC100 motor driver %s, numAxes=%d, moving poll period=%f, idle poll period=%f\n", 
     this->portName, numAxes_, movingPollPeriod_, idlePollPeriod_);
+  bus_->report(fp, level);
 
   // Call the base class method
   asynMotorController::report(fp, level);
@@ -189,6 +192,7 @@ asynStatus SMC100Axis::move(double position, int relative, double minVelocity, d
     sprintf(pC_->outString_, "%1dPA%f", axisNo_ + 1, (position*stepSize_));
   }
   status = pC_->writeController();
+  pC_->bus_->setMoving(axisNo_ + 1);
   return status;
 }
 
@@ -204,6 +208,7 @@ asynStatus SMC100Axis::home(double minVelocity, double maxVelocity, double accel
   sprintf(pC_->outString_, "%1dOR", axisNo_ + 1);
   
   status = pC_->writeController();
+  pC_->bus_->setMoving(axisNo_ + 1);
   return status;
 }
 
@@ -249,6 +254,7 @@ asynStatus SMC100Axis::moveVelocity(double minVelocity, double maxVelocity, doub
   }
   comStatus = pC_->writeController();
   if (comStatus) goto skip;
+  pC_->bus_->setMoving(axisNo_ + 1);
   
   skip:
   setIntegerParam(pC_->motorStatusProblem_, comStatus ? 1:0);
@@ -293,6 +299,7 @@ asynStatus SMC100Axis::setClosedLoop(bool closedLoop)
   * This function reads motor position, limit status, home status, and moving status
   * It calls setIntegerParam() and setDoubleParam() for each item that it polls,
   * and then calls callParamCallbacks() at the end.
+  * The bus scheduler decides whether the axis is polled in this cycle, a skipped axis keeps its last status.
   * \param[out] moving A flag that is set indicating that the axis is moving (true) or done (false). */
 asynStatus SMC100Axis::poll(bool *moving)
 { 
@@ -300,11 +307,19 @@ asynStatus SMC100Axis::poll(bool *moving)
   //int driveOn;
   int limit;
   double position;
+  double timeout;
+  size_t nread;
   asynStatus comStatus;
 
+  if (!pC_->bus_->startPoll(axisNo_ + 1, &timeout)) {
+    *moving = pC_->bus_->isMoving(axisNo_ + 1);
+    return asynSuccess;
+  }
+  *moving = false;
+
   // Read the current motor position
   sprintf(pC_->outString_, "%1dTP", axisNo_ + 1);
-  comStatus = pC_->writeReadController();
+  comStatus = pC_->writeReadController(pC_->outString_, pC_->inString_, sizeof(pC_->inString_), &nread, timeout);
   if (comStatus) goto skip;
   // The response string is of the form "1TP-0.123"
   position = (atof(&pC_->inString_[3]) / stepSize_);
@@ -313,7 +328,7 @@ asynStatus SMC100Axis::poll(bool *moving)
 
   // Read the moving status of this motor
   sprintf(pC_->outString_, "%1dTS", axisNo_ + 1);
-  comStatus = pC_->writeReadController();
+  comStatus = pC_->writeReadController(pC_->outString_, pC_->inString_, sizeof(pC_->inString_), &nread, timeout);
   if (comStatus) goto skip;
   // The response string is of the form "1TS000028"
   // May need to add logic for moving while homing
@@ -348,6 +363,7 @@ asynStatus SMC100Axis::poll(bool *moving)
   //setIntegerParam(pC_->motorStatusProblem_, 0);
 
   skip:
+  pC_->bus_->endPoll(axisNo_ + 1, *moving, comStatus);
   setIntegerParam(pC_->motorStatusProblem_, comStatus ? 1:0);
   callParamCallbacks();
   return comStatus ? asynError : asynSuccess;
@@ -12,6 +12,7 @@ K. Goetze 2012-03-23
 
 #include "asynMotorController.h"
 #include "asynMotorAxis.h"
+#include "NewportBus.h"
 
 #define MAX_SMC100_AXES 1
 
@@ -50,5 +51,8 @@ public:
   SMC100Axis* getAxis(asynUser *pasynUser);
   SMC100Axis* getAxis(int axisNo);
 
+private:
+  NewportBus *bus_;      /**< Poll scheduler of the serial chain */
+
 friend class SMC100Axis;
 };
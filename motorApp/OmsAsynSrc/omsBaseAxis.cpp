@@ -36,25 +36,46 @@ asynStatus omsBaseAxis::move(double position, int relative, double min_velocity,
     static const char *functionName = "moveAxis";
 
     asynStatus status = asynError;
-    epicsInt32 minvelo, velo, acc, rela, pos;
+    epicsInt32 pos;
     char *relabs[2] = {(char *) "MA", (char *) "MR"};
     char buff[100];
 
-    if (relative)
-        rela = 1;
-    else
-        rela = 0;
+    if (moveSetup(position, min_velocity, max_velocity, acceleration, &pos, buff) != asynSuccess)
+        return status;
+
+    /* move to the specified position */
+    sprintf(buff + strlen(buff), "%s%d;GO;ID;", relabs[relative ? 1 : 0], pos);
+
+    status = pC_->sendOnlyLock(buff);
+
+    asynPrint(pasynUser_, ASYN_TRACE_FLOW,
+        "%s:%s: Set driver %s, axis %d move to %f, min vel=%f, max_vel=%f, accel=%f",
+        driverName, functionName, pC_->portName, axisNo_, position, min_velocity, max_velocity, acceleration );
+
+    return status;
+}
+
+/** Builds the commands that select the axis and set the acceleration and velocities of a move.
+  * Used by move() and by omsBaseController::startDeferredMoves().
+  * \param[out] pos The target position rounded to steps.
+  * \param[out] buff The commands, e.g. "AX;AC1000;VL500;VB0;", at least 100 characters.
+  * Returns asynError if the position is out of range. */
+asynStatus omsBaseAxis::moveSetup(double position, double min_velocity, double max_velocity, double acceleration,
+                                  epicsInt32 *pos, char *buff)
+{
+    static const char *functionName = "moveSetup";
+    epicsInt32 minvelo, velo, acc;
 
     if ( position < 0.0)
-    	pos = (epicsInt32) (position - 0.5);
+    	*pos = (epicsInt32) (position - 0.5);
     else
-    	pos = (epicsInt32) (position + 0.5);
+    	*pos = (epicsInt32) (position + 0.5);
 
-    if (abs(pos) > 67000000){
+    if (abs(*pos) > 67000000){
         asynPrint(pasynUser_, ASYN_TRACE_ERROR,
               "%s:%s:%s axis %d position out of range %f\n",
               driverName, functionName, pC_->portName, axisNo_, position);
-        return status;
+        return asynError;
     }
 
     velo = (epicsInt32) (max_velocity + 0.5);
@@ -71,20 +92,12 @@ asynStatus omsBaseAxis::move(double position, int relative, double min_velocity,
     else if (acc < 1)
         acc = 1;
 
-    /* move to the specified position */
     if (velo < lastminvelo)
-        sprintf(buff, "A%1c;AC%d;VB%d;VL%d;%s%d;GO;ID;", axisChar, acc, minvelo, velo, relabs[rela], pos);
+        sprintf(buff, "A%1c;AC%d;VB%d;VL%d;", axisChar, acc, minvelo, velo);
     else
-        sprintf(buff, "A%1c;AC%d;VL%d;VB%d;%s%d;GO;ID;", axisChar, acc, velo, minvelo, relabs[rela], pos);
+        sprintf(buff, "A%1c;AC%d;VL%d;VB%d;", axisChar, acc, velo, minvelo);
     lastminvelo = minvelo;
-
-    status = pC_->sendOnlyLock(buff);
-
-    asynPrint(pasynUser_, ASYN_TRACE_FLOW,
-        "%s:%s: Set driver %s, axis %d move to %f, min vel=%f, max_vel=%f, accel=%f",
-        driverName, functionName, pC_->portName, axisNo_, position, min_velocity, max_velocity, acceleration );
-
-    return status;
+    return asynSuccess;
 }
 
 asynStatus omsBaseAxis::home(double min_velocity, double max_velocity, double acceleration, int forwards )
@@ -210,6 +223,6 @@ asynStatus omsBaseAxis::setPosition(double position)
  */
 asynStatus omsBaseAxis::poll(bool *moving)
 {
-    epicsEventSignal(pC_->pollEventId_);
+    pC_->wakeupPoller();
     return asynSuccess;
 }
@@ -45,6 +45,8 @@ private:
     int stepper;
     int invertLimit;
     epicsInt32 lastminvelo;
+    asynStatus moveSetup(double position, double minVelocity, double maxVelocity, double acceleration,
+                         epicsInt32 *pos, char *buff);
 
 friend class omsBaseController;
 };
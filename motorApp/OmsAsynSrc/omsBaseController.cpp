@@ -18,8 +18,6 @@ USAGE...        Pro-Dex OMS asyn motor base controller support
 
 #include "omsBaseController.h"
 
-#define MIN(a,b) ((a)<(b)? (a): (b))
-
 #define motorOmsStringSendString        "OMS_STRING_SEND"
 #define motorOmsStringSendRecvString    "OMS_STRING_SENDRECV"
 #define motorOmsStringRecvString        "OMS_STRING_RECV"
@@ -44,6 +42,19 @@ static const char *driverName = "omsBaseDriver";
 volatile int motorOMSBASEdebug = 0;
 extern "C" {epicsExportAddress(int, motorOMSBASEdebug);}
 
+/* default query plan, see omsBaseController::queryDue */
+static const omsQueryPlan defaultQueryPlan[OMS_NUM_QUERIES] = {
+    /* name          triggers                                    period */
+    {"status",       OMS_TRIGGER_ALWAYS,                         0.0},
+    {"positions",    OMS_TRIGGER_ALWAYS,                         0.0},
+    {"encoders",     OMS_TRIGGER_ALWAYS,                         0.0},
+    {"closedloop",   OMS_TRIGGER_IDLE,                           -1.0},
+    {"velocity",     OMS_TRIGGER_MOVING | OMS_TRIGGER_CHANGE,    0.0},
+    {"encstatus",    0,                                          -1.0},
+    {"limits",       OMS_TRIGGER_CHANGE,                         -1.0},
+    {"watchdog",     OMS_TRIGGER_ALWAYS,                         0.0}
+};
+
 
 
 omsBaseController::omsBaseController(const char *portName, int maxAxes, int prio, int stackSz, int extMotorParams=0)
@@ -81,6 +92,7 @@ omsBaseController::omsBaseController(const char *portName, int maxAxes, int prio
     numAxes = maxAxes;
     controllerType = NULL;
     baseMutex = new epicsMutex;
+    memcpy(queryPlan, defaultQueryPlan, sizeof(queryPlan));
 
     if (prio == 0)
         priority = epicsThreadPriorityLow;
@@ -156,10 +168,116 @@ void omsBaseController::report(FILE *fp, int level)
             if (pAxis->homing) fprintf(fp, "    Currently homing axis\n" );
         }
     }
+    if (level > 0) {
+        fprintf(fp, "  poll queries:  triggers  period      reads      skips     errors  avg(ms)  max(ms)\n");
+        lock();
+        for (int i=0; i < OMS_NUM_QUERIES; i++) {
+            omsQueryPlan *pQuery = &queryPlan[i];
+            fprintf(fp, "  %-12s %s%s%s%s %9.3f %10lu %10lu %10lu %8.3f %8.3f\n", pQuery->name,
+                    (pQuery->triggers & OMS_TRIGGER_ALWAYS) ? "A" : "-",
+                    (pQuery->triggers & OMS_TRIGGER_MOVING) ? "M" : "-",
+                    (pQuery->triggers & OMS_TRIGGER_CHANGE) ? "C" : "-",
+                    (pQuery->triggers & OMS_TRIGGER_IDLE)   ? "I" : "-",
+                    (pQuery->period < 0) ? idlePollPeriod_ : pQuery->period,
+                    pQuery->reads, pQuery->skips, pQuery->errors,
+                    pQuery->reads ? 1000. * pQuery->totalTime / pQuery->reads : 0.,
+                    1000. * pQuery->maxTime);
+        }
+        unlock();
+    }
     // Call the base class method
     asynMotorController::report(fp, level);
 }
 
+/**
+ * decide if a query of the poll loop is due in this poll.
+ * A query is due if one of its triggers applies or its refresh period has elapsed,
+ * but never while moving if it has the OMS_TRIGGER_IDLE bit.
+ * Counts the skipped queries.
+ * The query plan is read under the port lock, omsSetQueryPlan may change it at any time.
+ */
+bool omsBaseController::queryDue(int query, bool moving, bool statusChanged)
+{
+    omsQueryPlan *pQuery = &queryPlan[query];
+    bool due = false;
+    double period;
+    epicsTimeStamp now;
+
+    lock();
+    period = (pQuery->period < 0) ? idlePollPeriod_ : pQuery->period;
+    if ((pQuery->triggers & OMS_TRIGGER_IDLE) && moving)
+        due = false;
+    else if (!pQuery->done || (pQuery->triggers & OMS_TRIGGER_ALWAYS))
+        due = true;
+    else if ((pQuery->triggers & OMS_TRIGGER_MOVING) && moving)
+        due = true;
+    else if ((pQuery->triggers & OMS_TRIGGER_CHANGE) && statusChanged)
+        due = true;
+    else if (pQuery->period != 0) {
+        epicsTimeGetCurrent(&now);
+        /* allow for the jitter of the poll loop */
+        due = (epicsTimeDiffInSeconds(&now, &pQuery->lastRead) >= 0.9 * period);
+    }
+    if (!due) ++pQuery->skips;
+    unlock();
+    return due;
+}
+
+/**
+ * record the latency and result of a query of the poll loop
+ */
+void omsBaseController::queryDone(int query, epicsTimeStamp *start, asynStatus status)
+{
+    omsQueryPlan *pQuery = &queryPlan[query];
+    epicsTimeStamp now;
+    double elapsed;
+
+    epicsTimeGetCurrent(&now);
+    elapsed = epicsTimeDiffInSeconds(&now, start);
+    lock();
+    pQuery->lastRead = *start;
+    pQuery->done = true;
+    ++pQuery->reads;
+    if (status != asynSuccess) ++pQuery->errors;
+    pQuery->totalTime += elapsed;
+    if (elapsed > pQuery->maxTime) pQuery->maxTime = elapsed;
+    unlock();
+}
+
+/**
+ * change the query plan of the poll loop
+ * query:    name of the query, e.g. "velocity", see defaultQueryPlan
+ * triggers: comma separated list of "always", "moving", "change", "idle", or "none"
+ * period:   refresh period in s, <0 idle poll period, 0 no periodic refresh
+ */
+asynStatus omsBaseController::setQueryPlan(const char *query, const char *triggers, double period)
+{
+    const char* functionName = "setQueryPlan";
+    int i, triggerBits = 0;
+
+    for (i=0; i < OMS_NUM_QUERIES; i++)
+        if (query && (strcmp(query, queryPlan[i].name) == 0)) break;
+    if (i == OMS_NUM_QUERIES) {
+        errlogPrintf("%s:%s:%s: unknown query %s\n", driverName, functionName, portName, query ? query : "");
+        return asynError;
+    }
+    if (i == OMS_QUERY_STATUS) {
+        errlogPrintf("%s:%s:%s: the status query is needed in every poll\n", driverName, functionName, portName);
+        return asynError;
+    }
+    if (triggers) {
+        if (strstr(triggers, "always")) triggerBits |= OMS_TRIGGER_ALWAYS;
+        if (strstr(triggers, "moving")) triggerBits |= OMS_TRIGGER_MOVING;
+        if (strstr(triggers, "change")) triggerBits |= OMS_TRIGGER_CHANGE;
+        if (strstr(triggers, "idle"))   triggerBits |= OMS_TRIGGER_IDLE;
+    }
+    lock();
+    queryPlan[i].triggers = triggerBits;
+    queryPlan[i].period = period;
+    unlock();
+    return asynSuccess;
+}
+
 omsBaseAxis * omsBaseController::getAxis(asynUser *pasynUser)
 {
     int axisNo;
@@ -177,6 +295,92 @@ omsBaseAxis* omsBaseController::getAxis(int axisNo)
     return pAxes[axisNo];
 }
 
+/** Starts the deferred moves with a single "GO" in axes multiple mode, so that all axes start together.
+  * The acceleration and velocities are sent to each axis first, then e.g. "AM;MA1000,,-500;GO;ID;".
+  * Absolute and relative moves cannot be combined in one command, a mix of both, or a single move,
+  * is started by the base class one axis at a time.
+  * \param[in] moves Array of the moves to start.
+  * \param[in] numMoves The number of moves in the array. */
+asynStatus omsBaseController::startDeferredMoves(MotorDeferredMove *moves, int numMoves)
+{
+    const char *functionName = "startDeferredMoves";
+    asynStatus status = asynSuccess;
+    epicsInt32 pos;
+    char buff[100];
+    char moveBuff[OMS_MAX_AXES * (OMSBASE_MAXNUMBERLEN + 1) + 20];
+    char *positions[OMS_MAX_AXES];
+    char posBuff[OMS_MAX_AXES][OMSBASE_MAXNUMBERLEN + 1];
+    int i, axis, lastAxis = -1;
+    omsBaseAxis *pAxis;
+
+    if (numMoves < 2) return asynMotorController::startDeferredMoves(moves, numMoves);
+    for (i=1; i < numMoves; i++)
+        if (moves[i].relative != moves[0].relative)
+            return asynMotorController::startDeferredMoves(moves, numMoves);
+
+    for (axis=0; axis < OMS_MAX_AXES; axis++) positions[axis] = NULL;
+    for (i=0; i < numMoves; i++) {
+        pAxis = static_cast<omsBaseAxis*>(moves[i].pAxis);
+        if (!pAxis) continue;
+        if (pAxis->moveSetup(moves[i].position, moves[i].minVelocity, moves[i].maxVelocity,
+                             moves[i].acceleration, &pos, buff) != asynSuccess) {
+            status = asynError;
+            continue;
+        }
+        if (sendOnlyLock(buff) != asynSuccess) {
+            status = asynError;
+            continue;
+        }
+        axis = pAxis->axisNo_;
+        sprintf(posBuff[axis], "%d", pos);
+        positions[axis] = posBuff[axis];
+        if (axis > lastAxis) lastAxis = axis;
+    }
+    if (lastAxis < 0) return asynError;
+
+    /* the axes without a move get an empty field */
+    sprintf(moveBuff, "AM;%s", moves[0].relative ? "MR" : "MA");
+    for (axis=0; axis <= lastAxis; axis++) {
+        if (axis > 0) strcat(moveBuff, ",");
+        if (positions[axis]) strcat(moveBuff, positions[axis]);
+    }
+    strcat(moveBuff, ";GO;ID;");
+    if (sendOnlyLock(moveBuff) != asynSuccess) status = asynError;
+
+    asynPrint(pasynUserSelf, ASYN_TRACE_FLOW, "%s:%s:%s: started %d moves with %s\n",
+        driverName, functionName, portName, numMoves, moveBuff);
+    return status;
+}
+
+/** Stops all axes with a single "SA" in axes multiple mode.
+  * The deceleration of each axis is set to its motorAccel_ parameter first, as for a stop of that axis. */
+asynStatus omsBaseController::stopAllAxes()
+{
+    const char *functionName = "stopAllAxes";
+    asynStatus status = asynSuccess;
+    double accel;
+    int axis, acc;
+    char buff[50];
+    omsBaseAxis *pAxis;
+
+    for (axis=0; axis < numAxes; axis++) {
+        pAxis = getAxis(axis);
+        if (!pAxis) continue;
+        cancelDeferredMove(pAxis);
+        getDoubleParam(axis, motorAccel_, &accel);
+        acc = (int)(fabs(accel)+0.5);
+        if (acc > 8000000) acc=8000000;
+        if (acc < 1) acc = 200000;
+        sprintf(buff, "A%1c AC%d;", pAxis->axisChar, acc);
+        if (sendOnlyLock(buff) != asynSuccess) status = asynError;
+    }
+    if (sendOnlyLock("AM SA;ID;") != asynSuccess) status = asynError;
+
+    asynPrint(pasynUserSelf, ASYN_TRACE_FLOW, "%s:%s:%s: stop all axes\n",
+        driverName, functionName, portName);
+    return status;
+}
+
 asynStatus omsBaseController::writeOctet(asynUser *pasynUser, const char *value,
                                     size_t nChars, size_t *nActual)
 {
@@ -235,14 +439,14 @@ asynStatus omsBaseController::readInt32(asynUser *pasynUser, epicsInt32 *value)
     if (function == motorPosition_) {
         strcpy(outputBuffer,"A? RP");
         sendReceiveReplace(pAxis, outputBuffer, inputBuffer, sizeof(inputBuffer));
-        *value = strtol(inputBuffer, NULL, 10);
+        if (!omsResponse::parseInt(inputBuffer, value)) status = asynError;
      } else if (function == motorEncoderPosition_) {
          int haveEncoder;
          getIntegerParam(pAxis->axisNo_, motorStatusHasEncoder_, &haveEncoder);
          if (haveEncoder){
              strcpy(outputBuffer,"A? RE");
              sendReceiveReplace(pAxis, outputBuffer, inputBuffer, sizeof(inputBuffer));
-             *value = strtol(inputBuffer, NULL, 10);
+             if (!omsResponse::parseInt(inputBuffer, value)) status = asynError;
          }
      } else {
           // Call base class
@@ -266,9 +470,9 @@ asynStatus omsBaseController::writeInt32(asynUser *pasynUser, epicsInt32 value)
 
     if (function == motorDeferMoves_)
     {
-        asynPrint(pasynUser, ASYN_TRACE_ERROR,
-            "%s:%s:%s Deferred Move: not yet implemented\n",
-            driverName, functionName, portName);
+        asynPrint(pasynUser, ASYN_TRACE_FLOW, "%s:%s:%s deferred moves %s\n",
+            driverName, functionName, portName, value ? "on" : "off");
+        status = setDeferredMoves(value != 0);
     }
     else if (function == motorClosedLoop_)
     {
@@ -595,10 +799,14 @@ void omsBaseController::omsPoller()
     char statusBuffer[OMS_MAX_AXES*STATUSSTRINGLEN+2];
     char encStatusBuffer[OMS_MAX_AXES*6+2];
     int closedLoopStatus[OMS_MAX_AXES];
-    char encBuffer[7];
+    omsResponse encStatus;
+    const char *encField;
     unsigned int limitFlags;
-    epicsTimeStamp now, loopStart;
+    char prevStatusBuffer[OMS_MAX_AXES*STATUSSTRINGLEN+2];
+    epicsTimeStamp now, loopStart, queryStart;
     bool haveCLStatus, haveVeloArray, haveEncStatus, haveLimits, useEncoder=false, moveDone;
+    bool havePositions, haveEncPositions, pollMoving, statusChanged;
+    asynStatus queryStatus;
 
     lock();
     movingPollPeriod = movingPollPeriod_;
@@ -609,6 +817,7 @@ void omsBaseController::omsPoller()
         if (haveEncoder) useEncoder = true;
     }
     unlock();
+    prevStatusBuffer[0] = '\0';
 
 
     while(1) {
@@ -627,15 +836,19 @@ void omsBaseController::omsPoller()
         }
 
         epicsTimeGetCurrent(&loopStart);
+        pollMoving = (anyMoving > 0) || (fastPolls > 0);
+        startPollCycle();
 
         /* read all axis status values and reset done-field
          * MDNN,MDNN,PNLN,PNNN,PNLN,PNNN,PNNN,PNNN */
         retry_count = 0;
+        epicsTimeGetCurrent(&queryStart);
         while ((getAxesStatus(statusBuffer, sizeof(statusBuffer), &moveDone) != asynSuccess) && (retry_count < 5)){
             Debug(1, "%s:%s:%s: error reading axes status\n", driverName, functionName, this->portName);
             epicsThreadSleep(0.1);
             ++retry_count;
         }
+        queryDone(OMS_QUERY_STATUS, &queryStart, (retry_count > 4) ? asynError : asynSuccess);
 
         if (retry_count > 4){
             errlogPrintf("%s:%s:%s: error reading axis status (%d attempts)\n",
@@ -644,17 +857,31 @@ void omsBaseController::omsPoller()
             resetConnection();
             continue;
         }
-
-        if (getAxesPositions(axisPosArr) != asynSuccess){
-            Debug(1, "%s:%s:%s: error reading axis positions\n", driverName, functionName, this->portName);
-            ++loopBreakCount;
-            continue;
+        statusChanged = (strcmp(statusBuffer, prevStatusBuffer) != 0);
+        if (statusChanged) strcpy(prevStatusBuffer, statusBuffer);
+
+        havePositions = queryDue(OMS_QUERY_POSITIONS, pollMoving, statusChanged);
+        if (havePositions){
+            epicsTimeGetCurrent(&queryStart);
+            queryStatus = getAxesPositions(axisPosArr);
+            queryDone(OMS_QUERY_POSITIONS, &queryStart, queryStatus);
+            if (queryStatus != asynSuccess){
+                Debug(1, "%s:%s:%s: error reading axis positions\n", driverName, functionName, this->portName);
+                ++loopBreakCount;
+                continue;
+            }
         }
 
-        if (useEncoder && (getEncoderPositions(encPosArr) != asynSuccess)){
-            Debug(1, "%s:%s:%s: error reading encoder positions\n", driverName, functionName, this->portName);
-            ++loopBreakCount;
-            continue;
+        haveEncPositions = useEncoder && queryDue(OMS_QUERY_ENCODERS, pollMoving, statusChanged);
+        if (haveEncPositions){
+            epicsTimeGetCurrent(&queryStart);
+            queryStatus = getEncoderPositions(encPosArr);
+            queryDone(OMS_QUERY_ENCODERS, &queryStart, queryStatus);
+            if (queryStatus != asynSuccess){
+                Debug(1, "%s:%s:%s: error reading encoder positions\n", driverName, functionName, this->portName);
+                ++loopBreakCount;
+                continue;
+            }
         }
         loopBreakCount = 0;
 /*
@@ -663,39 +890,62 @@ void omsBaseController::omsPoller()
         }
 */
 
-        if (anyMoving)
-            haveCLStatus = false;
-        else
-            haveCLStatus = true;
-        if (haveCLStatus && getClosedLoopStatus(closedLoopStatus) != asynSuccess){
-            haveCLStatus = false;
-            Debug(1, "%s:%s:%s: error executing get Closed Loop Status\n", driverName, functionName, this->portName);
+        haveCLStatus = queryDue(OMS_QUERY_CLOSEDLOOP, pollMoving, statusChanged);
+        if (haveCLStatus){
+            epicsTimeGetCurrent(&queryStart);
+            queryStatus = getClosedLoopStatus(closedLoopStatus);
+            queryDone(OMS_QUERY_CLOSEDLOOP, &queryStart, queryStatus);
+            if (queryStatus != asynSuccess){
+                haveCLStatus = false;
+                Debug(1, "%s:%s:%s: error executing get Closed Loop Status\n", driverName, functionName, this->portName);
+            }
         }
 
-        haveVeloArray = true;
-        if (getAxesArray((char*) "AM;RV;", veloArr) != asynSuccess){
-            haveVeloArray = false;
-            Debug(1,"%s:%s:%s: Error executing command Report Velocity (RV)\n", driverName, functionName, this->portName);
+        haveVeloArray = queryDue(OMS_QUERY_VELOCITY, pollMoving, statusChanged);
+        if (haveVeloArray){
+            epicsTimeGetCurrent(&queryStart);
+            queryStatus = getAxesArray((char*) "AM;RV;", veloArr);
+            queryDone(OMS_QUERY_VELOCITY, &queryStart, queryStatus);
+            if (queryStatus != asynSuccess){
+                haveVeloArray = false;
+                Debug(1,"%s:%s:%s: Error executing command Report Velocity (RV)\n", driverName, functionName, this->portName);
+            }
         }
-        haveEncStatus = true;
-        if (sendReceiveLock((char*) "AM;EA;", encStatusBuffer, sizeof(encStatusBuffer)) != asynSuccess){
-            haveEncStatus = false;
-            Debug(1,"%s:%s:%s: Error reading encoder status buffer >%s<\n", driverName, functionName, this->portName, encStatusBuffer);
+
+        haveEncStatus = useEncoder && queryDue(OMS_QUERY_ENCSTATUS, pollMoving, statusChanged);
+        if (haveEncStatus){
+            epicsTimeGetCurrent(&queryStart);
+            queryStatus = sendReceiveLock((char*) "AM;EA;", encStatusBuffer, sizeof(encStatusBuffer));
+            queryDone(OMS_QUERY_ENCSTATUS, &queryStart, queryStatus);
+            if (queryStatus != asynSuccess){
+                haveEncStatus = false;
+                Debug(1,"%s:%s:%s: Error reading encoder status buffer >%s<\n", driverName, functionName, this->portName, encStatusBuffer);
+            }
+            else
+                encStatus.split(encStatusBuffer);
         }
 
-        haveLimits = true;
+        haveLimits = queryDue(OMS_QUERY_LIMITS, pollMoving, statusChanged);
         limitFlags =0;
-		if ((sendReceiveLock((char*) "AM;QL;", pollInputBuffer, sizeof(pollInputBuffer)) == asynSuccess)){
-			if (1 != sscanf(pollInputBuffer, "%x", &limitFlags)){
-				Debug(1,"%s:%s:%s: error converting limits: %s\n", driverName, functionName, this->portName, pollInputBuffer);
-				haveLimits = false;
-			}
-		}
-		else {
-			haveLimits = false;
-			Debug(1,"%s:%s:%s: error reading limits %s\n", driverName, functionName, this->portName, pollInputBuffer);
-		}
-        if (enabled) watchdogOK();
+        if (haveLimits){
+            epicsTimeGetCurrent(&queryStart);
+            queryStatus = sendReceiveLock((char*) "AM;QL;", pollInputBuffer, sizeof(pollInputBuffer));
+            queryDone(OMS_QUERY_LIMITS, &queryStart, queryStatus);
+            if (queryStatus == asynSuccess){
+                if (!omsResponse::parseHex(pollInputBuffer, &limitFlags)){
+                    Debug(1,"%s:%s:%s: error converting limits: %s\n", driverName, functionName, this->portName, pollInputBuffer);
+                    haveLimits = false;
+                }
+            }
+            else {
+                haveLimits = false;
+                Debug(1,"%s:%s:%s: error reading limits %s\n", driverName, functionName, this->portName, pollInputBuffer);
+            }
+        }
+        if (enabled && queryDue(OMS_QUERY_WATCHDOG, pollMoving, statusChanged)){
+            epicsTimeGetCurrent(&queryStart);
+            queryDone(OMS_QUERY_WATCHDOG, &queryStart, watchdogOK() ? asynSuccess : asynError);
+        }
 
         anyMoving = 0;
         lock();
@@ -707,18 +957,19 @@ void omsBaseController::omsPoller()
                 getIntegerParam(i, motorStatusHasEncoder_, &haveEncoder);
                 if (haveEncoder){
                     if (haveEncStatus){
-                        if (getSubstring(i, encStatusBuffer, encBuffer, sizeof(encBuffer)) == asynSuccess){
-                            if (encBuffer[2] == 'S')
+                        if (i < encStatus.getCount()){
+                            encField = encStatus.getField(i);
+                            if ((strlen(encField) > 2) && (encField[2] == 'S'))
                                 pAxis->setIntegerParam(motorStatusFollowingError_, 1);
                             else
                                 pAxis->setIntegerParam(motorStatusFollowingError_, 0);
                         }
                         else{
-                            errlogPrintf("%s:%s:%s: error parsing encoder status string %s\n",
-                                    driverName, functionName, this->portName, encStatusBuffer);
+                            errlogPrintf("%s:%s:%s: error parsing encoder status string, axis %d of %d fields\n",
+                                    driverName, functionName, this->portName, i, encStatus.getCount());
                         }
                     }
-                    pAxis->setDoubleParam(motorEncoderPosition_, (double) encPosArr[i]);
+                    if (haveEncPositions) pAxis->setDoubleParam(motorEncoderPosition_, (double) encPosArr[i]);
                 }
             }
 
@@ -762,7 +1013,7 @@ void omsBaseController::omsPoller()
                     }
                }
             }
-            else {
+            else if (haveVeloArray) {
                 Debug(4, "%s:%s:%s: poller loop: axis %d still moving\n", driverName, functionName, this->portName, i);
                 pAxis->moveDelay = 0;
                 pAxis->setIntegerParam(motorStatusProblem_, 0);
@@ -799,7 +1050,7 @@ void omsBaseController::omsPoller()
                 pAxis->setIntegerParam(motorStatusDirection_, 0);
 
             /* set positions */
-            pAxis->setDoubleParam(motorPosition_, (double) axisPosArr[i]);
+            if (havePositions) pAxis->setDoubleParam(motorPosition_, (double) axisPosArr[i]);
 
             /* set closed loop status */
             if (haveCLStatus) pAxis->setIntegerParam(motorStatusGainSupport_, closedLoopStatus[i]);
@@ -847,20 +1098,20 @@ asynStatus omsBaseController::getClosedLoopStatus(int clstatus[OMS_MAX_AXES])
 {
     asynStatus status = asynSuccess;
     char clBuffer[9];
+    omsResponse response;
 
     if (firmwareMin(1,30,0)){
         pollInputBuffer[0] = '\0';
         status = sendReceiveLock((char*) "AM;CL?;", pollInputBuffer, sizeof(pollInputBuffer));
         if (status == asynSuccess) {
-            for (int i=0; i < numAxes; ++i) {
-                status = getSubstring(i, pollInputBuffer, clBuffer, sizeof(clBuffer));
-                if ( status == asynSuccess){
-                    if (strncmp(clBuffer, "on", 2))
-                        clstatus[i] = 1;
-                    else
-                        clstatus[i] = 0;
-                }
+            response.split(pollInputBuffer);
+            for (int i=0; (i < numAxes) && (i < response.getCount()); ++i) {
+                if (strncmp(response.getField(i), "on", 2))
+                    clstatus[i] = 1;
+                else
+                    clstatus[i] = 0;
             }
+            if (response.getCount() < numAxes) status = asynError;
         }
     }
     else {
@@ -1022,90 +1273,20 @@ asynStatus omsBaseController::getAxesArray(char* cmd, int positions[OMS_MAX_AXES
     const char* functionName="getAxesArray";
     asynStatus status = asynSuccess;
     char inputBuff[OMSINPUTBUFFERLEN] = "";
-    char *start, *end, *stop;
-    int i, intVal, again = 1;
-    int count =0;
+    omsResponse response;
+    int count;
 
     status = sendReceiveLock(cmd, inputBuff, sizeof(inputBuff));
-    if ((status == asynSuccess) && (strlen(inputBuff) >= (unsigned int)numAxes -1)) {
-        start = inputBuff;
-        stop = start + MIN(strlen(inputBuff), sizeof(inputBuff));
-        for (i = 0; ((i < OMS_MAX_AXES) && again); ++i){
-            if (*start == ','){
-                positions[i] = 0;
-                ++count;
-                start += 1;
-                if (*start == '\0'){
-                    /* comma was last character */
-                    ++count;
-                    again=0;
-                    if (i < OMS_MAX_AXES-1) positions[i+1] = 0;
-                }
-                continue;
-            }
-            intVal = strtol(start, &end, 10);
-            if ((intVal == 0) && (start == end)) {
-                again = 0;
-            }
-            else {
-                positions[i] = intVal;
-                ++count;
-            }
-            if (end >= stop) again = 0;
-            start = end + 1;
-        }
-        if (count != numAxes) {
-            errlogPrintf("%s:%s:%s: array string conversion error, count: %d, axes: %d, input: >%s<\n",
-                                driverName, functionName, portName, count, numAxes, inputBuff);
-            return asynError;
-        }
-    }
-    else {
-        if (status == asynSuccess){
-            errlogPrintf("%s:%s:%s: read string too short %d\n",
-                                driverName, functionName, portName, (int)strlen(inputBuff));
-            return asynError;
-        }
-    }
-    return status;
-}
-
-asynStatus omsBaseController::getSubstring(unsigned int number, char* inputBuffer, char *outBuffer, unsigned int outBufferLen)
-{
-    /* get the numbered substring from a comma-separated string */
-    /* numbering starts with 0 */
-    /* other as strtok accept a sequence of commas ,,, as empty substrings */
-    char *start, *end, *pos, *tmpBuffer;
-    unsigned int i, count;
-    int doloop = 1;
-    asynStatus status = asynError;
-
-
-    if (strlen(inputBuffer) < number) return status;
-
-    tmpBuffer = epicsStrDup(inputBuffer);
-    start = tmpBuffer;
-    end = start + strlen(start);
-    for (i=0; i<=number && doloop==1; ++i){
-        pos = strchr(start, ',');
-        if (pos == NULL) {
-            doloop = 0;
-            count = MIN(strlen(start), outBufferLen-1);
-        }
-        else {
-            count = MIN((unsigned int)(pos-start), outBufferLen-1);
-            *pos = '\0';
-        }
-        if (i==number){
-               strncpy(outBuffer, start, count);
-                outBuffer[count]='\0';
-                status = asynSuccess;
-                break;
-            }
-        start = pos+1;
-        if (start > end) doloop =0;
+    if (status != asynSuccess) return status;
+
+    response.split(inputBuff);
+    count = response.getInts(positions, OMS_MAX_AXES);
+    if (count != numAxes) {
+        response.restore();
+        errlogPrintf("%s:%s:%s: array string conversion error, count: %d, axes: %d, input: >%s<\n",
+                            driverName, functionName, portName, count, numAxes, inputBuff);
+        return asynError;
     }
-    free (tmpBuffer);
     return status;
 }
 
@@ -1126,3 +1307,36 @@ bool omsBaseController::watchdogOK()
     return true;
 }
 
+extern "C" int omsSetQueryPlan(
+           const char *portName,      /* OMS Motor Asyn Port name */
+           const char *query,         /* name of the poll query */
+           const char *triggers,      /* comma separated list of always, moving, change, idle */
+           double period)             /* refresh period in s, <0 idle poll period, 0 no periodic refresh */
+{
+    omsBaseController *pController = omsBaseController::findController(portName);
+    if (pController == NULL) {
+        errlogPrintf("omsSetQueryPlan: ERROR: OMS asynPort %s not found\n", portName);
+        return 1;
+    }
+    return (pController->setQueryPlan(query, triggers, period) == asynSuccess) ? 0 : 1;
+}
+
+/* Code for iocsh registration */
+/* omsSetQueryPlan */
+static const iocshArg queryPlanArg0 = {"asyn motor port name", iocshArgString};
+static const iocshArg queryPlanArg1 = {"query", iocshArgString};
+static const iocshArg queryPlanArg2 = {"triggers", iocshArgString};
+static const iocshArg queryPlanArg3 = {"period", iocshArgDouble};
+static const iocshArg * const queryPlanArgs[4] = {&queryPlanArg0, &queryPlanArg1, &queryPlanArg2, &queryPlanArg3};
+static const iocshFuncDef queryPlanOms = {"omsSetQueryPlan", 4, queryPlanArgs};
+static void queryPlanOmsCallFunc(const iocshArgBuf *args)
+{
+    omsSetQueryPlan(args[0].sval, args[1].sval, args[2].sval, args[3].dval);
+}
+
+static void OmsBaseAsynRegister(void)
+{
+    iocshRegister(&queryPlanOms, queryPlanOmsCallFunc);
+}
+
+epicsExportRegistrar(OmsBaseAsynRegister);
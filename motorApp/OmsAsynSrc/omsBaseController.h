@@ -21,12 +21,45 @@ USAGE...        Pro-Dex OMS asyn motor base controller support
 #include <errlog.h>
 #include "asynMotorController.h"
 #include "omsBaseAxis.h"
+#include "omsResponse.h"
 #include <epicsExport.h>
 
 #define OMS_MAX_AXES 10
 #define OMSBASE_MAXNUMBERLEN 12
 #define OMSINPUTBUFFERLEN OMSBASE_MAXNUMBERLEN * OMS_MAX_AXES + 2
 
+/* The classes of data read by omsPoller, each has its own entry in the query plan */
+enum omsQuery {
+    OMS_QUERY_STATUS,
+    OMS_QUERY_POSITIONS,
+    OMS_QUERY_ENCODERS,
+    OMS_QUERY_CLOSEDLOOP,
+    OMS_QUERY_VELOCITY,
+    OMS_QUERY_ENCSTATUS,
+    OMS_QUERY_LIMITS,
+    OMS_QUERY_WATCHDOG,
+    OMS_NUM_QUERIES
+};
+
+/* triggers of a query in the query plan */
+#define OMS_TRIGGER_ALWAYS  0x01    /* read in every poll */
+#define OMS_TRIGGER_MOVING  0x02    /* read in every poll while an axis is moving or fast polls are forced */
+#define OMS_TRIGGER_CHANGE  0x04    /* read when the axes status string has changed */
+#define OMS_TRIGGER_IDLE    0x08    /* never read while an axis is moving */
+
+typedef struct omsQueryPlan {
+    const char *name;
+    int triggers;               /* OMS_TRIGGER_* bits */
+    double period;              /* read at least every period s, <0: idle poll period, 0: no periodic read */
+    bool done;                  /* has been read at least once */
+    epicsTimeStamp lastRead;
+    unsigned long reads;        /* statistics printed by report() */
+    unsigned long skips;
+    unsigned long errors;
+    double totalTime;
+    double maxTime;
+} omsQueryPlan;
+
 class omsBaseController : public asynMotorController {
 public:
     omsBaseController(const char *portName, int numAxes, int priority, int stackSize, int extMotorParams);
@@ -41,6 +74,10 @@ public:
     static void callPoller(void*);
     static void callShutdown(void *ptr){((omsBaseController*)ptr)->shutdown();};
     void shutdown();
+    asynStatus setQueryPlan(const char *query, const char *triggers, double period);
+    static omsBaseController* findController(const char*);
+    virtual asynStatus startDeferredMoves(MotorDeferredMove *moves, int numMoves);
+    virtual asynStatus stopAllAxes();
 
 protected:
     virtual asynStatus writeOctet(asynUser *, const char *, size_t, size_t *);
@@ -59,9 +96,9 @@ protected:
     virtual epicsEventWaitStatus waitInterruptible(double timeout);
     virtual bool watchdogOK();
     virtual bool resetConnection(){return false;};
+    virtual void startPollCycle(){};
     char* getPortName(){return portName;};
     bool firmwareMin(int, int, int);
-    static omsBaseController* findController(const char*);
     static ELLLIST omsControllerList;
     static int omsTotalControllerNumber;
     char* controllerType;
@@ -72,10 +109,12 @@ protected:
     bool enabled;
     int numAxes;
 
+    asynStatus sendReceiveReplace(omsBaseAxis*, char *, char *, int);
+    bool queryDue(int query, bool moving, bool statusChanged);
+    void queryDone(int query, epicsTimeStamp *start, asynStatus status);
+
 private:
     asynStatus sendReplace(omsBaseAxis*, char*);
-    asynStatus sendReceiveReplace(omsBaseAxis*, char *, char *, int);
-    asynStatus getSubstring(unsigned int , char* , char *, unsigned int);
     int sanityCounter;
     epicsThreadId motorThread;
     char inputBuffer[OMSINPUTBUFFERLEN];
@@ -88,6 +127,7 @@ private:
     int receiveIndex;
     int pollIndex;
     int priority, stackSize;
+    omsQueryPlan queryPlan[OMS_NUM_QUERIES];
 
     friend class omsBaseAxis;
 };
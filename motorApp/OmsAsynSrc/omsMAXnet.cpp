@@ -61,15 +61,119 @@ void omsMAXnet::asynCallback(void *drvPvt, asynUser *pasynUser, char *data, size
 
     if ((len >= 1) && (strchr(data, '%') != NULL)){
         char* pos = strchr(data, '%');
-        epicsEventSignal(pController->pollEventId_);
         while (pos != NULL){
             Debug(2, "omsMAXnet::asynCallback: %s (%d)\n", data, len);
             pController->notificationMutex->lock();
             ++pController->notificationCounter;
             pController->notificationMutex->unlock();
+            pController->handleNotification(pos);
             ++pos;
             pos = strchr(pos, '%');
         }
+        pController->wakeupPoller();
+    }
+}
+
+/*
+ * decode a notification message "%000 SSSSSSSS".
+ * The hex status has the same layout as the status register of the MAXv:
+ * done flags of the axes in bits 0-7, overtravel flags in bits 8-15.
+ * Remember the affected axes for refreshNotifiedAxes
+ */
+void omsMAXnet::handleNotification(const char *message)
+{
+    const char *pos = strstr(message, "000 ");
+    unsigned int flags;
+    epicsUInt32 newAxes;
+    epicsTimeStamp received;
+
+    if ((pos == NULL) || !omsResponse::parseHex(pos + 4, &flags)) return;
+
+    epicsTimeGetCurrent(&received);
+    notificationMutex->lock();
+    newAxes = (flags & 0xFFFF) & ~(notifiedDone | (notifiedLimit << 8));
+    notifiedDone  |= flags & 0xFF;
+    notifiedLimit |= (flags >> 8) & 0xFF;
+    for (int axis=0; (axis < numAxes) && (axis < 8); axis++)
+        if (newAxes & ((1 << axis) | (1 << (axis + 8)))) notifyTime[axis] = received;
+    notificationMutex->unlock();
+}
+
+/*
+ * read the status and position of the axes with a done or limit notification
+ * and post them immediately, without waiting for the next full poll.
+ * The latency from the notification to the callbacks is entered into the histogram
+ */
+void omsMAXnet::refreshNotifiedAxes()
+{
+    const char* functionName="refreshNotifiedAxes";
+    epicsUInt32 doneAxes, limitAxes;
+    epicsTimeStamp received[8], posted;
+    char command[10], axisStatus[10], positionBuffer[OMSBASE_MAXNUMBERLEN + 2];
+    double latency;
+    int position;
+
+    notificationMutex->lock();
+    doneAxes = notifiedDone;
+    limitAxes = notifiedLimit;
+    notifiedDone = 0;
+    notifiedLimit = 0;
+    for (int axis=0; (axis < numAxes) && (axis < 8); axis++)
+        received[axis] = notifyTime[axis];
+    notificationMutex->unlock();
+
+    for (int axis=0; (axis < numAxes) && (axis < 8); axis++){
+        if (!((doneAxes | limitAxes) & (1 << axis))) continue;
+        omsBaseAxis* pAxis = getAxis(axis);
+
+        /* axis status: direction, done, limit, home, e.g. "PDNN" */
+        strcpy(command, "A? RA");
+        if ((sendReceiveReplace(pAxis, command, axisStatus, sizeof(axisStatus)) != asynSuccess) ||
+            (strlen(axisStatus) < 4)){
+            Debug(1, "%s:%s:%s: error reading status of axis %d\n", driverName, functionName, portName, axis);
+            continue;
+        }
+        strcpy(command, "A? RP");
+        if ((sendReceiveReplace(pAxis, command, positionBuffer, sizeof(positionBuffer)) != asynSuccess) ||
+            !omsResponse::parseInt(positionBuffer, &position))
+            positionBuffer[0] = '\0';
+
+        lock();
+        pAxis->setIntegerParam(motorStatusDirection_, (axisStatus[0] == 'P') ? 1 : 0);
+        if ((doneAxes & (1 << axis)) || (axisStatus[1] == 'D')){
+            pAxis->setIntegerParam(motorStatusProblem_, 0);
+            pAxis->moveDelay = 0;
+            pAxis->setIntegerParam(motorStatusDone_, 1);
+            pAxis->setIntegerParam(motorStatusMoving_, 0);
+            if (pAxis->homing) pAxis->homing = 0;
+        }
+        if (axisStatus[2] == 'L'){
+            if (axisStatus[0] == 'P')
+                pAxis->setIntegerParam(motorStatusHighLimit_, 1);
+            else
+                pAxis->setIntegerParam(motorStatusLowLimit_, 1);
+        }
+        pAxis->setIntegerParam(motorStatusAtHome_, (axisStatus[3] == 'H') ? 1 : 0);
+        if (positionBuffer[0] != '\0')
+            pAxis->setDoubleParam(motorPosition_, (double) position);
+        pAxis->callParamCallbacks();
+
+        epicsTimeGetCurrent(&posted);
+        latency = epicsTimeDiffInSeconds(&posted, &received[axis]);
+        notifyLatency.add(latency);
+        unlock();
+        Debug(2, "%s:%s:%s: axis %d refreshed %.3f ms after notification\n",
+                driverName, functionName, portName, axis, latency * 1000.);
+    }
+}
+
+void omsMAXnet::report(FILE *fp, int level)
+{
+    omsBaseController::report(fp, level);
+    if (level > 0){
+        fprintf(fp, "  %lu notifications handled, max latency %.3f ms\n",
+                notifyLatency.count(), notifyLatency.maxTime() * 1000.);
+        notifyLatency.report(fp, "latency");
     }
 }
 
@@ -83,6 +187,8 @@ omsMAXnet::omsMAXnet(const char* portName, int numAxes, const char* serialPortNa
 
     notificationMutex = new epicsMutex();
     notificationCounter = 0;
+    notifiedDone = 0;
+    notifiedLimit = 0;
     useWatchdog = true;
     char eosstring[5];
     int eoslen=0;
@@ -196,6 +302,8 @@ epicsEventWaitStatus omsMAXnet::waitInterruptible(double timeout)
         epicsTimeGetCurrent(&now);
         timeToWait = timeout - epicsTimeDiffInSeconds(&now, &starttime);
     }
+    /* post the axes with notifications before the full poll */
+    if ((waitStatus == epicsEventWaitOK) && enabled) refreshNotifiedAxes();
     return waitStatus;
 }
 
@@ -314,7 +422,7 @@ int omsMAXnet::isNotification (char *buffer) {
         else {
             Debug(2,"%s:%s:%s: Interrupt notification: %s\n",
             		driverName, functionName, portName, buffer);
-            epicsEventSignal(pollEventId_);
+            wakeupPoller();
         }
         return 1;
     }
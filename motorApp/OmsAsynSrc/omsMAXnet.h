@@ -13,6 +13,7 @@ USAGE...        Pro-Dex OMS MAXnet asyn motor controller support
 #define OMSMAXNET_H_
 
 #include "omsBaseController.h"
+#include "asynMotorHistogram.h"
 
 class omsMAXnet : public omsBaseController {
 public:
@@ -25,9 +26,16 @@ public:
     asynStatus sendReceive(const char *, char *, unsigned int );
     asynStatus sendOnly(const char *);
     virtual bool resetConnection();
+    virtual void report(FILE *fp, int level);
 
 private:
     int isNotification (char *);
+    void handleNotification(const char *);
+    void refreshNotifiedAxes();
+    epicsUInt32 notifiedDone;                   /* done bits of axes received in notifications */
+    epicsUInt32 notifiedLimit;                  /* overtravel bits of axes received in notifications */
+    epicsTimeStamp notifyTime[OMS_MAX_AXES];    /* time of the first notification not yet handled */
+    asynMotorHistogram notifyLatency;           /* latency from a notification to the callbacks */
     asynUser* pasynUserSerial;
     asynUser* pasynUserSyncIOSerial;
     asynOctet *pasynOctetSerial;
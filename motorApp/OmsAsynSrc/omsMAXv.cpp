@@ -51,8 +51,9 @@ void omsMAXv::InterruptHandler( void * param )
 
     status1_flag.All = pmotor->status1_flag.All;
 
-    /* Motion done handling */
-    if (status1_flag.Bits.done != 0) epicsEventSignal(pController->pollEventId_);
+    /* Motion done handling, the OMS controllers run their own poller thread, so wakeupPoller()
+     * only signals an event and is safe at interrupt level */
+    if (status1_flag.Bits.done != 0) pController->wakeupPoller();
 
     if (status1_flag.Bits.cmndError)
     {
@@ -143,6 +144,11 @@ void omsMAXv::initialize(const char* portName, int numAxes, int cardNo, const ch
     Debug(32, "omsMAXv::initialize: start initialize\n" );
 
     controllerType = epicsStrDup("MAXv");
+    useCoherent = false;
+    haveCoherentEnc = false;
+    coherentErrors = 0;
+    coherentReads = 0;
+    coherentTimeouts = 0;
 
     // TODO check if cardNo has already been used
     this->cardNo = cardNo;
@@ -243,6 +249,9 @@ void omsMAXv::initialize(const char* portName, int numAxes, int cardNo, const ch
                         driverName, functionName, portName, fwMajor, fwMinor);
     }
 
+    /* The coherent position registers only exist for the 8 axes of the card */
+    useCoherent = (numAxes <= MAXv_NUM_AXES);
+
     Debug(64, "motor_init: send init string\n");
 
     if( Init(initString, 1) != asynSuccess) {
@@ -448,6 +457,102 @@ asynStatus omsMAXv::sendReceive(const char *outputBuff, char *inputBuff, unsigne
     return asynSuccess;
 }
 
+/**
+ * request a coherent snapshot of all command and encoder positions
+ * through the position request mailbox and copy it from the dual port memory.
+ * The firmware latches the coherent_cmndPos and coherent_encPos registers
+ * of all axes at the same instant and clears the mailbox when done.
+ */
+asynStatus omsMAXv::readCoherentPositions()
+{
+    static const char* functionName = "readCoherentPositions";
+    int itera = 0;
+    double time = 0.0;
+    double timeout = 0.01;
+    int axis;
+
+    if (!enabled) return asynError;
+
+    lock();
+    pmotor->position_req_mbox = 1;
+    // skip busy-waiting for small epicsThreadSleepQuantum
+    if (epicsThreadSleepQuantum() <= 0.01) itera = 201;
+    while ((pmotor->position_req_mbox != 0) && (time < timeout)){
+        //  busy-waiting but not more than 200 times
+        if (itera > 200){
+            time += epicsThreadSleepQuantum();
+            epicsThreadSleep(epicsThreadSleepQuantum());
+        }
+        itera++;
+    }
+    if (pmotor->position_req_mbox != 0){
+        ++coherentTimeouts;
+        if (++coherentErrors >= MAXv_COHERENT_MAX_ERRORS){
+            useCoherent = false;
+            errlogPrintf("%s:%s:%s: position request mailbox not answered, using ASCII position commands\n",
+                            driverName, functionName, portName);
+        }
+        unlock();
+        return asynTimeout;
+    }
+    for (axis=0; axis < numAxes; axis++){
+        coherentPos[axis] = (epicsInt32) pmotor->coherent_cmndPos[axis];
+        coherentEnc[axis] = (epicsInt32) pmotor->coherent_encPos[axis];
+    }
+    haveCoherentEnc = true;
+    coherentErrors = 0;
+    ++coherentReads;
+    unlock();
+    Debug(32, "%s:%s:%s: coherent positions read\n", driverName, functionName, portName);
+    return asynSuccess;
+}
+
+/**
+ * overrides the base class to read all axis positions from the dual port memory
+ * instead of sending "AM PP;" and parsing the answer.
+ * The encoder positions of the same snapshot are kept for the following call
+ * of getEncoderPositions().
+ */
+asynStatus omsMAXv::getAxesPositions(int positions[OMS_MAX_AXES])
+{
+    if (!useCoherent || (readCoherentPositions() != asynSuccess))
+        return omsBaseController::getAxesPositions(positions);
+
+    for (int axis=0; axis < numAxes; axis++) positions[axis] = coherentPos[axis];
+    return asynSuccess;
+}
+
+/**
+ * overrides the base class to return the encoder positions latched together with
+ * the command positions by getAxesPositions() in the same poll cycle, or to take a new snapshot.
+ */
+asynStatus omsMAXv::getEncoderPositions(epicsInt32 encPosArr[OMS_MAX_AXES])
+{
+    if (useCoherent && !haveCoherentEnc) readCoherentPositions();
+    if (!useCoherent || !haveCoherentEnc)
+        return omsBaseController::getEncoderPositions(encPosArr);
+
+    for (int axis=0; axis < numAxes; axis++) encPosArr[axis] = coherentEnc[axis];
+    haveCoherentEnc = false;
+    return asynSuccess;
+}
+
+/**
+ * drops the encoder positions of the last snapshot, a cycle that did not read the
+ * command positions must not return the encoders of an earlier cycle.
+ */
+void omsMAXv::startPollCycle()
+{
+    haveCoherentEnc = false;
+}
+
+void omsMAXv::report(FILE *fp, int level)
+{
+    omsBaseController::report(fp, level);
+    if (level > 0)
+        fprintf(fp, "  coherent positions %s, %lu reads, %lu mailbox timeouts\n",
+                useCoherent ? "enabled" : "disabled", coherentReads, coherentTimeouts);
+}
 
 void omsMAXv::motorIsrSetup(volatile unsigned int vector, volatile epicsUInt8 level)
 {
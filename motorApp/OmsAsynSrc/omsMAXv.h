@@ -18,6 +18,8 @@ USAGE...        Pro-Dex OMS MAXv asyn motor controller support
 #define BUFFER_SIZE	1024
 
 #define MAXv_NUM_CARDS           15		/* maximum number of cards */
+#define MAXv_NUM_AXES            8		/* number of axes with coherent position registers */
+#define MAXv_COHERENT_MAX_ERRORS 3		/* mailbox timeouts before falling back to ASCII positions */
 #define OMS_INT_VECTOR          180     /* default interrupt vector (64-255) */
 #define OMS_INT_LEVEL           5 		/* default interrupt level (1-6) */
 
@@ -158,15 +160,26 @@ public:
     static void resetOnExit(void* param){((omsMAXv*)param)->resetIntr();};
     void resetIntr();
     int getCardNo(){return cardNo;};
+    virtual void report(FILE *fp, int level);
 
 protected:
 	virtual void initialize(const char*, int, int, const char*, int, int, unsigned int, int, int, epicsAddressType, int );
+    virtual asynStatus getAxesPositions(int positions[OMS_MAX_AXES]);
+    virtual asynStatus getEncoderPositions(epicsInt32 encPosArr[OMS_MAX_AXES]);
+    virtual void startPollCycle();
 
 private:
     void motorIsrSetup(volatile unsigned int, volatile epicsUInt8);
+    asynStatus readCoherentPositions();
     int cardNo;
     volatile struct MAXv_motor *pmotor;
     char readBuffer[BUFFER_SIZE];
+    bool useCoherent;                               /* read positions through the position request mailbox */
+    bool haveCoherentEnc;                           /* coherentEnc was read in the current poll cycle */
+    int coherentErrors;                             /* consecutive mailbox timeouts */
+    epicsInt32 coherentPos[MAXv_NUM_AXES];          /* last snapshot of coherent_cmndPos */
+    epicsInt32 coherentEnc[MAXv_NUM_AXES];          /* last snapshot of coherent_encPos, same instant as coherentPos */
+    unsigned long coherentReads, coherentTimeouts;  /* statistics printed by report() */
 };
 
 #endif /* OMSMAXV_H_ */
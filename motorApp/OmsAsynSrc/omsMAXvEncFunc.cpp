@@ -117,7 +117,7 @@ asynStatus omsMAXvEncFunc::getEncoderPositions(epicsInt32 encPosArr[OMS_MAX_AXES
     asynStatus status = asynSuccess;
     double position;
 
-    omsBaseController::getEncoderPositions(encPosArr);
+    omsMAXv::getEncoderPositions(encPosArr);
 
     for (int i=0; i < OMS_MAX_AXES; ++i) {
         if ((i < MAXENCFUNC) && (averageChannel[i] != i) && (averageChannel[i] > 0) && (averageChannel[i] < OMS_MAX_AXES)){
@@ -0,0 +1,121 @@
+/*
+FILENAME...     omsResponse.cpp
+USAGE...        Pro-Dex OMS response tokenizer
+
+*/
+
+#include <stddef.h>
+
+#include "omsResponse.h"
+
+/*
+ * split the buffer at the commas, the commas are replaced by '\0'.
+ * returns the number of fields, an empty buffer has no fields,
+ * ",,," has 4 empty fields.  Fields beyond OMSRESPONSE_MAX_FIELDS
+ * remain part of the last field.
+ */
+int omsResponse::split(char *buffer)
+{
+    char *pos = buffer;
+
+    count = 0;
+    if ((buffer == NULL) || (*buffer == '\0')) return 0;
+
+    fields[count++] = pos;
+    for (; *pos != '\0'; ++pos){
+        if ((*pos == ',') && (count < OMSRESPONSE_MAX_FIELDS)){
+            *pos = '\0';
+            fields[count++] = pos + 1;
+        }
+    }
+    return count;
+}
+
+/* put the commas back, e.g. to print the complete response */
+void omsResponse::restore()
+{
+    for (int i=1; i < count; ++i) *(fields[i] - 1) = ',';
+    count = 0;
+}
+
+/* returns the numbered field, numbering starts with 0, "" if missing */
+const char* omsResponse::getField(int number)
+{
+    if ((number < 0) || (number >= count)) return "";
+    return fields[number];
+}
+
+bool omsResponse::getInt(int number, int *value)
+{
+    if ((number < 0) || (number >= count)) return false;
+    return parseInt(fields[number], value);
+}
+
+bool omsResponse::getHex(int number, unsigned int *value)
+{
+    if ((number < 0) || (number >= count)) return false;
+    return parseHex(fields[number], value);
+}
+
+/*
+ * convert all fields into values.
+ * returns the number of fields converted or -1 if a field is no number
+ * or there are more fields than values
+ */
+int omsResponse::getInts(int *values, int maxValues)
+{
+    if (count > maxValues) return -1;
+    for (int i=0; i < count; ++i){
+        if (!parseInt(fields[i], &values[i])) return -1;
+    }
+    return count;
+}
+
+/*
+ * decimal conversion like strtol for the range of int,
+ * leading blanks and an empty field give 0, conversion stops at the first non-digit
+ */
+bool omsResponse::parseInt(const char *field, int *value)
+{
+    const char *pos = field;
+    unsigned int result = 0, limit = 2147483647U;
+    bool negative = false;
+
+    while (*pos == ' ') ++pos;
+    if ((*pos == '-') || (*pos == '+')){
+        negative = (*pos == '-');
+        if (negative) ++limit;
+        ++pos;
+        if ((*pos < '0') || (*pos > '9')) return false;
+    }
+    else if ((*pos != '\0') && ((*pos < '0') || (*pos > '9'))) return false;
+
+    for (; (*pos >= '0') && (*pos <= '9'); ++pos){
+        unsigned int digit = *pos - '0';
+        if (result > (limit - digit) / 10) return false;
+        result = result * 10 + digit;
+    }
+    *value = negative ? (int) (0U - result) : (int) result;
+    return true;
+}
+
+/* hex conversion like sscanf("%x"), conversion stops at the first non-hex digit */
+bool omsResponse::parseHex(const char *field, unsigned int *value)
+{
+    const char *pos = field;
+    unsigned int result = 0, digit;
+    int digits = 0;
+
+    while (*pos == ' ') ++pos;
+    for (;; ++pos, ++digits){
+        if ((*pos >= '0') && (*pos <= '9')) digit = *pos - '0';
+        else if ((*pos >= 'a') && (*pos <= 'f')) digit = *pos - 'a' + 10;
+        else if ((*pos >= 'A') && (*pos <= 'F')) digit = *pos - 'A' + 10;
+        else break;
+        if (digits >= 8) return false;
+        result = (result << 4) | digit;
+    }
+    if (digits == 0) return false;
+    *value = result;
+    return true;
+}
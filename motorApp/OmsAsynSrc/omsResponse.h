@@ -0,0 +1,36 @@
+/*
+FILENAME...     omsResponse.h
+USAGE...        Pro-Dex OMS response tokenizer
+
+*/
+
+/*
+ * Splits comma-separated OMS responses like "0,5000,,-12" or "on,off"
+ * in place and converts the fields without copying or allocating.
+ * Empty fields are accepted as value 0, as the controllers send them.
+ */
+
+#ifndef OMSRESPONSE_H_
+#define OMSRESPONSE_H_
+
+#define OMSRESPONSE_MAX_FIELDS 16
+
+class omsResponse {
+public:
+    omsResponse(){count = 0;};
+    int split(char *buffer);
+    void restore();
+    int getCount(){return count;};
+    const char* getField(int);
+    bool getInt(int, int *);
+    bool getHex(int, unsigned int *);
+    int getInts(int *values, int maxValues);
+    static bool parseInt(const char *, int *);
+    static bool parseHex(const char *, unsigned int *);
+
+private:
+    char *fields[OMSRESPONSE_MAX_FIELDS];
+    int count;
+};
+
+#endif /* OMSRESPONSE_H_ */
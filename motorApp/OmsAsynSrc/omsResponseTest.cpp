@@ -0,0 +1,204 @@
+/*
+FILENAME...     omsResponseTest.cpp
+USAGE...        Replays OMS responses through the omsResponse tokenizer
+
+*/
+
+/*
+ * Host program that replays captured and malformed OMS responses through
+ * omsResponse and checks the parsed values.  Every prefix of the captured
+ * responses is split as well, as a truncated reply would be, and the
+ * replay is timed to compare the tokenizer with the controller latency.
+ *
+ * Usage: omsResponseTest [replays]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <epicsTime.h>
+#include <epicsUnitTest.h>
+
+#include "omsResponse.h"
+
+#define MAX_VALUES 10   /* OMS_MAX_AXES */
+
+/* a response to getInts() and the expected result, count -1 for an error */
+typedef struct {
+    const char *response;
+    int count;
+    int values[MAX_VALUES];
+} intCase;
+
+static const intCase intCases[] = {
+    /* replies to "AM;RP;" and "AM;RV;" captured from a MAXv and a MAXnet */
+    {"1000,2000,0,-500,0,0,0,0",            8, {1000, 2000, 0, -500, 0, 0, 0, 0}},
+    {"0,5000,,-12",                         4, {0, 5000, 0, -12}},
+    {"-67000000,67000000,0,0,0,0,0,0,0,0", 10, {-67000000, 67000000, 0, 0, 0, 0, 0, 0, 0, 0}},
+    {" 12, -7,+3",                          3, {12, -7, 3}},
+    {",,,",                                 4, {0, 0, 0, 0}},
+    {"",                                    0, {0}},
+    /* limits of int */
+    {"2147483647,-2147483648",              2, {2147483647, -2147483647 - 1}},
+    /* truncated replies */
+    {"1000,20",                             2, {1000, 20}},
+    {"1000,-",                             -1, {0}},
+    /* overlong numbers and too many fields */
+    {"2147483648",                         -1, {0}},
+    {"-2147483649",                        -1, {0}},
+    {"99999999999999999999",               -1, {0}},
+    {"0,0,0,0,0,0,0,0,0,0,0",              -1, {0}},
+    /* fields that are no numbers */
+    {"1000,EN",                            -1, {0}},
+    {"on,off",                             -1, {0}},
+    {"--5",                                -1, {0}},
+};
+
+/* a field for parseHex() and the expected result */
+typedef struct {
+    const char *field;
+    bool ok;
+    unsigned int value;
+} hexCase;
+
+static const hexCase hexCases[] = {
+    /* replies to "AM;QL;" and MAXnet notifications after "000 " */
+    {"0000",        true,  0x0},
+    {"00ff",        true,  0xff},
+    {" 1A0F",       true,  0x1a0f},
+    {"FFFFFFFF",    true,  0xffffffffU},
+    {"12 ",         true,  0x12},
+    {"7,8",         true,  0x7},
+    /* overlong, empty and non-hex fields */
+    {"123456789",   false, 0},
+    {"",            false, 0},
+    {" ",           false, 0},
+    {"xyz",         false, 0},
+    {"-1",          false, 0},
+};
+
+static void testInts()
+{
+    char buffer[128];
+    int values[MAX_VALUES];
+    omsResponse response;
+
+    for (size_t i=0; i < sizeof(intCases)/sizeof(intCases[0]); i++){
+        const intCase *pCase = &intCases[i];
+        int count;
+        bool same = true;
+
+        strcpy(buffer, pCase->response);
+        response.split(buffer);
+        count = response.getInts(values, MAX_VALUES);
+        for (int j=0; j < count; j++)
+            if (values[j] != pCase->values[j]) same = false;
+        testOk((count == pCase->count) && same, "getInts(\"%s\") = %d", pCase->response, count);
+
+        response.restore();
+        testOk(strcmp(buffer, pCase->response) == 0, "restore(\"%s\")", pCase->response);
+    }
+}
+
+static void testHex()
+{
+    unsigned int value;
+
+    for (size_t i=0; i < sizeof(hexCases)/sizeof(hexCases[0]); i++){
+        const hexCase *pCase = &hexCases[i];
+        bool ok;
+
+        value = 0;
+        ok = omsResponse::parseHex(pCase->field, &value);
+        testOk((ok == pCase->ok) && (!ok || (value == pCase->value)),
+               "parseHex(\"%s\") = %s 0x%x", pCase->field, ok ? "true" : "false", value);
+    }
+}
+
+static void testSplit()
+{
+    char buffer[128];
+    omsResponse response;
+    const char *field;
+
+    /* replies to "AM;EA;" and "AM;CL?;" are read as strings */
+    strcpy(buffer, "EN,EN,EN,EN,EN,EN,EN,EN");
+    testOk(response.split(buffer) == 8, "split encoder status into 8 fields");
+    testOk(strcmp(response.getField(7), "EN") == 0, "encoder status field 7");
+    testOk(strcmp(response.getField(8), "") == 0, "missing field is empty");
+    testOk(strcmp(response.getField(-1), "") == 0, "negative field number is empty");
+
+    strcpy(buffer, "on,off,on");
+    response.split(buffer);
+    testOk((strcmp(response.getField(0), "on") == 0) && (strcmp(response.getField(1), "off") == 0),
+           "split closed loop status");
+
+    /* fields beyond OMSRESPONSE_MAX_FIELDS remain part of the last field */
+    strcpy(buffer, "0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17");
+    testOk(response.split(buffer) == OMSRESPONSE_MAX_FIELDS, "split stops at %d fields", OMSRESPONSE_MAX_FIELDS);
+    field = response.getField(OMSRESPONSE_MAX_FIELDS - 1);
+    testOk(strcmp(field, "15,16,17") == 0, "last field is \"%s\"", field);
+
+    testOk(response.split(NULL) == 0, "split(NULL) has no fields");
+}
+
+/* every truncation of the captured replies splits into at most one more field than commas */
+static void testTruncated()
+{
+    char buffer[128];
+    int values[MAX_VALUES];
+    omsResponse response;
+    bool ok = true;
+
+    for (size_t i=0; i < sizeof(intCases)/sizeof(intCases[0]); i++){
+        const char *full = intCases[i].response;
+        for (size_t len=0; len <= strlen(full); len++){
+            int commas = 0;
+
+            memcpy(buffer, full, len);
+            buffer[len] = '\0';
+            for (size_t j=0; j < len; j++) if (buffer[j] == ',') commas++;
+            if (response.split(buffer) != ((len == 0) ? 0 : commas + 1)) ok = false;
+            response.getInts(values, MAX_VALUES);
+            response.restore();
+            if ((strlen(buffer) != len) || (strncmp(buffer, full, len) != 0)) ok = false;
+        }
+    }
+    testOk(ok, "truncated replies split and restore");
+}
+
+static void benchmark(int replays)
+{
+    char buffer[128];
+    int values[MAX_VALUES];
+    unsigned int flags;
+    omsResponse response;
+    epicsTimeStamp start, end;
+    double elapsed;
+
+    epicsTimeGetCurrent(&start);
+    for (int n=0; n < replays; n++){
+        strcpy(buffer, "-67000000,67000000,0,0,0,0,0,0,0,0");
+        response.split(buffer);
+        response.getInts(values, MAX_VALUES);
+        omsResponse::parseHex("00ff", &flags);
+    }
+    epicsTimeGetCurrent(&end);
+    elapsed = epicsTimeDiffInSeconds(&end, &start);
+    testDiag("%d replays of a 10 axis position reply in %.3f ms, %.3f us each",
+             replays, elapsed * 1000., (replays > 0) ? elapsed * 1.e6 / replays : 0.);
+}
+
+int main(int argc, char *argv[])
+{
+    int replays = (argc > 1) ? atoi(argv[1]) : 100000;
+
+    testPlan(2 * (sizeof(intCases)/sizeof(intCases[0])) + sizeof(hexCases)/sizeof(hexCases[0]) + 9);
+    testInts();
+    testHex();
+    testSplit();
+    testTruncated();
+    benchmark(replays);
+    return testDone();
+}
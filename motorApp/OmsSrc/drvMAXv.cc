@@ -255,7 +255,8 @@ struct driver_table MAXv_access =
     query_done,
     NULL,
     &initialized,
-    (char **) MAXv_axis
+    (char **) MAXv_axis,
+    true
 };
 
 struct drvMAXv_drvet
@@ -1079,9 +1080,12 @@ static void motorIsr(int card)
     pmotor = (struct MAXv_motor *) (pmotorState->localaddr);
     status1_flag.All = pmotor->status1_flag.All;
 
-    /* Motion done handling */
-    if (status1_flag.Bits.done != 0)
+    /* Motion done and overtravel handling; flag the axes for motor_task(). */
+    if (status1_flag.Bits.done != 0 || status1_flag.Bits.overtravel != 0)
+    {
+        pmotorState->isr_pending |= status1_flag.Bits.done | status1_flag.Bits.overtravel;
         motor_sem.signal();  /* Wake up 'motor_task()' to issue callbacks */
+    }
 
     if (status1_flag.Bits.cmndError)
     {
@@ -1245,6 +1249,7 @@ static int motor_init()
         pmotorState->localaddr = (char *) localaddr;
         pmotorState->motor_in_motion = 0;
         pmotorState->cmnd_response = false;
+        pmotorState->isr_pending = 0;
 
         pvtdata = (struct MAXvController *) malloc(sizeof(struct MAXvController));
         pvtdata->message_mutex = epicsMutexMustCreate();
@@ -196,7 +196,8 @@ struct driver_table oms_access =
     query_done,
     NULL,
     &initialized,
-    oms_axis
+    oms_axis,
+    true
 };
 
 struct drvOms_drvet
@@ -859,10 +860,15 @@ static void motorIsr(int card)
 
     /* Determine cause of entry */
 
-    /* Motion done handling */
+    /* Motion done handling; flag the axes for motor_task().  The overtravel
+     * status has no axis information and stays set while the serial
+     * interrupts run, overtravel is left to the regular scan. */
     if (status & STAT_DONE)
+    {
+        pmotorState->isr_pending |= doneFlags;
         /* Wake up polling task 'motor_task()' to issue callbacks */
         motor_sem.signal();
+    }
 
     /* If command error is present - clear it */
     if (status & STAT_ERROR)
@@ -1163,6 +1169,7 @@ static int motor_init()
             pmotorState->localaddr = (char *) localaddr;
             pmotorState->motor_in_motion = 0;
             pmotorState->cmnd_response = false;
+            pmotorState->isr_pending = 0;
 
             /* Disable Interrupts */
             irqdata = (struct irqdatastr *) malloc(sizeof(struct irqdatastr));
@@ -227,7 +227,8 @@ struct driver_table oms58_access =
     query_done,
     start_status,
     &initialized,
-    oms58_axis
+    oms58_axis,
+    true
 };
 
 struct drvOms58_drvet
@@ -1045,10 +1046,13 @@ static void motorIsr(int card)
         pmotor->control.cntrlReg = (epicsUInt8) 0x90;
 /* Questioniable Fix for undefined problem Ends Here. */
 
-    /* Motion done handling */
-    if (statusBuf.Bits.done)
+    /* Motion done and overtravel handling; flag the axes for motor_task(). */
+    if (statusBuf.Bits.done || limitFlags != 0)
+    {
+        pmotorState->isr_pending |= doneFlags | limitFlags;
         /* Wake up polling task 'motor_task()' to issue callbacks */
         motor_sem.signal();
+    }
 
     if (statusBuf.Bits.cmndError)
     {
@@ -1192,6 +1196,7 @@ static int motor_init()
             pmotorState->localaddr = (char *) localaddr;
             pmotorState->motor_in_motion = 0;
             pmotorState->cmnd_response = false;
+            pmotorState->isr_pending = 0;
 
             pmotor->control.cntrlReg = 0;   /* Disable all interrupts */
             pmotor->rebootind = 0x4321;     /* Set reboot indicator (before send_mess call). */
@@ -41,6 +41,8 @@ public:
 	virtual asynStatus setAcceleration( PIasynAxis* pAxis, double acceleration)	{ return asynSuccess; }
     virtual asynStatus getStatus(PIasynAxis* pAxis, int& homing, int& moving, int& negLimit, int& posLimit, int& servoControl);
 
+    virtual bool HasWaveGenerator() { return true; }
+
 private:
 
 };
@@ -272,6 +272,293 @@ int PIGCSController::getGCSError()
 	return errorCode;
 }
 
+asynStatus PIGCSController::getNrDataRecorderTables(int& nrTables)
+{
+	char buf[255];
+	asynStatus status = m_pInterface->sendAndReceive("TNR?", buf, 99);
+	if (status != asynSuccess)
+	{
+		return status;
+	}
+	nrTables = atoi(buf);
+	return status;
+}
+
+asynStatus PIGCSController::configDataRecorder(int table, const char* source, int option)
+{
+	char cmd[100];
+	sprintf(cmd, "DRC %d %s %d", table, source, option);
+	asynStatus status = m_pInterface->sendOnly(cmd);
+	if (status != asynSuccess)
+	{
+		return status;
+	}
+	return (COM_NO_ERROR == getGCSError()) ? asynSuccess : asynError;
+}
+
+asynStatus PIGCSController::setDataRecorderRate(int rate)
+{
+	char cmd[100];
+	sprintf(cmd, "RTR %d", rate);
+	asynStatus status = m_pInterface->sendOnly(cmd);
+	if (status != asynSuccess)
+	{
+		return status;
+	}
+	return (COM_NO_ERROR == getGCSError()) ? asynSuccess : asynError;
+}
+
+/**
+ * set the trigger source for all tables, e.g. 0 = start immediately,
+ * 1 = start with the next motion command (see the manual of the controller)
+ */
+asynStatus PIGCSController::setDataRecorderTrigger(int trigger)
+{
+	char cmd[100];
+	sprintf(cmd, "DRT 0 %d 0", trigger);
+	asynStatus status = m_pInterface->sendOnly(cmd);
+	if (status != asynSuccess)
+	{
+		return status;
+	}
+	return (COM_NO_ERROR == getGCSError()) ? asynSuccess : asynError;
+}
+
+asynStatus PIGCSController::getDataRecorderPoints(int table, int& nrPoints)
+{
+	char cmd[100];
+	char buf[255];
+	sprintf(cmd, "DRL? %d", table);
+	asynStatus status = m_pInterface->sendAndReceive(cmd, buf, 99);
+	if (status != asynSuccess)
+	{
+		return status;
+	}
+	if (!getValue(buf, nrPoints))
+	{
+		return asynError;
+	}
+	return status;
+}
+
+/**
+ * The reply to "DRR?" is in GCS array format: a header of lines starting with '#'
+ * which is terminated by "# END_HEADER", followed by one line per point with
+ * the values of all requested tables separated by spaces.
+ */
+asynStatus PIGCSController::readDataRecorder(int firstPoint, int numPoints, int numTables,
+                                             char* replyBuff, int replySize,
+                                             double* data, int& numRead, double& sampleTime)
+{
+	char cmd[100];
+	int len = sprintf(cmd, "DRR? %d %d", firstPoint, numPoints);
+	for (int table=1; table<=numTables && len<80; table++)
+	{
+		len += sprintf(cmd+len, " %d", table);
+	}
+	numRead = 0;
+	asynStatus status = m_pInterface->sendAndReceive(cmd, replyBuff, replySize);
+	if (status != asynSuccess)
+	{
+		return status;
+	}
+
+	bool bHeader = true;
+	char* line = replyBuff;
+	while (line != NULL && *line != '\0' && numRead < numPoints)
+	{
+		char* next = strchr(line, '\n');
+		if (next != NULL)
+		{
+			*next++ = '\0';
+		}
+		if (line[0] == '#')
+		{
+			if (strstr(line, "SAMPLE_TIME") != NULL)
+			{
+				getValue(line, sampleTime);
+			}
+			else if (strstr(line, "END_HEADER") != NULL)
+			{
+				bHeader = false;
+			}
+		}
+		else if (!bHeader)
+		{
+			double* pPoint = data + numRead*numTables;
+			char* p = line;
+			int table;
+			for (table=0; table<numTables; table++)
+			{
+				char* end;
+				pPoint[table] = strtod(p, &end);
+				if (end == p)
+				{
+					break;
+				}
+				p = end;
+			}
+			if (table < numTables)
+			{
+				if (m_pInterface->m_pCurrentLogSink)
+				{
+					asynPrint(m_pInterface->m_pCurrentLogSink, ASYN_TRACE_ERROR|ASYN_TRACE_FLOW,
+							"PIGCSController::readDataRecorder() incomplete data line \"%s\"\n", line);
+				}
+				return asynError;
+			}
+			numRead++;
+		}
+		line = next;
+	}
+	return status;
+}
+
+asynStatus PIGCSController::getNrWaveGenerators(int& nrGenerators)
+{
+	char buf[255];
+	asynStatus status = m_pInterface->sendAndReceive("TWG?", buf, 99);
+	if (status != asynSuccess)
+	{
+		return status;
+	}
+	nrGenerators = atoi(buf);
+	return status;
+}
+
+asynStatus PIGCSController::getMaxWaveTableLength(int table, int& maxPoints)
+{
+	char cmd[100];
+	char buf[255];
+	sprintf(cmd, "WMS? %d", table);
+	asynStatus status = m_pInterface->sendAndReceive(cmd, buf, 99);
+	if (status != asynSuccess)
+	{
+		return status;
+	}
+	if (!getValue(buf, maxPoints))
+	{
+		return asynError;
+	}
+	return status;
+}
+
+/** servo update time in seconds, the wave generator and data recorder rates are multiples of it */
+asynStatus PIGCSController::getServoCycleTime(PIasynAxis* pAxis, double& cycleTime)
+{
+	return getGCSParameter(pAxis, 0x0E000200, cycleTime);
+}
+
+/**
+ * Write \a numPoints points to the wave table. The points are sent with as many
+ * "WAV ... PNT" commands as needed to stay below the maximum command length,
+ * the first one clears the table, the others append to it.
+ */
+asynStatus PIGCSController::writeWaveTable(int table, const double* points, int numPoints)
+{
+	char cmd[PIInterface::MAX_CMD_LEN];
+	char values[PIInterface::MAX_CMD_LEN];
+	const size_t maxValuesLen = PIInterface::MAX_CMD_LEN - 50;
+	int point = 0;
+
+	while (point < numPoints)
+	{
+		int firstPoint = point;
+		size_t len = 0;
+		values[0] = '\0';
+		while (point < numPoints)
+		{
+			char value[32];
+			size_t valueLen = sprintf(value, " %.6f", points[point]);
+			if (len + valueLen >= maxValuesLen)
+			{
+				break;
+			}
+			memcpy(values+len, value, valueLen+1);
+			len += valueLen;
+			point++;
+		}
+		sprintf(cmd, "WAV %d %c PNT %d %d%s", table, (firstPoint == 0) ? 'X' : '&',
+				firstPoint+1, point-firstPoint, values);
+		asynStatus status = m_pInterface->sendOnly(cmd);
+		if (status != asynSuccess)
+		{
+			return status;
+		}
+	}
+	int errorCode = getGCSError();
+	if (errorCode == COM_NO_ERROR)
+	{
+		return asynSuccess;
+	}
+	asynPrint(m_pInterface->m_pCurrentLogSink, ASYN_TRACE_FLOW|ASYN_TRACE_ERROR,
+			"PIGCSController::writeWaveTable() failed, GCS error %d\n", errorCode);
+	return asynError;
+}
+
+/**
+ * connect the wave table to the generator, run it once with \a rate servo cycles
+ * per point and linear interpolation, \a offset is added to all points
+ */
+asynStatus PIGCSController::setupWaveGenerator(int generator, int table, int rate, double offset)
+{
+	char cmd[100];
+	asynStatus status;
+
+	sprintf(cmd, "WSL %d %d", generator, table);
+	status = m_pInterface->sendOnly(cmd);
+	if (status == asynSuccess)
+	{
+		sprintf(cmd, "WGC %d 1", generator);
+		status = m_pInterface->sendOnly(cmd);
+	}
+	if (status == asynSuccess)
+	{
+		sprintf(cmd, "WTR %d %d 1", generator, rate);
+		status = m_pInterface->sendOnly(cmd);
+	}
+	if (status == asynSuccess)
+	{
+		sprintf(cmd, "WOS %d %f", generator, offset);
+		status = m_pInterface->sendOnly(cmd);
+	}
+	if (status != asynSuccess)
+	{
+		return status;
+	}
+	return (COM_NO_ERROR == getGCSError()) ? asynSuccess : asynError;
+}
+
+/** start (\a startMode 1) or stop (\a startMode 0) the generators with a single "WGO" */
+asynStatus PIGCSController::startWaveGenerators(const int* generators, int numGenerators, int startMode)
+{
+	char cmd[PIInterface::MAX_CMD_LEN] = "WGO";
+	size_t len = strlen(cmd);
+	for (int i=0; i<numGenerators && len<PIInterface::MAX_CMD_LEN-20; i++)
+	{
+		len += sprintf(cmd+len, " %d %d", generators[i], startMode);
+	}
+	asynStatus status = m_pInterface->sendOnly(cmd);
+	if (status != asynSuccess)
+	{
+		return status;
+	}
+	return (COM_NO_ERROR == getGCSError()) ? asynSuccess : asynError;
+}
+
+/** bit n of \a runningMask is set while wave generator n+1 is running */
+asynStatus PIGCSController::getRunningWaveGenerators(int& runningMask)
+{
+	char buf[255];
+	asynStatus status = m_pInterface->sendAndReceive(char(9), buf, 99);
+	if (status != asynSuccess)
+	{
+		return status;
+	}
+	runningMask = strtol(buf, NULL, 16);
+	return status;
+}
+
 asynStatus PIGCSController::haltAxis(PIasynAxis* pAxis)
 {
 	char cmd[100];
@@ -299,6 +586,13 @@ asynStatus PIGCSController::getAxisPosition(PIasynAxis* pAxis, double& position)
 {
 	char cmd[100];
 	char buf[255];
+	int axis = pAxis->getAxisNo();
+	if (m_bPollCycle && axis >= 0 && size_t(axis) < MAX_NR_AXES && m_bPollPosition[axis])
+	{
+		m_bPollPosition[axis] = false;
+		position = m_pollPosition[axis];
+		return asynSuccess;
+	}
 	sprintf(cmd, "POS? %s", pAxis->m_szAxisName);
 	asynStatus status = m_pInterface->sendAndReceive(cmd, buf, 99);
 	if (status != asynSuccess)
@@ -501,7 +795,7 @@ asynStatus PIGCSController::setServo(PIasynAxis* pAxis, int servoState)
 asynStatus PIGCSController::getMoving(PIasynAxis* pAxis, int& moving)
 {
 	char buf[255];
-    asynStatus status = m_pInterface->sendAndReceive(char(5), buf, 99);;
+    asynStatus status = sendAndReceivePoll(char(5), buf, 99);
     if (status != asynSuccess)
     {
 //printf("PIGCSController::getMoving() failed, status %d", status);
@@ -518,7 +812,7 @@ return status;
 asynStatus PIGCSController::getBusy(PIasynAxis* pAxis, int& busy)
 {
 	char buf[255];
-    asynStatus status = m_pInterface->sendAndReceive(char(7), buf, 99);;
+    asynStatus status = sendAndReceivePoll(char(7), buf, 99);
     if (status != asynSuccess)
     {
     	return status;
@@ -562,8 +856,95 @@ PIGCSController::PIGCSController(PIInterface* pInterface, const char* szIDN)
 , m_bAnyAxisMoving(false)
 , m_nrFoundAxes(0)
 , m_LastError(0)
+, m_bPollCycle(false)
+, m_nrPollReplies(0)
 {
 	strncpy(szIdentification, szIDN, 199);
+	memset(m_bPollPosition, 0, sizeof(m_bPollPosition));
+}
+
+/**
+ *  start a new poll cycle: forget the replies of the last cycle and read the positions
+ *  of all axes with a single "POS?".
+ *  Derived classes may override this to read other data of all axes at once.
+ */
+asynStatus PIGCSController::startPollCycle(int numAxes)
+{
+	m_bPollCycle = true;
+	m_nrPollReplies = 0;
+	return readAllAxesPositions(numAxes);
+}
+
+/**
+ *  read the positions of all axes with "POS?", the reply has one line "<axisID>=<position>"
+ *  per axis. getAxisPosition() takes the value of an axis once during the current poll cycle.
+ */
+asynStatus PIGCSController::readAllAxesPositions(int numAxes)
+{
+	char buf[2048];
+	memset(m_bPollPosition, 0, sizeof(m_bPollPosition));
+	asynStatus status = m_pInterface->sendAndReceive("POS?", buf, sizeof(buf)-1);
+	if (status != asynSuccess)
+	{
+		return status;
+	}
+	char* pLine = buf;
+	while (pLine != NULL && *pLine != '\0')
+	{
+		char* pLF = strchr(pLine, '\n');
+		if (pLF != NULL)
+		{
+			*pLF = '\0';
+		}
+		while (*pLine == ' ') pLine++;
+		char* pEq = strchr(pLine, '=');
+		if (pEq != NULL)
+		{
+			size_t len = pEq - pLine;
+			while (len > 0 && pLine[len-1] == ' ') len--;
+			for (int axis=0; axis<numAxes && size_t(axis)<m_nrFoundAxes; axis++)
+			{
+				if (strlen(m_axesIDs[axis]) == len && strncmp(m_axesIDs[axis], pLine, len) == 0)
+				{
+					m_pollPosition[axis] = atof(pEq+1);
+					m_bPollPosition[axis] = true;
+					break;
+				}
+			}
+		}
+		pLine = (pLF != NULL) ? pLF+1 : NULL;
+	}
+	return status;
+}
+
+/**
+ *  send a single character query which reports all axes (e.g. #4, #5, #7).
+ *  Within a poll cycle the controller is asked only once, the other axes get the same reply.
+ */
+asynStatus PIGCSController::sendAndReceivePoll(char c, char* inputBuff, int inputSize)
+{
+	if (!m_bPollCycle)
+	{
+		return m_pInterface->sendAndReceive(c, inputBuff, inputSize);
+	}
+	for (int i=0; i<m_nrPollReplies; i++)
+	{
+		if (m_pollReplyCmd[i] == c)
+		{
+			strncpy(inputBuff, m_pollReply[i], inputSize);
+			inputBuff[inputSize-1] = '\0';
+			return asynSuccess;
+		}
+	}
+	asynStatus status = m_pInterface->sendAndReceive(c, inputBuff, inputSize);
+	if (status == asynSuccess && m_nrPollReplies < MAX_POLL_REPLIES)
+	{
+		m_pollReplyCmd[m_nrPollReplies] = c;
+		strncpy(m_pollReply[m_nrPollReplies], inputBuff, sizeof(m_pollReply[0]));
+		m_pollReply[m_nrPollReplies][sizeof(m_pollReply[0])-1] = '\0';
+		m_nrPollReplies++;
+	}
+	return status;
 }
 
 PIGCSController::~PIGCSController()
@@ -65,6 +65,8 @@ public:
     virtual asynStatus getResolution(PIasynAxis* pAxis, double& resolution );
     virtual asynStatus getStatus(PIasynAxis* pAxis, int& homing, int& moving, int& negLimit, int& posLimit, int& servoControl) = 0;
     virtual asynStatus getGlobalState( asynMotorAxis** Axes, int numAxes ) { return asynSuccess; }
+    virtual asynStatus startPollCycle(int numAxes);
+    void endPollCycle() { m_bPollCycle = false; }
     virtual asynStatus getMoving(PIasynAxis* pAxis, int& homing);
     virtual asynStatus getBusy(PIasynAxis* pAxis, int& busy);
     virtual asynStatus getTravelLimits(PIasynAxis* pAxis, double& negLimit, double& posLimit);
@@ -90,10 +92,38 @@ public:
 
     int getGCSError();
 
+    /**
+     * GCS data recorder, tables are numbered from 1.
+     * readDataRecorder() reads \a numPoints points starting with \a firstPoint
+     * of tables 1..numTables with a single "DRR?" and stores them point by point in \a data.
+     */
+    virtual asynStatus getNrDataRecorderTables(int& nrTables);
+    virtual asynStatus configDataRecorder(int table, const char* source, int option);
+    virtual asynStatus setDataRecorderRate(int rate);
+    virtual asynStatus setDataRecorderTrigger(int trigger);
+    virtual asynStatus getDataRecorderPoints(int table, int& nrPoints);
+    virtual asynStatus readDataRecorder(int firstPoint, int numPoints, int numTables,
+                                        char* replyBuff, int replySize,
+                                        double* data, int& numRead, double& sampleTime);
+
+    /**
+     * Wave generator, used for profile moves. Axis n uses wave table and wave generator n+1.
+     * Only controllers with HasWaveGenerator() support these commands.
+     */
+    virtual bool HasWaveGenerator() { return false; }
+    virtual asynStatus getNrWaveGenerators(int& nrGenerators);
+    virtual asynStatus getMaxWaveTableLength(int table, int& maxPoints);
+    virtual asynStatus getServoCycleTime(PIasynAxis* pAxis, double& cycleTime);
+    virtual asynStatus writeWaveTable(int table, const double* points, int numPoints);
+    virtual asynStatus setupWaveGenerator(int generator, int table, int rate, double offset);
+    virtual asynStatus startWaveGenerators(const int* generators, int numGenerators, int startMode);
+    virtual asynStatus getRunningWaveGenerators(int& runningMask);
+
     int GetLastError() { return m_LastError; }
 
     PIInterface* m_pInterface;
     static const size_t MAX_NR_AXES = 64;
+    static const int MAX_POLL_REPLIES = 4;
 	bool m_bAnyAxisMoving;
 protected:
     asynStatus setGCSParameter(PIasynAxis* pAxis, unsigned int paramID, double value);
@@ -101,6 +131,9 @@ protected:
 
     virtual asynStatus findConnectedAxes();
 
+    asynStatus sendAndReceivePoll(char c, char* inputBuff, int inputSize);
+    asynStatus readAllAxesPositions(int numAxes);
+
     static bool IsGCS2(PIInterface* pInterface);
 
 	char szIdentification[200];
@@ -111,6 +144,17 @@ protected:
 	int m_LastError;
 
     bool m_KnowsVELcommand;
+
+    /**
+     * Replies of the multi-axis queries, read once per poll cycle and decoded for each axis.
+     * A cycle starts with PIasynController::poll() and ends after the poll of the last axis.
+     */
+    bool m_bPollCycle;
+    double m_pollPosition[MAX_NR_AXES];
+    bool m_bPollPosition[MAX_NR_AXES];
+    int m_nrPollReplies;
+    char m_pollReplyCmd[MAX_POLL_REPLIES];
+    char m_pollReply[MAX_POLL_REPLIES][256];
 };
 
 #endif /* PIGCSCONTROLLER_H_ */
@@ -136,14 +136,13 @@ asynStatus PIGCSMotorController::getResolution(PIasynAxis* pAxis, double& resolu
 asynStatus PIGCSMotorController::getStatus(PIasynAxis* pAxis, int& homing, int& moving, int& negLimit, int& posLimit, int& servoControl)
 {
     char buf[255];
-    asynStatus status = m_pInterface->sendAndReceive(char(4), buf, 99);
+    asynStatus status = sendAndReceivePoll(char(4), buf, 99);
     if (status != asynSuccess)
     {
         return status;
     }
-    // TODO this is for a single axis C-863/867 controller!!!!
-    // TODO a) change it to multi-axis code.
-    // TODO b) support other controllers which do not understand #4 or have different bit masks
+    // #4 reports all axes, "0x" followed by 4 hex digits per axis; it is read once per poll cycle
+    // TODO support other controllers which do not understand #4 or have different bit masks
 
     int idx = 2 + pAxis->getAxisNo()*4;
     buf[idx+4] = '\0';
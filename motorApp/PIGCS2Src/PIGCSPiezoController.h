@@ -39,6 +39,8 @@ public:
     virtual asynStatus getStatus(PIasynAxis* pAxis, int& homing, int& moving, int& negLimit, int& posLimit, int& servoControl);
     virtual asynStatus getReferencedState(PIasynAxis* pAxis);
 
+    virtual bool HasWaveGenerator() { return true; }
+
 
 private:
 
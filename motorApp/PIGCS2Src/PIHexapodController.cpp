@@ -86,6 +86,22 @@ return status;
 
 }
 
+/**
+ *  while moving or homing the hexapod reads positions with #3 (see getAxisPosition()),
+ *  so "POS?" is only sent when it is at rest.
+ */
+asynStatus PIHexapodController::startPollCycle(int numAxes)
+{
+	if (!m_bAnyAxisMoving)
+	{
+		return PIGCSController::startPollCycle(numAxes);
+	}
+	m_bPollCycle = true;
+	m_nrPollReplies = 0;
+	memset(m_bPollPosition, 0, sizeof(m_bPollPosition));
+	return asynSuccess;
+}
+
 asynStatus PIHexapodController::getStatus(PIasynAxis* pAxis, int& homing, int& moving, int& negLimit, int& posLimit, int& servoControl)
 {
     negLimit = 0;
@@ -234,7 +250,7 @@ asynStatus PIHexapodController::getAxisPosition(PIasynAxis* pAxis, double& posit
 	if (m_bCanReadPosWithChar3)
 	{
 		char buf[255];
-		asynStatus status = m_pInterface->sendAndReceive(char(3), buf, 99);
+		asynStatus status = sendAndReceivePoll(char(3), buf, 99);
 		if (status != asynSuccess)
 		{
 			return status;
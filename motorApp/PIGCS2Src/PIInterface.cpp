@@ -44,26 +44,36 @@ PIInterface::~PIInterface()
 
 asynStatus PIInterface::sendOnly(const char *outputBuff, asynUser* logSink)
 {
+    char output[MAX_CMD_LEN+1];
     size_t nRequested = strlen(outputBuff);
-    size_t nActual;
+    size_t nActual = 0;
     asynStatus status;
+    epicsTimeStamp start;
 
     asynPrint(logSink, ASYN_TRACEIO_DRIVER,
     		"PIInterface::sendOnly() sending \"%s\"\n", outputBuff);
-    //printf("PIInterface::sendOnly() sending \"%s\"\n", outputBuff);
+    if (nRequested >= MAX_CMD_LEN)
+    {
+        asynPrint(logSink, ASYN_TRACE_ERROR|ASYN_TRACEIO_DRIVER,
+                  "PIGCSController:sendOnly: command too long %s\n", outputBuff);
+        return asynError;
+    }
+    /* command and terminator in one write */
+    memcpy(output, outputBuff, nRequested);
+    output[nRequested++] = '\n';
 
-    status = pasynOctetSyncIO->write(m_pAsynInterface, outputBuff,
+    epicsTimeGetCurrent(&start);
+    status = pasynOctetSyncIO->write(m_pAsynInterface, output,
                                      nRequested, TIMEOUT, &nActual);
     if (nActual != nRequested)
 		status = asynError;
-    status = pasynOctetSyncIO->write(m_pAsynInterface, "\n",
-                                     1, TIMEOUT, &nActual);
     if (status != asynSuccess)
     {
         asynPrint(logSink, ASYN_TRACE_ERROR|ASYN_TRACEIO_DRIVER,
                   "PIGCSController:sendOnly: error sending command %s, sent=%d, status=%d\n",
-                  outputBuff, nActual, status);
+                  outputBuff, int(nActual), status);
     }
+    addCmdTime(outputBuff, start);
     return(status);
 }
 
@@ -93,57 +103,118 @@ asynStatus PIInterface::sendOnly(char c, asynUser* logSink)
 
 asynStatus PIInterface::sendAndReceive(const char *outputBuff, char *inputBuff, int inputSize, asynUser* logSink)
 {
+    char output[MAX_CMD_LEN+1];
     size_t nWriteRequested=strlen(outputBuff);
-    size_t nWrite, nRead;
-    int eomReason;
-    asynStatus status;
-    size_t pos = 0;
+
     asynPrint(logSink, ASYN_TRACEIO_DRIVER,
     		"PIInterface::sendAndReceive() sending \"%s\"\n", outputBuff);
-//    //printf("PIInterface::sendAndReceive() sending \"%s\"\n", outputBuff);
-
-    status = pasynOctetSyncIO->write(m_pAsynInterface, outputBuff,
-    		nWriteRequested, TIMEOUT, &nWrite);
-    if (nWrite != nWriteRequested)
-	{
-        asynPrint(logSink, ASYN_TRACE_ERROR|ASYN_TRACEIO_DRIVER,
-                  "PIGCSController:sendAndReceive error calling write, output=%s status=%d, error=%s\n",
-                  outputBuff, status, m_pAsynInterface->errorMessage);
-    	return asynError;
-	}
-
-     status = pasynOctetSyncIO->writeRead(m_pAsynInterface,
-                                         "\n", 1,
-                                         inputBuff, inputSize,
-                                         TIMEOUT, &nWrite, &nRead, &eomReason);
-    if (nWrite != 1)
-	{
-        asynPrint(logSink, ASYN_TRACE_ERROR|ASYN_TRACEIO_DRIVER,
-                  "PIGCSController:sendAndReceive error calling write, output=%s status=%d, error=%s\n",
-                  outputBuff, status, m_pAsynInterface->errorMessage);
-    	return asynError;
-	}
-
-    if (status != asynSuccess)
+    if (nWriteRequested >= MAX_CMD_LEN)
     {
         asynPrint(logSink, ASYN_TRACE_ERROR|ASYN_TRACEIO_DRIVER,
-                  "PIGCSController:sendAndReceive error calling writeRead, output=%s status=%d, error=%s\n",
-                  outputBuff, status, m_pAsynInterface->errorMessage);
+                  "PIGCSController:sendAndReceive command too long, output=%s\n", outputBuff);
+        return asynError;
     }
-    while(inputBuff[strlen(inputBuff)-1] == ' ')
-    {
-    	inputBuff[strlen(inputBuff)] = '\n';
-    	pos += nRead + 1;
-        status = pasynOctetSyncIO->read(m_pAsynInterface,
-                                             inputBuff+pos, inputSize-pos,
-                                             TIMEOUT, &nRead, &eomReason);
+    /* command and terminator in one write */
+    memcpy(output, outputBuff, nWriteRequested);
+    output[nWriteRequested++] = '\n';
 
+    return transaction(output, nWriteRequested, outputBuff, inputBuff, inputSize, logSink);
+}
+
+/**
+ *  one write/read transaction on the asyn port: the complete command is written and the
+ *  first reply line read in a single writeRead().
+ *  GCS multi-line replies end every line but the last one with a space before the LF.
+ *  The state machine reads the following lines until the last one, joining them with LF
+ *  in \a inputBuff. The time of the complete transaction is added to the statistics of \a cmdName.
+ */
+asynStatus PIInterface::transaction(const char* output, size_t outputLen, const char* cmdName,
+                                    char *inputBuff, int inputSize, asynUser* logSink)
+{
+    enum { FIRST_LINE, NEXT_LINE, DONE } state = FIRST_LINE;
+    size_t nWrite = 0, nRead = 0;
+    size_t pos = 0;
+    int eomReason;
+    asynStatus status = asynSuccess;
+    epicsTimeStamp start;
+
+    if (inputSize < 2)
+    	return asynError;
+    inputBuff[0] = '\0';
+    epicsTimeGetCurrent(&start);
+
+    while (state != DONE)
+    {
+    	switch (state)
+    	{
+    	case FIRST_LINE:
+            status = pasynOctetSyncIO->writeRead(m_pAsynInterface,
+                                                 output, outputLen,
+                                                 inputBuff, inputSize-1,
+                                                 TIMEOUT, &nWrite, &nRead, &eomReason);
+            if (nWrite != outputLen)
+            {
+                asynPrint(logSink, ASYN_TRACE_ERROR|ASYN_TRACEIO_DRIVER,
+                          "PIGCSController:sendAndReceive error calling write, output=%s status=%d, error=%s\n",
+                          cmdName, status, m_pAsynInterface->errorMessage);
+                status = asynError;
+            }
+            break;
+    	case NEXT_LINE:
+    		inputBuff[pos++] = '\n';
+            status = pasynOctetSyncIO->read(m_pAsynInterface,
+                                            inputBuff+pos, inputSize-1-pos,
+                                            TIMEOUT, &nRead, &eomReason);
+            break;
+    	case DONE:
+    		break;
+    	}
+    	if (status != asynSuccess)
+    	{
+            asynPrint(logSink, ASYN_TRACE_ERROR|ASYN_TRACEIO_DRIVER,
+                      "PIGCSController:sendAndReceive error calling writeRead, output=%s status=%d, error=%s\n",
+                      cmdName, status, m_pAsynInterface->errorMessage);
+            nRead = 0;
+    	}
+    	pos += nRead;
+    	inputBuff[pos] = '\0';
+
+    	/* another line follows if this one ends with a space */
+    	if (status != asynSuccess || nRead == 0 || inputBuff[pos-1] != ' ')
+    		state = DONE;
+    	else if (pos + 2 >= size_t(inputSize))
+    	{
+            asynPrint(logSink, ASYN_TRACE_ERROR|ASYN_TRACEIO_DRIVER,
+                      "PIGCSController:sendAndReceive reply to %s longer than %d bytes\n",
+                      cmdName, inputSize);
+            status = asynOverflow;
+    		state = DONE;
+    	}
+    	else
+    		state = NEXT_LINE;
     }
+    addCmdTime(cmdName, start);
     asynPrint(logSink, ASYN_TRACEIO_DRIVER,
     		"PIInterface::sendAndReceive() received \"%s\"\n", inputBuff);
- //   //printf("PIInterface::sendAndReceive() received \"%s\"\n", inputBuff);
 
-   return(status);
+    return(status);
+}
+
+/**
+ *  add the time since \a start to the statistics of the command, the command name is
+ *  the GCS mnemonic up to the first space, e.g. "POS?"
+ */
+void PIInterface::addCmdTime(const char* cmdName, const epicsTimeStamp& start)
+{
+	epicsTimeStamp now;
+
+	epicsTimeGetCurrent(&now);
+	m_cmdStats.add(cmdName, strcspn(cmdName, " \n"), epicsTimeDiffInSeconds(&now, &start));
+}
+
+void PIInterface::report(FILE *fp, int level)
+{
+	m_cmdStats.report(fp);
 }
 
 
@@ -193,42 +264,10 @@ asynStatus PIInterface::sendAndReceive(const char* output, char *inputBuff, int
 
 asynStatus PIInterface::sendAndReceive(char c, char *inputBuff, int inputSize, asynUser* logSink)
 {
-    size_t nWrite, nRead;
-    int eomReason;
-    asynStatus status;
-    size_t pos = 0;
+    char cmdName[8];
 
     asynPrint(logSink, ASYN_TRACEIO_DRIVER,
     		"PIInterface::sendAndReceive() sending \"#%d\"\n", int(c));
-    //printf("PIInterface::sendAndReceive() sending \"#%d\"\n", int(c));
-    status = pasynOctetSyncIO->writeRead(m_pAsynInterface,
-                                         &c, 1,
-                                         inputBuff, inputSize,
-                                         TIMEOUT, &nWrite, &nRead, &eomReason);
-    if (nWrite != 1)
-		status = asynError;
-
-    if (status != asynSuccess)
-    {
-        asynPrint(logSink, ASYN_TRACE_ERROR|ASYN_TRACEIO_DRIVER,
-                  "PIInterface::sendAndReceive error calling writeRead, output=%d status=%d, error=%s\n",
-                  int(c), status, m_pAsynInterface->errorMessage);
-        //printf("PIInterface::sendAndReceive error calling writeRead, output=%d status=%d, error=%s\n", int(c), status, pInterface->errorMessage);
-    }
-
-    while(inputBuff[strlen(inputBuff)-1] == ' ')
-    {
-    	pos += nRead;
-        status = pasynOctetSyncIO->writeRead(m_pAsynInterface,
-                                             &c, 1,
-                                             inputBuff+pos, inputSize-pos,
-                                             TIMEOUT, &nWrite, &nRead, &eomReason);
-//printf("PIInterface::sendAndReceive(char) in while loop. inputBuff: \"%s\"\n", inputBuff);
-    }
-    asynPrint(logSink, ASYN_TRACEIO_DRIVER,
-    		"PIInterface::sendAndReceive() received \"%s\"\n", inputBuff);
-    //printf("PIInterface::sendAndReceive() received \"%s\" - (0x%02X)\n", inputBuff, int(inputBuff[0]));
-
-    return(status);
+    sprintf(cmdName, "#%d", int(c));
+    return transaction(&c, 1, cmdName, inputBuff, inputSize, logSink);
 }
-
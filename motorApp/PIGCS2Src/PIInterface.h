@@ -15,7 +15,10 @@ Created: 15.12.2010
 #ifndef PIINTERFACE_H_INCLUDED
 #define PIINTERFACE_H_INCLUDED
 
+#include <stdio.h>
 #include <epicsMutex.h>
+#include <epicsTime.h>
+#include "asynMotorCommandStats.h"
 
 
 class PIInterface
@@ -36,13 +39,24 @@ public:
 	asynStatus sendAndReceive(const char* output, char *inputBuff, int inputSize);
 	asynStatus sendAndReceive(char c, char *inputBuff, int inputSize, asynUser* logSink);
 
+	void report(FILE *fp, int level);
+
     asynUser* m_pCurrentLogSink;
 
+    static const size_t MAX_CMD_LEN = 256;
+
 protected:
+    asynStatus transaction(const char* output, size_t outputLen, const char* cmdName,
+                           char *inputBuff, int inputSize, asynUser* logSink);
+    void addCmdTime(const char* cmdName, const epicsTimeStamp& start);
+
     static double TIMEOUT;
 	epicsMutex m_interfaceMutex;
 
 	asynUser* m_pAsynInterface;
+
+	/** timing of the transactions, one entry per GCS command, printed by report() */
+	asynMotorCommandStats m_cmdStats;
 };
 
 #endif // PIINTERFACE_H_INCLUDED
@@ -137,10 +137,9 @@ asynStatus PIasynAxis::poll(bool *returnMoving)
 		if (!m_isHoming || m_pGCSController->IsGCS2())
 		{
 			m_bServoControl = (servoControl == 1);
-			m_pGCSController->getAxisPositionCts(this);
-			double realPosition;
-			m_pGCSController->getAxisPosition(this, realPosition);
-			setDoubleParam(pController_->PI_SUP_POSITION,      realPosition );
+			// getAxisPositionCts() also sets m_position, no second POS? needed
+			if (m_pGCSController->getAxisPositionCts(this) == asynSuccess)
+				setDoubleParam(pController_->PI_SUP_POSITION,      m_position );
 		}
     }
     if (m_isHoming)
@@ -163,6 +162,10 @@ asynStatus PIasynAxis::poll(bool *returnMoving)
 
     callParamCallbacks();
 
+    // the base class poller polls the axes in order, the cached replies end with the last one
+    if (axisNo_ == pController_->numAxes_ - 1)
+    	m_pGCSController->endPollCycle();
+
     *returnMoving = m_bMoving;
     return asynSuccess;
 }
@@ -222,7 +225,7 @@ asynStatus PIasynAxis::move(double position, int relative, double minVelocity, d
 
 		status = m_pGCSController->moveCts(this, position);
    }
-    epicsEventSignal(pController_->pollEventId_);
+    pController_->wakeupPoller();
 
     asynPrint(pasynUser_, ASYN_TRACE_FLOW,
         "%s:%s: Set driver %s, axis %d move to %f, min vel=%f, max_vel=%f, accel=%f, deffered=%d - status=%d\n",
@@ -258,7 +261,7 @@ asynStatus PIasynAxis::moveVelocity(double minVelocity, double maxVelocity, doub
     m_pGCSController->setVelocityCts(this, maxVelocity);
     m_pGCSController->move(this, target);
 
-    epicsEventSignal(pController_->pollEventId_);
+    pController_->wakeupPoller();
 
     asynPrint(pasynUser_, ASYN_TRACE_FLOW,
         "%s:%s: Set port %s, axis %d move with velocity of %f, accel=%f / target %f - AFTER MOV\n",
@@ -275,7 +278,7 @@ asynStatus PIasynAxis::stop(double acceleration)
 
     m_pGCSController->haltAxis(this);
 
-    epicsEventSignal(pController_->pollEventId_);
+    pController_->wakeupPoller();
 
     asynPrint(pasynUser_, ASYN_TRACE_FLOW,
         "%s:%s: Set axis %d to stop with accel=%f",
@@ -301,7 +304,7 @@ asynStatus PIasynAxis::home(double minVelocity, double maxVelocity, double accel
     	return status;
     }
     setIntegerParam(pController_->motorStatusHomed_, m_homed );
-    epicsEventSignal(pController_->pollEventId_);
+    pController_->wakeupPoller();
 
     asynPrint(pasynUser_, ASYN_TRACE_FLOW,
         "%s:%s: Set driver %s, axis %d to home %s, min vel=%f, max_vel=%f, accel=%f",
@@ -314,7 +317,7 @@ asynStatus PIasynAxis::setPosition(double position)
 	m_pGCSController->m_pInterface->m_pCurrentLogSink = pasynUser_;
 	asynStatus status = asynError;
 	status = m_pGCSController->setAxisPositionCts(this, position);
-    epicsEventSignal(pController_->pollEventId_);
+    pController_->wakeupPoller();
 
     asynPrint(pasynUser_, ASYN_TRACE_FLOW,
         "%s:%s: Set driver %s, axis %d set position to %f - status=%d\n",
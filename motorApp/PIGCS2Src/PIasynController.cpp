@@ -25,6 +25,7 @@ Based on drvMotorSim.c, Mark Rivers, December 13, 2009
 
 #include <epicsTime.h>
 #include <epicsThread.h>
+#include <epicsEvent.h>
 #include <epicsString.h>
 #include <epicsMutex.h>
 #include <ellLib.h>
@@ -51,8 +52,18 @@ static const char *driverName = "PIasynDriver";
 static ELLLIST PIasynControllerList;
 static int PIasynControllerListInitialized = 0;
 
+/** the readout stops when no new points were recorded for DREC_MAX_IDLE*DREC_IDLE_SLEEP seconds */
+static const double DREC_IDLE_SLEEP = 0.05;
+static const int DREC_MAX_IDLE = 20;
+
+static void PIDataRecorderTaskC(void *drvPvt)
+{
+    PIasynController *pController = (PIasynController*)drvPvt;
+    pController->dataRecorderTask();
+}
+
 PIasynController::PIasynController(const char *portName, const char* asynPort, int numAxes, int priority, int stackSize, int movingPollPeriod, int idlePollPeriod)
-    : asynMotorController(portName, numAxes, 10,
+    : asynMotorController(portName, numAxes, 18,
             asynInt32Mask | asynFloat64Mask,
             asynInt32Mask | asynFloat64Mask,
             ASYN_CANBLOCK | ASYN_MULTIDEVICE,
@@ -60,6 +71,20 @@ PIasynController::PIasynController(const char *portName, const char* asynPort, i
             priority, stackSize)
 	, movesDeferred( 0 )
 	, m_pGCSController( NULL )
+	, m_drecThread( NULL )
+	, m_drecReading( false )
+	, m_drecBusy( false )
+	, m_drecNumTables( 0 )
+	, m_drecNumPoints( 0 )
+	, m_drecSampleTime( 0.0 )
+	, m_drecData( NULL )
+	, m_drecTimes( NULL )
+	, m_drecPage( NULL )
+	, m_drecReply( NULL )
+	, m_profileBuilt( false )
+	, m_profileNumAxes( 0 )
+	, m_profileRate( 1 )
+	, m_profileStartPolls( 0 )
 {
     createParam(PI_SUP_POSITION_String,		asynParamFloat64,	&PI_SUP_POSITION);
     createParam(PI_SUP_TARGET_String,		asynParamFloat64,	&PI_SUP_TARGET);
@@ -71,6 +96,20 @@ PIasynController::PIasynController(const char *portName, const char* asynPort, i
     createParam(PI_SUP_RBPIVOT_X_String,	asynParamFloat64,	&PI_SUP_RBPIVOT_X);
     createParam(PI_SUP_RBPIVOT_Y_String,	asynParamFloat64,	&PI_SUP_RBPIVOT_Y);
     createParam(PI_SUP_RBPIVOT_Z_String,	asynParamFloat64,	&PI_SUP_RBPIVOT_Z);
+    createParam(PI_SUP_DREC_RATE_String,	asynParamInt32,		&PI_SUP_DREC_RATE);
+    createParam(PI_SUP_DREC_TRIGGER_String,	asynParamInt32,		&PI_SUP_DREC_TRIGGER);
+    createParam(PI_SUP_DREC_OPTION_String,	asynParamInt32,		&PI_SUP_DREC_OPTION);
+    createParam(PI_SUP_DREC_CONFIG_String,	asynParamInt32,		&PI_SUP_DREC_CONFIG);
+    createParam(PI_SUP_DREC_READ_String,	asynParamInt32,		&PI_SUP_DREC_READ);
+    createParam(PI_SUP_DREC_NPOINTS_String,	asynParamInt32,		&PI_SUP_DREC_NPOINTS);
+    createParam(PI_SUP_DREC_DATA_String,	asynParamFloat64Array,	&PI_SUP_DREC_DATA);
+    createParam(PI_SUP_DREC_TIMES_String,	asynParamFloat64Array,	&PI_SUP_DREC_TIMES);
+
+    m_drecEvent = epicsEventMustCreate(epicsEventEmpty);
+    setIntegerParam(PI_SUP_DREC_RATE, 1);
+    setIntegerParam(PI_SUP_DREC_TRIGGER, 0);
+    setIntegerParam(PI_SUP_DREC_READ, 0);
+    setIntegerParam(PI_SUP_DREC_NPOINTS, 0);
 
     int axis;
     PIasynAxis *pAxis;
@@ -150,10 +189,12 @@ PIasynController::PIasynController(const char *portName, const char* asynPort, i
 		return;
 	}
 
+    m_drecData = (double**) calloc(numAxes, sizeof(double*));
     for (axis=0; axis<numAxes; axis++)
     {
         pAxis  = new PIasynAxis(this, m_pGCSController, axis, m_pGCSController->getAxesID(axis));
         pAxis->Init(portName);
+        setIntegerParam(axis, PI_SUP_DREC_OPTION, 0);
     }
 
     startPoller(double(movingPollPeriod)/1000, double(idlePollPeriod)/1000, 10);
@@ -185,6 +226,13 @@ void PIasynController::report(FILE *fp, int level)
         }
     }
 
+    if (level > 0)
+    {
+        fprintf(fp, "  data recorder: %d table(s), %d point(s) read, readout %s\n",
+            m_drecNumTables, m_drecNumPoints, m_drecReading ? "running" : "stopped");
+        m_pGCSController->m_pInterface->report(fp, level);
+    }
+
     // Call the base class method
     asynMotorController::report(fp, level);
 }
@@ -234,7 +282,7 @@ asynStatus PIasynController::processDeferredMoves()
         	getPIAxis(axis)->deferred_move = 0;
         }
     }
-    epicsEventSignal(pollEventId_);
+    wakeupPoller();
 
     return status;
 }
@@ -280,6 +328,32 @@ asynStatus PIasynController::writeInt32(asynUser *pasynUser, epicsInt32 value)
             processDeferredMoves();
         }
         this->movesDeferred = value;
+    }
+    else if (function == PI_SUP_DREC_CONFIG)
+    {
+        if (value != 0)
+        {
+            status = configDataRecorder();
+        }
+    }
+    else if (function == PI_SUP_DREC_READ)
+    {
+        if (value != 0)
+        {
+            status = startDataRecorderReadout();
+            if (status != asynSuccess)
+            {
+                setIntegerParam(PI_SUP_DREC_READ, 0);
+            }
+        }
+        else
+        {
+            m_drecReading = false;
+        }
+    }
+    else if (function == PI_SUP_DREC_RATE || function == PI_SUP_DREC_TRIGGER || function == PI_SUP_DREC_OPTION)
+    {
+        /* sent to the controller with PI_SUP_DREC_CONFIG */
     } else {
         /* Call base class call its method (if we have our parameters check this here) */
         status = asynMotorController::writeInt32(pasynUser, value);
@@ -371,6 +445,607 @@ asynStatus PIasynController::writeFloat64(asynUser *pasynUser, epicsFloat64 valu
 
 
 
+/** Returns the data recorder arrays, all other arrays are handled by the base class */
+asynStatus PIasynController::readFloat64Array(asynUser *pasynUser, epicsFloat64 *value, size_t nElements, size_t *nRead)
+{
+    int function = pasynUser->reason;
+    const double* pData = NULL;
+    int addr;
+
+    if (function != PI_SUP_DREC_DATA && function != PI_SUP_DREC_TIMES)
+    {
+        return asynMotorController::readFloat64Array(pasynUser, value, nElements, nRead);
+    }
+    getAddress(pasynUser, &addr);
+    if (function == PI_SUP_DREC_TIMES)
+    {
+        pData = m_drecTimes;
+    }
+    else if (addr >= 0 && addr < numAxes_ && m_drecData != NULL)
+    {
+        pData = m_drecData[addr];
+    }
+    *nRead = 0;
+    if (pData != NULL)
+    {
+        *nRead = m_drecNumPoints;
+        if (*nRead > nElements) *nRead = nElements;
+        memcpy(value, pData, *nRead*sizeof(double));
+    }
+    return asynSuccess;
+}
+
+/** Sends the data recorder configuration, every axis with PI_SUP_DREC_OPTION > 0 gets the next table */
+asynStatus PIasynController::configDataRecorder()
+{
+    asynStatus status;
+    int nrTables, option, rate, trigger;
+    int numTables = 0;
+
+    if (m_drecBusy)
+    {
+        asynPrint(pasynUserSelf, ASYN_TRACE_ERROR|ASYN_TRACE_FLOW,
+                  "PIasynController::configDataRecorder() readout is running\n");
+        return asynError;
+    }
+    m_drecNumTables = 0;
+    status = m_pGCSController->getNrDataRecorderTables(nrTables);
+    if (status != asynSuccess)
+    {
+        return status;
+    }
+    if (nrTables > PI_DREC_MAX_TABLES)
+    {
+        nrTables = PI_DREC_MAX_TABLES;
+    }
+    for (int axis=0; axis<numAxes_; axis++)
+    {
+        getIntegerParam(axis, PI_SUP_DREC_OPTION, &option);
+        if (option <= 0)
+        {
+            continue;
+        }
+        if (numTables >= nrTables)
+        {
+            asynPrint(pasynUserSelf, ASYN_TRACE_ERROR|ASYN_TRACE_FLOW,
+                      "PIasynController::configDataRecorder() only %d data recorder tables available\n", nrTables);
+            return asynError;
+        }
+        status = m_pGCSController->configDataRecorder(numTables+1, getPIAxis(axis)->m_szAxisName, option);
+        if (status != asynSuccess)
+        {
+            return status;
+        }
+        if (m_drecData[axis] == NULL)
+        {
+            m_drecData[axis] = (double*) calloc(DREC_MAX_POINTS, sizeof(double));
+        }
+        m_drecTableAxis[numTables++] = axis;
+    }
+
+    getIntegerParam(PI_SUP_DREC_RATE, &rate);
+    getIntegerParam(PI_SUP_DREC_TRIGGER, &trigger);
+    if (rate > 0)
+    {
+        status = m_pGCSController->setDataRecorderRate(rate);
+    }
+    if (status == asynSuccess)
+    {
+        status = m_pGCSController->setDataRecorderTrigger(trigger);
+    }
+    m_drecNumTables = numTables;
+    return status;
+}
+
+/** Starts streaming the recorded points into the PI_SUP_DREC_DATA arrays */
+asynStatus PIasynController::startDataRecorderReadout()
+{
+    if (m_drecNumTables == 0)
+    {
+        asynPrint(pasynUserSelf, ASYN_TRACE_ERROR|ASYN_TRACE_FLOW,
+                  "PIasynController::startDataRecorderReadout() no data recorder table configured\n");
+        return asynError;
+    }
+    if (m_drecBusy)
+    {
+        asynPrint(pasynUserSelf, ASYN_TRACE_ERROR|ASYN_TRACE_FLOW,
+                  "PIasynController::startDataRecorderReadout() readout is already running\n");
+        return asynError;
+    }
+    if (m_drecThread == NULL)
+    {
+        m_drecTimes = (double*) calloc(DREC_MAX_POINTS, sizeof(double));
+        m_drecPage = (double*) calloc(DREC_PAGE_POINTS*PI_DREC_MAX_TABLES, sizeof(double));
+        m_drecReply = (char*) calloc(DREC_REPLY_SIZE, sizeof(char));
+        m_drecThread = epicsThreadCreate("PIDataRecorder",
+                                         epicsThreadPriorityMedium,
+                                         epicsThreadGetStackSize(epicsThreadStackMedium),
+                                         (EPICSTHREADFUNC)PIDataRecorderTaskC, (void *)this);
+    }
+    m_drecNumPoints = 0;
+    m_drecSampleTime = 0.0;
+    setIntegerParam(PI_SUP_DREC_NPOINTS, 0);
+    m_drecReading = true;
+    m_drecBusy = true;
+    epicsEventSignal(m_drecEvent);
+    return asynSuccess;
+}
+
+/**
+ * Readout thread of the data recorder.
+ * Reads the recorded points page by page with "DRR?" without holding the port lock,
+ * the PIInterface serializes the transactions with the poller. Only the copy of a page
+ * into the arrays and the callbacks are done with the lock held.
+ */
+void PIasynController::dataRecorderTask()
+{
+    while (true)
+    {
+        epicsEventMustWait(m_drecEvent);
+
+        int numTables = m_drecNumTables;
+        int pagePoints = (DREC_REPLY_SIZE - 1024) / (16 * numTables);
+        if (pagePoints > DREC_PAGE_POINTS)
+        {
+            pagePoints = DREC_PAGE_POINTS;
+        }
+        int nrIdle = 0;
+        while (m_drecReading && m_drecNumPoints < DREC_MAX_POINTS)
+        {
+            int nrRecorded = 0;
+            asynStatus status = m_pGCSController->getDataRecorderPoints(1, nrRecorded);
+            if (status != asynSuccess)
+            {
+                break;
+            }
+            int numPoints = nrRecorded - m_drecNumPoints;
+            if (numPoints <= 0)
+            {
+                /* nothing recorded yet or recording finished */
+                if (m_drecNumPoints > 0 && ++nrIdle >= DREC_MAX_IDLE)
+                {
+                    break;
+                }
+                epicsThreadSleep(DREC_IDLE_SLEEP);
+                continue;
+            }
+            nrIdle = 0;
+            if (numPoints > pagePoints)
+            {
+                numPoints = pagePoints;
+            }
+            if (numPoints > DREC_MAX_POINTS - m_drecNumPoints)
+            {
+                numPoints = DREC_MAX_POINTS - m_drecNumPoints;
+            }
+            int numRead = 0;
+            double sampleTime = m_drecSampleTime;
+            status = m_pGCSController->readDataRecorder(m_drecNumPoints+1, numPoints, numTables,
+                                                        m_drecReply, DREC_REPLY_SIZE,
+                                                        m_drecPage, numRead, sampleTime);
+            if (status != asynSuccess || numRead == 0)
+            {
+                break;
+            }
+
+            lock();
+            m_drecSampleTime = sampleTime;
+            for (int point=0; point<numRead; point++)
+            {
+                int index = m_drecNumPoints + point;
+                for (int table=0; table<numTables; table++)
+                {
+                    m_drecData[m_drecTableAxis[table]][index] = m_drecPage[point*numTables + table];
+                }
+                m_drecTimes[index] = index * sampleTime;
+            }
+            m_drecNumPoints += numRead;
+            setIntegerParam(PI_SUP_DREC_NPOINTS, m_drecNumPoints);
+            for (int table=0; table<numTables; table++)
+            {
+                int axis = m_drecTableAxis[table];
+                doCallbacksFloat64Array(m_drecData[axis], m_drecNumPoints, PI_SUP_DREC_DATA, axis);
+            }
+            doCallbacksFloat64Array(m_drecTimes, m_drecNumPoints, PI_SUP_DREC_TIMES, 0);
+            callParamCallbacks();
+            unlock();
+        }
+
+        lock();
+        m_drecReading = false;
+        m_drecBusy = false;
+        setIntegerParam(PI_SUP_DREC_READ, 0);
+        callParamCallbacks();
+        unlock();
+    }
+}
+
+/** Allocates the profile arrays, called from PI_GCS2_CreateProfile() */
+asynStatus PIasynController::createProfile(size_t maxPoints)
+{
+    lock();
+    asynStatus status = initializeProfile(maxPoints);
+    unlock();
+    return status;
+}
+
+/**
+ * Checks the profile against the wave generators of the controller and writes the
+ * positions of all used axes to their wave tables. The wave generator runs with a
+ * fixed rate, so all times of the profile must be the same.
+ */
+asynStatus PIasynController::buildProfile()
+{
+    static const char *functionName = "buildProfile";
+    char message[256];
+    bool buildOK = false;
+    double* wave = NULL;
+    double cycleTime;
+    int numPoints, useAxis, nrGenerators, maxPoints;
+    int axis, i;
+
+    // Call the base class method which will build the time array if needed
+    asynMotorController::buildProfile();
+
+    strcpy(message, "");
+    setStringParam(profileBuildMessage_, message);
+    setIntegerParam(profileBuildState_, PROFILE_BUILD_BUSY);
+    setIntegerParam(profileBuildStatus_, PROFILE_STATUS_UNDEFINED);
+    callParamCallbacks();
+
+    m_profileBuilt = false;
+    m_profileNumAxes = 0;
+    getIntegerParam(profileNumPoints_, &numPoints);
+    if (!m_pGCSController->HasWaveGenerator())
+    {
+        sprintf(message, "Controller has no wave generator");
+        goto done;
+    }
+    if (numPoints < 2 || size_t(numPoints) > maxProfilePoints_)
+    {
+        sprintf(message, "Invalid number of points %d", numPoints);
+        goto done;
+    }
+    for (i=1; i<numPoints; i++)
+    {
+        if (fabs(profileTimes_[i] - profileTimes_[0]) > 1e-6 * profileTimes_[0])
+        {
+            sprintf(message, "Wave generator needs equal times, time %d differs", i);
+            goto done;
+        }
+    }
+    if (m_pGCSController->getNrWaveGenerators(nrGenerators) != asynSuccess)
+    {
+        sprintf(message, "Error reading the number of wave generators");
+        goto done;
+    }
+    for (axis=0; axis<numAxes_; axis++)
+    {
+        getIntegerParam(axis, profileUseAxis_, &useAxis);
+        if (!useAxis)
+        {
+            continue;
+        }
+        if (axis >= nrGenerators || m_profileNumAxes >= PI_DREC_MAX_TABLES/2)
+        {
+            sprintf(message, "No wave generator for axis %d", axis);
+            goto done;
+        }
+        if (m_pGCSController->getMaxWaveTableLength(axis+1, maxPoints) != asynSuccess)
+        {
+            sprintf(message, "Error reading the wave table length of axis %d", axis);
+            goto done;
+        }
+        if (numPoints > maxPoints)
+        {
+            sprintf(message, "%d points exceed the wave table length %d of axis %d", numPoints, maxPoints, axis);
+            goto done;
+        }
+        m_profileGenerators[m_profileNumAxes] = axis+1;
+        m_profileAxes[m_profileNumAxes++] = axis;
+    }
+    if (m_profileNumAxes == 0)
+    {
+        sprintf(message, "No axis used in profile");
+        goto done;
+    }
+    if (m_pGCSController->getServoCycleTime(getPIAxis(m_profileAxes[0]), cycleTime) != asynSuccess || cycleTime <= 0.0)
+    {
+        sprintf(message, "Error reading the servo cycle time");
+        goto done;
+    }
+    m_profileRate = int(floor(profileTimes_[0] / cycleTime + 0.5));
+    if (m_profileRate < 1)
+    {
+        sprintf(message, "Time per point %f is shorter than the servo cycle %f", profileTimes_[0], cycleTime);
+        goto done;
+    }
+
+    /* positions are in counts, the wave table needs physical units */
+    wave = (double*) calloc(numPoints, sizeof(double));
+    for (i=0; i<m_profileNumAxes; i++)
+    {
+        PIasynAxis* pAxis = getPIAxis(m_profileAxes[i]);
+        for (int point=0; point<numPoints; point++)
+        {
+            wave[point] = pAxis->profilePositions_[point] * pAxis->m_CPUdenominator / pAxis->m_CPUnumerator;
+        }
+        if (m_pGCSController->writeWaveTable(m_profileGenerators[i], wave, numPoints) != asynSuccess)
+        {
+            sprintf(message, "Error writing the wave table of axis %d", m_profileAxes[i]);
+            goto done;
+        }
+    }
+    buildOK = true;
+    m_profileBuilt = true;
+    strcpy(message, " ");
+
+  done:
+    if (wave) free(wave);
+    setIntegerParam(profileBuildStatus_, buildOK ? PROFILE_STATUS_SUCCESS : PROFILE_STATUS_FAILURE);
+    setStringParam(profileBuildMessage_, message);
+    if (!buildOK)
+    {
+        asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+                  "%s:%s: %s\n",
+                  driverName, functionName, message);
+    }
+    /* Clear build command.  This is a "busy" record, don't want to do this until build is complete. */
+    setIntegerParam(profileBuild_, 0);
+    setIntegerParam(profileBuildState_, PROFILE_BUILD_DONE);
+    callParamCallbacks();
+    return buildOK ? asynSuccess : asynError;
+}
+
+/**
+ * Sets up the wave generators and the data recorder and moves the axes to the first point.
+ * The wave generators are started by pollProfile() when the axes are there, so
+ * the execute record does not block the port.
+ */
+asynStatus PIasynController::executeProfile()
+{
+    static const char *functionName = "executeProfile";
+    char message[256];
+    PIasynAxis* pAxesArray[PI_DREC_MAX_TABLES/2];
+    int targetsCts[PI_DREC_MAX_TABLES/2];
+    int moveMode, nrTables;
+    int i;
+
+    strcpy(message, " ");
+    setStringParam(profileExecuteMessage_, message);
+    setIntegerParam(profileExecuteState_, PROFILE_EXECUTE_MOVE_START);
+    setIntegerParam(profileExecuteStatus_, PROFILE_STATUS_UNDEFINED);
+    callParamCallbacks();
+
+    if (!m_profileBuilt)
+    {
+        setProfileExecuteDone(PROFILE_STATUS_FAILURE, "Profile is not built");
+        return asynError;
+    }
+    if (m_drecBusy)
+    {
+        setProfileExecuteDone(PROFILE_STATUS_FAILURE, "Data recorder readout is running");
+        return asynError;
+    }
+    getIntegerParam(profileMoveMode_, &moveMode);
+
+    /* two data recorder tables per axis: target and current position */
+    if (m_pGCSController->getNrDataRecorderTables(nrTables) != asynSuccess || nrTables < 2*m_profileNumAxes)
+    {
+        setProfileExecuteDone(PROFILE_STATUS_FAILURE, "Not enough data recorder tables for the readback");
+        return asynError;
+    }
+    m_drecNumTables = 0;
+    for (i=0; i<m_profileNumAxes; i++)
+    {
+        PIasynAxis* pAxis = getPIAxis(m_profileAxes[i]);
+        double offset = (moveMode == PROFILE_MOVE_MODE_RELATIVE) ? pAxis->m_position : 0.0;
+        if (m_pGCSController->configDataRecorder(2*i+1, pAxis->m_szAxisName, 1) != asynSuccess
+         || m_pGCSController->configDataRecorder(2*i+2, pAxis->m_szAxisName, 2) != asynSuccess
+         || m_pGCSController->setupWaveGenerator(m_profileGenerators[i], m_profileGenerators[i], m_profileRate, offset) != asynSuccess)
+        {
+            sprintf(message, "Error setting up the wave generator of axis %d", m_profileAxes[i]);
+            setProfileExecuteDone(PROFILE_STATUS_FAILURE, message);
+            return asynError;
+        }
+        pAxesArray[i] = pAxis;
+        targetsCts[i] = int(floor(pAxis->profilePositions_[0] + 0.5));
+        if (moveMode == PROFILE_MOVE_MODE_RELATIVE)
+        {
+            targetsCts[i] += pAxis->m_positionCts;
+        }
+    }
+    /* the recorder starts with WGO */
+    if (m_pGCSController->setDataRecorderRate(m_profileRate) != asynSuccess
+     || m_pGCSController->setDataRecorderTrigger(0) != asynSuccess)
+    {
+        setProfileExecuteDone(PROFILE_STATUS_FAILURE, "Error setting up the data recorder");
+        return asynError;
+    }
+    if (m_pGCSController->moveCts(pAxesArray, targetsCts, m_profileNumAxes) != asynSuccess)
+    {
+        setProfileExecuteDone(PROFILE_STATUS_FAILURE, "Error moving to the start position");
+        return asynError;
+    }
+    asynPrint(pasynUserSelf, ASYN_TRACE_FLOW,
+              "%s:%s: %d axes, %d servo cycles per point\n",
+              driverName, functionName, m_profileNumAxes, m_profileRate);
+    m_profileStartPolls = 0;
+    wakeupPoller();
+    return asynSuccess;
+}
+
+/** Stops the wave generators */
+asynStatus PIasynController::abortProfile()
+{
+    int state;
+
+    getIntegerParam(profileExecuteState_, &state);
+    if (state == PROFILE_EXECUTE_DONE)
+    {
+        return asynSuccess;
+    }
+    asynStatus status = m_pGCSController->startWaveGenerators(m_profileGenerators, m_profileNumAxes, 0);
+    setProfileExecuteDone(PROFILE_STATUS_ABORT, "Profile aborted");
+    return status;
+}
+
+void PIasynController::setProfileExecuteDone(int status, const char* message)
+{
+    setIntegerParam(profileExecuteStatus_, status);
+    setStringParam(profileExecuteMessage_, message);
+    if (status == PROFILE_STATUS_FAILURE)
+    {
+        asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+                  "%s:executeProfile: %s\n",
+                  driverName, message);
+    }
+    /* Clear execute command.  This is a "busy" record, don't want to do this until execution is complete. */
+    setIntegerParam(profileExecute_, 0);
+    setIntegerParam(profileExecuteState_, PROFILE_EXECUTE_DONE);
+    callParamCallbacks();
+}
+
+/**
+ * Called by poll() with the lock held: starts the wave generators when the axes
+ * reached the first point and detects the end of the profile.
+ */
+void PIasynController::pollProfile()
+{
+    int state, runningMask, numPoints, i;
+
+    getIntegerParam(profileExecuteState_, &state);
+    if (state == PROFILE_EXECUTE_MOVE_START)
+    {
+        /* the moving flags are updated by the axis polls, wait for one complete cycle after MOV */
+        if (++m_profileStartPolls < 2)
+        {
+            return;
+        }
+        for (i=0; i<m_profileNumAxes; i++)
+        {
+            if (getPIAxis(m_profileAxes[i])->m_bMoving)
+            {
+                return;
+            }
+        }
+        if (m_pGCSController->startWaveGenerators(m_profileGenerators, m_profileNumAxes, 1) != asynSuccess)
+        {
+            setProfileExecuteDone(PROFILE_STATUS_FAILURE, "Error starting the wave generators");
+            return;
+        }
+        setIntegerParam(profileExecuteState_, PROFILE_EXECUTE_EXECUTING);
+    }
+    else if (state == PROFILE_EXECUTE_EXECUTING)
+    {
+        if (m_pGCSController->getRunningWaveGenerators(runningMask) != asynSuccess)
+        {
+            setProfileExecuteDone(PROFILE_STATUS_FAILURE, "Error reading the wave generator state");
+            return;
+        }
+        for (i=0; i<m_profileNumAxes; i++)
+        {
+            if (runningMask & (1 << (m_profileGenerators[i]-1)))
+            {
+                return;
+            }
+        }
+        getIntegerParam(profileNumPoints_, &numPoints);
+        setIntegerParam(profileCurrentPoint_, numPoints);
+        setProfileExecuteDone(PROFILE_STATUS_SUCCESS, " ");
+    }
+}
+
+/** Reads target and current positions of the last profile from the data recorder */
+asynStatus PIasynController::readbackProfile()
+{
+    static const char *functionName = "readbackProfile";
+    char message[256];
+    bool readbackOK = false;
+    int numReadbacks = 0;
+    int nrRecorded = 0;
+    int numTables = 2*m_profileNumAxes;
+    double sampleTime = 0.0;
+
+    strcpy(message, "");
+    setStringParam(profileReadbackMessage_, message);
+    setIntegerParam(profileReadbackState_, PROFILE_READBACK_BUSY);
+    setIntegerParam(profileReadbackStatus_, PROFILE_STATUS_UNDEFINED);
+    callParamCallbacks();
+
+    if (m_profileNumAxes == 0 || m_drecBusy)
+    {
+        sprintf(message, "No profile data available");
+        goto done;
+    }
+    if (m_drecReply == NULL)
+    {
+        m_drecPage = (double*) calloc(DREC_PAGE_POINTS*PI_DREC_MAX_TABLES, sizeof(double));
+        m_drecReply = (char*) calloc(DREC_REPLY_SIZE, sizeof(char));
+    }
+    if (m_pGCSController->getDataRecorderPoints(1, nrRecorded) != asynSuccess)
+    {
+        sprintf(message, "Error reading the number of recorded points");
+        goto done;
+    }
+    if (size_t(nrRecorded) > maxProfilePoints_)
+    {
+        nrRecorded = maxProfilePoints_;
+    }
+    while (numReadbacks < nrRecorded)
+    {
+        int numPoints = nrRecorded - numReadbacks;
+        int numRead = 0;
+        if (numPoints > DREC_PAGE_POINTS)
+        {
+            numPoints = DREC_PAGE_POINTS;
+        }
+        if (m_pGCSController->readDataRecorder(numReadbacks+1, numPoints, numTables,
+                                               m_drecReply, DREC_REPLY_SIZE,
+                                               m_drecPage, numRead, sampleTime) != asynSuccess || numRead == 0)
+        {
+            sprintf(message, "Error reading the data recorder at point %d", numReadbacks+1);
+            goto done;
+        }
+        for (int point=0; point<numRead; point++)
+        {
+            for (int i=0; i<m_profileNumAxes; i++)
+            {
+                PIasynAxis* pAxis = getPIAxis(m_profileAxes[i]);
+                double scale = double(pAxis->m_CPUnumerator) / pAxis->m_CPUdenominator;
+                double target = m_drecPage[point*numTables + 2*i] * scale;
+                double actual = m_drecPage[point*numTables + 2*i + 1] * scale;
+                pAxis->profileReadbacks_[numReadbacks+point] = actual;
+                pAxis->profileFollowingErrors_[numReadbacks+point] = actual - target;
+            }
+        }
+        numReadbacks += numRead;
+    }
+    readbackOK = true;
+    strcpy(message, " ");
+
+  done:
+    setIntegerParam(profileNumReadbacks_, numReadbacks);
+    /* Convert from controller to user units and post the arrays */
+    for (int i=0; i<m_profileNumAxes && readbackOK; i++)
+    {
+        getPIAxis(m_profileAxes[i])->readbackProfile();
+    }
+    setIntegerParam(profileReadbackStatus_, readbackOK ? PROFILE_STATUS_SUCCESS : PROFILE_STATUS_FAILURE);
+    setStringParam(profileReadbackMessage_, message);
+    if (!readbackOK)
+    {
+        asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+                  "%s:%s: %s\n",
+                  driverName, functionName, message);
+    }
+    /* Clear readback command.  This is a "busy" record, don't want to do this until readback is complete. */
+    setIntegerParam(profileReadback_, 0);
+    setIntegerParam(profileReadbackState_, PROFILE_READBACK_DONE);
+    callParamCallbacks();
+    return readbackOK ? asynSuccess : asynError;
+}
+
 asynStatus PIasynController::profileMove(asynUser *pasynUser, int npoints, double positions[], double times[], int relative, int trigger )
 {
 	asynPrint(pasynUser, ASYN_TRACE_FLOW|ASYN_TRACE_ERROR,
@@ -418,7 +1093,7 @@ asynStatus PIasynController::configAxis(PIasynAxis *pAxis)
 
     /* Send a signal to the poller task which will make it do a poll,
      * updating values for this axis to use the new resolution (stepSize) */
-    epicsEventSignal(pollEventId_);
+    wakeupPoller();
 
     return(asynSuccess);
 }
@@ -486,6 +1161,7 @@ asynStatus PIasynController::configAxis(PIasynAxis *pAxis)
 asynStatus PIasynController::poll()
 {
     m_pGCSController->getGlobalState(pAxes_, numAxes_);
+    m_pGCSController->startPollCycle(numAxes_);
 
     setDoubleParam( 0, PI_SUP_RBPIVOT_X, m_pGCSController->GetPivotX());
     setDoubleParam( 0, PI_SUP_RBPIVOT_Y, m_pGCSController->GetPivotY());
@@ -493,6 +1169,11 @@ asynStatus PIasynController::poll()
 
     setIntegerParam( 0, PI_SUP_LAST_ERR, m_pGCSController->GetLastError() );
 
+    if (m_profileNumAxes > 0)
+    {
+        pollProfile();
+    }
+
     callParamCallbacks();
     return asynSuccess;
 }
@@ -529,9 +1210,44 @@ static void PI_GCS2_CreateControllerCallFunc(const iocshArgBuf *args)
 }
 
 
+/** Allocates the profile move arrays of a controller, called directly or from iocsh */
+extern "C" int PI_GCS2_CreateProfile(const char *portName, int maxPoints)
+{
+    PIasynControllerNode *pNode;
+
+    if (!PIasynControllerListInitialized)
+    {
+        printf("PI_GCS2_CreateProfile: no controllers\n");
+        return asynError;
+    }
+    for (pNode = (PIasynControllerNode*) ellFirst(&PIasynControllerList);
+         pNode != NULL;
+         pNode = (PIasynControllerNode*) ellNext(&pNode->node))
+    {
+        if (strcmp(pNode->portName, portName) == 0)
+        {
+            return pNode->pController->createProfile(maxPoints);
+        }
+    }
+    printf("PI_GCS2_CreateProfile: controller %s not found\n", portName);
+    return asynError;
+}
+
+static const iocshArg PI_GCS2_CreateProfileArg0 = {"Port name", iocshArgString};
+static const iocshArg PI_GCS2_CreateProfileArg1 = {"Max points", iocshArgInt};
+static const iocshArg * const PI_GCS2_CreateProfileArgs[] = {&PI_GCS2_CreateProfileArg0,
+                                                             &PI_GCS2_CreateProfileArg1};
+static const iocshFuncDef PI_GCS2_CreateProfileDef = {"PI_GCS2_CreateProfile", 2, PI_GCS2_CreateProfileArgs};
+static void PI_GCS2_CreateProfileCallFunc(const iocshArgBuf *args)
+{
+    PI_GCS2_CreateProfile(args[0].sval, args[1].ival);
+}
+
+
 static void PIasynDriverRegister(void)
 {
     iocshRegister(&PI_GCS2_CreateControllerDef, PI_GCS2_CreateControllerCallFunc);
+    iocshRegister(&PI_GCS2_CreateProfileDef, PI_GCS2_CreateProfileCallFunc);
 }
 
 extern "C" {
@@ -24,20 +24,38 @@ December 13, 2009
 class PIasynAxis;
 class PIGCSController;
 
+/** maximum number of data recorder tables read out together */
+#define PI_DREC_MAX_TABLES 16
+
 class PIasynController : asynMotorController {
 public:
     PIasynController(const char *portName, const char* asynPort, int numAxes, int priority, int stackSize, int movingPollPeriod, int idlePollPeriod);
     asynStatus writeInt32(asynUser *pasynUser, epicsInt32 value);
     asynStatus writeFloat64(asynUser *pasynUser, epicsFloat64 value);
+    asynStatus readFloat64Array(asynUser *pasynUser, epicsFloat64 *value, size_t nElements, size_t *nRead);
     void report(FILE *fp, int level);
     asynStatus profileMove(asynUser *pasynUser, int npoints, double positions[], double times[], int relative, int trigger);
     asynStatus triggerProfile(asynUser *pasynUser);
     asynStatus configAxis(PIasynAxis *pAxis);
 
+    /* profile moves with the wave generator of the controller */
+    asynStatus createProfile(size_t maxPoints);
+    asynStatus buildProfile();
+    asynStatus executeProfile();
+    asynStatus abortProfile();
+    asynStatus readbackProfile();
+
     PIasynAxis* getPIAxis(asynUser *pasynUser) { return (PIasynAxis*)asynMotorController::getAxis(pasynUser); }
     PIasynAxis* getPIAxis(int axisNo) { return (PIasynAxis*)asynMotorController::getAxis(axisNo); }
 
     virtual asynStatus poll();
+    void dataRecorderTask();
+
+    /** points per table kept in the data recorder arrays */
+    static const int DREC_MAX_POINTS = 16384;
+    /** points per table read with one "DRR?" */
+    static const int DREC_PAGE_POINTS = 100;
+    static const int DREC_REPLY_SIZE = 16384;
 
     friend class PIasynAxis;
 
@@ -47,6 +65,10 @@ private:
     int movesDeferred;
     //int numAxes;
     asynStatus processDeferredMoves();
+    asynStatus configDataRecorder();
+    asynStatus startDataRecorderReadout();
+    void pollProfile();
+    void setProfileExecuteDone(int status, const char* message);
     //PIasynAxis** m_pAxes;
     
     PIGCSController* m_pGCSController;
@@ -61,6 +83,44 @@ private:
     int PI_SUP_RBPIVOT_X;
     int PI_SUP_RBPIVOT_Y;
     int PI_SUP_RBPIVOT_Z;
+    int PI_SUP_DREC_RATE;
+    int PI_SUP_DREC_TRIGGER;
+    int PI_SUP_DREC_OPTION;
+    int PI_SUP_DREC_CONFIG;
+    int PI_SUP_DREC_READ;
+    int PI_SUP_DREC_NPOINTS;
+    int PI_SUP_DREC_DATA;
+    int PI_SUP_DREC_TIMES;
+
+    /**
+     * Data recorder readout, done by its own thread page by page while the
+     * recorder is running, so the poller is never blocked by a long "DRR?".
+     * Table i+1 records the axis m_drecTableAxis[i].
+     */
+    epicsThreadId m_drecThread;
+    epicsEventId m_drecEvent;
+    bool m_drecReading;
+    bool m_drecBusy;
+    int m_drecNumTables;
+    int m_drecTableAxis[PI_DREC_MAX_TABLES];
+    int m_drecNumPoints;
+    double m_drecSampleTime;
+    double** m_drecData;
+    double* m_drecTimes;
+    double* m_drecPage;
+    char* m_drecReply;
+
+    /**
+     * Profile move: the axes m_profileAxes[] run their wave generators with
+     * m_profileRate servo cycles per point, the data recorder records target and
+     * current position of each of them for readbackProfile().
+     */
+    bool m_profileBuilt;
+    int m_profileNumAxes;
+    int m_profileAxes[PI_DREC_MAX_TABLES/2];
+    int m_profileGenerators[PI_DREC_MAX_TABLES/2];
+    int m_profileRate;
+    int m_profileStartPolls;
 
 };
 
@@ -75,6 +135,14 @@ private:
 #define PI_SUP_RBPIVOT_X_String		"PI_SUP_RBPIVOT_X"
 #define PI_SUP_RBPIVOT_Y_String		"PI_SUP_RBPIVOT_Y"
 #define PI_SUP_RBPIVOT_Z_String		"PI_SUP_RBPIVOT_Z"
+#define PI_SUP_DREC_RATE_String		"PI_SUP_DREC_RATE"
+#define PI_SUP_DREC_TRIGGER_String	"PI_SUP_DREC_TRIGGER"
+#define PI_SUP_DREC_OPTION_String	"PI_SUP_DREC_OPTION"
+#define PI_SUP_DREC_CONFIG_String	"PI_SUP_DREC_CONFIG"
+#define PI_SUP_DREC_READ_String		"PI_SUP_DREC_READ"
+#define PI_SUP_DREC_NPOINTS_String	"PI_SUP_DREC_NPOINTS"
+#define PI_SUP_DREC_DATA_String		"PI_SUP_DREC_DATA"
+#define PI_SUP_DREC_TIMES_String	"PI_SUP_DREC_TIMES"
 
 
 typedef struct PIasynControllerNode {
@@ -38,6 +38,9 @@ using namespace std;
 //Used for casting position doubles to integers
 #define NINT(f) (int)((f)>0 ? (f)+0.5 : (f)-0.5)
 
+//Frames a command as sendPhytronCommand does: STX, module address 0, command, separator, no checksum, ETX
+#define PHYTRON_TELEGRAM(cmd) "\002" "0" cmd ":XX" "\003"
+
 /*
  * Contains phytronController instances, phytronCreateAxis uses it to find and
  * bind axis object to the correct controller object.
@@ -119,6 +122,13 @@ phytronController::phytronController(const char *phytronPortName, const char *as
     //phytronCreateAxis will search for the controller for axis registration
     controllers.push_back(this);
 
+    /*
+     * The poller writes the status telegrams of several axes back-to-back and
+     * reads the replies afterwards, which needs every reply to end at its ETX
+     */
+    pasynOctetSyncIO->setInputEos(pasynUserController_, "\3", 1);
+    setBurstPipelining(true);
+
     //RESET THE CONTROLLER
     sprintf(this->outString_, "CR");
     phyStatus = sendPhytronCommand(this->outString_, this->inString_, MAX_CONTROLLER_STRING_SIZE, &response_len);
@@ -197,45 +207,45 @@ asynStatus phytronController::readInt32(asynUser *pasynUser, epicsInt32 *value)
     //Called only on initialization of AXIS-RESET and AXIS-STATUS-RESET bo records
     return asynSuccess;
   } else if (pasynUser->reason == axisMode_){
-    sprintf(this->outString_, "M%.1fP01R", pAxis->axisModuleNo_);
+    sprintf(this->outString_, "%sP01R", pAxis->cmdPrefix_);
   } else if(pasynUser->reason == mopOffsetPos_){
-    sprintf(this->outString_, "M%.1fP11R", pAxis->axisModuleNo_);
+    sprintf(this->outString_, "%sP11R", pAxis->cmdPrefix_);
   } else if(pasynUser->reason == mopOffsetNeg_){
-    sprintf(this->outString_, "M%.1fP12R", pAxis->axisModuleNo_);
+    sprintf(this->outString_, "%sP12R", pAxis->cmdPrefix_);
   } else if (pasynUser->reason == stepResolution_){
-    sprintf(this->outString_, "M%.1fP45R", pAxis->axisModuleNo_);
+    sprintf(this->outString_, "%sP45R", pAxis->cmdPrefix_);
   } else if (pasynUser->reason == stopCurrent_){
-    sprintf(this->outString_, "M%.1fP40R", pAxis->axisModuleNo_);
+    sprintf(this->outString_, "%sP40R", pAxis->cmdPrefix_);
   } else if (pasynUser->reason == runCurrent_){
-    sprintf(this->outString_, "M%.1fP41R", pAxis->axisModuleNo_);
+    sprintf(this->outString_, "%sP41R", pAxis->cmdPrefix_);
   } else if (pasynUser->reason == boostCurrent_){
-    sprintf(this->outString_, "M%.1fP42R", pAxis->axisModuleNo_);
+    sprintf(this->outString_, "%sP42R", pAxis->cmdPrefix_);
   } else if (pasynUser->reason == encoderType_){
-    sprintf(this->outString_, "M%.1fP34R", pAxis->axisModuleNo_);
+    sprintf(this->outString_, "%sP34R", pAxis->cmdPrefix_);
   } else if(pasynUser->reason == initRecoveryTime_){
-    sprintf(this->outString_, "M%.1fP13R", pAxis->axisModuleNo_);
+    sprintf(this->outString_, "%sP13R", pAxis->cmdPrefix_);
   } else if(pasynUser->reason == positionRecoveryTime_){
-    sprintf(this->outString_, "M%.1fP16R", pAxis->axisModuleNo_);
+    sprintf(this->outString_, "%sP16R", pAxis->cmdPrefix_);
   } else if(pasynUser->reason == boost_){
-    sprintf(this->outString_, "M%.1fP17R", pAxis->axisModuleNo_);
+    sprintf(this->outString_, "%sP17R", pAxis->cmdPrefix_);
   } else if(pasynUser->reason == encoderRate_){
-    sprintf(this->outString_, "M%.1fP26R", pAxis->axisModuleNo_);
+    sprintf(this->outString_, "%sP26R", pAxis->cmdPrefix_);
   } else if(pasynUser->reason == switchTyp_){
-    sprintf(this->outString_, "M%.1fP27R", pAxis->axisModuleNo_);
+    sprintf(this->outString_, "%sP27R", pAxis->cmdPrefix_);
   } else if(pasynUser->reason == pwrStageMode_){
-    sprintf(this->outString_, "M%.1fP28R", pAxis->axisModuleNo_);
+    sprintf(this->outString_, "%sP28R", pAxis->cmdPrefix_);
   } else if(pasynUser->reason == encoderRes_){
-    sprintf(this->outString_, "M%.1fP35R", pAxis->axisModuleNo_);
+    sprintf(this->outString_, "%sP35R", pAxis->cmdPrefix_);
   } else if(pasynUser->reason == encoderFunc_){
-    sprintf(this->outString_, "M%.1fP36R", pAxis->axisModuleNo_);
+    sprintf(this->outString_, "%sP36R", pAxis->cmdPrefix_);
   } else if(pasynUser->reason == encoderSFIWidth_){
-    sprintf(this->outString_, "M%.1fP37R", pAxis->axisModuleNo_);
+    sprintf(this->outString_, "%sP37R", pAxis->cmdPrefix_);
   } else if(pasynUser->reason == encoderDirection_){
-    sprintf(this->outString_, "M%.1fP38R", pAxis->axisModuleNo_);
+    sprintf(this->outString_, "%sP38R", pAxis->cmdPrefix_);
   } else if(pasynUser->reason == currentDelayTime_){
-    sprintf(this->outString_, "M%.1fP43R", pAxis->axisModuleNo_);
+    sprintf(this->outString_, "%sP43R", pAxis->cmdPrefix_);
   } else if(pasynUser->reason == powerStageMonitor_){
-    sprintf(this->outString_, "M%.1fP53R", pAxis->axisModuleNo_);
+    sprintf(this->outString_, "%sP53R", pAxis->cmdPrefix_);
   }
 
 
@@ -309,55 +319,55 @@ asynStatus phytronController::writeInt32(asynUser *pasynUser, epicsInt32 value)
     callParamCallbacks();
     return asynSuccess;
   } else if(pasynUser->reason == axisReset_){
-    sprintf(this->outString_, "M%.1fC", pAxis->axisModuleNo_);
+    sprintf(this->outString_, "%sC", pAxis->cmdPrefix_);
   } else if(pasynUser->reason == axisStatusReset_){
     sprintf(this->outString_, "SEC%.1f", pAxis->axisModuleNo_);
   } else if(pasynUser->reason == axisMode_){
-    sprintf(this->outString_, "M%.1fP01=%d", pAxis->axisModuleNo_,value);
+    sprintf(this->outString_, "%sP01=%d", pAxis->cmdPrefix_,value);
   } else if(pasynUser->reason == mopOffsetPos_){
-    sprintf(this->outString_, "M%.1fP11=%d", pAxis->axisModuleNo_,value);
+    sprintf(this->outString_, "%sP11=%d", pAxis->cmdPrefix_,value);
   } else if(pasynUser->reason == mopOffsetNeg_){
-    sprintf(this->outString_, "M%.1fP12=%d", pAxis->axisModuleNo_,value);
+    sprintf(this->outString_, "%sP12=%d", pAxis->cmdPrefix_,value);
   } else if (pasynUser->reason == stepResolution_){
-    sprintf(this->outString_, "M%.1fP45=%d", pAxis->axisModuleNo_,value);
+    sprintf(this->outString_, "%sP45=%d", pAxis->cmdPrefix_,value);
   }  else if (pasynUser->reason == stopCurrent_){
     value /= 10; //STOP_CURRENT record has EGU mA, device expects 10mA
-    sprintf(this->outString_, "M%.1fP40=%d", pAxis->axisModuleNo_,value);
+    sprintf(this->outString_, "%sP40=%d", pAxis->cmdPrefix_,value);
   } else if (pasynUser->reason == runCurrent_){
     value /= 10; //RUN_CURRENT record has EGU mA, device expects 10mA
-    sprintf(this->outString_, "M%.1fP41=%d", pAxis->axisModuleNo_,value);
+    sprintf(this->outString_, "%sP41=%d", pAxis->cmdPrefix_,value);
   } else if (pasynUser->reason == boostCurrent_){
     value /= 10; //BOOST_CURRENT record has EGU mA, device expects 10mA
-    sprintf(this->outString_, "M%.1fP42=%d", pAxis->axisModuleNo_,value);
+    sprintf(this->outString_, "%sP42=%d", pAxis->cmdPrefix_,value);
   } else if (pasynUser->reason == encoderType_){
-    sprintf(this->outString_, "M%.1fP34=%d", pAxis->axisModuleNo_, value);
+    sprintf(this->outString_, "%sP34=%d", pAxis->cmdPrefix_, value);
   } else if (pasynUser->reason == initRecoveryTime_){
-    sprintf(this->outString_, "M%.1fP13=%d", pAxis->axisModuleNo_, value);
+    sprintf(this->outString_, "%sP13=%d", pAxis->cmdPrefix_, value);
   } else if (pasynUser->reason == positionRecoveryTime_){
-    sprintf(this->outString_, "M%.1fP16=%d", pAxis->axisModuleNo_, value);
+    sprintf(this->outString_, "%sP16=%d", pAxis->cmdPrefix_, value);
   } else if (pasynUser->reason == boost_){
-    sprintf(this->outString_, "M%.1fP17=%d", pAxis->axisModuleNo_, value);
+    sprintf(this->outString_, "%sP17=%d", pAxis->cmdPrefix_, value);
   } else if (pasynUser->reason == encoderRate_){
-    sprintf(this->outString_, "M%.1fP26=%d", pAxis->axisModuleNo_, value);
+    sprintf(this->outString_, "%sP26=%d", pAxis->cmdPrefix_, value);
   } else if (pasynUser->reason == switchTyp_){
-    sprintf(this->outString_, "M%.1fP27=%d", pAxis->axisModuleNo_, value);
+    sprintf(this->outString_, "%sP27=%d", pAxis->cmdPrefix_, value);
   } else if (pasynUser->reason == pwrStageMode_){
-    sprintf(this->outString_, "M%.1fP28=%d", pAxis->axisModuleNo_, value);
+    sprintf(this->outString_, "%sP28=%d", pAxis->cmdPrefix_, value);
   } else if (pasynUser->reason == encoderRes_){
-    sprintf(this->outString_, "M%.1fP35=%d", pAxis->axisModuleNo_, value);
+    sprintf(this->outString_, "%sP35=%d", pAxis->cmdPrefix_, value);
   } else if (pasynUser->reason == encoderFunc_){
     //Value is VAL field of parameter P37 record. If P37 is positive P36 is set to 1, else 0
-    sprintf(this->outString_, "M%.1fP36=%d", pAxis->axisModuleNo_, value > 0 ? 1 : 0);
+    sprintf(this->outString_, "%sP36=%d", pAxis->cmdPrefix_, value > 0 ? 1 : 0);
   } else if(pasynUser->reason == encoderSFIWidth_){
-    sprintf(this->outString_, "M%.1fP37=%d", pAxis->axisModuleNo_, value);
+    sprintf(this->outString_, "%sP37=%d", pAxis->cmdPrefix_, value);
   } else if(pasynUser->reason == encoderSFIWidth_){
-    sprintf(this->outString_, "M%.1fP38=%d", pAxis->axisModuleNo_, value);
+    sprintf(this->outString_, "%sP38=%d", pAxis->cmdPrefix_, value);
   } else if(pasynUser->reason == powerStageMonitor_){
-    sprintf(this->outString_, "M%.1fP53=%d", pAxis->axisModuleNo_, value);
+    sprintf(this->outString_, "%sP53=%d", pAxis->cmdPrefix_, value);
   } else if(pasynUser->reason == currentDelayTime_){
-    sprintf(this->outString_, "M%.1fP43=%d", pAxis->axisModuleNo_, value);
+    sprintf(this->outString_, "%sP43=%d", pAxis->cmdPrefix_, value);
   } else if(pasynUser->reason == encoderDirection_){
-    sprintf(this->outString_, "M%.1fP38=%d", pAxis->axisModuleNo_, value);
+    sprintf(this->outString_, "%sP38=%d", pAxis->cmdPrefix_, value);
   }
 
   phyStatus = sendPhytronCommand(this->outString_, this->inString_, MAX_CONTROLLER_STRING_SIZE, &pAxis->response_len);
@@ -389,9 +399,9 @@ asynStatus phytronController::readFloat64(asynUser *pasynUser, epicsFloat64 *val
   asynPortDriver::readFloat64(pasynUser, value);
 
   if(pasynUser->reason == powerStageTemp_){
-    sprintf(this->outString_, "M%.1fP49R", pAxis->axisModuleNo_);
+    sprintf(this->outString_, "%sP49R", pAxis->cmdPrefix_);
   } else if(pasynUser->reason == motorTemp_){
-    sprintf(this->outString_, "M%.1fP54R", pAxis->axisModuleNo_);
+    sprintf(this->outString_, "%sP54R", pAxis->cmdPrefix_);
   }
 
   phyStatus = sendPhytronCommand(this->outString_, this->inString_, MAX_CONTROLLER_STRING_SIZE, &pAxis->response_len);
@@ -429,9 +439,14 @@ void phytronController::resetAxisEncoderRatio(){
   */
 void phytronController::report(FILE *fp, int level)
 {
-  fprintf(fp, "MCB-4B motor driver %s, numAxes=%d, moving poll period=%f, idle poll period=%f\n",
+  fprintf(fp, "Phytron motor driver %s, numAxes=%d, moving poll period=%f, idle poll period=%f\n",
     this->portName, numAxes_, movingPollPeriod_, idlePollPeriod_);
 
+  if (level > 0) {
+    fprintf(fp, "  %lu polls, max poll time %.3f ms\n", pollTimes_.count(), pollTimes_.maxTime() * 1000.);
+    pollTimes_.report(fp, "poll time");
+  }
+
   // Call the base class method
   asynMotorController::report(fp, level);
 }
@@ -483,9 +498,24 @@ phytronStatus phytronController::sendPhytronCommand(const char *command, char *r
         return status;
     }
 
-    char* nack_ack = strchr(buffer,0x02); //Find STX
+    return parsePhytronReply(buffer, response_buffer, response_max_len, nread);
+}
+
+/**
+ * @brief extracts the payload of a reply telegram
+ * @param reply             Reply as read from the controller
+ * @param response_buffer   Receives the payload, NULL terminated
+ * @param response_max_len  Size of response_buffer
+ * @param nread             Length of the payload
+ * @return phytronInvalidReturn if the reply is not a telegram, phytronInvalidCommand on NAK
+ */
+phytronStatus phytronController::parsePhytronReply(const char *reply, char *response_buffer, size_t response_max_len, size_t *nread)
+{
+    static const char *functionName = "phytronController::parsePhytronReply";
+
+    const char* nack_ack = strchr(reply,0x02); //Find STX
     if(!nack_ack){
-        nread=0;
+        *nread=0;
         asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
           "%s: Communication failed\n",
           functionName);
@@ -494,29 +524,116 @@ phytronStatus phytronController::sendPhytronCommand(const char *command, char *r
     nack_ack++; //NACK/ACK is one
     //ACK, extract response
     if(*nack_ack==0x06){
-        char* separator = strchr(nack_ack,0x3a);          //find separator
+        const char* separator = strchr(nack_ack,0x3a);    //find separator
+        if(!separator){
+            *nread=0;
+            asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
+              "%s: Reply has no separator\n",
+              functionName);
+            return phytronInvalidReturn;
+        }
 
         /* Copy data from nack_ack to
          * separator into buffer */
         uint32_t len = separator-nack_ack-1;              //calculate length of message
-        if(len > response_max_len) len=response_max_len;
+        if(len > response_max_len-1) len=response_max_len-1;
 
         memcpy(response_buffer,nack_ack+1,len);           //copy payload to destination
-        response_buffer[separator-nack_ack-1]=0;          //Add NULL terminator
+        response_buffer[len]=0;                           //Add NULL terminator
 
         *nread=strlen(response_buffer);
     }
     //NAK return error
     else if(*nack_ack==0x15){
-        nread=0;
+        *nread=0;
         asynPrint(this->pasynUserSelf, ASYN_TRACE_ERROR,
           "%s: Nack sent by the controller\n",
           functionName);
         return phytronInvalidCommand;
     }
 
-    return status;
+    return phytronSuccess;
+
+}
+
+/** Reads the status of all axes.
+  * The P20R, P22R, ==H and SE telegrams of up to PHYTRON_POLL_AXES axes are written in one
+  * pipelined burst and the replies are cached in the axes, which phytronAxis::poll then publishes.
+  * The time of each poll is entered into the histogram printed by report().
+  */
+asynStatus phytronController::poll()
+{
+  asynMotorBurst burst;
+  phytronAxis *pending[PHYTRON_POLL_AXES];
+  epicsTimeStamp start, end;
+  phytronStatus phyStatus = phytronSuccess;
+  phytronStatus status;
+  double elapsed;
+  int n = 0;
+
+  epicsTimeGetCurrent(&start);
+  for(uint32_t i = 0; i < axes.size(); i++){
+    if(n == PHYTRON_POLL_AXES){
+      if((status = readAxesStatus(&burst, pending, n))) phyStatus = status;
+      n = 0;
+    }
+    pending[n++] = axes[i];
+  }
+  if(n > 0 && (status = readAxesStatus(&burst, pending, n))) phyStatus = status;
+  epicsTimeGetCurrent(&end);
+
+  elapsed = epicsTimeDiffInSeconds(&end, &start);
+  pollTimes_.add(elapsed);
+
+  return phyToAsyn(phyStatus);
+}
+
+/** Reads the status telegrams of numAxes axes in one burst.
+  * \param[in] pBurst   Burst to use
+  * \param[in] pAxes    Axes to read
+  * \param[in] numAxes  Number of axes, at most PHYTRON_POLL_AXES
+  */
+phytronStatus phytronController::readAxesStatus(asynMotorBurst *pBurst, phytronAxis **pAxes, int numAxes)
+{
+  char response[MAX_BURST_STRING_SIZE];
+  size_t nread;
+  phytronStatus phyStatus = phytronSuccess;
+  phytronStatus status;
+  phytronAxis *pAxis;
+  int i, j;
+
+  pBurst->clear();
+  for(i = 0; i < numAxes; i++){
+    pBurst->add(PHYTRON_TELEGRAM("%sP20R"), pAxes[i]->cmdPrefix_);  //Motor position
+    pBurst->add(PHYTRON_TELEGRAM("%sP22R"), pAxes[i]->cmdPrefix_);  //Encoder position
+    pBurst->add(PHYTRON_TELEGRAM("%s==H"), pAxes[i]->cmdPrefix_);   //Moving status
+    pBurst->add(PHYTRON_TELEGRAM("%sSE"), pAxes[i]->cmdPrefix_);    //Axis status
+  }
+
+  //The burst stops at the first failure, the axes of the later commands get its status
+  phyStatus = (phytronStatus) writeReadBurst(pBurst, timeout_);
+
+  for(i = 0; i < numAxes; i++){
+    pAxis = pAxes[i];
+    pAxis->pollStatus_ = phytronSuccess;
+    for(j = 0; j < PHYTRON_POLL_COMMANDS; j++){
+      status = (phytronStatus) pBurst->status(i*PHYTRON_POLL_COMMANDS + j);
+      if(!status) status = parsePhytronReply(pBurst->reply(i*PHYTRON_POLL_COMMANDS + j), response, sizeof(response), &nread);
+      if(status){
+        pAxis->pollStatus_ = status;
+        if(!phyStatus) phyStatus = status;
+        break;
+      }
+      switch(j){
+        case 0: pAxis->position_ = atof(response); break;
+        case 1: pAxis->encoderPosition_ = atof(response); break;
+        case 2: pAxis->moving_ = (response[0] == 'E') ? false : true; break;
+        case 3: pAxis->statusByte_ = atoi(response); break;
+      }
+    }
+  }
 
+  return phyStatus;
 }
 
 /** Castst phytronStatus to asynStatus enumeration
@@ -571,8 +688,14 @@ phytronAxis::phytronAxis(phytronController *pC, int axisNo)
   : asynMotorAxis(pC, axisNo),
     axisModuleNo_((float)axisNo/10),
     pC_(pC),
-    response_len(0)
+    response_len(0),
+    pollStatus_(phytronSuccess),
+    position_(0.),
+    encoderPosition_(0.),
+    moving_(false),
+    statusByte_(0)
 {
+  sprintf(cmdPrefix_, "M%.1f", axisModuleNo_);
 
   //Controller always supports encoder. Encoder enable/disable is set through UEIP
   setIntegerParam(pC_->motorStatusHasEncoder_, 1);
@@ -640,19 +763,19 @@ phytronStatus phytronAxis::setVelocity(double minVelocity, double maxVelocity, i
 
   if(moveType == stdMove){
     //Set maximum velocity (P14)
-    sprintf(pC_->outString_, "M%.1fP14=%f", axisModuleNo_, maxVelocity);
+    sprintf(pC_->outString_, "%sP14=%f", cmdPrefix_, maxVelocity);
     maxStatus = pC_->sendPhytronCommand(pC_->outString_, pC_->inString_, MAX_CONTROLLER_STRING_SIZE, &this->response_len);
 
     //Set minimum velocity (P04)
-    sprintf(pC_->outString_, "M%.1fP04=%f", axisModuleNo_, minVelocity);
+    sprintf(pC_->outString_, "%sP04=%f", cmdPrefix_, minVelocity);
     minStatus = pC_->sendPhytronCommand(pC_->outString_, pC_->inString_, MAX_CONTROLLER_STRING_SIZE, &this->response_len);
   } else if (moveType == homeMove){
     //Set maximum velocity (P08)
-    sprintf(pC_->outString_, "M%.1fP08=%f", axisModuleNo_, maxVelocity);
+    sprintf(pC_->outString_, "%sP08=%f", cmdPrefix_, maxVelocity);
     maxStatus = pC_->sendPhytronCommand(pC_->outString_, pC_->inString_, MAX_CONTROLLER_STRING_SIZE, &this->response_len);
 
     //Set minimum velocity (P10)
-    sprintf(pC_->outString_, "M%.1fP10=%f", axisModuleNo_, minVelocity);
+    sprintf(pC_->outString_, "%sP10=%f", cmdPrefix_, minVelocity);
     minStatus = pC_->sendPhytronCommand(pC_->outString_, pC_->inString_, MAX_CONTROLLER_STRING_SIZE, &this->response_len);
   }
 
@@ -678,11 +801,11 @@ phytronStatus phytronAxis::setAcceleration(double acceleration, int moveType)
   }
 
   if (moveType == stdMove){
-    sprintf(pC_->outString_, "M%.1fP15=%f", axisModuleNo_, acceleration);
+    sprintf(pC_->outString_, "%sP15=%f", cmdPrefix_, acceleration);
   } else if(moveType == homeMove){
-    sprintf(pC_->outString_, "M%.1fP09=%f", axisModuleNo_, acceleration);
+    sprintf(pC_->outString_, "%sP09=%f", cmdPrefix_, acceleration);
   } else if (moveType == stopMove){
-    sprintf(pC_->outString_, "M%.1fP07=%f", axisModuleNo_, acceleration);
+    sprintf(pC_->outString_, "%sP07=%f", cmdPrefix_, acceleration);
   }
 
   return pC_->sendPhytronCommand(pC_->outString_, pC_->inString_, MAX_CONTROLLER_STRING_SIZE, &this->response_len);
@@ -718,9 +841,9 @@ asynStatus phytronAxis::move(double position, int relative, double minVelocity,
   }
 
   if (relative) {
-    sprintf(pC_->outString_, "M%.1f%c%d", axisModuleNo_, position>0 ? '+':'-', abs(NINT(position)));
+    sprintf(pC_->outString_, "%s%c%d", cmdPrefix_, position>0 ? '+':'-', abs(NINT(position)));
   } else {
-    sprintf(pC_->outString_, "M%.1fA%d", axisModuleNo_, NINT(position));
+    sprintf(pC_->outString_, "%sA%d", cmdPrefix_, NINT(position));
   }
 
   phyStatus = pC_->sendPhytronCommand(pC_->outString_, pC_->inString_, MAX_CONTROLLER_STRING_SIZE, &this->response_len);
@@ -763,23 +886,23 @@ asynStatus phytronAxis::home(double minVelocity, double maxVelocity, double acce
   }
 
   if(forwards){
-    if(homingType == limit) sprintf(pC_->outString_, "M%.1fR+", axisModuleNo_);
-    else if(homingType == center) sprintf(pC_->outString_, "M%.1fR+C", axisModuleNo_);
-    else if(homingType == encoder) sprintf(pC_->outString_, "M%.1fR+I", axisModuleNo_);
-    else if(homingType == limitEncoder) sprintf(pC_->outString_, "M%.1fR+^I", axisModuleNo_);
-    else if(homingType == centerEncoder) sprintf(pC_->outString_, "M%.1fR+C^I", axisModuleNo_);
+    if(homingType == limit) sprintf(pC_->outString_, "%sR+", cmdPrefix_);
+    else if(homingType == center) sprintf(pC_->outString_, "%sR+C", cmdPrefix_);
+    else if(homingType == encoder) sprintf(pC_->outString_, "%sR+I", cmdPrefix_);
+    else if(homingType == limitEncoder) sprintf(pC_->outString_, "%sR+^I", cmdPrefix_);
+    else if(homingType == centerEncoder) sprintf(pC_->outString_, "%sR+C^I", cmdPrefix_);
     //Homing procedures for rotational movements (no hardware limit switches)
-    else if(homingType == referenceCenter) sprintf(pC_->outString_, "M%.1fRC+", axisModuleNo_);
-    else if(homingType == referenceCenterEncoder) sprintf(pC_->outString_, "M%.1fRC+^I", axisModuleNo_);
+    else if(homingType == referenceCenter) sprintf(pC_->outString_, "%sRC+", cmdPrefix_);
+    else if(homingType == referenceCenterEncoder) sprintf(pC_->outString_, "%sRC+^I", cmdPrefix_);
   } else {
-    if(homingType == limit) sprintf(pC_->outString_, "M%.1fR-", axisModuleNo_);
-    else if(homingType == center) sprintf(pC_->outString_, "M%.1fR-C", axisModuleNo_);
-    else if(homingType == encoder) sprintf(pC_->outString_, "M%.1fR-I", axisModuleNo_);
-    else if(homingType == limitEncoder) sprintf(pC_->outString_, "M%.1fR-^I", axisModuleNo_);
-    else if(homingType == centerEncoder) sprintf(pC_->outString_, "M%.1fR-C^I", axisModuleNo_);
+    if(homingType == limit) sprintf(pC_->outString_, "%sR-", cmdPrefix_);
+    else if(homingType == center) sprintf(pC_->outString_, "%sR-C", cmdPrefix_);
+    else if(homingType == encoder) sprintf(pC_->outString_, "%sR-I", cmdPrefix_);
+    else if(homingType == limitEncoder) sprintf(pC_->outString_, "%sR-^I", cmdPrefix_);
+    else if(homingType == centerEncoder) sprintf(pC_->outString_, "%sR-C^I", cmdPrefix_);
     //Homing procedures for rotational movements (no hardware limit switches)
-    else if(homingType == referenceCenter) sprintf(pC_->outString_, "M%.1fRC-", axisModuleNo_);
-    else if(homingType == referenceCenterEncoder) sprintf(pC_->outString_, "M%.1fRC-^I", axisModuleNo_);
+    else if(homingType == referenceCenter) sprintf(pC_->outString_, "%sRC-", cmdPrefix_);
+    else if(homingType == referenceCenterEncoder) sprintf(pC_->outString_, "%sRC-^I", cmdPrefix_);
   }
 
   phyStatus = pC_->sendPhytronCommand(pC_->outString_, pC_->inString_, MAX_CONTROLLER_STRING_SIZE, &this->response_len);
@@ -817,9 +940,9 @@ asynStatus phytronAxis::moveVelocity(double minVelocity, double maxVelocity, dou
   }
 
   if(maxVelocity < 0) {
-    sprintf(pC_->outString_, "M%.1fL-", axisModuleNo_);
+    sprintf(pC_->outString_, "%sL-", cmdPrefix_);
   } else {
-    sprintf(pC_->outString_, "M%.1fL+", axisModuleNo_);
+    sprintf(pC_->outString_, "%sL+", cmdPrefix_);
   }
 
   phyStatus = pC_->sendPhytronCommand(pC_->outString_, pC_->inString_, MAX_CONTROLLER_STRING_SIZE, &this->response_len);
@@ -847,7 +970,7 @@ asynStatus phytronAxis::stop(double acceleration)
             "error code: %d!\n", axisNo_, acceleration, phyStatus);
   }
 
-  sprintf(pC_->outString_, "M%.1fS", axisModuleNo_);
+  sprintf(pC_->outString_, "%sS", cmdPrefix_);
   phyStatus = pC_->sendPhytronCommand(pC_->outString_, pC_->inString_, MAX_CONTROLLER_STRING_SIZE, &this->response_len);
   if(phyStatus){
     asynPrint(pC_->pasynUserSelf, ASYN_TRACE_ERROR,
@@ -863,7 +986,7 @@ asynStatus phytronAxis::setEncoderRatio(double ratio){
 
   phytronStatus phyStatus;
 
-  sprintf(pC_->outString_, "M%.1fP39=%f", axisModuleNo_, 1/ratio);
+  sprintf(pC_->outString_, "%sP39=%f", cmdPrefix_, 1/ratio);
   phyStatus = pC_->sendPhytronCommand(pC_->outString_, pC_->inString_, MAX_CONTROLLER_STRING_SIZE, &this->response_len);
   if(phyStatus){
     asynPrint(pC_->pasynUserSelf, ASYN_TRACE_ERROR,
@@ -889,7 +1012,7 @@ asynStatus phytronAxis::setPosition(double position)
 {
   phytronStatus phyStatus = phytronSuccess;
 
-  sprintf(pC_->outString_, "M%.1fP20=%f", axisModuleNo_, position);
+  sprintf(pC_->outString_, "%sP20=%f", cmdPrefix_, position);
   phyStatus = pC_->sendPhytronCommand(pC_->outString_, pC_->inString_, MAX_CONTROLLER_STRING_SIZE, &this->response_len);
   if(phyStatus){
     asynPrint(pC_->pasynUserSelf, ASYN_TRACE_ERROR,
@@ -901,44 +1024,27 @@ asynStatus phytronAxis::setPosition(double position)
 }
 
 /** Polls the axis.
-  * This function reads the motor position, the limit status, the home status, the moving status,
-  * and the drive power-on status.
+  * This function publishes the motor position, the limit status, the home status, the moving status,
+  * and the drive power-on status, which phytronController::poll has read for all axes.
   * It calls setIntegerParam() and setDoubleParam() for each item that it polls,
   * and then calls callParamCallbacks() at the end.
   * \param[out] moving A flag that is set indicating that the axis is moving (true) or done (false).
   */
 asynStatus phytronAxis::poll(bool *moving)
 {
-  int axisStatus;
-  double position;
-  double encoderPosition;
   double encoderRatio;
-  phytronStatus phyStatus;
 
-  // Read the current motor position
-  sprintf(pC_->outString_, "M%.1fP20R", axisModuleNo_);
-  phyStatus = pC_->sendPhytronCommand(pC_->outString_, pC_->inString_, MAX_CONTROLLER_STRING_SIZE, &this->response_len);
-  if(phyStatus){
-    setIntegerParam(pC_->motorStatusProblem_, 1);
-    callParamCallbacks();
-    asynPrint(pC_->pasynUserSelf, ASYN_TRACE_ERROR,
-             "phytronAxis::poll: Reading axis position failed for axis: %d!\n", axisNo_);
-    return pC_->phyToAsyn(phyStatus);
-  }
-  position = atof(pC_->inString_);
-  setDoubleParam(pC_->motorPosition_, position);
+  *moving = moving_;
 
-  // Read the current encoder value
-  sprintf(pC_->outString_, "M%.1fP22R", axisModuleNo_);
-  phyStatus = pC_->sendPhytronCommand(pC_->outString_, pC_->inString_, MAX_CONTROLLER_STRING_SIZE, &this->response_len);
-  if(phyStatus){
+  if(pollStatus_){
     setIntegerParam(pC_->motorStatusProblem_, 1);
     callParamCallbacks();
     asynPrint(pC_->pasynUserSelf, ASYN_TRACE_ERROR,
-             "phytronAxis::poll: Reading encoder value failed for axis: %d!\n", axisNo_);
-    return pC_->phyToAsyn(phyStatus);
+             "phytronAxis::poll: Reading axis status failed for axis: %d!\n", axisNo_);
+    return pC_->phyToAsyn(pollStatus_);
   }
-  encoderPosition = atof(pC_->inString_);
+
+  setDoubleParam(pC_->motorPosition_, position_);
 
   /*
    * The encoder position returned by the controller is weighted by the controller
@@ -946,42 +1052,21 @@ asynStatus phytronAxis::poll(bool *moving)
    * multiplied by the encoder resolution.
    */
   pC_->getDoubleParam(axisNo_, pC_->motorEncoderRatio_, &encoderRatio);
-  setDoubleParam(pC_->motorEncoderPosition_, encoderPosition*encoderRatio);
+  setDoubleParam(pC_->motorEncoderPosition_, encoderPosition_*encoderRatio);
 
-  // Read the moving status of this motor
-  sprintf(pC_->outString_, "M%.1f==H", axisModuleNo_);
-  phyStatus = pC_->sendPhytronCommand(pC_->outString_, pC_->inString_, MAX_CONTROLLER_STRING_SIZE, &this->response_len);
-  if(phyStatus){
-    setIntegerParam(pC_->motorStatusProblem_, 1);
-    callParamCallbacks();
-    asynPrint(pC_->pasynUserSelf, ASYN_TRACE_ERROR,
-              "phytronAxis::poll: Reading axis moving status failed for axis: %d!\n", axisNo_);
-    return pC_->phyToAsyn(phyStatus);
-  }
-  *moving = (pC_->inString_[0] == 'E') ? 0:1;
   setIntegerParam(pC_->motorStatusDone_, !*moving);
 
-  sprintf(pC_->outString_, "M%.1fSE", axisModuleNo_);
-  phyStatus = pC_->sendPhytronCommand(pC_->outString_, pC_->inString_, MAX_CONTROLLER_STRING_SIZE, &this->response_len);
-  if(phyStatus){
-    setIntegerParam(pC_->motorStatusProblem_, 1);
-    callParamCallbacks();
-    asynPrint(pC_->pasynUserSelf, ASYN_TRACE_ERROR,
-             "phytronAxis::poll: Reading axis status failed for axis: %d!\n", axisNo_);
-    return pC_->phyToAsyn(phyStatus);
-  }
-  axisStatus = atoi(pC_->inString_);
-  setIntegerParam(pC_->motorStatusHighLimit_, (axisStatus & 0x10)/0x10);
-  setIntegerParam(pC_->motorStatusLowLimit_, (axisStatus & 0x20)/0x20);
-  setIntegerParam(pC_->motorStatusAtHome_, (axisStatus & 0x40)/0x40);
+  setIntegerParam(pC_->motorStatusHighLimit_, (statusByte_ & 0x10)/0x10);
+  setIntegerParam(pC_->motorStatusLowLimit_, (statusByte_ & 0x20)/0x20);
+  setIntegerParam(pC_->motorStatusAtHome_, (statusByte_ & 0x40)/0x40);
 
-  setIntegerParam(pC_->motorStatusHomed_, (axisStatus & 0x08)/0x08);
-  setIntegerParam(pC_->motorStatusHome_, (axisStatus & 0x08)/0x08);
+  setIntegerParam(pC_->motorStatusHomed_, (statusByte_ & 0x08)/0x08);
+  setIntegerParam(pC_->motorStatusHome_, (statusByte_ & 0x08)/0x08);
 
-  setIntegerParam(pC_->motorStatusSlip_, (axisStatus & 0x4000)/0x4000);
+  setIntegerParam(pC_->motorStatusSlip_, (statusByte_ & 0x4000)/0x4000);
 
   //Update the axis status record ($(P)$(M)_STATUS)
-  setIntegerParam(pC_->axisStatus_, axisStatus);
+  setIntegerParam(pC_->axisStatus_, statusByte_);
 
   //No problem occurred
   setIntegerParam(pC_->motorStatusProblem_, 0);
@@ -9,6 +9,7 @@ Cosylab d.d. 2014
 
 #include "asynMotorController.h"
 #include "asynMotorAxis.h"
+#include "asynMotorHistogram.h"
 
 
 //Number of controller specific parameters
@@ -20,6 +21,10 @@ Cosylab d.d. 2014
 #define MAX_ACCELERATION  500000  // steps/s^2
 #define MIN_ACCELERATION  4000    // steps/s^2
 
+//Telegrams per axis in the status burst of phytronController::poll (P20R, P22R, ==H, SE)
+#define PHYTRON_POLL_COMMANDS   4
+#define PHYTRON_POLL_AXES       (MAX_BURST_COMMANDS/PHYTRON_POLL_COMMANDS)
+
 //Controller parameters
 #define controllerStatusString      "CONTROLLER_STATUS"
 #define controllerStatusResetString "CONTROLLER_STATUS_RESET"
@@ -98,6 +103,7 @@ public:
   asynStatus setEncoderPosition(double position);
 
   float axisModuleNo_; //Used by sprintf to form commands
+  char cmdPrefix_[16];  //"M<module>.<axis>", formatted once from axisModuleNo_
 
 private:
   phytronController *pC_;          /**< Pointer to the asynMotorController to which this axis belongs.
@@ -108,6 +114,13 @@ private:
 
   size_t response_len;
 
+  //Status read by phytronController::poll
+  phytronStatus pollStatus_;
+  double position_;
+  double encoderPosition_;
+  bool moving_;
+  int statusByte_;
+
 friend class phytronController;
 };
 
@@ -121,8 +134,10 @@ public:
   void report(FILE *fp, int level);
   phytronAxis* getAxis(asynUser *pasynUser);
   phytronAxis* getAxis(int axisNo);
+  asynStatus poll();
 
   phytronStatus sendPhytronCommand(const char *command, char *response_buffer, size_t response_max_len, size_t *nread);
+  phytronStatus parsePhytronReply(const char *reply, char *response_buffer, size_t response_max_len, size_t *nread);
 
   void resetAxisEncoderRatio();
 
@@ -165,8 +180,11 @@ protected:
   int controllerStatusReset_;
 
 private:
+  phytronStatus readAxesStatus(asynMotorBurst *pBurst, phytronAxis **pAxes, int numAxes);
+
   double timeout_;
 
+  asynMotorHistogram pollTimes_;
 
 friend class phytronAxis;
 };
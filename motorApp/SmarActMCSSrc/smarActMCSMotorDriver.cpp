@@ -35,6 +35,9 @@
 #define FAR_AWAY     1000000000 /*nm*/
 #define UDEG_PER_REV 360000000
 
+/* Commands per channel in a poll burst (GP or GA, GS) */
+#define POLL_COMMANDS    2
+
 // Windows and vxWorks do not have rint(), but minGW does
 #if defined __MINGW32__ || defined __MINGW64__
 #elif defined _WIN32 || defined vxWorks
@@ -187,6 +190,12 @@ pAxes_ = (SmarActMCSAxis **)(asynMotorController::pAxes_);
 	pasynOctetSyncIO->setInputEos ( asynUserMot_p_, "\n", 1 );
 	pasynOctetSyncIO->setOutputEos( asynUserMot_p_, "\n", 1 );
 
+	// The poller reads all channels with bursts through the base class. The MCS
+	// buffers its input and replies to every command in order, so the commands
+	// of a burst may be written back-to-back, as if they were sent on one line.
+	pasynUserController_ = asynUserMot_p_;
+	setBurstPipelining( true );
+
 	// Create axes
 /*	for ( ax=0; ax<numAxes; ax++ ) {
 		//axis_p = new SmarActMCSAxis(this, ax);
@@ -268,7 +277,18 @@ SmarActMCSAxis::SmarActMCSAxis(class SmarActMCSController *cnt_p, int axis, int
 	int val;
 	int angle;
 	int rev;
-	channel_ = channel;
+	channel_    = channel;
+	pos_        = 0;
+	status_     = -1;
+	ppk_        = 0;
+	needPPK_    = true;
+	moving_     = false;
+	polled_     = false;
+	pollNow_    = true;
+	everPolled_ = false;
+	numPolls_   = 0;
+	numSkips_   = 0;
+	numPPK_     = 0;
 
 	asynPrint(c_p_->pasynUserSelf, ASYN_TRACEIO_DRIVER, "SmarActMCSAxis::SmarActMCSAxis -- creating axis %u\n", axis);
 
@@ -373,49 +393,22 @@ int        ax;
 	return c_p_->parseAngle(rep, &ax, val_p, rev_p) ? asynError: asynSuccess;
 }
 
-asynStatus
-SmarActMCSAxis::poll(bool *moving_p)
+/* Map the channel state (GS) to 'moving'.
+ *
+ * If we use 'infinite' holding (until the next 'move' command)
+ * then the 'Holding' state must be considered 'not moving'. However,
+ * if we use a 'finite' holding time then we probably should consider
+ * the 'move' command incomplete until the holding time expires.
+ */
+bool
+SmarActMCSAxis::statusMoving(int status) const
 {
-int                    val;
-int                    angle;
-int                    rev;
-enum SmarActMCSStatus status;
-
-	if ( isRot_ ) {
-		if ( (comStatus_ = getAngle(&angle, &rev)) )
-			goto bail;
-		// Convert angle and revs to total angle
-		val = rev * UDEG_PER_REV + angle;
-	}
-	else {
-		if ( (comStatus_ = getVal("GP", &val)) )
-			goto bail;
-        }
-
-	setDoubleParam(c_p_->motorEncoderPosition_, (double)val);
-	setDoubleParam(c_p_->motorPosition_, (double)val);
-#ifdef DEBUG
-	printf("POLL (position %d)", val);
-#endif
-
-	if ( (comStatus_ = getVal("GS", &val)) )
-		goto bail;
-
-	status = (enum SmarActMCSStatus)val;
-
-	switch ( status ) {
+	switch ( (enum SmarActMCSStatus)status ) {
 		default:
-			*moving_p = false;
-		break;
+		return false;
 
-		/* If we use 'infinite' holding (until the next 'move' command)
-		 * then the 'Holding' state must be considered 'not moving'. However,
-		 * if we use a 'finite' holding time then we probably should consider
-		 * the 'move' command incomplete until the holding time expires.
-		 */
 		case Holding:
-			*moving_p = HOLD_FOREVER == holdTime_ ? false : true;
-		break;
+		return HOLD_FOREVER == holdTime_ ? false : true;
 
 		case Stepping:
 		case Scanning:
@@ -423,37 +416,217 @@ enum SmarActMCSStatus status;
 		case MoveDelay:
 		case Calibrating:
 		case FindRefMark:
-			*moving_p = true;
-		break;
+		return true;
 	}
+}
 
-	setIntegerParam(c_p_->motorStatusDone_, ! *moving_p );
-
-
-	/* Check if the sensor 'knows' absolute position and
-	 * update the MSTA 'HOMED' bit.
-	 */
-	if ( (comStatus_ = getVal("GPPK", &val)) ) 
-		goto bail;
+/* The channels are read by SmarActMCSController::poll() which runs
+ * before the axes are polled; here we only publish what it read.
+ * A channel that was not scheduled in this cycle keeps its parameters
+ * and reports the moving state of its last read.
+ */
+asynStatus
+SmarActMCSAxis::poll(bool *moving_p)
+{
+	*moving_p = moving_;
 
-	setIntegerParam(c_p_->motorStatusHomed_, val ? 1 : 0 );
+	if ( ! polled_ && ! comStatus_ )
+		return asynSuccess;
 
-#ifdef DEBUG
-	printf(" status %u", status);
-#endif
+	if ( ! comStatus_ ) {
+		setDoubleParam(c_p_->motorEncoderPosition_, (double)pos_);
+		setDoubleParam(c_p_->motorPosition_, (double)pos_);
+		setIntegerParam(c_p_->motorStatusDone_, ! moving_ );
+		/* Does the sensor 'know' the absolute position? -> MSTA 'HOMED' bit */
+		setIntegerParam(c_p_->motorStatusHomed_, ppk_ ? 1 : 0 );
+	}
 
-bail:
 	setIntegerParam(c_p_->motorStatusProblem_,    comStatus_ ? 1 : 0 );
 	setIntegerParam(c_p_->motorStatusCommsError_, comStatus_ ? 1 : 0 );
-#ifdef DEBUG
-	printf("\n");
-#endif
 
 	callParamCallbacks();
 
 	return comStatus_;
 }
 
+/* Read position and state of all channels that are due.
+ *
+ * Moving channels, channels which were just commanded and channels
+ * that failed to communicate are read in every cycle; idle channels
+ * only once per idle poll period. The GP (GA for rotation stages) and
+ * GS commands of up to MAX_BURST_COMMANDS/POLL_COMMANDS channels go
+ * out in one burst. GPPK only changes when the channel changes state
+ * (e.g., at the end of a FRM or after a power cycle) so it is read
+ * in a second burst, only for channels whose state changed.
+ */
+asynStatus
+SmarActMCSController::poll()
+{
+asynMotorBurst  burst;
+SmarActMCSAxis *due[MAX_BURST_COMMANDS];
+SmarActMCSAxis *axis_p;
+epicsTimeStamp  now;
+asynStatus      status = asynSuccess;
+asynStatus      st;
+int             ax, n;
+
+	epicsTimeGetCurrent( &now );
+
+	for ( ax = 0, n = 0; ax < numAxes_; ax++ ) {
+		if ( ! (axis_p = pAxes_[ax]) )
+			continue;
+		axis_p->polled_ = false;
+		/* allow for jitter of the poller; half a fast period early is good enough */
+		if (    ! axis_p->moving_ && ! axis_p->pollNow_ && ! axis_p->comStatus_
+		     && axis_p->everPolled_
+		     && epicsTimeDiffInSeconds( &now, &axis_p->lastPoll_ ) < idlePollPeriod_ - 0.5*movingPollPeriod_ ) {
+			axis_p->numSkips_++;
+			continue;
+		}
+		if ( n + 1 > MAX_BURST_COMMANDS/POLL_COMMANDS ) {
+			if ( (st = readChannels( &burst, due, n, &now )) )
+				status = st;
+			n = 0;
+		}
+		due[n++] = axis_p;
+	}
+	if ( n > 0 && (st = readChannels( &burst, due, n, &now )) )
+		status = st;
+
+	for ( ax = 0, n = 0; ax < numAxes_; ax++ ) {
+		if ( ! (axis_p = pAxes_[ax]) || ! axis_p->polled_ || ! axis_p->needPPK_ )
+			continue;
+		if ( n >= MAX_BURST_COMMANDS ) {
+			if ( (st = readPPK( &burst, due, n )) )
+				status = st;
+			n = 0;
+		}
+		due[n++] = axis_p;
+	}
+	if ( n > 0 && (st = readPPK( &burst, due, n )) )
+		status = st;
+
+	return status;
+}
+
+/* Read GP/GA and GS of n channels in one burst and update the
+ * cache of their axes.
+ *
+ * The burst stops at the first command that fails; the channels of that
+ * command and of all later ones keep comStatus_ set, so they are read
+ * again in the next cycle. Returns the status of the burst.
+ */
+asynStatus
+SmarActMCSController::readChannels(asynMotorBurst *burst_p, SmarActMCSAxis **axes_p, int n, epicsTimeStamp *now_p)
+{
+SmarActMCSAxis *axis_p;
+asynStatus      status;
+int             i, ch, pos, angle, rev, state;
+
+	burst_p->clear();
+	for ( i = 0; i < n; i++ ) {
+		burst_p->add( axes_p[i]->isRot_ ? ":GA%u" : ":GP%u", axes_p[i]->channel_ );
+		burst_p->add( ":GS%u", axes_p[i]->channel_ );
+	}
+
+	status = writeReadBurst( burst_p, DEFLT_TIMEOUT );
+
+	for ( i = 0; i < n; i++ ) {
+		axis_p = axes_p[i];
+
+		if ( (axis_p->comStatus_ = burst_p->status( POLL_COMMANDS*i )) )
+			continue;
+		if ( (axis_p->comStatus_ = burst_p->status( POLL_COMMANDS*i + 1 )) )
+			continue;
+
+		if ( axis_p->isRot_ ) {
+			if ( parseAngle( burst_p->reply( POLL_COMMANDS*i ), &ch, &angle, &rev ) || ch != axis_p->channel_ ) {
+				axis_p->comStatus_ = asynError;
+				continue;
+			}
+			// Convert angle and revs to total angle
+			pos = rev * UDEG_PER_REV + angle;
+		} else {
+			if ( parseReply( burst_p->reply( POLL_COMMANDS*i ), &ch, &pos ) || ch != axis_p->channel_ ) {
+				axis_p->comStatus_ = asynError;
+				continue;
+			}
+		}
+
+		if ( parseReply( burst_p->reply( POLL_COMMANDS*i + 1 ), &ch, &state ) || ch != axis_p->channel_ ) {
+			axis_p->comStatus_ = asynError;
+			continue;
+		}
+
+		if ( state != axis_p->status_ )
+			axis_p->needPPK_ = true;
+
+		axis_p->pos_        = pos;
+		axis_p->status_     = state;
+		axis_p->moving_     = axis_p->statusMoving( state );
+		axis_p->polled_     = true;
+		axis_p->pollNow_    = false;
+		axis_p->everPolled_ = true;
+		axis_p->lastPoll_   = *now_p;
+		axis_p->numPolls_++;
+	}
+
+	return status;
+}
+
+/* Read GPPK of n channels in one burst; channels that fail keep
+ * needPPK_ set and are read again in the next cycle. Returns the
+ * status of the burst.
+ */
+asynStatus
+SmarActMCSController::readPPK(asynMotorBurst *burst_p, SmarActMCSAxis **axes_p, int n)
+{
+SmarActMCSAxis *axis_p;
+asynStatus      status;
+int             i, ch, val;
+
+	burst_p->clear();
+	for ( i = 0; i < n; i++ )
+		burst_p->add( ":GPPK%u", axes_p[i]->channel_ );
+
+	status = writeReadBurst( burst_p, DEFLT_TIMEOUT );
+
+	for ( i = 0; i < n; i++ ) {
+		axis_p = axes_p[i];
+		if ( (axis_p->comStatus_ = burst_p->status( i )) )
+			continue;
+		if ( parseReply( burst_p->reply( i ), &ch, &val ) || ch != axis_p->channel_ ) {
+			axis_p->comStatus_ = asynError;
+			continue;
+		}
+		axis_p->ppk_     = val;
+		axis_p->needPPK_ = false;
+		axis_p->numPPK_++;
+	}
+
+	return status;
+}
+
+void
+SmarActMCSController::report(FILE *fp, int level)
+{
+SmarActMCSAxis *axis_p;
+int             ax;
+
+	if ( level > 0 ) {
+		fprintf(fp, "SmarActMCSController %s: channel polls (idle period %g s)\n", portName, idlePollPeriod_);
+		for ( ax = 0; ax < numAxes_; ax++ ) {
+			if ( ! (axis_p = pAxes_[ax]) )
+				continue;
+			fprintf(fp, "  axis %d channel %d: state %d, %s, %lu reads, %lu skipped, %lu GPPK reads\n",
+			        ax, axis_p->channel_, axis_p->status_, axis_p->moving_ ? "moving" : "idle",
+			        axis_p->numPolls_, axis_p->numSkips_, axis_p->numPPK_);
+		}
+	}
+
+	asynMotorController::report(fp, level);
+}
+
 asynStatus
 SmarActMCSAxis::moveCmd(const char *fmt, ...)
 {
@@ -538,6 +711,7 @@ int rev;
 	} else {
 		comStatus_ = moveCmd(fmt, channel_, (long)rpos, holdTime_);
 	}
+	pollSoon();
 
 bail:
 	if ( comStatus_ ) {
@@ -563,6 +737,7 @@ SmarActMCSAxis::home(double min_vel, double max_vel, double accel, int forwards)
 	holdTime_  = getClosedLoop() ? HOLD_FOREVER : 0;
 
 	comStatus_ = moveCmd(":FRM%u,%u,%d,%d", channel_, forwards ? 0 : 1, holdTime_, isRot_ ? 1 : 0);
+	pollSoon();
 
 bail:
 	if ( comStatus_ ) {
@@ -580,6 +755,7 @@ SmarActMCSAxis::stop(double acceleration)
 	printf("Stop\n");
 #endif
 	comStatus_ = moveCmd(":S%u", channel_);
+	pollSoon();
 
 	if ( comStatus_ ) {
 		setIntegerParam(c_p_->motorStatusProblem_, 1);
@@ -607,6 +783,7 @@ double rpos;
 	} else {
 		comStatus_ = moveCmd(":SP%u,%d", channel_, (long)rpos);
 	}
+	pollSoon();
 
 	if ( comStatus_ ) {
 		setIntegerParam(c_p_->motorStatusProblem_,    1);
@@ -649,6 +826,7 @@ long       tgt_pos = FAR_AWAY;
 		goto bail;
 
 	comStatus_ = moveCmd(":MPR%u,%ld,0", channel_, tgt_pos);
+	pollSoon();
 
 bail:
 	if ( comStatus_ ) {
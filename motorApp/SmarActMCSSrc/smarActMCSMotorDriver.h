@@ -11,6 +11,7 @@
 
 #include <asynMotorController.h>
 #include <asynMotorAxis.h>
+#include <epicsTime.h>
 #include <stdarg.h>
 #include <exception>
 
@@ -57,9 +58,11 @@ public:
 	virtual int        getClosedLoop();
 
 	int         getVel() const { return vel_; }
+	bool        statusMoving(int status) const;
 
 protected:
 	asynStatus  setSpeed(double velocity);
+	void        pollSoon() { pollNow_ = true; }
 
 private:
 	SmarActMCSController   *c_p_;  // pointer to asynMotorController for this axis
@@ -69,6 +72,19 @@ private:
 	int                    channel_;
 	int                    sensorType_;
 	int                    isRot_;
+	// Cache filled by SmarActMCSController::poll()
+	int                    pos_;          // position (or total angle) from GP/GA
+	int                    status_;       // channel state from GS, -1 if never read
+	int                    ppk_;          // 'physical position known' from GPPK
+	bool                   needPPK_;      // GPPK must be re-read (state changed)
+	bool                   moving_;       // moving state from the last GS
+	bool                   polled_;       // channel was read in this poll cycle
+	bool                   pollNow_;      // read the channel in the next cycle
+	bool                   everPolled_;   // lastPoll_ is valid
+	epicsTimeStamp         lastPoll_;
+	unsigned long          numPolls_;
+	unsigned long          numSkips_;
+	unsigned long          numPPK_;
 
 friend class SmarActMCSController;
 };
@@ -85,9 +101,15 @@ public:
 	static int parseReply(const char *reply, int *ax_p, int *val_p);
 	static int parseAngle(const char *reply, int *ax_p, int *val_p, int *rot_p);
 
+	asynStatus poll();
+	void       report(FILE *fp, int level);
+
 protected:
 	SmarActMCSAxis **pAxes_;
 
+	asynStatus readChannels(asynMotorBurst *burst_p, SmarActMCSAxis **axes_p, int n, epicsTimeStamp *now_p);
+	asynStatus readPPK(asynMotorBurst *burst_p, SmarActMCSAxis **axes_p, int n);
+
 private:
 	asynUser *asynUserMot_p_;
 friend class SmarActMCSAxis;